@@ -0,0 +1,776 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+
+//Benchmarks of fty-service-status:
+// - call path: load of a plugin, creation of a provider, set() through a no-op plugin with and without the statistics
+//   of the calls, setForAll over 1 to 256 plugins and the memory of the collections of these plugins
+// - startup of a service: discovery and load of folders of synthetic plugins
+// - monitor reading the status of many services: files of the example plugin against the shared memory board
+// - updates of the file plugins: example plugin against the status file plugin
+// - load of the status socket aggregator: thousands of services sending their status to one aggregator
+// - journal of the transitions: rate of the updates for each sync policy and restore of the last status
+// - static plugins: startup and setForAll of a plugin linked in the service against the same plugin loaded with dlopen
+// - keepalive: timers of the hierarchical wheel and re-assertion of the status of many services by one scheduler
+// - component tree: update of the Health State of one component among 100 to 100000, rolled up to the service
+// - status accounting: setForAll with and without the accounting of the time in each status, and its snapshot
+// - isolated plugins: setForAll through the ring of a host process against the same plugin loaded in the service
+//
+//Usage: fty-service-status-bench [name prefix]
+//Output (CSV): "name,size,iterations,ns_per_iteration", the best of several runs.
+//The */bytes measures give a number of bytes instead of a time.
+//The size is the number of plugins, services or updates of the measure.
+
+#include <fty_service_status_isolated.h>
+#include <fty_service_status_keepalive.h>
+#include <shm_board_reader.h>
+#include <status_file_record.h>
+#include <status_aggregator.h>
+#include <static_memory_plugin.h>
+#include <status_journal_layout.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <regex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <dlfcn.h>
+#include <malloc.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+using Clock = std::chrono::steady_clock;
+
+static std::string gFilter;
+static const unsigned REPEAT = 5;
+
+//bytes allocated with the global operator new and not released, by the benchmarks and the plugins
+static std::atomic<std::int64_t> gHeapBytes(0);
+
+void * operator new(std::size_t size) {
+    void * ptr = std::malloc(size == 0 ? 1 : size);
+    if(ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    gHeapBytes.fetch_add(static_cast<std::int64_t>(malloc_usable_size(ptr)), std::memory_order_relaxed);
+    return ptr;
+}
+
+void operator delete(void * ptr) noexcept {
+    if(ptr != nullptr) {
+        gHeapBytes.fetch_sub(static_cast<std::int64_t>(malloc_usable_size(ptr)), std::memory_order_relaxed);
+        std::free(ptr);
+    }
+}
+
+void operator delete(void * ptr, std::size_t) noexcept {
+    operator delete(ptr);
+}
+
+//folder with copies of a plugin and some files which are not plugins
+class SyntheticPluginFolder
+{
+    private:
+    std::string m_path;
+    std::vector<std::string> m_files;
+
+    void copy(const std::string & source, const std::string & name) {
+        std::ifstream in(source, std::ios::binary);
+        std::ofstream out(m_path + "/" + name, std::ios::binary);
+        out << in.rdbuf();
+        m_files.push_back(m_path + "/" + name);
+    }
+
+    public:
+    SyntheticPluginFolder(const std::string & pluginPath, unsigned plugins, unsigned otherFiles) {
+        char folderTemplate[] = "/tmp/fty-service-status-bench-XXXXXX";
+        if(mkdtemp(folderTemplate) == nullptr) {
+            throw std::runtime_error("Cannot create the folder of synthetic plugins");
+        }
+        m_path = folderTemplate;
+
+        for(unsigned i = 0; i < plugins; i++) {
+            copy(pluginPath, "libsynthetic-" + std::to_string(i) + "-status.so");
+        }
+        for(unsigned i = 0; i < otherFiles; i++) {
+            std::string file = m_path + "/readme-" + std::to_string(i) + ".txt";
+            std::ofstream(file) << "not a plugin";
+            m_files.push_back(file);
+        }
+    }
+
+    ~SyntheticPluginFolder() {
+        for(auto & file : m_files) {
+            unlink(file.c_str());
+        }
+        rmdir(m_path.c_str());
+    }
+
+    const std::string & getPath() const { return m_path; }
+};
+
+//run the function, which does the given number of iterations, and print the best time per iteration
+template<typename Function>
+static void measure(const std::string & name, unsigned size, unsigned iterations, Function function) {
+    if(name.compare(0, gFilter.size(), gFilter) != 0) {
+        return;
+    }
+
+    Clock::duration best = Clock::duration::max();
+    for(unsigned i = 0; i < REPEAT; i++) {
+        Clock::time_point start = Clock::now();
+        function();
+        Clock::duration elapsed = Clock::now() - start;
+        if(elapsed < best) {
+            best = elapsed;
+        }
+    }
+
+    const double nanoseconds = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(best).count());
+    std::cout << name << "," << size << "," << iterations << "," << std::fixed << std::setprecision(1) << (nanoseconds / iterations) << std::endl;
+}
+
+//print a measure which is not a time
+static void report(const std::string & name, unsigned size, std::int64_t value) {
+    if(name.compare(0, gFilter.size(), gFilter) == 0) {
+        std::cout << name << "," << size << ",1," << value << std::endl;
+    }
+}
+
+static void measureCallPath() {
+    measure("wrapper/construct", 1, 100, [] {
+        for(unsigned i = 0; i < 100; i++) {
+            fty::ServiceStatusPluginWrapper plugin(NOOP_PLUGIN_PATH);
+        }
+    });
+
+    measure("wrapper/construct-lazy", 1, 100000, [] {
+        for(unsigned i = 0; i < 100000; i++) {
+            fty::ServiceStatusPluginWrapper plugin(NOOP_PLUGIN_PATH, "noop", fty::LoadMode::Lazy);
+        }
+    });
+
+    fty::ServiceStatusPluginWrapper plugin(NOOP_PLUGIN_PATH);
+
+    measure("wrapper/newServiceStatusProviderPtr", 1, 10000, [&] {
+        for(unsigned i = 0; i < 10000; i++) {
+            fty::ServiceStatusProviderPtr provider = plugin.newServiceStatusProviderPtr("bench-service");
+        }
+    });
+
+    fty::ServiceStatusProviderPtr provider = plugin.newServiceStatusProviderPtr("bench-service");
+    measure("provider/set", 1, 1000000, [&] {
+        for(unsigned i = 0; i < 1000000; i++) {
+            provider->set((i % 2 == 0) ? fty::HealthState::Ok : fty::HealthState::Warning);
+        }
+    });
+
+    //same calls recorded in the statistics of the plugin, the difference is the overhead of the recording
+    fty::detail::CallStats stats;
+    measure("provider/set/stats", 1, 1000000, [&] {
+        for(unsigned i = 0; i < 1000000; i++) {
+            int result = provider->set((i % 2 == 0) ? fty::HealthState::Ok : fty::HealthState::Warning);
+            stats.record(i % 2048, result < 0);
+        }
+    });
+}
+
+static void measureSetForAll() {
+    const unsigned calls = 1000;
+
+    for(unsigned plugins : {1u, 4u, 16u, 64u, 256u}) {
+        SyntheticPluginFolder folder(NOOP_PLUGIN_PATH, plugins, 0);
+
+        //the collection with its providers, the memory of the dynamic loader is not counted
+        const std::int64_t heapBytes = gHeapBytes.load();
+        std::unique_ptr<fty::ServiceStatusPluginWrapperCollection> owner(new fty::ServiceStatusPluginWrapperCollection("bench-service"));
+        fty::ServiceStatusPluginWrapperCollection & collection = *owner;
+        collection.addAll(folder.getPath(), "*status.so");
+        report("setForAll/bytes", plugins, gHeapBytes.load() - heapBytes);
+
+        measure("setForAll/sync", plugins, calls, [&] {
+            for(unsigned i = 0; i < calls; i++) {
+                collection.setForAll((i % 2 == 0) ? fty::HealthState::Ok : fty::HealthState::Warning);
+            }
+        });
+
+        collection.enableChangeSuppression();
+        measure("setForAll/sync/suppressed", plugins, calls, [&] {
+            for(unsigned i = 0; i < calls; i++) {
+                collection.setForAll(fty::HealthState::Ok);
+            }
+        });
+        collection.disableChangeSuppression();
+
+        //the queue is large enough to never drop, the time includes the delivery by the threads
+        collection.enableAsyncDispatch(calls, fty::OverflowPolicy::Block);
+        measure("setForAll/async", plugins, calls, [&] {
+            for(unsigned i = 0; i < calls; i++) {
+                collection.setForAll((i % 2 == 0) ? fty::HealthState::Ok : fty::HealthState::Warning);
+            }
+            collection.flush(std::chrono::seconds(10));
+        });
+    }
+
+    //latency seen by the service when a plugin is slow
+    setenv("FTY_SERVICE_STATUS_SLEEP_US", "100", 1);
+    {
+        SyntheticPluginFolder folder(SLEEP_PLUGIN_PATH, 1, 0);
+        fty::ServiceStatusPluginWrapperCollection collection("bench-service");
+        collection.addAll(folder.getPath(), "*status.so");
+
+        measure("setForAll/sync/sleep-100us", 1, 100, [&] {
+            for(unsigned i = 0; i < 100; i++) {
+                collection.setForAll((i % 2 == 0) ? fty::HealthState::Ok : fty::HealthState::Warning);
+            }
+        });
+
+        collection.enableAsyncDispatch(64, fty::OverflowPolicy::DropOldest);
+        measure("setForAll/async/sleep-100us", 1, 100, [&] {
+            for(unsigned i = 0; i < 100; i++) {
+                collection.setForAll((i % 2 == 0) ? fty::HealthState::Ok : fty::HealthState::Warning);
+            }
+        });
+    }
+    unsetenv("FTY_SERVICE_STATUS_SLEEP_US");
+}
+
+//setForAll from several threads, the time is per call of all the threads together
+static void measureConcurrentSetForAll() {
+    const unsigned calls = 10000;
+    SyntheticPluginFolder folder(NOOP_PLUGIN_PATH, 5, 0);
+
+    for(bool churn : {false, true}) {
+        fty::ServiceStatusPluginWrapperCollection collection("bench-service");
+        collection.addAll(folder.getPath(), std::regex("libsynthetic-[0-3]-status\\.so"));
+
+        //one plugin is added and removed continuously while the statuses are set
+        std::atomic<bool> stop(false);
+        std::thread mutator;
+        if(churn) {
+            const std::string path = folder.getPath() + "/libsynthetic-4-status.so";
+            mutator = std::thread([&collection, &stop, path] () {
+                while(!stop) {
+                    collection.add(path);
+                    collection.remove("libsynthetic-4-status.so");
+                }
+            });
+        }
+
+        for(unsigned threads : {1u, 2u, 4u, 8u}) {
+            measure(churn ? "setForAll/threads/churn" : "setForAll/threads", threads, threads * calls, [&] {
+                std::vector<std::thread> setters;
+                for(unsigned t = 0; t < threads; t++) {
+                    setters.emplace_back([&collection] () {
+                        for(unsigned i = 0; i < calls; i++) {
+                            collection.setForAll((i % 2 == 0) ? fty::HealthState::Ok : fty::HealthState::Warning);
+                        }
+                    });
+                }
+                for(auto & setter : setters) {
+                    setter.join();
+                }
+            });
+        }
+
+        stop = true;
+        if(mutator.joinable()) {
+            mutator.join();
+        }
+    }
+}
+
+//status of many services: one collection per service, or one registry and one batch
+static void measureServices() {
+    const unsigned rounds = 100;
+
+    for(unsigned services : {16u, 256u}) {
+        std::vector<std::unique_ptr<fty::ServiceStatusPluginWrapperCollection>> collections;
+        std::vector<fty::ServiceStatus> statuses;
+        for(unsigned i = 0; i < services; i++) {
+            const std::string serviceName = "bench-service-" + std::to_string(i);
+            collections.emplace_back(new fty::ServiceStatusPluginWrapperCollection(serviceName));
+            collections.back()->add(NOOP_PLUGIN_PATH);
+            statuses.push_back(fty::ServiceStatus{serviceName, fty::OperatingStatus::InService, fty::HealthState::Ok});
+        }
+
+        measure("services/collections", services, rounds, [&] {
+            for(unsigned i = 0; i < rounds; i++) {
+                for(auto & collection : collections) {
+                    collection->setForAll(fty::OperatingStatus::InService);
+                    collection->setForAll((i % 2 == 0) ? fty::HealthState::Ok : fty::HealthState::Warning);
+                }
+            }
+        });
+
+        fty::ServiceStatusPluginRegistry registry;
+        registry.add(NOOP_PLUGIN_PATH);
+        registry.setForServices(statuses);
+
+        measure("services/registry/batch", services, rounds, [&] {
+            for(unsigned i = 0; i < rounds; i++) {
+                for(auto & status : statuses) {
+                    status.healthState = (i % 2 == 0) ? fty::HealthState::Ok : fty::HealthState::Warning;
+                }
+                registry.setForServices(statuses);
+            }
+        });
+    }
+}
+
+static void measureAddAll() {
+    for(unsigned plugins : {1u, 16u, 64u, 256u}) {
+        SyntheticPluginFolder folder(NOOP_PLUGIN_PATH, plugins, plugins);
+
+        measure("addAll/regex/sequential", plugins, 1, [&] {
+            fty::ServiceStatusPluginWrapperCollection collection("bench-service");
+            collection.addAllWithReport(folder.getPath(), std::regex(".*status\\.so"), 1);
+        });
+
+        measure("addAll/glob/sequential", plugins, 1, [&] {
+            fty::ServiceStatusPluginWrapperCollection collection("bench-service");
+            collection.addAllWithReport(folder.getPath(), "*status.so", 1);
+        });
+
+        measure("addAll/glob/parallel", plugins, 1, [&] {
+            fty::ServiceStatusPluginWrapperCollection collection("bench-service");
+            collection.addAllWithReport(folder.getPath(), "*status.so");
+        });
+
+        //every file is matched: the cache knows the files which are not plugins after the first start
+        measure("addAll/manifest/none", plugins, 1, [&] {
+            fty::ServiceStatusPluginWrapperCollection collection("bench-service");
+            collection.addAllWithReport(folder.getPath(), "*", 1);
+        });
+
+        const std::string cachePath = folder.getPath() + ".manifest";
+        auto cache = std::make_shared<fty::PluginManifestCache>(cachePath);
+        measure("addAll/manifest/cached", plugins, 1, [&] {
+            fty::ServiceStatusPluginWrapperCollection collection("bench-service");
+            collection.setManifestCache(cache);
+            collection.addAllWithReport(folder.getPath(), "*", 1);
+        });
+        unlink(cachePath.c_str());
+    }
+}
+
+//read the files written by the example plugin, as a monitor would do without the board
+static unsigned readStatusFiles(const std::vector<std::string> & serviceNames) {
+    unsigned sum = 0;
+    for(const std::string & serviceName : serviceNames) {
+        for(const char * suffix : {".operating", ".health"}) {
+            std::ifstream file(serviceName + suffix);
+            unsigned value = 0;
+            file >> value;
+            sum += value;
+        }
+    }
+    return sum;
+}
+
+static void measureScan(unsigned services) {
+    const unsigned scans = 100;
+    char folderTemplate[] = "/tmp/fty-service-status-bench-XXXXXX";
+    if(mkdtemp(folderTemplate) == nullptr) {
+        throw std::runtime_error("Cannot create the folder of the status files");
+    }
+    const std::string folder = folderTemplate;
+    const std::string boardName = "/fty-service-status-bench-" + std::to_string(getpid());
+    setenv(shmboard::BOARD_NAME_ENV, boardName.c_str(), 1);
+
+    {
+        fty::ServiceStatusPluginWrapper example(EXAMPLE_PLUGIN_PATH);
+        fty::ServiceStatusPluginWrapper board(BOARD_PLUGIN_PATH);
+        std::vector<fty::ServiceStatusProviderPtr> providers;
+        std::vector<std::string> fileNames;
+
+        //the example plugin writes in "<service name>.<status>"
+        for(unsigned i = 0; i < services; i++) {
+            const std::string serviceName = "service-" + std::to_string(i);
+            fileNames.push_back(folder + "/" + serviceName);
+            providers.push_back(example.newServiceStatusProviderPtr(fileNames.back()));
+            providers.push_back(board.newServiceStatusProviderPtr(serviceName));
+        }
+        for(auto & provider : providers) {
+            provider->set(fty::OperatingStatus::InService);
+            provider->set(fty::HealthState::Ok);
+        }
+
+        volatile unsigned sink = 0;
+        measure("scan/files", services, scans, [&] {
+            for(unsigned i = 0; i < scans; i++) {
+                sink = sink + readStatusFiles(fileNames);
+            }
+        });
+
+        shmboard::BoardReader reader(boardName);
+        std::vector<shmboard::BoardEntry> entries;
+        measure("scan/board", services, scans, [&] {
+            for(unsigned i = 0; i < scans; i++) {
+                sink = sink + static_cast<unsigned>(reader.snapshot(entries));
+            }
+        });
+
+        for(const std::string & fileName : fileNames) {
+            unlink((fileName + ".operating").c_str());
+            unlink((fileName + ".health").c_str());
+        }
+    }
+
+    shm_unlink(boardName.c_str());
+    unsetenv(shmboard::BOARD_NAME_ENV);
+    rmdir(folder.c_str());
+}
+
+static void measureFileUpdates() {
+    const unsigned updates = 1000;
+    char folderTemplate[] = "/tmp/fty-service-status-bench-XXXXXX";
+    if(mkdtemp(folderTemplate) == nullptr) {
+        throw std::runtime_error("Cannot create the folder of the status files");
+    }
+    const std::string folder = folderTemplate;
+    setenv(statusfile::FOLDER_ENV, folder.c_str(), 1);
+
+    auto measureUpdates = [&](const std::string & name, const std::string & pluginPath, const std::string & serviceName) {
+        fty::ServiceStatusPluginWrapper plugin(pluginPath);
+        fty::ServiceStatusProviderPtr provider = plugin.newServiceStatusProviderPtr(serviceName);
+        measure(name, 1, updates, [&] {
+            for(unsigned i = 0; i < updates; i++) {
+                provider->set((i % 2 == 0) ? fty::HealthState::Ok : fty::HealthState::Warning);
+            }
+        });
+    };
+
+    measureUpdates("update/example", EXAMPLE_PLUGIN_PATH, folder + "/example-service");
+    unlink((folder + "/example-service.health").c_str());
+
+    for(const char * mode : {"record", "rename"}) {
+        for(const char * sync : {"none", "group", "update"}) {
+            setenv(statusfile::MODE_ENV, mode, 1);
+            setenv(statusfile::SYNC_ENV, sync, 1);
+            measureUpdates(std::string("update/file/") + mode + "/sync-" + sync, FILE_PLUGIN_PATH, "file-service");
+            unlink((folder + "/file-service" + statusfile::STATUS_FILE_EXTENSION).c_str());
+        }
+    }
+
+    for(const char * name : {statusfile::FOLDER_ENV, statusfile::MODE_ENV, statusfile::SYNC_ENV}) {
+        unsetenv(name);
+    }
+    rmdir(folder.c_str());
+}
+
+//status of many emulated services sent to one aggregator
+//"socket/send" is the cost of an update for the service, "socket/aggregate" includes the reception by the aggregator
+static void measureSocketAggregator() {
+    const unsigned rounds = 10;
+    const std::string socketPath = "/tmp/fty-service-status-bench-" + std::to_string(getpid()) + ".sock";
+    setenv(statussocket::SOCKET_PATH_ENV, socketPath.c_str(), 1);
+
+    {
+        fty::ServiceStatusPluginWrapper plugin(SOCKET_PLUGIN_PATH);
+        void * handle = dlopen(SOCKET_PLUGIN_PATH, RTLD_NOW);
+        using FctGetCount = std::uint64_t(*)();
+        FctGetCount getSent = reinterpret_cast<FctGetCount>(dlsym(handle, "statusSocketGetSentCount"));
+        FctGetCount getDropped = reinterpret_cast<FctGetCount>(dlsym(handle, "statusSocketGetDroppedCount"));
+
+        statussocket::Aggregator aggregator(socketPath, 4 * 1024 * 1024);
+
+        for(unsigned services : {1000u, 4000u}) {
+            std::vector<fty::ServiceStatusProviderPtr> providers;
+            for(unsigned i = 0; i < services; i++) {
+                providers.push_back(plugin.newServiceStatusProviderPtr("bench-service-" + std::to_string(i)));
+            }
+
+            auto sendAll = [&] {
+                for(unsigned round = 0; round < rounds; round++) {
+                    for(auto & provider : providers) {
+                        provider->set((round % 2 == 0) ? fty::HealthState::Ok : fty::HealthState::Warning);
+                    }
+                }
+            };
+
+            measure("socket/send", services, services * rounds, sendAll);
+
+            //wait until the aggregator received all the datagrams which were not dropped, it is the only receiver of the plugin
+            const std::uint64_t droppedBefore = getDropped();
+            measure("socket/aggregate", services, services * rounds, [&] {
+                sendAll();
+                const std::uint64_t sent = getSent();
+                while(aggregator.getStats().received < sent) {
+                    std::this_thread::yield();
+                }
+            });
+
+            if(gFilter.compare(0, gFilter.size(), "socket/aggregate", 0, gFilter.size()) == 0) {
+                std::cerr << "socket/aggregate," << services << ": " << (getDropped() - droppedBefore) << " datagrams dropped, "
+                          << aggregator.getStats().batches << " batches received so far" << std::endl;
+            }
+        }
+
+        dlclose(handle);
+    }
+
+    unsetenv(statussocket::SOCKET_PATH_ENV);
+}
+
+//transitions appended to the journal, and creation of a provider restoring the last status of its service
+static void measureJournal() {
+    const std::string journalPath = "/tmp/fty-service-status-bench-" + std::to_string(getpid()) + ".journal";
+    setenv(statusjournal::JOURNAL_PATH_ENV, journalPath.c_str(), 1);
+
+    for(const char * sync : {"none", "group", "update"}) {
+        setenv(statusjournal::JOURNAL_SYNC_ENV, sync, 1);
+        fty::ServiceStatusPluginWrapper plugin(JOURNAL_PLUGIN_PATH);
+        fty::ServiceStatusProviderPtr provider = plugin.newServiceStatusProviderPtr("bench-service");
+
+        //a synchronous write per update is much slower
+        const unsigned updates = (std::string(sync) == "update") ? 100 : 100000;
+        measure(std::string("journal/set/") + sync, 1, updates, [&] {
+            for(unsigned i = 0; i < updates; i++) {
+                provider->set((i % 2 == 0) ? fty::HealthState::Ok : fty::HealthState::Warning);
+            }
+        });
+    }
+    unsetenv(statusjournal::JOURNAL_SYNC_ENV);
+
+    {
+        fty::ServiceStatusPluginWrapper plugin(JOURNAL_PLUGIN_PATH);
+        fty::ServiceStatusProviderPtr mapped = plugin.newServiceStatusProviderPtr("other-service");
+        measure("journal/restore", 1, 1000, [&] {
+            for(unsigned i = 0; i < 1000; i++) {
+                plugin.newServiceStatusProviderPtr("bench-service");
+            }
+        });
+    }
+
+    unsetenv(statusjournal::JOURNAL_PATH_ENV);
+    unlink(journalPath.c_str());
+}
+
+//same plugin linked in the service and loaded with dlopen
+static void measureStaticPlugins() {
+    using StaticCollection = fty::StaticServiceStatusPluginCollection<test::StaticMemoryPlugin>;
+
+    measure("static/startup", 1, 10000, [] {
+        for(unsigned i = 0; i < 10000; i++) {
+            StaticCollection collection("bench-service");
+        }
+    });
+
+    measure("static/startup/dlopen", 1, 100, [] {
+        for(unsigned i = 0; i < 100; i++) {
+            fty::ServiceStatusPluginWrapperCollection collection("bench-service");
+            collection.add(STATIC_MEMORY_PLUGIN_PATH);
+        }
+    });
+
+    const unsigned calls = 1000000;
+    StaticCollection staticCollection("bench-service");
+    measure("static/setForAll", 1, calls, [&] {
+        for(unsigned i = 0; i < calls; i++) {
+            staticCollection.setForAll((i % 2 == 0) ? fty::HealthState::Ok : fty::HealthState::Warning);
+        }
+    });
+
+    fty::ServiceStatusPluginWrapperCollection dynamicCollection("bench-service");
+    dynamicCollection.add(STATIC_MEMORY_PLUGIN_PATH);
+    measure("static/setForAll/dlopen", 1, calls, [&] {
+        for(unsigned i = 0; i < calls; i++) {
+            dynamicCollection.setForAll((i % 2 == 0) ? fty::HealthState::Ok : fty::HealthState::Warning);
+        }
+    });
+}
+
+static void measureKeepalive() {
+    const unsigned timers = 100000;
+    measure("keepalive/wheel", 1, timers, [] {
+        fty::detail::TimerWheel wheel;
+        std::vector<std::uint64_t> expired;
+        expired.reserve(timers);
+        for(unsigned i = 0; i < timers; i++) {
+            wheel.add(i, (i * 7919u) % 300000u);
+        }
+        wheel.advance(300000, expired);
+    });
+
+    //every service is due on each tick, so the scheduler runs without pause
+    for(unsigned services : {100u, 1000u}) {
+        const std::uint64_t rounds = 20;
+        std::shared_ptr<fty::KeepaliveScheduler> scheduler = std::make_shared<fty::KeepaliveScheduler>(std::chrono::milliseconds(1));
+        fty::KeepaliveSettings settings;
+        settings.interval = std::chrono::milliseconds(1);
+
+        std::vector<std::unique_ptr<fty::ServiceStatusPluginWrapperCollection>> collections;
+        for(unsigned i = 0; i < services; i++) {
+            collections.emplace_back(new fty::ServiceStatusPluginWrapperCollection("bench-service-" + std::to_string(i)));
+            collections.back()->add(NOOP_PLUGIN_PATH);
+            collections.back()->setForAll(fty::OperatingStatus::InService);
+            collections.back()->enableAsyncDispatch();
+            collections.back()->enableKeepalive(settings, scheduler);
+        }
+
+        auto keepaliveCount = [&collections] {
+            std::uint64_t count = 0;
+            for(auto & collection : collections) {
+                count += collection->getKeepaliveCount();
+            }
+            return count;
+        };
+
+        measure("keepalive/services", services, static_cast<unsigned>(services * rounds), [&] {
+            const std::uint64_t target = keepaliveCount() + services * rounds;
+            while(keepaliveCount() < target) {
+                std::this_thread::sleep_for(std::chrono::microseconds(100));
+            }
+        });
+    }
+}
+
+static void measureComponentTree() {
+    const unsigned updates = 100000;
+
+    //three levels: groups of 10 assets, assets of 10 sensors
+    for(unsigned components : {100u, 10000u, 100000u}) {
+        fty::ComponentHealthTree tree;
+        std::vector<fty::ComponentHealthTree::ComponentId> sensors;
+        for(unsigned group = 0; group * 100 < components; group++) {
+            auto groupId = tree.add("group-" + std::to_string(group));
+            for(unsigned asset = 0; asset < 10; asset++) {
+                auto assetId = tree.add("group-" + std::to_string(group) + "/asset-" + std::to_string(asset), groupId);
+                for(unsigned sensor = 0; sensor < 10; sensor++) {
+                    sensors.push_back(tree.add("sensor-" + std::to_string(sensors.size()), assetId));
+                    tree.set(sensors.back(), fty::HealthState::Ok);
+                }
+            }
+        }
+
+        measure("componentTree/set", components, updates, [&] {
+            for(unsigned i = 0; i < updates; i++) {
+                tree.set(sensors[(i * 7919u) % sensors.size()], (i % 2 == 0) ? fty::HealthState::Warning : fty::HealthState::Ok);
+            }
+        });
+    }
+}
+
+static void measureAccounting() {
+    const unsigned calls = 1000000;
+    fty::ServiceStatusPluginWrapperCollection collection("bench-service");
+    collection.add(NOOP_PLUGIN_PATH);
+
+    auto setForAll = [&] {
+        for(unsigned i = 0; i < calls; i++) {
+            collection.setForAll((i % 2 == 0) ? fty::HealthState::Ok : fty::HealthState::Warning);
+        }
+    };
+    measure("accounting/setForAll/none", 1, calls, setForAll);
+
+    std::shared_ptr<fty::StatusAccounting> accounting = std::make_shared<fty::StatusAccounting>();
+    collection.setStatusAccounting(accounting);
+    measure("accounting/setForAll", 1, calls, setForAll);
+
+    const unsigned snapshots = 10000;
+    measure("accounting/snapshot", 1, snapshots, [&] {
+        for(unsigned i = 0; i < snapshots; i++) {
+            fty::StatusAccountingSnapshot snapshot = accounting->getSnapshot();
+            if(!snapshot.consistent) {
+                std::cerr << "inconsistent snapshot" << std::endl;
+            }
+        }
+    });
+}
+
+static void measureIsolation() {
+    const unsigned calls = 1000;
+    fty::IsolationSettings settings;
+    settings.hostPath = PLUGIN_HOST_PATH;
+    settings.ringCapacity = 1024;
+
+    auto setForAll = [](fty::ServiceStatusPluginWrapperCollection & collection, unsigned count) {
+        for(unsigned i = 0; i < count; i++) {
+            collection.setForAll((i % 2 == 0) ? fty::HealthState::Ok : fty::HealthState::Warning);
+        }
+    };
+
+    {
+        fty::ServiceStatusPluginWrapperCollection collection("bench-service");
+        collection.add(NOOP_PLUGIN_PATH);
+        measure("isolated/setForAll/in-process", 1, calls, [&] { setForAll(collection, calls); });
+    }
+    {
+        //the ring is large enough to never drop, the time includes the delivery by the host
+        fty::ServiceStatusPluginWrapperCollection collection("bench-service");
+        std::shared_ptr<fty::IsolatedServiceStatusProvider> provider = collection.addIsolated(NOOP_PLUGIN_PATH, settings);
+        measure("isolated/setForAll", 1, calls, [&] {
+            setForAll(collection, calls);
+            provider->flush(std::chrono::seconds(10));
+        });
+
+        //each update waits for the host: wake up of the host and of the service
+        measure("isolated/setForAll/round-trip", 1, calls, [&] {
+            for(unsigned i = 0; i < calls; i++) {
+                setForAll(collection, 1);
+                provider->flush(std::chrono::seconds(10));
+            }
+        });
+    }
+
+    //latency seen by the service when a plugin is slow
+    setenv("FTY_SERVICE_STATUS_SLEEP_US", "100", 1);
+    {
+        fty::ServiceStatusPluginWrapperCollection collection("bench-service");
+        collection.addIsolated(SLEEP_PLUGIN_PATH, settings);
+        measure("isolated/setForAll/sleep-100us", 1, 100, [&] { setForAll(collection, 100); });
+    }
+    unsetenv("FTY_SERVICE_STATUS_SLEEP_US");
+}
+
+int main(int argc, char * argv[]) {
+    if(argc > 1) {
+        gFilter = argv[1];
+    }
+
+    std::cout << "name,size,iterations,ns_per_iteration" << std::endl;
+
+    measureCallPath();
+    measureSetForAll();
+    measureConcurrentSetForAll();
+    measureServices();
+    measureAddAll();
+
+    for(unsigned services : {1u, 16u, 200u}) {
+        measureScan(services);
+    }
+
+    measureFileUpdates();
+    measureSocketAggregator();
+    measureStaticPlugins();
+    measureJournal();
+    measureKeepalive();
+    measureComponentTree();
+    measureAccounting();
+    measureIsolation();
+
+    return EXIT_SUCCESS;
+}
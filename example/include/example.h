@@ -36,6 +36,8 @@ namespace example
     {
         private:
         std::string m_serviceName;
+        std::string m_operatingPath;
+        std::string m_healthPath;
 
         public:
         ServiceStatusExample( const char * serviceName);
@@ -18,13 +18,19 @@
 */
 #include "example.h"
 
-#include <fstream>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
 #include <string>
 
+#include <fcntl.h>
+#include <unistd.h>
 
 //internal variables and functions
-static std::string gPluginLastError = "";
-static int writeToFile(const std::string & fullPath, uint8_t value);
+//the status is set without heap allocation: the paths are built once and the error is kept in a fixed buffer
+static char gPluginLastError[256] = "";
+static void setLastError(const char * message, const char * path) noexcept;
+static int writeToFile(const char * fullPath, uint8_t value) noexcept;
 
 //public interfaces
 const char * getPluginName() {
@@ -32,7 +38,7 @@ const char * getPluginName() {
 }
 
 const char * getPluginLastError(){
-    return gPluginLastError.c_str();
+    return gPluginLastError;
 }
 
 int createServiceStatusProvider(fty::ServiceStatusProvider** spp, const char * serviceName) {
@@ -40,11 +46,11 @@ int createServiceStatusProvider(fty::ServiceStatusProvider** spp, const char * s
         *spp = dynamic_cast<fty::ServiceStatusProvider*>(new example::ServiceStatusExample(serviceName));
     }
     catch(const std::exception& e) {
-        gPluginLastError = e.what();
+        setLastError(e.what(), "");
         return -1;
     }
 
-    gPluginLastError = "";
+    gPluginLastError[0] = '\0';
     return 0;
 }
 
@@ -58,7 +64,9 @@ namespace example
 {
 
     ServiceStatusExample::ServiceStatusExample(const char * serviceName)
-        : m_serviceName(serviceName)
+        : m_serviceName(serviceName),
+          m_operatingPath(m_serviceName + ".operating"),
+          m_healthPath(m_serviceName + ".health")
         {}
 
     const char * ServiceStatusExample::getServiceName() const noexcept {
@@ -69,38 +77,48 @@ namespace example
     ///@param os [in] Operating Status to set
     ///@return 0 in success, -1  in case of error and message is stored in getPluginLastError
     int ServiceStatusExample::set(fty::OperatingStatus os) noexcept {
-        return writeToFile( m_serviceName + ".operating", static_cast<uint8_t>(os));
+        return writeToFile( m_operatingPath.c_str(), static_cast<uint8_t>(os));
     }
 
     /// Set the Health State
     ///@param hs [in] Health state to set
     ///@return 0 in success, -1  in case of error and message is stored in getPluginLastError
     int ServiceStatusExample::set(fty::HealthState hs) noexcept {
-        return writeToFile( m_serviceName + ".health", static_cast<uint8_t>(hs));
+        return writeToFile( m_healthPath.c_str(), static_cast<uint8_t>(hs));
     }
 
 } //namespace example
 
 int setHealthState(const char * serviceName, uint8_t healthState)
 {
-    return writeToFile( std::string(serviceName) + ".health", healthState);
+    return writeToFile( (std::string(serviceName) + ".health").c_str(), healthState);
 }
 
 int setOperatingStatus(const char * serviceName, uint8_t operatingStatus) {
-    return writeToFile( std::string(serviceName) + ".operating", operatingStatus);
+    return writeToFile( (std::string(serviceName) + ".operating").c_str(), operatingStatus);
 }
 
-static int writeToFile(const std::string & fullPath, uint8_t value) {
-    try {
-        std::ofstream outfile(fullPath, std::ofstream::trunc);
-        outfile << std::to_string(value) << std::endl;
-        outfile.close();
+static void setLastError(const char * message, const char * path) noexcept {
+    snprintf(gPluginLastError, sizeof(gPluginLastError), "%s%s%s", message, (path[0] != '\0') ? ": " : "", path);
+}
+
+static int writeToFile(const char * fullPath, uint8_t value) noexcept {
+    char buffer[8];
+    const int length = snprintf(buffer, sizeof(buffer), "%u\n", static_cast<unsigned>(value));
+
+    int fd = open(fullPath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0) {
+        setLastError(strerror(errno), fullPath);
+        return -1;
     }
-    catch(std::exception & e) {
-        gPluginLastError = e.what();
+
+    const bool written = write(fd, buffer, static_cast<size_t>(length)) == length;
+    const int error = errno;
+    if(close(fd) != 0 || !written) {
+        setLastError(strerror(written ? errno : error), fullPath);
         return -1;
     }
 
-    gPluginLastError = "";
+    gPluginLastError[0] = '\0';
     return 0;
-}
\ No newline at end of file
+}
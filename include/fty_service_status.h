@@ -18,17 +18,38 @@
 */
 #pragma once
 
+#include <algorithm>
+#include <array>
 #include <cstdint>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <string>
 #include <stdexcept>
 #include <functional>
 #include <memory>
+#include <new>
 #include <map>
 #include <list>
+#include <set>
+#include <unordered_map>
+#include <vector>
 #include <regex>
+#include <system_error>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include <cerrno>
 
 #include <dirent.h> 
 #include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace fty
 {
@@ -91,194 +112,4655 @@ namespace fty
 
     using ServiceStatusProviderPtr = std::shared_ptr<ServiceStatusProvider>;
 
+    /// Highest version of the plugin ABI known by this header
+    ///
+    /// Version 1 is the four functions getPluginName, getPluginLastError, createServiceStatusProvider and
+    /// deleteServiceStatusProvider. Version 2 adds the descriptor of the plugin and its capabilities.
+    constexpr std::uint32_t PLUGIN_ABI_VERSION = 2;
+
+    /// Optional features of a plugin implementing the version 2 of the ABI, given as flags in its descriptor
+    enum class PluginCapability : std::uint32_t
+    {
+        CombinedUpdate  = 0x1   ///< the providers implement ServiceStatusProviderV2
+    };
+
+    /// Descriptor of a plugin implementing the version 2 of the ABI, returned by the optional entry point
+    ///     const fty::ServiceStatusPluginDescriptor * getServiceStatusPluginDescriptor()
+    /// The next versions of the ABI only append fields, so a plugin and a service may use different versions:
+    /// the lowest one is used, and the unknown capabilities are ignored.
+    struct ServiceStatusPluginDescriptor
+    {
+        /// Version of the ABI implemented by the plugin, at least 2
+        std::uint32_t abiVersion;
+        /// PluginCapability flags
+        std::uint32_t capabilities;
+    };
+
+    /// Provider which accepts the Operating Status and the Health State in one update
+    ///
+    /// The providers of a plugin with the CombinedUpdate capability implement this interface.
+    class ServiceStatusProviderV2 : public ServiceStatusProvider
+    {
+        public:
+        using ServiceStatusProvider::set;
+
+        /// Set the Operating Status and the Health State
+        ///@param os [in] Operating Status to set
+        ///@param hs [in] Health state to set
+        ///@param timestamp [in] time of the status in nano seconds since the Unix epoch
+        ///@return 0 in success, negative number in case of error (see plugin documentation)
+        virtual int set(OperatingStatus os, HealthState hs, std::int64_t timestamp) noexcept = 0;
+    };
+
+    /// Status of one provider, given in one call to the plugins which have the optional entry point
+    ///     int setServiceStatusBatch(const fty::ServiceStatusBatchEntry * entries, std::size_t count)
+    /// which returns the number of entries which could not be set.
+    struct ServiceStatusBatchEntry
+    {
+        /// Provider created by the plugin
+        ServiceStatusProvider * provider;
+        OperatingStatus operatingStatus;
+        HealthState healthState;
+    };
+
+    /// Status of one service, for ServiceStatusPluginRegistry::setForServices
+    struct ServiceStatus
+    {
+        std::string serviceName;
+        OperatingStatus operatingStatus;
+        HealthState healthState;
+    };
+
+    /// How a ServiceStatusPluginWrapper loads its plugin
+    enum class LoadMode : std::uint8_t
+    {
+        Now     = 0,    ///< the plugin is loaded by the constructor and all its symbols are bound (RTLD_NOW)
+        Lazy    = 1     ///< the plugin is loaded on first use and its symbols are bound on first call (RTLD_LAZY)
+    };
+
     /// This class is a wrapper on a plugin which should implement service status funtions
     ///
     /// This class is in charge of the life cycle of the plugin accross the service
-    /// Plugin wrapper must exist during the life of the object generated by the plugin.
+    /// The copies of a wrapper share the same plugin. The plugin is unloaded when the wrappers
+    /// and the objects generated by the plugin are all destroyed.
     class ServiceStatusPluginWrapper
     {
         using FctNewSPP = int(*)(ServiceStatusProvider**, const char *);
         using FctDeleteSPP = void(*)(ServiceStatusProvider *);
         using FctGetString = const char * (*)();
+        using FctSetBatch = int(*)(const ServiceStatusBatchEntry *, std::size_t);
+        using FctGetDescriptor = const ServiceStatusPluginDescriptor * (*)();
+
+        //state shared by the copies of the wrapper
+        struct Library
+        {
+            std::string path;
+            std::string name;
+            int flags = RTLD_NOW;
+
+            std::mutex mutex;
+            std::shared_ptr<void> handle;
+            FctGetString fctGetName = nullptr;
+            FctGetString fctGetLastError = nullptr;
+            FctNewSPP fctNewSPP = nullptr;
+            FctDeleteSPP fctDeleteSPP = nullptr;
+            FctSetBatch fctSetBatch = nullptr;  //optional
+
+            //negotiated with the descriptor of the plugin, 0 while the plugin is not loaded
+            std::uint32_t abiVersion = 0;
+            std::uint32_t capabilities = 0;
+        };
         
         private:
-        std::shared_ptr<void> m_spPlugin;
+        std::shared_ptr<Library> m_library;
+
+        template<typename Fct>
+        static Fct loadFunction(void * handle, const char * name) {
+            // reset errors
+            dlerror();
 
-        FctGetString m_fctGetName;
-        FctGetString m_fctGetLastError;
-        FctNewSPP m_fctNewSPP;
-        FctDeleteSPP m_fctDeleteSPP;
+            Fct fct = reinterpret_cast<Fct>(dlsym(handle, name));
+            const char * dlsymError = dlerror();
+            if(dlsymError) {
+                throw std::runtime_error("Cannot load function " + std::string(name) + ": " + std::string(dlsymError));
+            }
+            return fct;
+        }
+
+        //load the plugin, the mutex of the library must be locked
+        static void load(Library & library) {
+            //try to load the plugin
+            std::shared_ptr<void> handle(dlopen(library.path.c_str(), library.flags), [] (void * ptr) { if(ptr) dlclose(ptr);});
+            if (!handle) {
+                throw std::runtime_error("Cannot load plugin: " + std::string(dlerror()));
+            }
+
+            //try to load the 4 functions, even with RTLD_LAZY a missing one is detected here
+            FctGetString fctGetName = loadFunction<FctGetString>(handle.get(), "getPluginName");
+            FctNewSPP fctNewSPP = loadFunction<FctNewSPP>(handle.get(), "createServiceStatusProvider");
+            FctDeleteSPP fctDeleteSPP = loadFunction<FctDeleteSPP>(handle.get(), "deleteServiceStatusProvider");
+            FctGetString fctGetLastError = loadFunction<FctGetString>(handle.get(), "getPluginLastError");
+            FctSetBatch fctSetBatch = reinterpret_cast<FctSetBatch>(dlsym(handle.get(), "setServiceStatusBatch"));
+
+            std::string name(fctGetName());
+            if(!library.name.empty() && name != library.name) {
+                throw std::runtime_error("Plugin <" + library.path + "> is named <" + name + "> instead of <" + library.name + ">");
+            }
+
+            //a plugin without descriptor implements the version 1 of the ABI
+            std::uint32_t abiVersion = 1;
+            std::uint32_t capabilities = 0;
+            FctGetDescriptor fctGetDescriptor = reinterpret_cast<FctGetDescriptor>(dlsym(handle.get(), "getServiceStatusPluginDescriptor"));
+            if(fctGetDescriptor) {
+                const ServiceStatusPluginDescriptor * descriptor = fctGetDescriptor();
+                if(descriptor == nullptr || descriptor->abiVersion < 2) {
+                    throw std::runtime_error("Plugin <" + library.path + "> has an invalid descriptor");
+                }
+                abiVersion = std::min(descriptor->abiVersion, PLUGIN_ABI_VERSION);
+                capabilities = descriptor->capabilities & static_cast<std::uint32_t>(PluginCapability::CombinedUpdate);
+            }
+
+            //the name is only set once, so getPluginName can return it without lock
+            if(library.name.empty()) {
+                library.name = name;
+            }
+            library.fctGetName = fctGetName;
+            library.fctGetLastError = fctGetLastError;
+            library.fctNewSPP = fctNewSPP;
+            library.fctDeleteSPP = fctDeleteSPP;
+            library.fctSetBatch = fctSetBatch;
+            library.abiVersion = abiVersion;
+            library.capabilities = capabilities;
+            library.handle = handle;
+        }
+
+        //current time in nano seconds since the Unix epoch
+        static std::int64_t now() noexcept {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+
+        //the capabilities of the plugin are checked by the caller
+        static int setStatus(ServiceStatusProvider & provider, OperatingStatus os, HealthState hs, std::int64_t timestamp, bool combined) noexcept {
+            if(combined) {
+                return static_cast<ServiceStatusProviderV2 &>(provider).set(os, hs, timestamp);
+            }
+
+            const int osResult = provider.set(os);
+            const int hsResult = provider.set(hs);
+            return (osResult < 0) ? osResult : hsResult;
+        }
 
         public:
         /// Get the plugin name
-        ///@return plugin name
-        std::string getPluginName() const noexcept { return std::string(m_fctGetName()); }
+        ///@return plugin name, valid while the wrapper exists
+        const std::string & getPluginName() const noexcept { return m_library->name; }
+
+        /// Get the path of the plugin
+        ///@return path given at the creation of the wrapper
+        const std::string & getPluginPath() const noexcept { return m_library->path; }
+
+        /// Check if the plugin is loaded
+        bool isLoaded() const noexcept {
+            std::lock_guard<std::mutex> lock(m_library->mutex);
+            return m_library->handle != nullptr;
+        }
+
+        /// Get the last error message of the plugin
+        ///@return message returned by getPluginLastError(), empty if the plugin is not loaded
+        std::string getPluginLastError() const {
+            std::lock_guard<std::mutex> lock(m_library->mutex);
+            const char * error = m_library->handle ? m_library->fctGetLastError() : nullptr;
+            return error ? error : "";
+        }
+
+        /// Check if the plugin receives the batches in one call, with the setServiceStatusBatch entry point
+        ///@return false if the plugin does not have it or is not loaded
+        bool hasBatchEntryPoint() const noexcept {
+            std::lock_guard<std::mutex> lock(m_library->mutex);
+            return m_library->handle && m_library->fctSetBatch;
+        }
+
+        /// Get the version of the ABI used with the plugin
+        ///@return the lowest of the versions of the plugin and of PLUGIN_ABI_VERSION, 0 if the plugin is not loaded
+        std::uint32_t getAbiVersion() const noexcept {
+            std::lock_guard<std::mutex> lock(m_library->mutex);
+            return m_library->handle ? m_library->abiVersion : 0;
+        }
+
+        /// Check if the plugin has a capability of the version 2 of the ABI
+        ///@return false if the plugin does not have it or is not loaded
+        bool hasCapability(PluginCapability capability) const noexcept {
+            std::lock_guard<std::mutex> lock(m_library->mutex);
+            return m_library->handle && (m_library->capabilities & static_cast<std::uint32_t>(capability)) != 0;
+        }
+
+        /// Set the Operating Status and the Health State of a provider created by this plugin
+        ///
+        /// The provider receives one update if the plugin has the CombinedUpdate capability, else two calls to set().
+        ///@param provider [in] provider created by this plugin
+        ///@param os [in] Operating Status to set
+        ///@param hs [in] Health state to set
+        ///@param timestamp [in] time of the status in nano seconds since the Unix epoch
+        ///@return 0 in success, else the first error returned by the provider
+        int setStatus(ServiceStatusProvider & provider, OperatingStatus os, HealthState hs, std::int64_t timestamp) const noexcept {
+            return setStatus(provider, os, hs, timestamp, hasCapability(PluginCapability::CombinedUpdate));
+        }
+
+        /// Set the Operating Status and the Health State of a provider created by this plugin, at the current time
+        ///@param provider [in] provider created by this plugin
+        ///@param os [in] Operating Status to set
+        ///@param hs [in] Health state to set
+        ///@return 0 in success, else the first error returned by the provider
+        int setStatus(ServiceStatusProvider & provider, OperatingStatus os, HealthState hs) const noexcept {
+            return setStatus(provider, os, hs, now());
+        }
+
+        /// Set the status of several providers created by this plugin
+        ///
+        /// The plugin receives the batch in one call if it has the setServiceStatusBatch entry point,
+        /// else the Operating Status and the Health State are set on each provider, in one update
+        /// if the plugin has the CombinedUpdate capability. A plugin released by unload() is loaded again,
+        /// if it cannot be the status are set on each provider with two calls to set().
+        ///@param entries [in] providers and their status
+        ///@param count [in] number of entries
+        ///@return number of entries which could not be set
+        int setBatch(const ServiceStatusBatchEntry * entries, std::size_t count) const noexcept {
+            //the copy of the handle keeps the entry point loaded during the call
+            std::shared_ptr<void> handle;
+            FctSetBatch fctSetBatch = nullptr;
+            bool combined = false;
+            {
+                std::lock_guard<std::mutex> lock(m_library->mutex);
+                if(!m_library->handle && count != 0) {
+                    //the providers of the entries keep the library mapped, so this only takes a reference on it
+                    try {
+                        load(*m_library);
+                    }
+                    catch(const std::exception &) {
+                    }
+                }
+                if(m_library->handle) {
+                    handle = m_library->handle;
+                    fctSetBatch = m_library->fctSetBatch;
+                    combined = (m_library->capabilities & static_cast<std::uint32_t>(PluginCapability::CombinedUpdate)) != 0;
+                }
+            }
 
-        /// Create a ServiceStatusProvider
+            if(fctSetBatch) {
+                return fctSetBatch(entries, count);
+            }
+
+            const std::int64_t timestamp = now();
+            int failures = 0;
+            for(std::size_t i = 0; i < count; i++) {
+                if(setStatus(*entries[i].provider, entries[i].operatingStatus, entries[i].healthState, timestamp, combined) < 0) {
+                    failures++;
+                }
+            }
+            return failures;
+        }
+
+        /// Load the plugin if it is not loaded yet
+        void load() {
+            std::lock_guard<std::mutex> lock(m_library->mutex);
+            if(!m_library->handle) {
+                load(*m_library);
+            }
+        }
+
+        /// Release the plugin, it is reloaded on next use
+        ///
+        /// The plugin is really unloaded once the ServiceStatusProvider objects it created are destroyed.
+        void unload() noexcept {
+            std::lock_guard<std::mutex> lock(m_library->mutex);
+            m_library->handle.reset();
+            //the functions are set again by the next load, they must not be called before
+            m_library->fctGetName = nullptr;
+            m_library->fctGetLastError = nullptr;
+            m_library->fctNewSPP = nullptr;
+            m_library->fctDeleteSPP = nullptr;
+            m_library->fctSetBatch = nullptr;
+            m_library->abiVersion = 0;
+            m_library->capabilities = 0;
+        }
+
+        /// Create a ServiceStatusProvider, the plugin is loaded if needed
         ///@param serviceName [in] name of the service for which we do the notification
         ///@return sharedptr of ServiceStatusProvider with the correct deleter
         ServiceStatusProviderPtr newServiceStatusProviderPtr(const std::string & serviceName) {
+            std::lock_guard<std::mutex> lock(m_library->mutex);
+            if(!m_library->handle) {
+                load(*m_library);
+            }
 
             ServiceStatusProvider * ptr = nullptr;
-            int error = m_fctNewSPP(&ptr, serviceName.c_str());
+            int error = m_library->fctNewSPP(&ptr, serviceName.c_str());
             if(error != 0) {
                 throw std::runtime_error("Impossible to create the ServiceStatusProvider. Error "
-                                            +std::to_string(error) +": " +m_fctGetLastError());
+                                            +std::to_string(error) +": " +m_library->fctGetLastError());
             }
 
-            return ServiceStatusProviderPtr(ptr, m_fctDeleteSPP);
+            //the provider keeps the plugin loaded
+            std::shared_ptr<void> handle = m_library->handle;
+            FctDeleteSPP fctDeleteSPP = m_library->fctDeleteSPP;
+            return ServiceStatusProviderPtr(ptr, [handle, fctDeleteSPP] (ServiceStatusProvider * provider) { fctDeleteSPP(provider); });
         }
 
         /// Create a ServiceStatusPluginWrapper
         /// @param pluginPath [in] path to the plugin
-        ServiceStatusPluginWrapper(const std::string & pluginPath) {
-            //try to load the plugin
-            m_spPlugin = std::shared_ptr<void>(dlopen(pluginPath.c_str(), RTLD_NOW), [] (void * ptr) { if(ptr) dlclose(ptr);});
-            if (!m_spPlugin) {
-                throw std::runtime_error("Cannot load plugin: " + std::string(dlerror()));
+        ServiceStatusPluginWrapper(const std::string & pluginPath) : m_library(std::make_shared<Library>()) {
+            m_library->path = pluginPath;
+            load(*m_library);
+        }
+
+        /// Create a ServiceStatusPluginWrapper with the expected name of the plugin
+        ///
+        /// In Lazy mode nothing is loaded until the first use, so the name must be given.
+        /// The four functions of the plugin are checked when it is loaded, the other symbols of the plugin
+        /// are bound on their first call: use the Now mode for plugins which are not trusted to be complete.
+        /// @param pluginPath [in] path to the plugin
+        /// @param pluginName [in] name of the plugin, the load fails if the plugin returns another name
+        /// @param mode [in] when the plugin is loaded
+        ServiceStatusPluginWrapper(const std::string & pluginPath, const std::string & pluginName, LoadMode mode) : m_library(std::make_shared<Library>()) {
+            if(pluginName.empty()) {
+                throw std::invalid_argument("The name of the plugin <" + pluginPath + "> must not be empty");
             }
 
-            //try to load the 3 functions
-            // reset errors
-            const char *dlsymError = dlerror();
+            m_library->path = pluginPath;
+            m_library->name = pluginName;
+            if(mode == LoadMode::Lazy) {
+                m_library->flags = RTLD_LAZY;
+            } else {
+                load(*m_library);
+            }
+        }
+    };
 
-            m_fctGetName = reinterpret_cast<FctGetString>(dlsym(m_spPlugin.get(), "getPluginName"));
-            dlsymError = dlerror();
-            if(dlsymError) {
-                throw std::runtime_error("Cannot load function getPluginName: " + std::string(dlsymError));
+    /// Policy applied by the asynchronous dispatch when the queue of a plugin is full
+    enum class OverflowPolicy : std::uint8_t
+    {
+        DropNewest  = 0,    ///< the new update is discarded
+        DropOldest  = 1,    ///< the oldest pending update is discarded to make room
+        Block       = 2     ///< the caller waits until the dispatcher makes room, or drops the update after the block timeout
+    };
+
+    /// Settings of the watchdog which quarantines the misbehaving plugins
+    struct WatchdogSettings
+    {
+        /// Maximum duration of a call to set(), a plugin exceeding it is quarantined
+        std::chrono::milliseconds latencyBudget {1000};
+        /// Number of consecutive errors returned by set() before the quarantine, 0 to ignore the errors
+        unsigned maxConsecutiveErrors = 3;
+        /// Delay before the first probe of a quarantined plugin, doubled after each failed probe
+        std::chrono::milliseconds initialBackoff {100};
+        /// Maximum delay between two probes
+        std::chrono::milliseconds maxBackoff {30000};
+        /// Period of the checks done by the watchdog thread
+        std::chrono::milliseconds checkPeriod {10};
+    };
+
+    /// Settings of the keepalive which re-asserts the last status to the plugins
+    struct KeepaliveSettings
+    {
+        /// Period of the re-assertion, a plugin which received a status more recently is skipped
+        std::chrono::milliseconds interval {30000};
+        /// Maximum random delay added to each period, to spread the re-assertions of many plugins
+        std::chrono::milliseconds jitter {0};
+    };
+
+    /// Settings of a plugin running in a host process
+    struct IsolationSettings
+    {
+        /// Path of the fty-service-status-plugin-host executable, searched in the PATH if it has no slash
+        std::string hostPath = "fty-service-status-plugin-host";
+        /// Number of updates queued for the host, a power of 2
+        std::uint32_t ringCapacity = 256;
+        /// Maximum time for the host to load the plugin
+        std::chrono::milliseconds startTimeout {5000};
+        /// Delay before the restart of a host which died
+        std::chrono::milliseconds restartDelay {100};
+    };
+
+    /// Result of the load of one plugin file by addAllWithReport
+    struct PluginLoadResult
+    {
+        /// Full path of the plugin file
+        std::string path;
+        /// Name of the plugin, empty if the file is not a valid plugin
+        std::string pluginName;
+        /// True if the plugin was added to the collection
+        bool added = false;
+        /// True if the plugin was removed from the collection, because its file was deleted or replaced
+        bool removed = false;
+        /// Reason of the failure when the plugin was not added
+        std::string error;
+    };
+
+    /// Cache of the plugin files probed by addAll, to skip the files already known not to be plugins
+    ///
+    /// A file is identified by its path, inode, size and modification time: a file whose identity changed is probed
+    /// again. The cache is kept in a file which can be shared by the services, replaced atomically by save().
+    /// The functions can be called from several threads.
+    class PluginManifestCache
+    {
+        public:
+        /// Result of the probe of one plugin file
+        struct Entry
+        {
+            std::string path;
+            std::uint64_t inode = 0;
+            std::int64_t size = 0;
+            /// Modification time in nano seconds
+            std::int64_t modificationTime = 0;
+            /// True if the file is a plugin
+            bool valid = false;
+            /// Name of the plugin, empty if the file is not a plugin
+            std::string pluginName;
+            /// Version of the ABI exported by the plugin
+            std::uint32_t abiVersion = 0;
+            /// Reason why the file is not a plugin
+            std::string error;
+        };
+
+        private:
+        std::string m_cachePath;
+        mutable std::mutex m_mutex;
+        std::unordered_map<std::string, Entry> m_entries;
+        bool m_modified = false;
+        mutable std::atomic<std::uint64_t> m_hitCount {0};
+        mutable std::atomic<std::uint64_t> m_missCount {0};
+
+        static const char * header() noexcept { return "fty-service-status-plugin-manifest 2"; }
+
+        //the fields are separated by tabulations and the entries by new lines, escaped with a backslash in the texts
+        static std::string escape(const std::string & text) {
+            std::string escaped;
+            escaped.reserve(text.size());
+            for(char c : text) {
+                switch(c) {
+                    case '\\': escaped += "\\\\"; break;
+                    case '\t': escaped += "\\t"; break;
+                    case '\n': escaped += "\\n"; break;
+                    default: escaped += c;
+                }
             }
+            return escaped;
+        }
 
-            m_fctNewSPP = reinterpret_cast<FctNewSPP>(dlsym(m_spPlugin.get(), "createServiceStatusProvider"));
-            dlsymError = dlerror();
-            if(dlsymError) {
-                throw std::runtime_error("Cannot load function createServiceStatusProvider: " + std::string(dlsymError));
+        //false if the text ends with a backslash or has an unknown escape sequence
+        static bool unescape(const std::string & text, std::string & unescaped) {
+            unescaped.clear();
+            unescaped.reserve(text.size());
+            for(std::size_t i = 0; i < text.size(); i++) {
+                if(text[i] != '\\') {
+                    unescaped += text[i];
+                    continue;
+                }
+                if(++i == text.size()) {
+                    return false;
+                }
+                switch(text[i]) {
+                    case '\\': unescaped += '\\'; break;
+                    case 't': unescaped += '\t'; break;
+                    case 'n': unescaped += '\n'; break;
+                    default: return false;
+                }
             }
+            return true;
+        }
 
-            m_fctDeleteSPP = reinterpret_cast<FctDeleteSPP>(dlsym(m_spPlugin.get(), "deleteServiceStatusProvider"));
-            dlsymError = dlerror();
-            if(dlsymError) {
-                throw std::runtime_error("Cannot load function deleteServiceStatusProvider: " + std::string(dlsymError));
+        //a corrupted or unknown file is ignored, the files are probed again
+        void load() {
+            std::ifstream file(m_cachePath);
+            std::string line;
+            if(!std::getline(file, line) || line != header()) {
+                return;
             }
 
-            m_fctGetLastError = reinterpret_cast<FctGetString>(dlsym(m_spPlugin.get(), "getPluginLastError"));
-            dlsymError = dlerror();
-            if(dlsymError) {
-                throw std::runtime_error("Cannot load function getPluginLastError: " + std::string(dlsymError));
+            while(std::getline(file, line)) {
+                std::vector<std::string> fields;
+                std::size_t start = 0;
+                for(std::size_t end = line.find('\t'); end != std::string::npos; end = line.find('\t', start)) {
+                    fields.push_back(line.substr(start, end - start));
+                    start = end + 1;
+                }
+                fields.push_back(line.substr(start));
+                if(fields.size() != 8 || fields[0].empty()) {
+                    continue;
+                }
+
+                try {
+                    Entry entry;
+                    if(!unescape(fields[0], entry.path) || !unescape(fields[6], entry.pluginName) || !unescape(fields[7], entry.error)) {
+                        continue;
+                    }
+                    entry.inode = std::stoull(fields[1]);
+                    entry.size = std::stoll(fields[2]);
+                    entry.modificationTime = std::stoll(fields[3]);
+                    entry.valid = (fields[4] == "1");
+                    entry.abiVersion = static_cast<std::uint32_t>(std::stoul(fields[5]));
+                    m_entries[entry.path] = entry;
+                }
+                catch(const std::exception &) {
+                    //malformed number
+                }
             }
         }
-    };
-
-    /// This class is all an easy use of collection of ServiceStatusPluginWrapper
-    class ServiceStatusPluginWrapperCollection
-    {
-        private:
-        std::string m_serviceName;
-        std::map<std::string, ServiceStatusPluginWrapper> m_serviceStatusPluginWrappers;
-        std::map<std::string, ServiceStatusProviderPtr> m_serviceStatusProviders;
 
         public:
-        /// Create a ServiceStatusPluginWrapperCollection
-        ServiceStatusPluginWrapperCollection(const std::string & serviceName) : m_serviceName(serviceName){}
+        /// Create the cache and read its file
+        ///@param cachePath [in] path of the file of the cache, which may not exist yet
+        explicit PluginManifestCache(const std::string & cachePath) : m_cachePath(cachePath) {
+            load();
+        }
 
-        ~ServiceStatusPluginWrapperCollection(){
-            //remove the objects first
-            m_serviceStatusProviders.clear();
+        PluginManifestCache(const PluginManifestCache &) = delete;
+        PluginManifestCache & operator=(const PluginManifestCache &) = delete;
+
+        /// Get the path of the file of the cache
+        const std::string & getCachePath() const noexcept { return m_cachePath; }
 
-            //remove the plugins after
-            m_serviceStatusPluginWrappers.clear();
+        /// Read the identity of a file: inode, size and modification time
+        ///@return false if the file does not exist
+        static bool readIdentity(const std::string & path, Entry & entry) noexcept {
+            struct stat info;
+            if(stat(path.c_str(), &info) != 0) {
+                return false;
+            }
+            entry.inode = static_cast<std::uint64_t>(info.st_ino);
+            entry.size = static_cast<std::int64_t>(info.st_size);
+            entry.modificationTime = static_cast<std::int64_t>(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+            return true;
         }
 
-        /// Get the service name
-        ///@return  service name
-        const std::string & getServiceName() const noexcept {return m_serviceName;}
+        /// Check if a file is an ELF object, the only kind of file dlopen can load
+        static bool isElfFile(const std::string & path) noexcept {
+            char magic[4] = {0, 0, 0, 0};
+            std::ifstream file(path, std::ios::binary);
+            file.read(magic, sizeof(magic));
+            return file && std::memcmp(magic, "\x7f" "ELF", sizeof(magic)) == 0;
+        }
 
-        /// Set the Health State for all the collection
-        ///@param hs [in] Health state to set
-        void setForAll(HealthState hs) noexcept { 
-            for(auto & item : m_serviceStatusProviders)
-            {
-                item.second->set(hs);
+        /// Find the result of the last probe of a file
+        ///@param path [in] path of the file
+        ///@param entry [out] result of the probe
+        ///@return false if the file was not probed or changed since the probe
+        bool lookup(const std::string & path, Entry & entry) const {
+            Entry current;
+            if(readIdentity(path, current)) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                auto it = m_entries.find(path);
+                if(it != m_entries.end() && it->second.inode == current.inode && it->second.size == current.size
+                        && it->second.modificationTime == current.modificationTime) {
+                    entry = it->second;
+                    m_hitCount.fetch_add(1, std::memory_order_relaxed);
+                    return true;
+                }
             }
+            m_missCount.fetch_add(1, std::memory_order_relaxed);
+            return false;
         }
 
-        /// Set the Operating Status for all the collection
-        ///@param os [in] Operating Status to set
-        void setForAll(OperatingStatus os) noexcept { 
-            for(auto & item : m_serviceStatusProviders)
-            {
-                item.second->set(os);
+        /// Record the result of the probe of a file, replacing the previous one
+        void record(const Entry & entry) {
+            if(entry.path.empty()) {
+                return;
+            }
+            std::lock_guard<std::mutex> lock(m_mutex);
+            Entry & current = m_entries[entry.path];
+            if(current.inode != entry.inode || current.size != entry.size || current.modificationTime != entry.modificationTime
+                    || current.valid != entry.valid || current.pluginName != entry.pluginName
+                    || current.abiVersion != entry.abiVersion || current.error != entry.error) {
+                current = entry;
+                m_modified = true;
             }
         }
 
-        /// Add a ServiceStatusProvider to the collection using the path to the plugin
-        /// @param pluginPath [in] Path of the plugin
-        void add(const std::string & pluginPath) {
-            ServiceStatusPluginWrapper newPlugin(pluginPath);
-            
-            if(m_serviceStatusProviders.count(newPlugin.getPluginName()) > 0) {
-                throw std::runtime_error("Plugin <"+newPlugin.getPluginName()+ "> already exist in the collection.");
+        /// Remove all the entries
+        void clear() {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_modified = m_modified || !m_entries.empty();
+            m_entries.clear();
+        }
+
+        /// Write the cache to its file if it changed
+        /// The file is written to a new file next to the cache file, created by mkstemp, and renamed over it,
+        /// so the readers never see a partial file.
+        ///@return false if the file could not be written
+        bool save() noexcept {
+            try {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                if(!m_modified) {
+                    return true;
+                }
+
+                std::string content = std::string(header()) + "\n";
+                for(const auto & item : m_entries) {
+                    const Entry & entry = item.second;
+                    content += escape(entry.path) + "\t" + std::to_string(entry.inode) + "\t" + std::to_string(entry.size) + "\t"
+                             + std::to_string(entry.modificationTime) + "\t" + (entry.valid ? "1" : "0") + "\t"
+                             + std::to_string(entry.abiVersion) + "\t" + escape(entry.pluginName) + "\t" + escape(entry.error) + "\n";
+                }
+
+                std::string temporaryPath = m_cachePath + ".XXXXXX";
+                int fd = mkstemp(&temporaryPath[0]);
+                if(fd < 0) {
+                    return false;
+                }
+                //mkstemp creates the file readable by its owner only, the cache is read by the other services
+                bool written = (fchmod(fd, 0644) == 0);
+                for(std::size_t offset = 0; written && offset < content.size(); ) {
+                    ssize_t count = write(fd, content.data() + offset, content.size() - offset);
+                    if(count < 0 && errno != EINTR) {
+                        written = false;
+                    } else if(count > 0) {
+                        offset += static_cast<std::size_t>(count);
+                    }
+                }
+                if(close(fd) != 0 || !written) {
+                    unlink(temporaryPath.c_str());
+                    return false;
+                }
+                if(rename(temporaryPath.c_str(), m_cachePath.c_str()) != 0) {
+                    unlink(temporaryPath.c_str());
+                    return false;
+                }
+                m_modified = false;
+                return true;
             }
+            catch(const std::exception &) {
+                return false;
+            }
+        }
 
-            m_serviceStatusProviders.emplace(newPlugin.getPluginName(), newPlugin.newServiceStatusProviderPtr(m_serviceName));
-            m_serviceStatusPluginWrappers.emplace(newPlugin.getPluginName(), newPlugin);
+        /// Get the number of entries
+        std::size_t size() const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_entries.size();
         }
 
-        /// Add all ServiceStatusProvider from a folder to the collection
-        ///@param folderPath [in] Path to the folder
-        ///@param regex [in] 
-        ///@return number of added ServiceStatusProvider
-        int addAll(const std::string & folderPath, const std::regex & regex = std::regex(".*")) {
-            
-            int added = 0;
-            for(auto & path : listPathOfFolderElements(folderPath, regex)) {
-                try {
-                    add(path);
-                    added++;
+        /// Get the number of lookups which found the file in the cache
+        std::uint64_t getHitCount() const noexcept { return m_hitCount.load(std::memory_order_relaxed); }
+
+        /// Get the number of lookups which did not find the file in the cache, or found it changed
+        std::uint64_t getMissCount() const noexcept { return m_missCount.load(std::memory_order_relaxed); }
+    };
+
+    /// Number of buckets of the latency histogram of PluginStats
+    constexpr std::size_t LATENCY_BUCKET_COUNT = 12;
+
+    /// Statistics of the calls to set() of one plugin
+    ///
+    /// The updates suppressed by the change suppression or skipped by the quarantine are not calls.
+    struct PluginStats
+    {
+        /// Name of the plugin
+        std::string pluginName;
+        /// Number of calls, including the failed ones
+        std::uint64_t calls = 0;
+        /// Number of calls which returned an error, or which could not be done because the plugin failed to load
+        std::uint64_t errors = 0;
+        /// getPluginLastError() after the last failed call
+        std::string lastError;
+        /// Number of calls per bucket of duration, see getBucketUpperBound
+        std::array<std::uint64_t, LATENCY_BUCKET_COUNT> latencyHistogram {};
+
+        /// Get the duration limit (excluded) of a bucket of the latency histogram
+        ///
+        /// The limits are 1.024 micro seconds multiplied by 4 at each bucket, the last bucket has no limit.
+        ///@param bucket [in] index of the bucket
+        ///@return limit of the bucket, std::chrono::nanoseconds::max() for the last one
+        static std::chrono::nanoseconds getBucketUpperBound(std::size_t bucket) noexcept {
+            return (bucket + 1 < LATENCY_BUCKET_COUNT) ? std::chrono::nanoseconds(std::int64_t(1024) << (2 * bucket))
+                                                       : std::chrono::nanoseconds::max();
+        }
+    };
+
+    namespace detail
+    {
+        /// Match a file name against a glob pattern
+        ///
+        /// '*' matches any sequence of characters and '?' matches exactly one character.
+        /// It is much cheaper than a std::regex, for example "*.so" is a plain suffix comparison.
+        ///@param pattern [in] glob pattern
+        ///@param name [in] name to check
+        ///@return true if the name matches the pattern
+        inline bool globMatch(const char * pattern, const char * name) noexcept {
+            const char * backtrackPattern = nullptr;
+            const char * backtrackName = nullptr;
+
+            while(*name != '\0') {
+                if(*pattern == '*') {
+                    //remember where to restart if the rest does not match
+                    backtrackPattern = ++pattern;
+                    backtrackName = name;
+                } else if(*pattern == '?' || *pattern == *name) {
+                    pattern++;
+                    name++;
+                } else if(backtrackPattern != nullptr) {
+                    pattern = backtrackPattern;
+                    name = ++backtrackName;
+                } else {
+                    return false;
                 }
-                catch(...){}
             }
 
-            return added;
+            while(*pattern == '*') {
+                pattern++;
+            }
+            return *pattern == '\0';
         }
 
-        /// Remove a ServiceStatusProvider to the collection using the name to the plugin
-        /// @param pluginName [in] Path of the plugin to remove
-        void remove( const std::string & pluginName ) noexcept { 
-            m_serviceStatusProviders.erase(pluginName);
-            m_serviceStatusPluginWrappers.erase(pluginName);
-        }
+        /// Bounded multi-producer/multi-consumer lock-free queue (Dmitry Vyukov's algorithm)
+        ///
+        /// T must be trivially copyable and default constructible.
+        template<typename T>
+        class BoundedQueue
+        {
+            struct Cell
+            {
+                std::atomic<std::size_t> sequence;
+                T data;
+            };
 
-        /// Get the ServiceStatusPluginWrapper from the collection.
-        /// The ServiceStatusPluginWrapper are inside a map with there name as a key
-        ///@return map of <name, ServiceStatusProvider>
-        const std::map<std::string, ServiceStatusPluginWrapper> & getPluginCollection() const noexcept { return m_serviceStatusPluginWrappers; }
+            private:
+            //keep producers and consumers positions on different cache lines
+            char m_pad0[64];
+            std::size_t m_mask;
+            std::unique_ptr<Cell[]> m_cells;
+            char m_pad1[64];
+            std::atomic<std::size_t> m_enqueuePos;
+            char m_pad2[64];
+            std::atomic<std::size_t> m_dequeuePos;
+            char m_pad3[64];
 
-        /// Helper which list the content of a folder and return their full path if they match to the regex
-        /// For example use "*.so" to get all the <file>.so path
-        ///@param folderPath [in] Path to the folder
-        ///@param regex [in] 
-        ///@return List of paths
-        static std::list<std::string> listPathOfFolderElements(const std::string & folderPath, const std::regex & regex = std::regex(".*")) {
-            std::list<std::string> listPathElements;
-            DIR *d;
-            struct dirent *dir;
-            d = opendir(folderPath.c_str());
+            static std::size_t roundUpPowerOf2(std::size_t value) noexcept {
+                std::size_t result = 2;
+                while(result < value) {
+                    result <<= 1;
+                }
+                return result;
+            }
 
-            if (d) {
-                while ((dir = readdir(d)) != NULL) {
-                    if(std::regex_match(dir->d_name, regex)){
-                        std::string path(folderPath +"/"+std::string(dir->d_name));
-                        char * fullPath = realpath(path.c_str(), NULL);
-                        listPathElements.push_back(fullPath);
-                        free(fullPath);
+            public:
+            /// Create a BoundedQueue
+            ///@param capacity [in] minimum number of elements, rounded up to a power of 2
+            explicit BoundedQueue(std::size_t capacity)
+                : m_mask(roundUpPowerOf2(capacity) - 1), m_cells(new Cell[m_mask + 1]), m_enqueuePos(0), m_dequeuePos(0) {
+                for(std::size_t i = 0; i <= m_mask; i++) {
+                    m_cells[i].sequence.store(i, std::memory_order_relaxed);
+                }
+            }
+
+            BoundedQueue(const BoundedQueue &) = delete;
+            BoundedQueue & operator=(const BoundedQueue &) = delete;
+
+            /// Number of elements the queue can hold
+            std::size_t capacity() const noexcept { return m_mask + 1; }
+
+            /// Try to push an element
+            ///@return false if the queue is full
+            bool push(const T & data) noexcept {
+                Cell * cell;
+                std::size_t pos = m_enqueuePos.load(std::memory_order_relaxed);
+                for(;;) {
+                    cell = &m_cells[pos & m_mask];
+                    std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+                    std::intptr_t dif = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos);
+                    if(dif == 0) {
+                        if(m_enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                            break;
+                        }
+                    } else if(dif < 0) {
+                        return false;
+                    } else {
+                        pos = m_enqueuePos.load(std::memory_order_relaxed);
                     }
                 }
-                closedir(d);
+                cell->data = data;
+                cell->sequence.store(pos + 1, std::memory_order_release);
+                return true;
             }
 
-            return listPathElements;
+            /// Try to pop an element
+            ///@return false if the queue is empty
+            bool pop(T & data) noexcept {
+                Cell * cell;
+                std::size_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+                for(;;) {
+                    cell = &m_cells[pos & m_mask];
+                    std::size_t seq = cell->sequence.load(std::memory_order_acquire);
+                    std::intptr_t dif = static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1);
+                    if(dif == 0) {
+                        if(m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                            break;
+                        }
+                    } else if(dif < 0) {
+                        return false;
+                    } else {
+                        pos = m_dequeuePos.load(std::memory_order_relaxed);
+                    }
+                }
+                data = cell->data;
+                cell->sequence.store(pos + m_mask + 1, std::memory_order_release);
+                return true;
+            }
+
+            /// Check if an element is ready to be popped
+            bool empty() const noexcept {
+                std::size_t pos = m_dequeuePos.load(std::memory_order_acquire);
+                std::size_t seq = m_cells[pos & m_mask].sequence.load(std::memory_order_acquire);
+                return static_cast<std::intptr_t>(seq) - static_cast<std::intptr_t>(pos + 1) < 0;
+            }
+        };
+
+        /// A status update waiting to be delivered to a provider
+        struct StatusUpdate
+        {
+            bool isHealthState;
+            bool isProbe;       ///< sent by the watchdog to a quarantined provider
+            bool isKeepalive;   ///< re-assertion of the last value requested by the service, resolved on delivery
+            std::uint8_t value;
+
+            StatusUpdate() noexcept : isHealthState(false), isProbe(false), isKeepalive(false), value(0) {}
+            explicit StatusUpdate(OperatingStatus os) noexcept : isHealthState(false), isProbe(false), isKeepalive(false), value(static_cast<std::uint8_t>(os)) {}
+            explicit StatusUpdate(HealthState hs) noexcept : isHealthState(true), isProbe(false), isKeepalive(false), value(static_cast<std::uint8_t>(hs)) {}
+        };
+
+        /// Monotonic time in nano seconds
+        inline std::int64_t monotonicNs() noexcept {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
         }
 
-    };
+        /// Counters shared by all the plugins of a collection
+        struct DeliveryCounters
+        {
+            std::atomic<std::uint64_t> dropped{0};
+            std::atomic<std::uint64_t> suppressed{0};
+            std::atomic<std::uint64_t> coalesced{0};
+            std::atomic<std::uint64_t> skipped{0};
+            std::atomic<std::uint64_t> keepalives{0};
+            std::atomic<std::uint64_t> freshKeepalives{0};
+        };
+
+        /// Statistics of the calls to one provider
+        ///
+        /// The counters use relaxed atomics, so concurrent callers can record without lock.
+        /// A successful call costs one atomic addition: the number of calls is the sum of the histogram.
+        /// Only the last error message, recorded on failure, is protected by a mutex.
+        class CallStats
+        {
+            private:
+            std::atomic<std::uint64_t> m_errors;
+            std::atomic<std::uint64_t> m_histogram[LATENCY_BUCKET_COUNT];
+
+            mutable std::mutex m_errorMutex;
+            std::string m_lastError;
+
+            public:
+            CallStats() noexcept : m_errors(0) {
+                for(auto & bucket : m_histogram) {
+                    bucket.store(0, std::memory_order_relaxed);
+                }
+            }
+
+            CallStats(const CallStats &) = delete;
+            CallStats & operator=(const CallStats &) = delete;
+
+            /// Get the bucket of the latency histogram of a duration
+            ///@param latency [in] duration in nano seconds
+            static std::size_t getBucket(std::int64_t latency) noexcept {
+                std::size_t bucket = 0;
+                std::int64_t bound = 1024;
+                while(latency >= bound && bucket + 1 < LATENCY_BUCKET_COUNT) {
+                    bound <<= 2;
+                    bucket++;
+                }
+                return bucket;
+            }
+
+            /// Record a call
+            ///@param latency [in] duration of the call in nano seconds
+            ///@param failed [in] true if the call returned an error
+            void record(std::int64_t latency, bool failed) noexcept {
+                if(failed) {
+                    m_errors.fetch_add(1, std::memory_order_relaxed);
+                }
+                m_histogram[getBucket(latency)].fetch_add(1, std::memory_order_relaxed);
+            }
+
+            /// Record the message of the last error
+            void setLastError(const std::string & error) noexcept {
+                std::lock_guard<std::mutex> lock(m_errorMutex);
+                try {
+                    m_lastError = error;
+                }
+                catch(...) {
+                    m_lastError.clear();
+                }
+            }
+
+            /// Copy the statistics, the counters are read one by one while calls may be recorded
+            ///@param stats [out] statistics, the name of the plugin is not changed
+            void get(PluginStats & stats) const {
+                stats.calls = 0;
+                for(std::size_t bucket = 0; bucket < LATENCY_BUCKET_COUNT; bucket++) {
+                    stats.latencyHistogram[bucket] = m_histogram[bucket].load(std::memory_order_relaxed);
+                    stats.calls += stats.latencyHistogram[bucket];
+                }
+                stats.errors = m_errors.load(std::memory_order_relaxed);
+
+                std::lock_guard<std::mutex> lock(m_errorMutex);
+                stats.lastError = m_lastError;
+            }
+        };
+
+        /// This class deliver the status updates to one provider
+        ///
+        /// It remembers the last value successfully delivered for each kind of update,
+        /// so unchanged values can be skipped when the change suppression is enabled.
+        /// It also measures the calls to quarantine the provider when it is too slow or keeps failing.
+        class ProviderChannel
+        {
+            private:
+            ServiceStatusProviderPtr m_provider;
+            std::shared_ptr<DeliveryCounters> m_counters;
+
+            //last delivered values, -1 if none or if the last call failed
+            std::atomic<int> m_lastOperatingStatus;
+            std::atomic<int> m_lastHealthState;
+            std::atomic<bool> m_changeSuppression;
+
+            //last values requested by the service, -1 if none
+            std::atomic<int> m_wantedOperatingStatus;
+            std::atomic<int> m_wantedHealthState;
+
+            //end of the last successful call, 0 if none
+            std::atomic<std::int64_t> m_lastSuccess;
+
+            //quarantine, all durations and times in nano seconds
+            std::atomic<std::int64_t> m_latencyBudget;
+            std::atomic<unsigned> m_maxConsecutiveErrors;
+            std::atomic<std::int64_t> m_initialBackoff;
+            std::atomic<std::int64_t> m_maxBackoff;
+
+            std::atomic<std::int64_t> m_callStart;
+            std::atomic<unsigned> m_consecutiveErrors;
+            std::atomic<bool> m_quarantined;
+            std::atomic<std::int64_t> m_backoff;
+            std::atomic<std::int64_t> m_nextProbe;
+            std::atomic<std::uint64_t> m_quarantineCount;
+
+            //lazy loading, the provider is created by the loader on first use
+            //Allocated only for the lazy channels, the others do not pay for it.
+            struct LazyLoader
+            {
+                std::function<ServiceStatusProviderPtr()> loader;
+                std::mutex mutex;
+                std::int64_t nextLoadAttempt = 0;
+                std::atomic<std::int64_t> lastUse {0};
+                std::string loadError;
+            };
+            std::unique_ptr<LazyLoader> m_lazy;
+
+            //statistics of the calls, the getter returns the last error of the plugin
+            CallStats m_stats;
+            std::function<std::string()> m_lastErrorGetter;
+
+            //delay between two attempts to load a failing plugin
+            static constexpr std::int64_t LOAD_RETRY_DELAY = 1000000000;
+
+            int callProvider(const StatusUpdate & update) noexcept {
+                return update.isHealthState ? m_provider->set(static_cast<HealthState>(update.value))
+                                            : m_provider->set(static_cast<OperatingStatus>(update.value));
+            }
+
+            //create the provider, the loader mutex must be locked
+            bool loadProvider(std::int64_t now) noexcept {
+                if(now < m_lazy->nextLoadAttempt) {
+                    return false;
+                }
+
+                try {
+                    m_provider = m_lazy->loader();
+                }
+                catch(const std::exception & e) {
+                    m_lazy->loadError = e.what();
+                    m_lazy->nextLoadAttempt = now + LOAD_RETRY_DELAY;
+                    return false;
+                }
+                catch(...) {
+                    m_lazy->loadError = "Unknown error";
+                    m_lazy->nextLoadAttempt = now + LOAD_RETRY_DELAY;
+                    return false;
+                }
+
+                //a new provider did not receive anything yet
+                m_lastOperatingStatus.store(-1, std::memory_order_relaxed);
+                m_lastHealthState.store(-1, std::memory_order_relaxed);
+                return true;
+            }
+
+            void recordLastError() noexcept {
+                if(m_lastErrorGetter) {
+                    try {
+                        m_stats.setLastError(m_lastErrorGetter());
+                    }
+                    catch(...) {
+                        m_stats.setLastError("");
+                    }
+                }
+            }
+
+            void recordCall(const StatusUpdate & update, int result, std::int64_t start, std::int64_t end) noexcept {
+                const bool failed = result < 0;
+                const std::int64_t budget = m_latencyBudget.load(std::memory_order_relaxed);
+                const bool slow = budget > 0 && (end - start) > budget;
+                const unsigned maxErrors = m_maxConsecutiveErrors.load(std::memory_order_relaxed);
+
+                const unsigned errors = failed ? m_consecutiveErrors.fetch_add(1, std::memory_order_relaxed) + 1 : 0;
+                if(!failed) {
+                    m_consecutiveErrors.store(0, std::memory_order_relaxed);
+                }
+
+                if(update.isProbe) {
+                    if(failed || slow) {
+                        extendQuarantine(end);
+                    } else {
+                        reinstate();
+                    }
+                } else if(slow || (maxErrors > 0 && errors >= maxErrors)) {
+                    quarantine(end);
+                }
+            }
+
+            public:
+            /// Create a ProviderChannel
+            ///@param provider [in] provider which receives the updates
+            ///@param counters [in] counters of the collection
+            ProviderChannel(ServiceStatusProviderPtr provider, std::shared_ptr<DeliveryCounters> counters) noexcept
+                : m_provider(provider), m_counters(counters), m_lastOperatingStatus(-1), m_lastHealthState(-1), m_changeSuppression(false),
+                  m_wantedOperatingStatus(-1), m_wantedHealthState(-1), m_lastSuccess(0),
+                  m_latencyBudget(0), m_maxConsecutiveErrors(0), m_initialBackoff(0), m_maxBackoff(0),
+                  m_callStart(0), m_consecutiveErrors(0), m_quarantined(false), m_backoff(0), m_nextProbe(0), m_quarantineCount(0) {}
+
+            /// Create a ProviderChannel which creates the provider on the first update
+            ///@param loader [in] function creating the provider
+            ///@param counters [in] counters of the collection
+            ProviderChannel(std::function<ServiceStatusProviderPtr()> loader, std::shared_ptr<DeliveryCounters> counters)
+                : ProviderChannel(ServiceStatusProviderPtr(), counters) {
+                m_lazy.reset(new LazyLoader());
+                m_lazy->loader = loader;
+            }
+
+            /// Check if the provider is created lazily
+            bool isLazy() const noexcept { return m_lazy != nullptr; }
+
+            /// Check if the provider exists
+            bool hasProvider() noexcept {
+                if(!m_lazy) {
+                    return true;
+                }
+                std::lock_guard<std::mutex> lock(m_lazy->mutex);
+                return m_provider != nullptr;
+            }
+
+            /// Destroy a lazily created provider if it was not used for a while
+            ///@param now [in] current monotonic time
+            ///@param idlePeriod [in] time without update in nano seconds
+            ///@return true if the provider was destroyed, it is created again on the next update
+            bool releaseIfIdle(std::int64_t now, std::int64_t idlePeriod) noexcept {
+                if(!m_lazy) {
+                    return false;
+                }
+
+                //a provider being called is not idle
+                std::unique_lock<std::mutex> lock(m_lazy->mutex, std::try_to_lock);
+                if(!lock.owns_lock() || !m_provider || (now - m_lazy->lastUse.load(std::memory_order_relaxed)) < idlePeriod) {
+                    return false;
+                }
+
+                m_provider.reset();
+                return true;
+            }
+
+            ProviderChannel(const ProviderChannel &) = delete;
+            ProviderChannel & operator=(const ProviderChannel &) = delete;
+
+            /// Set the function giving the last error of the plugin, called after a failed call
+            void setLastErrorGetter(std::function<std::string()> getter) { m_lastErrorGetter = getter; }
+
+            /// Check if the function giving the last error of the plugin is set
+            bool hasLastErrorGetter() const noexcept { return static_cast<bool>(m_lastErrorGetter); }
+
+            /// Get the statistics of the calls
+            ///@param stats [out] statistics, the name of the plugin is not changed
+            void getStats(PluginStats & stats) const { m_stats.get(stats); }
+
+            /// Enable or disable the skip of unchanged values
+            void setChangeSuppression(bool enable) noexcept { m_changeSuppression.store(enable, std::memory_order_relaxed); }
+
+            /// Check if unchanged values are skipped
+            bool hasChangeSuppression() const noexcept { return m_changeSuppression.load(std::memory_order_relaxed); }
+
+            /// Remember the value requested by the service, used to probe the provider when it is quarantined
+            void setWanted(const StatusUpdate & update) noexcept {
+                (update.isHealthState ? m_wantedHealthState : m_wantedOperatingStatus).store(update.value, std::memory_order_relaxed);
+            }
+
+            /// Get the last value requested by the service
+            ///@return -1 if none
+            int getWanted(bool healthState) const noexcept {
+                return (healthState ? m_wantedHealthState : m_wantedOperatingStatus).load(std::memory_order_relaxed);
+            }
+
+            /// Get the end of the last successful call to the provider
+            ///@return monotonic time, 0 if none
+            std::int64_t getLastSuccess() const noexcept { return m_lastSuccess.load(std::memory_order_relaxed); }
+
+            /// Deliver an update to the provider
+            ///
+            /// A keepalive delivers the last value requested by the service, even if it is unchanged. The value is read
+            /// again after the call, and delivered again if the service changed it meanwhile, so a keepalive racing with
+            /// a new value cannot leave the provider with the older one.
+            ///@return the value returned by the provider, 0 if the update was suppressed or if there is nothing to re-assert,
+            ///        -1 if it was skipped by the quarantine
+            int deliver(const StatusUpdate & update) noexcept {
+                if(!update.isKeepalive) {
+                    return deliverValue(update);
+                }
+
+                StatusUpdate keepalive(update);
+                int result = 0;
+                int wanted = getWanted(update.isHealthState);
+                //a service changing its status continuously delivers it anyway, do not chase it forever
+                for(unsigned attempt = 0; wanted >= 0 && attempt < 3; attempt++) {
+                    keepalive.value = static_cast<std::uint8_t>(wanted);
+                    result = deliverValue(keepalive);
+
+                    const int newer = getWanted(update.isHealthState);
+                    if(newer == wanted) {
+                        break;
+                    }
+                    wanted = newer;
+                }
+                return result;
+            }
+
+            /// Deliver a value to the provider
+            ///@return the value returned by the provider, 0 if the update was suppressed, -1 if it was skipped by the quarantine
+            int deliverValue(const StatusUpdate & update) noexcept {
+                if(!update.isProbe && isQuarantined()) {
+                    m_counters->skipped.fetch_add(1, std::memory_order_relaxed);
+                    return -1;
+                }
+
+                std::atomic<int> & last = update.isHealthState ? m_lastHealthState : m_lastOperatingStatus;
+                if(!update.isProbe && !update.isKeepalive && hasChangeSuppression() && last.load(std::memory_order_relaxed) == update.value) {
+                    m_counters->suppressed.fetch_add(1, std::memory_order_relaxed);
+                    return 0;
+                }
+
+                const std::int64_t start = monotonicNs();
+                m_callStart.store(start, std::memory_order_relaxed);
+
+                int result = -1;
+                if(m_lazy) {
+                    std::lock_guard<std::mutex> lock(m_lazy->mutex);
+                    if(m_provider || loadProvider(start)) {
+                        result = callProvider(update);
+                        if(result < 0) {
+                            recordLastError();
+                        }
+                    } else {
+                        m_stats.setLastError(m_lazy->loadError);
+                    }
+                    m_lazy->lastUse.store(start, std::memory_order_relaxed);
+                } else {
+                    result = callProvider(update);
+                    if(result < 0) {
+                        recordLastError();
+                    }
+                }
+
+                const std::int64_t end = monotonicNs();
+                m_callStart.store(0, std::memory_order_relaxed);
+
+                last.store(result < 0 ? -1 : update.value, std::memory_order_relaxed);
+                if(result >= 0) {
+                    m_lastSuccess.store(end, std::memory_order_relaxed);
+                }
+                m_stats.record(end - start, result < 0);
+                recordCall(update, result, start, end);
+                return result;
+            }
+
+            /// Configure the quarantine
+            ///@param settings [in] settings of the watchdog
+            void configureQuarantine(const WatchdogSettings & settings) noexcept {
+                m_latencyBudget.store(std::chrono::duration_cast<std::chrono::nanoseconds>(settings.latencyBudget).count(), std::memory_order_relaxed);
+                m_maxConsecutiveErrors.store(settings.maxConsecutiveErrors, std::memory_order_relaxed);
+                m_initialBackoff.store(std::chrono::duration_cast<std::chrono::nanoseconds>(settings.initialBackoff).count(), std::memory_order_relaxed);
+                m_maxBackoff.store(std::chrono::duration_cast<std::chrono::nanoseconds>(settings.maxBackoff).count(), std::memory_order_relaxed);
+            }
+
+            /// Set the maximum duration of a call to the provider
+            void setLatencyBudget(std::chrono::nanoseconds budget) noexcept { m_latencyBudget.store(budget.count(), std::memory_order_relaxed); }
+
+            /// Get the maximum duration of a call to the provider, 0 if there is no limit
+            std::int64_t getLatencyBudget() const noexcept { return m_latencyBudget.load(std::memory_order_relaxed); }
+
+            /// Get the start time of the call in progress, 0 if the provider is not called
+            std::int64_t getCallStart() const noexcept { return m_callStart.load(std::memory_order_relaxed); }
+
+            /// Check if the provider is quarantined
+            bool isQuarantined() const noexcept { return m_quarantined.load(std::memory_order_acquire); }
+
+            /// Get the number of times the provider was quarantined
+            std::uint64_t getQuarantineCount() const noexcept { return m_quarantineCount.load(std::memory_order_relaxed); }
+
+            /// Get the time of the next probe of a quarantined provider
+            std::int64_t getNextProbe() const noexcept { return m_nextProbe.load(std::memory_order_relaxed); }
+
+            /// Put the provider in quarantine, nothing is done if it is already quarantined
+            ///@param now [in] current monotonic time
+            void quarantine(std::int64_t now) noexcept {
+                if(!m_quarantined.exchange(true, std::memory_order_acq_rel)) {
+                    const std::int64_t backoff = m_initialBackoff.load(std::memory_order_relaxed);
+                    m_backoff.store(backoff, std::memory_order_relaxed);
+                    m_nextProbe.store(now + backoff, std::memory_order_relaxed);
+                    m_quarantineCount.fetch_add(1, std::memory_order_relaxed);
+                }
+            }
+
+            /// Keep the provider in quarantine and double the delay before the next probe
+            ///@param now [in] current monotonic time
+            void extendQuarantine(std::int64_t now) noexcept {
+                const std::int64_t backoff = std::min(m_backoff.load(std::memory_order_relaxed) * 2, m_maxBackoff.load(std::memory_order_relaxed));
+                m_backoff.store(backoff, std::memory_order_relaxed);
+                m_nextProbe.store(now + backoff, std::memory_order_relaxed);
+            }
+
+            /// Postpone the next probe, while a probe is in progress
+            ///@param now [in] current monotonic time
+            void postponeProbe(std::int64_t now) noexcept {
+                m_nextProbe.store(now + m_backoff.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            }
+
+            /// Take the provider out of the quarantine
+            void reinstate() noexcept {
+                m_consecutiveErrors.store(0, std::memory_order_relaxed);
+                m_quarantined.store(false, std::memory_order_release);
+            }
+        };
+
+        using ProviderChannelPtr = std::shared_ptr<ProviderChannel>;
+
+        /// This class deliver the status updates to one provider from a dedicated thread
+        ///
+        /// Updates are delivered in the order they were pushed.
+        /// When the change suppression of the channel is enabled, the pending updates are coalesced:
+        /// only the newest Operating Status and the newest Health State are delivered.
+        /// The destructor delivers the pending updates before stopping the thread.
+        class ServiceStatusDispatcher
+        {
+            private:
+            ProviderChannelPtr m_channel;
+            std::shared_ptr<DeliveryCounters> m_counters;
+            OverflowPolicy m_policy;
+            std::chrono::milliseconds m_blockTimeout;
+            BoundedQueue<StatusUpdate> m_queue;
+
+            std::atomic<std::uint64_t> m_pushed;
+            std::atomic<std::uint64_t> m_processed;
+
+            //wake up of the dispatcher thread
+            std::mutex m_mutex;
+            std::condition_variable m_cv;
+            std::atomic<bool> m_waiting;
+            bool m_stop;
+
+            //wake up of the flush callers, and of the callers blocked on a full queue
+            std::mutex m_flushMutex;
+            std::condition_variable m_flushCv;
+            std::atomic<unsigned> m_flushWaiters;
+
+            std::thread m_thread;
+
+            static void merge(StatusUpdate & latest, const StatusUpdate & update) noexcept {
+                const bool probe = latest.isProbe || update.isProbe;
+                const bool keepalive = latest.isKeepalive || update.isKeepalive;
+                latest = update;
+                latest.isProbe = probe;
+                latest.isKeepalive = keepalive;
+            }
+
+            //pop all the pending updates and deliver only the newest of each kind, in order of arrival
+            void deliverCoalesced(const StatusUpdate & first) noexcept {
+                StatusUpdate latest[2] = {first, first};
+                bool present[2] = {!first.isHealthState, first.isHealthState};
+                bool healthLast = first.isHealthState;
+                std::uint64_t popped = 1;
+
+                StatusUpdate update;
+                while(popped < m_queue.capacity() && m_queue.pop(update)) {
+                    if(present[update.isHealthState]) {
+                        merge(latest[update.isHealthState], update);
+                    } else {
+                        latest[update.isHealthState] = update;
+                    }
+                    present[update.isHealthState] = true;
+                    healthLast = update.isHealthState;
+                    popped++;
+                }
+
+                const std::uint64_t delivered = (present[0] ? 1 : 0) + (present[1] ? 1 : 0);
+                m_counters->coalesced.fetch_add(popped - delivered, std::memory_order_relaxed);
+
+                //the kind updated last is delivered last
+                if(present[!healthLast]) {
+                    m_channel->deliver(latest[!healthLast]);
+                }
+                m_channel->deliver(latest[healthLast]);
+
+                notifyProcessed(popped);
+            }
+
+            void notifyProcessed(std::uint64_t count) noexcept {
+                m_processed.fetch_add(count);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if(m_flushWaiters.load(std::memory_order_relaxed) > 0) {
+                    std::lock_guard<std::mutex> lock(m_flushMutex);
+                    m_flushCv.notify_all();
+                }
+            }
+
+            //queue the update once the dispatcher made room, the caller sleeps until notifyProcessed wakes it up
+            //@return false if the block timeout expired
+            bool pushWhenRoom(const StatusUpdate & update) noexcept {
+                const auto pushed = [this, &update] { return m_queue.push(update); };
+                std::unique_lock<std::mutex> lock(m_flushMutex);
+                m_flushWaiters.fetch_add(1);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                bool queued = true;
+                if(m_blockTimeout.count() > 0) {
+                    queued = m_flushCv.wait_for(lock, m_blockTimeout, pushed);
+                } else {
+                    m_flushCv.wait(lock, pushed);
+                }
+                m_flushWaiters.fetch_sub(1);
+                return queued;
+            }
+
+            void run() noexcept {
+                for(;;) {
+                    StatusUpdate update;
+                    if(m_queue.pop(update)) {
+                        if(m_channel->hasChangeSuppression()) {
+                            deliverCoalesced(update);
+                        } else {
+                            m_channel->deliver(update);
+                            notifyProcessed(1);
+                        }
+                        continue;
+                    }
+
+                    std::unique_lock<std::mutex> lock(m_mutex);
+                    m_waiting.store(true);
+                    std::atomic_thread_fence(std::memory_order_seq_cst);
+                    m_cv.wait(lock, [this] { return m_stop || !m_queue.empty(); });
+                    m_waiting.store(false, std::memory_order_relaxed);
+
+                    if(m_stop && m_queue.empty()) {
+                        break;
+                    }
+                }
+            }
+
+            public:
+            /// Create a ServiceStatusDispatcher and start its thread
+            ///@param channel [in] channel to the provider which receives the updates
+            ///@param counters [in] counters of the collection
+            ///@param queueCapacity [in] number of pending updates which can be stored
+            ///@param policy [in] policy to apply when the queue is full
+            ///@param blockTimeout [in] maximum wait for room with OverflowPolicy::Block before the update is dropped, 0 for ever
+            ServiceStatusDispatcher(ProviderChannelPtr channel, std::shared_ptr<DeliveryCounters> counters,
+                                    std::size_t queueCapacity, OverflowPolicy policy,
+                                    std::chrono::milliseconds blockTimeout = std::chrono::milliseconds(0))
+                : m_channel(channel), m_counters(counters), m_policy(policy), m_blockTimeout(blockTimeout), m_queue(queueCapacity),
+                  m_pushed(0), m_processed(0), m_waiting(false), m_stop(false), m_flushWaiters(0) {
+                m_thread = std::thread(&ServiceStatusDispatcher::run, this);
+            }
+
+            ServiceStatusDispatcher(const ServiceStatusDispatcher &) = delete;
+            ServiceStatusDispatcher & operator=(const ServiceStatusDispatcher &) = delete;
+
+            ~ServiceStatusDispatcher() {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_stop = true;
+                }
+                m_cv.notify_one();
+                m_thread.join();
+            }
+
+            /// Queue an update for delivery, without waiting for the provider
+            ///
+            /// With OverflowPolicy::Block, the caller sleeps until the dispatcher makes room or the block timeout expires.
+            ///@return false if the update was discarded by the overflow policy
+            bool push(const StatusUpdate & update) noexcept {
+                //counted before it is queued, so the dispatcher never processes more than was pushed
+                m_pushed.fetch_add(1);
+                bool queued = m_queue.push(update);
+                while(!queued && m_policy == OverflowPolicy::DropOldest) {
+                    StatusUpdate oldest;
+                    if(m_queue.pop(oldest)) {
+                        m_counters->dropped.fetch_add(1, std::memory_order_relaxed);
+                        notifyProcessed(1);
+                    }
+                    queued = m_queue.push(update);
+                }
+                if(!queued && m_policy == OverflowPolicy::Block) {
+                    queued = pushWhenRoom(update);
+                }
+                if(!queued) {
+                    m_counters->dropped.fetch_add(1, std::memory_order_relaxed);
+                    notifyProcessed(1);
+                    return false;
+                }
+
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if(m_waiting.load(std::memory_order_relaxed)) {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_cv.notify_one();
+                }
+                return true;
+            }
+
+            /// Get the channel to the provider
+            const ProviderChannelPtr & getChannel() const noexcept { return m_channel; }
+
+            /// Check if all the pushed updates were processed
+            bool isIdle() const noexcept { return m_processed.load() >= m_pushed.load(); }
+
+            /// Wait for the updates pushed before the call to be delivered
+            ///@param timeout [in] maximum time to wait
+            ///@return true if all the updates were delivered, false on timeout
+            bool flush(std::chrono::milliseconds timeout) noexcept {
+                const std::uint64_t target = m_pushed.load();
+                std::unique_lock<std::mutex> lock(m_flushMutex);
+                m_flushWaiters.fetch_add(1);
+                bool done = m_flushCv.wait_for(lock, timeout, [this, target] { return m_processed.load() >= target; });
+                m_flushWaiters.fetch_sub(1);
+                return done;
+            }
+        };
+
+        /// This class watches the providers from a dedicated thread
+        ///
+        /// A provider whose call exceeds the latency budget is quarantined while the call is still in progress.
+        /// A quarantined provider is probed through its dispatcher with the last values requested by the service,
+        /// with an exponential backoff, and reinstated when the probe succeeds within the budget.
+        class ServiceStatusWatchdog
+        {
+            struct Watched
+            {
+                ProviderChannelPtr channel;
+                ServiceStatusDispatcher * dispatcher;
+            };
+
+            private:
+            std::chrono::milliseconds m_checkPeriod;
+            std::map<std::string, Watched> m_watched;
+
+            std::mutex m_mutex;
+            std::condition_variable m_cv;
+            bool m_stop;
+            std::thread m_thread;
+
+            void check(Watched & watched) noexcept {
+                ProviderChannel & channel = *watched.channel;
+                const std::int64_t now = monotonicNs();
+
+                const std::int64_t callStart = channel.getCallStart();
+                const std::int64_t budget = channel.getLatencyBudget();
+                if(callStart != 0 && budget > 0 && (now - callStart) > budget) {
+                    channel.quarantine(now);
+                }
+
+                if(!channel.isQuarantined() || callStart != 0 || now < channel.getNextProbe() || !watched.dispatcher->isIdle()) {
+                    return;
+                }
+
+                const int os = channel.getWanted(false);
+                const int hs = channel.getWanted(true);
+                if(os < 0 && hs < 0) {
+                    //nothing to probe with
+                    channel.reinstate();
+                    return;
+                }
+
+                channel.postponeProbe(now);
+                if(os >= 0) {
+                    StatusUpdate probe(static_cast<OperatingStatus>(os));
+                    probe.isProbe = true;
+                    watched.dispatcher->push(probe);
+                }
+                if(hs >= 0) {
+                    StatusUpdate probe(static_cast<HealthState>(hs));
+                    probe.isProbe = true;
+                    watched.dispatcher->push(probe);
+                }
+            }
+
+            void run() noexcept {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                while(!m_stop) {
+                    for(auto & item : m_watched) {
+                        check(item.second);
+                    }
+                    m_cv.wait_for(lock, m_checkPeriod, [this] { return m_stop; });
+                }
+            }
+
+            public:
+            /// Create a ServiceStatusWatchdog and start its thread
+            ///@param checkPeriod [in] period of the checks
+            explicit ServiceStatusWatchdog(std::chrono::milliseconds checkPeriod)
+                : m_checkPeriod(checkPeriod), m_stop(false) {
+                m_thread = std::thread(&ServiceStatusWatchdog::run, this);
+            }
+
+            ServiceStatusWatchdog(const ServiceStatusWatchdog &) = delete;
+            ServiceStatusWatchdog & operator=(const ServiceStatusWatchdog &) = delete;
+
+            ~ServiceStatusWatchdog() {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_stop = true;
+                }
+                m_cv.notify_one();
+                m_thread.join();
+            }
+
+            /// Start to watch a provider
+            ///@param name [in] name of the plugin
+            ///@param channel [in] channel to the provider
+            ///@param dispatcher [in] dispatcher of the provider, must be unwatched before being destroyed
+            void watch(const std::string & name, const ProviderChannelPtr & channel, ServiceStatusDispatcher * dispatcher) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_watched[name] = Watched{channel, dispatcher};
+            }
+
+            /// Stop to watch a provider
+            ///@param name [in] name of the plugin
+            void unwatch(const std::string & name) noexcept {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_watched.erase(name);
+            }
+        };
+
+        /// Counters of the readers of all the SnapshotPublisher of the process
+        ///
+        /// A publisher needs two groups of counters spread over the threads. The counters of the publishers are
+        /// interleaved: a cache line holds the counters of one shard of threads for 8 publishers, so the readers of
+        /// two shards never share a line and a publisher takes 256 bytes instead of 2 KB of padded counters.
+        /// The places of a block are reused, and a block is freed when its last publisher is destroyed.
+        class ReaderCounterArena
+        {
+            public:
+            static constexpr std::size_t SHARD_COUNT = 16;
+            static constexpr std::size_t PUBLISHERS_PER_LINE = 8;
+
+            struct alignas(64) Line
+            {
+                std::atomic<std::int64_t> values[PUBLISHERS_PER_LINE];
+            };
+
+            struct Block
+            {
+                Line lines[2][SHARD_COUNT];
+                std::uint32_t used;     //one bit per place
+                Block * next;
+            };
+
+            /// Place of the counters of one publisher
+            struct Place
+            {
+                Block * block;
+                std::size_t index;
+            };
+
+            private:
+            static constexpr std::uint32_t ALL_USED = (std::uint32_t(1) << PUBLISHERS_PER_LINE) - 1;
+
+            static std::mutex & getMutex() noexcept {
+                static std::mutex mutex;
+                return mutex;
+            }
+
+            static Block *& getHead() noexcept {
+                static Block * head = nullptr;
+                return head;
+            }
+
+            public:
+            /// Get the shard of the calling thread
+            static std::size_t getShard() noexcept {
+                static std::atomic<std::size_t> nextShard(0);
+                static thread_local std::size_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % SHARD_COUNT;
+                return shard;
+            }
+
+            /// Take the place of a new publisher, its counters are 0
+            static Place acquire() {
+                std::lock_guard<std::mutex> lock(getMutex());
+                Block * block = getHead();
+                while(block != nullptr && block->used == ALL_USED) {
+                    block = block->next;
+                }
+                if(block == nullptr) {
+                    block = new Block();
+                    for(auto & group : block->lines) {
+                        for(Line & line : group) {
+                            for(std::atomic<std::int64_t> & value : line.values) {
+                                value.store(0, std::memory_order_relaxed);
+                            }
+                        }
+                    }
+                    block->used = 0;
+                    block->next = getHead();
+                    getHead() = block;
+                }
+
+                //the counters of a released place went back to 0 with its last reader
+                std::size_t index = 0;
+                while(block->used & (std::uint32_t(1) << index)) {
+                    index++;
+                }
+                block->used |= std::uint32_t(1) << index;
+                return Place{block, index};
+            }
+
+            /// Get the number of blocks in use
+            static std::size_t getBlockCount() noexcept {
+                std::lock_guard<std::mutex> lock(getMutex());
+                std::size_t count = 0;
+                for(const Block * block = getHead(); block != nullptr; block = block->next) {
+                    count++;
+                }
+                return count;
+            }
+
+            /// Give back the place of a destroyed publisher, it has no reader anymore
+            static void release(const Place & place) noexcept {
+                std::lock_guard<std::mutex> lock(getMutex());
+                place.block->used &= ~(std::uint32_t(1) << place.index);
+                if(place.block->used != 0) {
+                    return;
+                }
+
+                Block ** link = &getHead();
+                while(*link != place.block) {
+                    link = &(*link)->next;
+                }
+                *link = place.block->next;
+                delete place.block;
+            }
+        };
+
+        /// Publication of an immutable object which is read without lock
+        ///
+        /// The readers announce themselves in one of two groups of counters (left-right), read the current object
+        /// and leave. A writer publishes a new object, then waits until every reader which may still use the previous
+        /// object has left, before destroying it. New readers join the other group, so the writer cannot be starved.
+        /// Each group is spread over the shards of threads of the ReaderCounterArena to limit the contention between readers.
+        /// The writers must be serialized by the caller. A reader must not publish.
+        template<typename T>
+        class SnapshotPublisher
+        {
+            private:
+            using Arena = ReaderCounterArena;
+
+            Arena::Place m_place;
+            std::atomic<unsigned> m_group;
+            std::atomic<const T *> m_current;
+            std::unique_ptr<const T> m_object;
+
+            std::atomic<std::int64_t> & getCounter(unsigned group, std::size_t shard) const noexcept {
+                return m_place.block->lines[group][shard].values[m_place.index];
+            }
+
+            void waitForReaders(unsigned group) const noexcept {
+                for(std::size_t shard = 0; shard < Arena::SHARD_COUNT; shard++) {
+                    while(getCounter(group, shard).load() != 0) {
+                        std::this_thread::yield();
+                    }
+                }
+            }
+
+            public:
+            /// Access to the current object, valid until the guard is destroyed
+            class ReadGuard
+            {
+                private:
+                std::atomic<std::int64_t> * m_counter;
+                const T * m_object;
+
+                public:
+                ReadGuard(std::atomic<std::int64_t> & counter, const T * object) noexcept : m_counter(&counter), m_object(object) {}
+                ReadGuard(ReadGuard && other) noexcept : m_counter(other.m_counter), m_object(other.m_object) { other.m_counter = nullptr; }
+                ReadGuard(const ReadGuard &) = delete;
+                ReadGuard & operator=(const ReadGuard &) = delete;
+
+                ~ReadGuard() {
+                    if(m_counter != nullptr) {
+                        m_counter->fetch_sub(1, std::memory_order_release);
+                    }
+                }
+
+                const T & operator*() const noexcept { return *m_object; }
+                const T * operator->() const noexcept { return m_object; }
+            };
+
+            /// Create a publisher
+            ///@param object [in] initial object
+            explicit SnapshotPublisher(std::unique_ptr<const T> object)
+                : m_place(Arena::acquire()), m_group(0), m_current(object.get()), m_object(std::move(object)) {}
+
+            ~SnapshotPublisher() {
+                Arena::release(m_place);
+            }
+
+            SnapshotPublisher(const SnapshotPublisher &) = delete;
+            SnapshotPublisher & operator=(const SnapshotPublisher &) = delete;
+
+            /// Read the current object, without lock
+            ReadGuard read() const noexcept {
+                std::atomic<std::int64_t> & counter = getCounter(m_group.load() & 1, Arena::getShard());
+                counter.fetch_add(1);
+                return ReadGuard(counter, m_current.load());
+            }
+
+            /// Replace the object, the previous one is destroyed once no reader uses it
+            ///@param object [in] new object
+            void publish(std::unique_ptr<const T> object) noexcept {
+                m_current.store(object.get());
+
+                //the readers of the previous object are in the current group, or in the other one if they read
+                //the group before the previous publication: drain the other group, switch, drain the old group
+                const unsigned group = m_group.load() & 1;
+                waitForReaders(group ^ 1);
+                m_group.store(group ^ 1);
+                waitForReaders(group);
+
+                m_object = std::move(object);
+            }
+        };
+
+    } //namespace detail
+
+    /// Status of a service recorded by a LocalStatusRegistry
+    struct LocalStatus
+    {
+        OperatingStatus operatingStatus = OperatingStatus::Unknown;
+        HealthState healthState = HealthState::Unknown;
+        /// Time of the last change of the Operating Status or of the Health State in milli seconds since the Unix epoch,
+        /// 0 if the status was never set
+        std::int64_t transitionTime = 0;
+    };
+
+    /// Change of the status of a service, given to the subscribers of a LocalStatusRegistry
+    struct LocalStatusChange
+    {
+        /// Index of the service in the registry
+        std::size_t index;
+        /// Name of the service, valid while the registry exists
+        const std::string * serviceName;
+        LocalStatus previous;
+        LocalStatus current;
+    };
+
+    /// Last status of the services of the process, readable without leaving the process
+    ///
+    /// The status of each service is packed in one 64 bits atomic of a fixed array: the Operating Status,
+    /// the Health State and the transition time in milli seconds (48 bits). The reads and the updates are lock-free,
+    /// and the service names are found in an open addressing table which is also read without lock.
+    /// The services are added once and never removed, up to the capacity given at the creation.
+    ///
+    /// The subscribers are called in the thread which changed the status, without lock held by the registry.
+    /// A callback must not subscribe or unsubscribe, and must not throw.
+    ///
+    /// The registry is filled by ServiceStatusPluginWrapperCollection::setLocalStatusRegistry,
+    /// or by the providers returned by newProvider.
+    class LocalStatusRegistry
+    {
+        public:
+        /// Called on each change of a status
+        using Callback = std::function<void(const LocalStatusChange &)>;
+
+        /// Index returned when a service is not known
+        static constexpr std::size_t NOT_FOUND = static_cast<std::size_t>(-1);
+
+        private:
+        struct Subscriber
+        {
+            std::uint64_t id;
+            Callback callback;
+        };
+        using Subscribers = std::vector<Subscriber>;
+
+        //provider writing in the registry
+        class Provider : public ServiceStatusProvider
+        {
+            private:
+            std::shared_ptr<LocalStatusRegistry> m_registry;
+            std::size_t m_index;
+
+            public:
+            Provider(std::shared_ptr<LocalStatusRegistry> registry, std::size_t index) noexcept : m_registry(registry), m_index(index) {}
+
+            const char * getServiceName() const noexcept override { return m_registry->getServiceName(m_index).c_str(); }
+            int set(OperatingStatus os) noexcept override { m_registry->set(m_index, os); return 0; }
+            int set(HealthState hs) noexcept override { m_registry->set(m_index, hs); return 0; }
+        };
+
+        static constexpr std::uint64_t OPERATING_STATUS_MASK = 0xff;
+        static constexpr std::uint64_t HEALTH_STATE_MASK = 0xff00;
+        static constexpr unsigned TIME_SHIFT = 16;
+
+        std::size_t m_capacity;
+        std::unique_ptr<std::atomic<std::uint64_t>[]> m_states;
+        std::unique_ptr<std::string[]> m_names;
+        std::atomic<std::size_t> m_count;
+
+        //index of the services by hash of their name, NOT_FOUND in the free buckets
+        std::size_t m_bucketMask;
+        std::unique_ptr<std::atomic<std::size_t>[]> m_buckets;
+
+        //serializes the additions of services and the subscriptions
+        std::mutex m_mutex;
+        std::uint64_t m_nextSubscriberId;
+        detail::SnapshotPublisher<Subscribers> m_subscribers {std::unique_ptr<const Subscribers>(new Subscribers())};
+
+        static std::int64_t nowMs() noexcept {
+            return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+        }
+
+        static LocalStatus unpack(std::uint64_t state) noexcept {
+            LocalStatus status;
+            status.operatingStatus = static_cast<OperatingStatus>(state & OPERATING_STATUS_MASK);
+            status.healthState = static_cast<HealthState>((state & HEALTH_STATE_MASK) >> 8);
+            status.transitionTime = static_cast<std::int64_t>(state >> TIME_SHIFT);
+            return status;
+        }
+
+        //replace the bits of the mask, the subscribers are notified if the value changed
+        void update(std::size_t index, std::uint64_t mask, std::uint64_t value) noexcept {
+            if(index >= m_count.load(std::memory_order_acquire)) {
+                return;
+            }
+
+            std::atomic<std::uint64_t> & state = m_states[index];
+            std::uint64_t previous = state.load(std::memory_order_relaxed);
+            std::uint64_t current;
+            do {
+                if((previous & mask) == value) {
+                    return;
+                }
+                current = (previous & ~mask & (OPERATING_STATUS_MASK | HEALTH_STATE_MASK)) | value
+                        | (static_cast<std::uint64_t>(nowMs()) << TIME_SHIFT);
+            } while(!state.compare_exchange_weak(previous, current, std::memory_order_acq_rel, std::memory_order_relaxed));
+
+            const auto subscribers = m_subscribers.read();
+            if(subscribers->empty()) {
+                return;
+            }
+
+            const LocalStatusChange change{index, &m_names[index], unpack(previous), unpack(current)};
+            for(const Subscriber & subscriber : *subscribers) {
+                try {
+                    subscriber.callback(change);
+                }
+                catch(...) {
+                    //a callback must not throw, the other subscribers are still notified
+                }
+            }
+        }
+
+        public:
+        /// Create a LocalStatusRegistry
+        ///@param capacity [in] maximum number of services
+        explicit LocalStatusRegistry(std::size_t capacity)
+            : m_capacity(capacity), m_states(new std::atomic<std::uint64_t>[capacity]), m_names(new std::string[capacity]),
+              m_count(0), m_bucketMask(0), m_nextSubscriberId(1) {
+            for(std::size_t i = 0; i < capacity; i++) {
+                m_states[i].store(0, std::memory_order_relaxed);
+            }
+
+            //at most half of the buckets are used
+            std::size_t buckets = 2;
+            while(buckets < 2 * capacity) {
+                buckets <<= 1;
+            }
+            m_bucketMask = buckets - 1;
+            m_buckets.reset(new std::atomic<std::size_t>[buckets]);
+            for(std::size_t i = 0; i < buckets; i++) {
+                m_buckets[i].store(NOT_FOUND, std::memory_order_relaxed);
+            }
+        }
+
+        LocalStatusRegistry(const LocalStatusRegistry &) = delete;
+        LocalStatusRegistry & operator=(const LocalStatusRegistry &) = delete;
+
+        /// Get the maximum number of services
+        std::size_t getCapacity() const noexcept { return m_capacity; }
+
+        /// Get the number of services
+        std::size_t getServiceCount() const noexcept { return m_count.load(std::memory_order_acquire); }
+
+        /// Add a service, nothing is done if it is known
+        ///@param serviceName [in] name of the service
+        ///@return index of the service
+        std::size_t addService(const std::string & serviceName) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::size_t bucket = std::hash<std::string>()(serviceName) & m_bucketMask;
+            for(std::size_t index = m_buckets[bucket].load(std::memory_order_relaxed); index != NOT_FOUND;
+                    index = m_buckets[bucket].load(std::memory_order_relaxed)) {
+                if(m_names[index] == serviceName) {
+                    return index;
+                }
+                bucket = (bucket + 1) & m_bucketMask;
+            }
+
+            const std::size_t index = m_count.load(std::memory_order_relaxed);
+            if(index >= m_capacity) {
+                throw std::length_error("The local status registry is full, cannot add the service <" + serviceName + ">");
+            }
+
+            //the name is written before the index is published
+            m_names[index] = serviceName;
+            m_count.store(index + 1, std::memory_order_release);
+            m_buckets[bucket].store(index, std::memory_order_release);
+            return index;
+        }
+
+        /// Find a service, without lock
+        ///@param serviceName [in] name of the service
+        ///@return index of the service, NOT_FOUND if it is not known
+        std::size_t find(const std::string & serviceName) const noexcept {
+            std::size_t bucket = std::hash<std::string>()(serviceName) & m_bucketMask;
+            for(std::size_t index = m_buckets[bucket].load(std::memory_order_acquire); index != NOT_FOUND;
+                    index = m_buckets[bucket].load(std::memory_order_acquire)) {
+                if(m_names[index] == serviceName) {
+                    return index;
+                }
+                bucket = (bucket + 1) & m_bucketMask;
+            }
+            return NOT_FOUND;
+        }
+
+        /// Get the name of a service
+        ///@param index [in] index of the service, lower than getServiceCount()
+        const std::string & getServiceName(std::size_t index) const noexcept { return m_names[index]; }
+
+        /// Get the status of a service, without lock
+        ///@param index [in] index of the service
+        ///@return the status, Unknown with a transition time of 0 if the service was never set or is not known
+        LocalStatus get(std::size_t index) const noexcept {
+            if(index >= m_count.load(std::memory_order_acquire)) {
+                return LocalStatus();
+            }
+            return unpack(m_states[index].load(std::memory_order_acquire));
+        }
+
+        /// Get the status of a service, without lock
+        ///@param serviceName [in] name of the service
+        ///@return the status, Unknown with a transition time of 0 if the service was never set or is not known
+        LocalStatus get(const std::string & serviceName) const noexcept { return get(find(serviceName)); }
+
+        /// Set the Operating Status of a service, the subscribers are notified if it changed
+        ///@param index [in] index of the service, nothing is done if it is not known
+        ///@param os [in] Operating Status to set
+        void set(std::size_t index, OperatingStatus os) noexcept {
+            update(index, OPERATING_STATUS_MASK, static_cast<std::uint64_t>(os));
+        }
+
+        /// Set the Health State of a service, the subscribers are notified if it changed
+        ///@param index [in] index of the service, nothing is done if it is not known
+        ///@param hs [in] Health state to set
+        void set(std::size_t index, HealthState hs) noexcept {
+            update(index, HEALTH_STATE_MASK, static_cast<std::uint64_t>(hs) << 8);
+        }
+
+        /// Set the Operating Status and the Health State of a service, the subscribers are notified once if one changed
+        ///@param index [in] index of the service, nothing is done if it is not known
+        ///@param os [in] Operating Status to set
+        ///@param hs [in] Health state to set
+        void set(std::size_t index, OperatingStatus os, HealthState hs) noexcept {
+            update(index, OPERATING_STATUS_MASK | HEALTH_STATE_MASK, static_cast<std::uint64_t>(os) | (static_cast<std::uint64_t>(hs) << 8));
+        }
+
+        /// Create a provider which sets the status of a service in the registry, the service is added if needed
+        ///@param registry [in] registry of the service
+        ///@param serviceName [in] name of the service
+        static ServiceStatusProviderPtr newProvider(const std::shared_ptr<LocalStatusRegistry> & registry, const std::string & serviceName) {
+            return std::make_shared<Provider>(registry, registry->addService(serviceName));
+        }
+
+        /// Call a function on each change of a status
+        ///@param callback [in] function to call, from the thread which changed the status
+        ///@return identifier of the subscription
+        std::uint64_t subscribe(Callback callback) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::unique_ptr<Subscribers> subscribers(new Subscribers(*m_subscribers.read()));
+            const std::uint64_t id = m_nextSubscriberId++;
+            subscribers->push_back(Subscriber{id, callback});
+            m_subscribers.publish(std::move(subscribers));
+            return id;
+        }
+
+        /// Stop a subscription, the callback is not called anymore once the function returns
+        ///@param id [in] identifier returned by subscribe
+        void unsubscribe(std::uint64_t id) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::unique_ptr<Subscribers> subscribers(new Subscribers(*m_subscribers.read()));
+            subscribers->erase(std::remove_if(subscribers->begin(), subscribers->end(),
+                [id] (const Subscriber & subscriber) { return subscriber.id == id; }), subscribers->end());
+            m_subscribers.publish(std::move(subscribers));
+        }
+    };
+
+    /// Settings of the flap detection of a StatusAccounting
+    struct FlapSettings
+    {
+        /// Number of changes within the window which make a status flapping, from 2 to 64
+        unsigned transitions = 5;
+        /// Duration of the window
+        std::chrono::milliseconds window {60000};
+    };
+
+    /// Time spent by a service in each status and changes of status, read from a StatusAccounting
+    ///
+    /// The arrays are indexed by the value of the Operating Status, and by the value of the Health State divided by 5.
+    struct StatusAccountingSnapshot
+    {
+        static constexpr std::size_t OPERATING_STATUS_COUNT = 17;
+        static constexpr std::size_t HEALTH_STATE_COUNT = 7;
+
+        /// Time since the creation of the accounting
+        std::chrono::microseconds elapsed {0};
+        OperatingStatus operatingStatus = OperatingStatus::Unknown;
+        HealthState healthState = HealthState::Unknown;
+        /// Cumulative time spent in each status, including the time spent in the current one
+        std::array<std::chrono::microseconds, OPERATING_STATUS_COUNT> operatingStatusTime;
+        std::array<std::chrono::microseconds, HEALTH_STATE_COUNT> healthStateTime;
+        /// Number of changes, by previous and new status
+        std::array<std::array<std::uint64_t, OPERATING_STATUS_COUNT>, OPERATING_STATUS_COUNT> operatingStatusTransitions;
+        std::array<std::array<std::uint64_t, HEALTH_STATE_COUNT>, HEALTH_STATE_COUNT> healthStateTransitions;
+        /// True if the status changed too often during the last flap window
+        bool operatingStatusFlapping = false;
+        bool healthStateFlapping = false;
+        /// Number of times the status started to flap
+        std::uint64_t operatingStatusFlaps = 0;
+        std::uint64_t healthStateFlaps = 0;
+        /// False if changes kept happening during the read, the counters of the last changes may be missing
+        bool consistent = true;
+
+        StatusAccountingSnapshot() {
+            operatingStatusTime.fill(std::chrono::microseconds(0));
+            healthStateTime.fill(std::chrono::microseconds(0));
+            for(auto & row : operatingStatusTransitions) {
+                row.fill(0);
+            }
+            for(auto & row : healthStateTransitions) {
+                row.fill(0);
+            }
+        }
+
+        /// Get the time spent in an Operating Status
+        std::chrono::microseconds getTime(OperatingStatus os) const noexcept {
+            return static_cast<std::size_t>(os) < OPERATING_STATUS_COUNT ? operatingStatusTime[static_cast<std::size_t>(os)] : std::chrono::microseconds(0);
+        }
+
+        /// Get the time spent in a Health State
+        std::chrono::microseconds getTime(HealthState hs) const noexcept {
+            return static_cast<std::size_t>(hs) / 5 < HEALTH_STATE_COUNT ? healthStateTime[static_cast<std::size_t>(hs) / 5] : std::chrono::microseconds(0);
+        }
+
+        /// Get the time spent in the Health States more severe than the given one
+        std::chrono::microseconds getTimeAbove(HealthState hs) const noexcept {
+            std::chrono::microseconds time(0);
+            for(std::size_t index = static_cast<std::size_t>(hs) / 5 + 1; index < HEALTH_STATE_COUNT; index++) {
+                time += healthStateTime[index];
+            }
+            return time;
+        }
+
+        /// Get the number of changes from an Operating Status to another
+        std::uint64_t getTransitions(OperatingStatus from, OperatingStatus to) const noexcept {
+            const std::size_t row = static_cast<std::size_t>(from);
+            const std::size_t column = static_cast<std::size_t>(to);
+            return row < OPERATING_STATUS_COUNT && column < OPERATING_STATUS_COUNT ? operatingStatusTransitions[row][column] : 0;
+        }
+
+        /// Get the number of changes from a Health State to another
+        std::uint64_t getTransitions(HealthState from, HealthState to) const noexcept {
+            const std::size_t row = static_cast<std::size_t>(from) / 5;
+            const std::size_t column = static_cast<std::size_t>(to) / 5;
+            return row < HEALTH_STATE_COUNT && column < HEALTH_STATE_COUNT ? healthStateTransitions[row][column] : 0;
+        }
+    };
+
+    /// Time spent by a service in each status, changes of status and flap detection
+    ///
+    /// The accounting is updated without lock: an unchanged status costs one atomic load, a change one compare and swap
+    /// of the current status and its start time packed in 64 bits, then relaxed atomic additions. Times are measured
+    /// with the monotonic clock in micro seconds.
+    /// A status is flapping when it changed the given number of times within the flap window.
+    /// The snapshots only read the counters: they are retried while a change is in progress, without slowing the changes.
+    class StatusAccounting
+    {
+        private:
+        static constexpr std::size_t MAX_FLAP_TRANSITIONS = 64;
+        static constexpr unsigned STATE_SHIFT = 56;
+        static constexpr std::uint64_t TIME_MASK = (std::uint64_t(1) << STATE_SHIFT) - 1;
+
+        template<std::size_t N>
+        struct Account
+        {
+            //current state in the high byte and time since the start of the accounting when it was entered
+            std::atomic<std::uint64_t> current;
+            std::array<std::atomic<std::uint64_t>, N> time;
+            std::array<std::array<std::atomic<std::uint64_t>, N>, N> transitions;
+
+            //times of the last changes plus 1, 0 if none, and whether the last change detected a flap
+            std::array<std::atomic<std::uint64_t>, MAX_FLAP_TRANSITIONS> changes;
+            std::atomic<std::uint64_t> changeIndex;
+            std::atomic<bool> flapping;
+            std::atomic<std::uint64_t> flaps;
+
+            //changes started and finished, the snapshot is consistent when they are equal
+            std::atomic<std::uint64_t> started;
+            std::atomic<std::uint64_t> finished;
+
+            Account() noexcept : current(0), changeIndex(0), flapping(false), flaps(0), started(0), finished(0) {
+                for(auto & value : time) {
+                    value.store(0, std::memory_order_relaxed);
+                }
+                for(auto & row : transitions) {
+                    for(auto & value : row) {
+                        value.store(0, std::memory_order_relaxed);
+                    }
+                }
+                for(auto & value : changes) {
+                    value.store(0, std::memory_order_relaxed);
+                }
+            }
+        };
+
+        std::int64_t m_start;
+        std::uint64_t m_flapTransitions;
+        std::uint64_t m_flapWindow;
+        Account<StatusAccountingSnapshot::OPERATING_STATUS_COUNT> m_operatingStatus;
+        Account<StatusAccountingSnapshot::HEALTH_STATE_COUNT> m_healthState;
+
+        std::uint64_t now() const noexcept {
+            const std::int64_t elapsed = detail::monotonicNs() - m_start;
+            return elapsed > 0 ? static_cast<std::uint64_t>(elapsed / 1000) : 0;
+        }
+
+        template<std::size_t N>
+        void record(Account<N> & account, std::size_t state) noexcept {
+            std::uint64_t current = account.current.load(std::memory_order_relaxed);
+            if((current >> STATE_SHIFT) == state) {
+                return;
+            }
+
+            account.started.fetch_add(1);
+            const std::uint64_t time = now();
+            const std::uint64_t next = (static_cast<std::uint64_t>(state) << STATE_SHIFT) | (time & TIME_MASK);
+            while(!account.current.compare_exchange_weak(current, next)) {
+                if((current >> STATE_SHIFT) == state) {
+                    account.finished.fetch_add(1);
+                    return;
+                }
+            }
+
+            //a concurrent change may have read the clock earlier
+            const std::uint64_t entry = current & TIME_MASK;
+            const std::size_t previous = static_cast<std::size_t>(current >> STATE_SHIFT);
+            account.time[previous].fetch_add(time > entry ? time - entry : 0, std::memory_order_relaxed);
+            account.transitions[previous][state].fetch_add(1, std::memory_order_relaxed);
+
+            //flapping when the last m_flapTransitions changes, this one included, are in the window
+            const std::uint64_t index = account.changeIndex.fetch_add(1, std::memory_order_relaxed);
+            account.changes[index % m_flapTransitions].store(time + 1, std::memory_order_relaxed);
+            const std::uint64_t oldest = account.changes[(index + 1) % m_flapTransitions].load(std::memory_order_relaxed);
+            if(oldest != 0 && time + 1 - oldest <= m_flapWindow) {
+                if(!account.flapping.exchange(true, std::memory_order_relaxed)) {
+                    account.flaps.fetch_add(1, std::memory_order_relaxed);
+                }
+            } else {
+                account.flapping.store(false, std::memory_order_relaxed);
+            }
+
+            account.finished.fetch_add(1);
+        }
+
+        template<std::size_t N, typename Time, typename Transitions>
+        bool read(const Account<N> & account, std::uint64_t time, std::size_t & state, Time & times, Transitions & transitions,
+                  bool & flapping, std::uint64_t & flaps) const noexcept {
+            const std::uint64_t finished = account.finished.load();
+
+            const std::uint64_t current = account.current.load(std::memory_order_relaxed);
+            state = static_cast<std::size_t>(current >> STATE_SHIFT);
+            const std::uint64_t entry = current & TIME_MASK;
+            for(std::size_t i = 0; i < N; i++) {
+                std::uint64_t value = account.time[i].load(std::memory_order_relaxed);
+                if(i == state && time > entry) {
+                    value += time - entry;
+                }
+                times[i] = std::chrono::microseconds(value);
+                for(std::size_t j = 0; j < N; j++) {
+                    transitions[i][j] = account.transitions[i][j].load(std::memory_order_relaxed);
+                }
+            }
+
+            //flapping while the oldest of the last m_flapTransitions changes is in the window
+            const std::uint64_t index = account.changeIndex.load(std::memory_order_relaxed);
+            const std::uint64_t oldest = account.changes[index % m_flapTransitions].load(std::memory_order_relaxed);
+            flapping = oldest != 0 && time + 1 - oldest <= m_flapWindow;
+            flaps = account.flaps.load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            return account.started.load() == finished;
+        }
+
+        public:
+        /// Create a StatusAccounting, the service is in the Unknown statuses from now
+        ///@param settings [in] settings of the flap detection
+        explicit StatusAccounting(const FlapSettings & settings = FlapSettings())
+            : m_start(detail::monotonicNs()), m_flapTransitions(settings.transitions),
+              m_flapWindow(static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(settings.window).count())) {
+            if(settings.transitions < 2 || settings.transitions > MAX_FLAP_TRANSITIONS || settings.window.count() <= 0) {
+                throw std::invalid_argument("The flap detection needs 2 to 64 transitions and a window greater than 0");
+            }
+        }
+
+        StatusAccounting(const StatusAccounting &) = delete;
+        StatusAccounting & operator=(const StatusAccounting &) = delete;
+
+        /// Record the Operating Status of the service
+        void record(OperatingStatus os) noexcept {
+            if(static_cast<std::size_t>(os) < StatusAccountingSnapshot::OPERATING_STATUS_COUNT) {
+                record(m_operatingStatus, static_cast<std::size_t>(os));
+            }
+        }
+
+        /// Record the Health State of the service
+        void record(HealthState hs) noexcept {
+            const std::size_t value = static_cast<std::size_t>(hs);
+            if(value % 5 == 0 && value / 5 < StatusAccountingSnapshot::HEALTH_STATE_COUNT) {
+                record(m_healthState, value / 5);
+            }
+        }
+
+        /// Read the accounting
+        ///
+        /// The snapshot is retried while a change is in progress, up to a few times: under a continuous stream of changes,
+        /// it is returned not consistent.
+        StatusAccountingSnapshot getSnapshot() const noexcept {
+            StatusAccountingSnapshot snapshot;
+            for(unsigned attempt = 0; attempt < 16; attempt++) {
+                const std::uint64_t time = now();
+                snapshot.elapsed = std::chrono::microseconds(time);
+
+                std::size_t os = 0;
+                std::size_t hs = 0;
+                bool consistent = read(m_operatingStatus, time, os, snapshot.operatingStatusTime, snapshot.operatingStatusTransitions,
+                                       snapshot.operatingStatusFlapping, snapshot.operatingStatusFlaps);
+                consistent = read(m_healthState, time, hs, snapshot.healthStateTime, snapshot.healthStateTransitions,
+                                  snapshot.healthStateFlapping, snapshot.healthStateFlaps) && consistent;
+                snapshot.operatingStatus = static_cast<OperatingStatus>(os);
+                snapshot.healthState = static_cast<HealthState>(hs * 5);
+                snapshot.consistent = consistent;
+                if(consistent) {
+                    break;
+                }
+                std::this_thread::yield();
+            }
+            return snapshot;
+        }
+    };
+
+    /// Timers of the keepalive of the collections, implemented by KeepaliveScheduler (fty_service_status_keepalive.h)
+    class KeepaliveTimers
+    {
+        public:
+        /// Function called when a timer expires
+        ///@param now [in] current monotonic time in nano seconds
+        ///@return monotonic time of the next expiry, before the jitter is added, or a negative value to stop the timer
+        using Callback = std::function<std::int64_t(std::int64_t now)>;
+
+        virtual ~KeepaliveTimers() = default;
+
+        /// Add a timer
+        ///@param expiry [in] monotonic time of the first expiry, in nano seconds
+        ///@param jitter [in] maximum random delay added to each expiry
+        ///@param callback [in] function called when the timer expires
+        ///@return identifier of the timer
+        virtual std::uint64_t add(std::int64_t expiry, std::chrono::nanoseconds jitter, Callback callback) = 0;
+
+        /// Remove a timer, its callback is not called after the return
+        ///@param id [in] identifier of the timer
+        virtual void remove(std::uint64_t id) noexcept = 0;
+    };
+
+    //defined in fty_service_status_keepalive.h
+    class KeepaliveScheduler;
+
+    //defined in fty_service_status_isolated.h
+    class IsolatedServiceStatusProvider;
+
+    namespace detail
+    {
+        //defined in fty_service_status_folder_watcher.h
+        class FolderWatcher;
+    }
+
+    /// This class is all an easy use of collection of ServiceStatusPluginWrapper
+    ///
+    /// The collection can be used from several threads. setForAll does not take any lock: it reads an immutable
+    /// snapshot of the providers, which is replaced when plugins are added or removed. A removed plugin is
+    /// released once the setForAll in progress are done with it. The other functions are serialized.
+    class ServiceStatusPluginWrapperCollection
+    {
+        using DispatcherPtr = std::shared_ptr<detail::ServiceStatusDispatcher>;
+
+        //plugin of the collection, with its provider
+        //The name is the key of the plugin in the map of the wrappers, which outlives the slot.
+        struct PluginSlot
+        {
+            const std::string * name;
+            ServiceStatusPluginWrapper plugin;
+            detail::ProviderChannelPtr channel;
+            DispatcherPtr dispatcher;   //null without the asynchronous dispatch
+        };
+        using PluginSlots = std::vector<PluginSlot>;
+
+        //providers read by setForAll, allocated in one block with the array of the providers
+        //setForAll walks the dense array of raw pointers, the shared pointers after it keep the providers alive.
+        struct Snapshot
+        {
+            struct Entry
+            {
+                detail::ProviderChannel * channel;
+                detail::ServiceStatusDispatcher * dispatcher;
+            };
+            struct Owner
+            {
+                detail::ProviderChannelPtr channel;
+                DispatcherPtr dispatcher;
+            };
+
+            std::size_t size;
+            std::shared_ptr<LocalStatusRegistry> localRegistry;     //null if the statuses are not recorded
+            std::size_t localIndex = LocalStatusRegistry::NOT_FOUND;
+            std::shared_ptr<StatusAccounting> accounting;           //null without accounting
+
+            //size of the block of a snapshot of a number of providers
+            static std::size_t getBlockSize(std::size_t capacity) noexcept {
+                return sizeof(Snapshot) + capacity * (sizeof(Entry) + sizeof(Owner));
+            }
+
+            static Snapshot * create(const PluginSlots & slots) {
+                return create(::operator new(getBlockSize(slots.size())), slots);
+            }
+
+            //build the snapshot in a block of getBlockSize(slots.size()) bytes or more
+            static Snapshot * create(void * block, const PluginSlots & slots) noexcept {
+                Snapshot * snapshot = new (block) Snapshot(slots.size());
+                for(std::size_t i = 0; i < slots.size(); i++) {
+                    snapshot->begin()[i] = Entry{slots[i].channel.get(), slots[i].dispatcher.get()};
+                    new (snapshot->getOwners() + i) Owner{slots[i].channel, slots[i].dispatcher};
+                }
+                return snapshot;
+            }
+
+            ~Snapshot() {
+                for(std::size_t i = 0; i < size; i++) {
+                    getOwners()[i].~Owner();
+                }
+            }
+
+            //the block is allocated by create()
+            static void operator delete(void * ptr) noexcept { ::operator delete(ptr); }
+
+            const Entry * begin() const noexcept { return reinterpret_cast<const Entry *>(this + 1); }
+            const Entry * end() const noexcept { return begin() + size; }
+
+            private:
+            explicit Snapshot(std::size_t entryCount) noexcept : size(entryCount) {}
+
+            Entry * begin() noexcept { return reinterpret_cast<Entry *>(this + 1); }
+            Owner * getOwners() noexcept { return reinterpret_cast<Owner *>(begin() + size); }
+        };
+
+        //block of the next snapshot, allocated before the slots change so that the publication cannot fail
+        class SnapshotBlock
+        {
+            private:
+            void * m_block;
+
+            public:
+            //the block holds up to capacity providers
+            explicit SnapshotBlock(std::size_t capacity) : m_block(::operator new(Snapshot::getBlockSize(capacity))) {}
+            //the block is null if the memory cannot be allocated
+            SnapshotBlock(std::size_t capacity, const std::nothrow_t &) noexcept : m_block(::operator new(Snapshot::getBlockSize(capacity), std::nothrow)) {}
+            ~SnapshotBlock() { ::operator delete(m_block); }
+
+            SnapshotBlock(const SnapshotBlock &) = delete;
+            SnapshotBlock & operator=(const SnapshotBlock &) = delete;
+
+            bool isAllocated() const noexcept { return m_block != nullptr; }
+
+            //build the snapshot of the slots, at most the capacity, the block is used once
+            Snapshot * build(const PluginSlots & slots) noexcept {
+                Snapshot * snapshot = Snapshot::create(m_block, slots);
+                m_block = nullptr;
+                return snapshot;
+            }
+        };
+
+        private:
+        std::string m_serviceName;
+        PluginSlots m_plugins;     //sorted by name
+        std::map<std::string, ServiceStatusPluginWrapper> m_pluginWrappers;    //same plugins, for getPluginCollection
+        std::shared_ptr<detail::DeliveryCounters> m_counters = std::make_shared<detail::DeliveryCounters>();
+        std::atomic<bool> m_changeSuppression {false};
+
+        //probes of the plugin files by addAll, null without cache
+        std::shared_ptr<PluginManifestCache> m_manifestCache;
+
+        //record of the statuses in the process
+        std::shared_ptr<LocalStatusRegistry> m_localRegistry;
+        std::size_t m_localIndex = LocalStatusRegistry::NOT_FOUND;
+
+        //time in each status of the service
+        std::shared_ptr<StatusAccounting> m_accounting;
+
+        //asynchronous dispatch
+        std::atomic<bool> m_asyncDispatch {false};
+        std::size_t m_queueCapacity = 0;
+        OverflowPolicy m_overflowPolicy = OverflowPolicy::DropOldest;
+        std::chrono::milliseconds m_blockTimeout {0};
+
+        //watchdog, requires the asynchronous dispatch
+        bool m_watchdogEnabled = false;
+        WatchdogSettings m_watchdogSettings;
+        std::unique_ptr<detail::ServiceStatusWatchdog> m_watchdog;
+
+        //keepalive, one timer per plugin in a shared scheduler
+        struct KeepaliveTimer
+        {
+            const detail::ProviderChannel * channel;
+            const detail::ServiceStatusDispatcher * dispatcher;
+            std::uint64_t id;
+        };
+        std::shared_ptr<KeepaliveTimers> m_keepaliveScheduler;  //null without keepalive
+        KeepaliveSettings m_keepaliveSettings;
+        std::map<std::string, KeepaliveSettings> m_pluginKeepaliveSettings;
+        std::map<std::string, KeepaliveTimer> m_keepaliveTimers;
+
+        //serializes all the functions but setForAll
+        mutable std::mutex m_mutex;
+        detail::SnapshotPublisher<Snapshot> m_snapshot {std::unique_ptr<const Snapshot>(Snapshot::create(PluginSlots()))};
+
+        //last status set with setForAll, given to the plugins loaded from the watched folder
+        std::atomic<int> m_currentOperatingStatus {-1};
+        std::atomic<int> m_currentHealthState {-1};
+
+        //hot reload of the watched folder, the reload mutex is locked before the mutex
+        struct WatchedFile
+        {
+            std::string pluginName;
+            dev_t device;
+            ino_t inode;
+            std::int64_t modificationTime;
+            off_t size;
+        };
+        mutable std::mutex m_reloadMutex;
+        std::string m_watchedFolder;
+        std::function<bool(const char *)> m_watchMatch;
+        std::map<std::string, WatchedFile> m_watchedFiles;
+        std::vector<PluginLoadResult> m_lastReloadReport;
+        std::atomic<std::uint64_t> m_reloadCount {0};
+        std::uint64_t m_watchGeneration = 0;
+        std::shared_ptr<detail::FolderWatcher> m_folderWatcher;
+
+        //binary search of a plugin by name, the mutex must be locked
+        template<typename Slots>
+        static auto findSlot(Slots & slots, const std::string & pluginName) -> decltype(slots.begin()) {
+            auto it = std::lower_bound(slots.begin(), slots.end(), pluginName,
+                [] (const PluginSlot & slot, const std::string & name) { return *slot.name < name; });
+            return (it != slots.end() && *it->name == pluginName) ? it : slots.end();
+        }
+
+        //publish the providers for setForAll in a block allocated before the slots changed, the mutex must be locked
+        //The previous providers and dispatchers are released once no setForAll uses them.
+        void publishSnapshot(SnapshotBlock & block) noexcept {
+            std::unique_ptr<Snapshot> snapshot(block.build(m_plugins));
+            snapshot->localRegistry = m_localRegistry;
+            snapshot->localIndex = m_localIndex;
+            snapshot->accounting = m_accounting;
+            m_snapshot.publish(std::move(snapshot));
+
+            updateKeepaliveTimers();
+        }
+
+        DispatcherPtr newDispatcher(const detail::ProviderChannelPtr & channel) const {
+            return DispatcherPtr(new detail::ServiceStatusDispatcher(channel, m_counters, m_queueCapacity, m_overflowPolicy, m_blockTimeout));
+        }
+
+        void startWatchdog() {
+            m_watchdog.reset(new detail::ServiceStatusWatchdog(m_watchdogSettings.checkPeriod));
+            for(PluginSlot & slot : m_plugins) {
+                slot.channel->configureQuarantine(m_watchdogSettings);
+                m_watchdog->watch(*slot.name, slot.channel, slot.dispatcher.get());
+            }
+        }
+
+        //the mutex must be locked
+        void stopDispatchers() {
+            SnapshotBlock block(m_plugins.size());
+
+            //the watchdog uses the dispatchers
+            m_watchdog.reset();
+            m_asyncDispatch = false;
+            for(PluginSlot & slot : m_plugins) {
+                slot.dispatcher.reset();
+            }
+
+            //the dispatchers deliver their pending updates when they are released
+            publishSnapshot(block);
+        }
+
+        void deliverTo(detail::ProviderChannel & channel, detail::ServiceStatusDispatcher * dispatcher, const detail::StatusUpdate & update) noexcept {
+            channel.setWanted(update);
+
+            if(!dispatcher) {
+                channel.deliver(update);
+            } else if(channel.isQuarantined()) {
+                m_counters->skipped.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                dispatcher->push(update);
+            }
+        }
+
+        void deliverForAll(const detail::StatusUpdate & update) noexcept {
+            const auto snapshot = m_snapshot.read();
+            (update.isHealthState ? m_currentHealthState : m_currentOperatingStatus).store(update.value, std::memory_order_release);
+
+            if(snapshot->localRegistry) {
+                if(update.isHealthState) {
+                    snapshot->localRegistry->set(snapshot->localIndex, static_cast<HealthState>(update.value));
+                } else {
+                    snapshot->localRegistry->set(snapshot->localIndex, static_cast<OperatingStatus>(update.value));
+                }
+            }
+
+            if(snapshot->accounting) {
+                if(update.isHealthState) {
+                    snapshot->accounting->record(static_cast<HealthState>(update.value));
+                } else {
+                    snapshot->accounting->record(static_cast<OperatingStatus>(update.value));
+                }
+            }
+
+            for(const Snapshot::Entry & entry : *snapshot)
+            {
+                deliverTo(*entry.channel, entry.dispatcher, update);
+            }
+        }
+
+        //give the last status set with setForAll to a provider which was just published
+        //The setForAll which did not see the provider are done, the next ones deliver to it: the status is given
+        //again until it does not change during the delivery.
+        void deliverCurrentStatus(const PluginSlot & slot) noexcept {
+            for(bool healthState : {false, true}) {
+                const std::atomic<int> & current = healthState ? m_currentHealthState : m_currentOperatingStatus;
+                int delivered = -1;
+                for(int value = current.load(std::memory_order_acquire); value != delivered; value = current.load(std::memory_order_acquire)) {
+                    if(healthState) {
+                        deliverTo(*slot.channel, slot.dispatcher.get(), detail::StatusUpdate(static_cast<HealthState>(value)));
+                    } else {
+                        deliverTo(*slot.channel, slot.dispatcher.get(), detail::StatusUpdate(static_cast<OperatingStatus>(value)));
+                    }
+                    delivered = value;
+                }
+            }
+        }
+
+        //open a new version of a plugin file
+        //The dynamic loader identifies a library by its path and would return a previous version still in memory
+        //(a C++ plugin with unique symbols is never unloaded): the path is spelled differently in this case.
+        static ServiceStatusPluginWrapper loadNewVersion(const std::string & folderPath, const std::string & name) {
+            std::string prefix = folderPath + "/";
+            for(int i = 0; i < 64; i++) {
+                void * handle = dlopen((prefix + name).c_str(), RTLD_LAZY | RTLD_NOLOAD);
+                if(handle == NULL) {
+                    break;
+                }
+                dlclose(handle);
+                prefix += "./";
+            }
+            return ServiceStatusPluginWrapper(prefix + name);
+        }
+
+        //apply the change of one file of the watched folder, the reload mutex must be locked
+        //return false if the file did not change
+        bool reloadWatchedFile(const std::string & name, bool adopt, PluginLoadResult & result) {
+            result.path = m_watchedFolder + "/" + name;
+
+            struct stat info;
+            const bool exists = (stat(result.path.c_str(), &info) == 0) && S_ISREG(info.st_mode);
+            const std::int64_t modificationTime = exists ? std::int64_t(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec : 0;
+
+            auto watched = m_watchedFiles.find(name);
+            if(watched != m_watchedFiles.end()) {
+                const WatchedFile & file = watched->second;
+                if(exists && file.device == info.st_dev && file.inode == info.st_ino && file.modificationTime == modificationTime && file.size == info.st_size) {
+                    return false;
+                }
+
+                result.pluginName = file.pluginName;
+                result.removed = true;
+                remove(file.pluginName);
+                m_watchedFiles.erase(watched);
+            }
+
+            if(!exists) {
+                return result.removed;
+            }
+
+            try {
+                //the first scan may find the plugins already loaded
+                ServiceStatusPluginWrapper plugin = adopt ? ServiceStatusPluginWrapper(result.path) : loadNewVersion(m_watchedFolder, name);
+                result.pluginName = plugin.getPluginName();
+
+                //the copy of the slot keeps the provider alive
+                std::unique_ptr<PluginSlot> slot;
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    //the plugins already added from the folder are kept when the watch starts
+                    if(!adopt || findSlot(m_plugins, result.pluginName) == m_plugins.end()) {
+                        SnapshotBlock block(m_plugins.size() + 1);
+                        insert(plugin, plugin.newServiceStatusProviderPtr(m_serviceName));
+                        publishSnapshot(block);
+                        slot.reset(new PluginSlot(*findSlot(m_plugins, result.pluginName)));
+                    }
+                }
+
+                if(slot) {
+                    deliverCurrentStatus(*slot);
+                    result.added = true;
+                }
+                m_watchedFiles[name] = WatchedFile{result.pluginName, info.st_dev, info.st_ino, modificationTime, info.st_size};
+            }
+            catch(const std::exception & e) {
+                result.error = e.what();
+            }
+            return true;
+        }
+
+        //apply the changes of the watched folder, the reload mutex must be locked
+        void reloadWatchedFiles(std::set<std::string> names, bool rescan, bool adopt) {
+            if(rescan) {
+                DIR * d = opendir(m_watchedFolder.c_str());
+                if(d != NULL) {
+                    struct dirent * dir;
+                    while((dir = readdir(d)) != NULL) {
+                        if(m_watchMatch(dir->d_name)) {
+                            names.insert(dir->d_name);
+                        }
+                    }
+                    closedir(d);
+                }
+                for(auto & item : m_watchedFiles) {
+                    names.insert(item.first);
+                }
+            }
+
+            std::vector<PluginLoadResult> report;
+            for(const std::string & name : names) {
+                PluginLoadResult result;
+                if(reloadWatchedFile(name, adopt, result)) {
+                    report.push_back(result);
+                }
+            }
+            m_lastReloadReport = std::move(report);
+            m_reloadCount++;
+        }
+
+        template<typename Watcher>
+        void startFolderWatch(const std::string & folderPath, const std::function<bool(const char *)> & match, std::chrono::milliseconds debounce) {
+            if(debounce.count() < 0) {
+                throw std::invalid_argument("The debounce period must not be negative");
+            }
+
+            //the previous watcher is stopped after the lock is released, its thread may wait for it
+            std::shared_ptr<detail::FolderWatcher> previous;
+            std::lock_guard<std::mutex> lock(m_reloadMutex);
+            previous = std::move(m_folderWatcher);
+
+            const std::uint64_t generation = ++m_watchGeneration;
+            m_watchedFolder = folderPath;
+            m_watchMatch = match;
+            m_watchedFiles.clear();
+            m_lastReloadReport.clear();
+
+            //watch before the first scan, so no change is missed
+            m_folderWatcher.reset(new Watcher(folderPath, match, debounce,
+                [this, generation] (const std::set<std::string> & names, bool rescan) {
+                    std::lock_guard<std::mutex> reloadLock(m_reloadMutex);
+                    if(generation == m_watchGeneration) {
+                        reloadWatchedFiles(names, rescan, false);
+                    }
+                }));
+            reloadWatchedFiles(std::set<std::string>(), true, true);
+        }
+
+        void checkNotInCollection(const std::string & pluginName) const {
+            if(findSlot(m_plugins, pluginName) != m_plugins.end()) {
+                throw std::runtime_error("Plugin <"+pluginName+ "> already exist in the collection.");
+            }
+        }
+
+        //the mutex must be locked, the caller publishes the new providers
+        void insert(const ServiceStatusPluginWrapper & newPlugin, const ServiceStatusProviderPtr & provider) {
+            insert(newPlugin, std::make_shared<detail::ProviderChannel>(provider, m_counters));
+        }
+
+        void insert(const ServiceStatusPluginWrapper & newPlugin, const detail::ProviderChannelPtr & channel) {
+            const std::string & pluginName = newPlugin.getPluginName();
+            checkNotInCollection(pluginName);
+
+            channel->setChangeSuppression(m_changeSuppression);
+
+            //the copy of the wrapper shares the state of the plugin
+            if(!channel->hasLastErrorGetter()) {
+                const ServiceStatusPluginWrapper plugin = newPlugin;
+                channel->setLastErrorGetter([plugin] () { return plugin.getPluginLastError(); });
+            }
+
+            DispatcherPtr dispatcher;
+            if(m_asyncDispatch) {
+                dispatcher = newDispatcher(channel);
+                if(m_watchdog) {
+                    channel->configureQuarantine(m_watchdogSettings);
+                    m_watchdog->watch(pluginName, channel, dispatcher.get());
+                }
+            }
+
+            auto wrapper = m_pluginWrappers.end();
+            try {
+                wrapper = m_pluginWrappers.emplace(pluginName, newPlugin).first;
+                auto position = std::lower_bound(m_plugins.begin(), m_plugins.end(), pluginName,
+                    [] (const PluginSlot & slot, const std::string & name) { return *slot.name < name; });
+                m_plugins.insert(position, PluginSlot{&wrapper->first, newPlugin, channel, dispatcher});
+            }
+            catch(...) {
+                if(wrapper != m_pluginWrappers.end()) {
+                    m_pluginWrappers.erase(wrapper);
+                }
+                if(m_watchdog) {
+                    m_watchdog->unwatch(pluginName);
+                }
+                throw;
+            }
+        }
+
+        //list the regular files of a folder matching the filter, sorted by path
+        static std::vector<std::string> listPluginFiles(const std::string & folderPath, const std::function<bool(const char *)> & match) {
+            std::vector<std::string> paths;
+            DIR * d = opendir(folderPath.c_str());
+            if(d == NULL) {
+                return paths;
+            }
+
+            struct dirent * dir;
+            while((dir = readdir(d)) != NULL) {
+                if(dir->d_type != DT_REG && dir->d_type != DT_LNK && dir->d_type != DT_UNKNOWN) {
+                    continue;
+                }
+                if(!match(dir->d_name)) {
+                    continue;
+                }
+
+                std::string path(folderPath + "/" + dir->d_name);
+                struct stat info;
+                if(dir->d_type != DT_REG && (stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode))) {
+                    continue;
+                }
+
+                char * fullPath = realpath(path.c_str(), NULL);
+                if(fullPath != NULL) {
+                    paths.push_back(fullPath);
+                    free(fullPath);
+                }
+            }
+            closedir(d);
+
+            //links may resolve to the same file
+            std::sort(paths.begin(), paths.end());
+            paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+            return paths;
+        }
+
+        //an object file refused by dlopen may load once its dependencies are installed, so only the other failures are cached
+        static bool isPermanentFailure(const std::string & path, const std::string & error) {
+            static const std::string dlopenFailure = "Cannot load plugin: ";
+            return error.compare(0, dlopenFailure.size(), dlopenFailure) != 0 || !PluginManifestCache::isElfFile(path);
+        }
+
+        //load the plugins in parallel, then insert them in the order of the paths
+        std::vector<PluginLoadResult> addFiles(const std::vector<std::string> & paths, unsigned concurrency) {
+            struct Loaded
+            {
+                std::unique_ptr<ServiceStatusPluginWrapper> plugin;
+                ServiceStatusProviderPtr provider;
+            };
+
+            std::vector<PluginLoadResult> results(paths.size());
+            std::vector<Loaded> loaded(paths.size());
+            std::vector<bool> skipped(paths.size(), false);
+            std::atomic<std::size_t> next(0);
+
+            std::shared_ptr<PluginManifestCache> cache;
+            std::set<std::string> knownNames;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                cache = m_manifestCache;
+                for(const PluginSlot & slot : m_plugins) {
+                    knownNames.insert(*slot.name);
+                }
+            }
+
+            //the files known not to be plugins and the duplicates of a known plugin name are not loaded
+            for(std::size_t i = 0; cache && i < paths.size(); i++) {
+                PluginManifestCache::Entry entry;
+                if(!cache->lookup(paths[i], entry)) {
+                    continue;
+                }
+                results[i].path = paths[i];
+                if(!entry.valid) {
+                    results[i].error = entry.error;
+                    skipped[i] = true;
+                } else if(!knownNames.insert(entry.pluginName).second) {
+                    results[i].pluginName = entry.pluginName;
+                    results[i].error = "Plugin <" + entry.pluginName + "> already exist in the collection.";
+                    skipped[i] = true;
+                }
+            }
+
+            const std::string serviceName = m_serviceName;
+            auto work = [&] {
+                for(std::size_t i = next++; i < paths.size(); i = next++) {
+                    if(skipped[i]) {
+                        continue;
+                    }
+                    results[i].path = paths[i];
+
+                    PluginManifestCache::Entry entry;
+                    entry.path = paths[i];
+                    const bool identified = cache && PluginManifestCache::readIdentity(paths[i], entry);
+                    try {
+                        loaded[i].plugin.reset(new ServiceStatusPluginWrapper(paths[i]));
+                        results[i].pluginName = loaded[i].plugin->getPluginName();
+                        entry.valid = true;
+                        entry.pluginName = results[i].pluginName;
+                        entry.abiVersion = loaded[i].plugin->getAbiVersion();
+                        loaded[i].provider = loaded[i].plugin->newServiceStatusProviderPtr(serviceName);
+                    }
+                    catch(const std::exception & e) {
+                        results[i].error = e.what();
+                        if(!entry.valid) {
+                            entry.error = e.what();
+                        }
+                    }
+
+                    if(identified && (entry.valid || isPermanentFailure(paths[i], entry.error))) {
+                        cache->record(entry);
+                    }
+                }
+            };
+
+            if(concurrency == 0) {
+                concurrency = std::max(1u, std::thread::hardware_concurrency());
+            }
+            concurrency = static_cast<unsigned>(std::min<std::size_t>(concurrency, paths.size()));
+
+            //the calling thread is one of the workers
+            std::vector<std::thread> workers;
+            for(unsigned i = 1; i < concurrency; i++) {
+                try {
+                    workers.emplace_back(work);
+                }
+                catch(const std::system_error &) {
+                    break;
+                }
+            }
+            work();
+            for(auto & worker : workers) {
+                worker.join();
+            }
+
+            if(cache) {
+                cache->save();
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::size_t loadedCount = 0;
+            for(const Loaded & plugin : loaded) {
+                loadedCount += plugin.provider ? 1 : 0;
+            }
+            SnapshotBlock block(m_plugins.size() + loadedCount);
+            for(std::size_t i = 0; i < paths.size(); i++) {
+                if(!loaded[i].provider) {
+                    continue;
+                }
+                try {
+                    insert(*loaded[i].plugin, loaded[i].provider);
+                    results[i].added = true;
+                }
+                catch(const std::exception & e) {
+                    results[i].error = e.what();
+                }
+            }
+            publishSnapshot(block);
+
+            return results;
+        }
+
+        static int countAdded(const std::vector<PluginLoadResult> & results) noexcept {
+            int added = 0;
+            for(auto & result : results) {
+                added += result.added ? 1 : 0;
+            }
+            return added;
+        }
+
+        //the mutex must be locked
+        void enableAsyncDispatchLocked(std::size_t queueCapacity, OverflowPolicy policy, std::chrono::milliseconds blockTimeout) {
+            if(queueCapacity == 0) {
+                throw std::invalid_argument("The queue capacity of the asynchronous dispatch must be greater than 0");
+            }
+            if(blockTimeout.count() < 0) {
+                throw std::invalid_argument("The block timeout of the asynchronous dispatch must not be negative");
+            }
+
+            stopDispatchers();
+
+            m_queueCapacity = queueCapacity;
+            m_overflowPolicy = policy;
+            m_blockTimeout = blockTimeout;
+
+            //the published snapshot has no dispatcher until the new ones are all created
+            SnapshotBlock block(m_plugins.size());
+            try {
+                for(PluginSlot & slot : m_plugins) {
+                    slot.dispatcher = newDispatcher(slot.channel);
+                }
+
+                if(m_watchdogEnabled) {
+                    startWatchdog();
+                }
+            }
+            catch(...) {
+                m_watchdog.reset();
+                for(PluginSlot & slot : m_plugins) {
+                    slot.dispatcher.reset();
+                }
+                throw;
+            }
+
+            m_asyncDispatch = true;
+            publishSnapshot(block);
+        }
+
+        //the mutex must be locked
+        void disableWatchdogLocked() noexcept {
+            m_watchdog.reset();
+            m_watchdogEnabled = false;
+
+            WatchdogSettings noLimit;
+            noLimit.latencyBudget = std::chrono::milliseconds(0);
+            noLimit.maxConsecutiveErrors = 0;
+            for(PluginSlot & slot : m_plugins) {
+                slot.channel->configureQuarantine(noLimit);
+                slot.channel->reinstate();
+            }
+        }
+
+        //re-assert the last status to a provider, from the thread of the keepalive scheduler
+        //The update is queued to the dispatcher of the provider: the scheduler thread never calls a provider.
+        //@return time of the next keepalive, negative once the provider or its dispatcher is released
+        static std::int64_t keepalive(const std::weak_ptr<detail::ProviderChannel> & weakChannel,
+                                      const std::weak_ptr<detail::ServiceStatusDispatcher> & weakDispatcher,
+                                      detail::DeliveryCounters & counters, std::int64_t interval, std::int64_t now) noexcept {
+            detail::ProviderChannelPtr channel = weakChannel.lock();
+            DispatcherPtr dispatcher = weakDispatcher.lock();
+            if(!channel || !dispatcher) {
+                return -1;
+            }
+
+            //a provider which received a status during the interval is fresh
+            const std::int64_t lastSuccess = channel->getLastSuccess();
+            if(lastSuccess != 0 && now - lastSuccess < interval) {
+                counters.freshKeepalives.fetch_add(1, std::memory_order_relaxed);
+                return lastSuccess + interval;
+            }
+
+            //a quarantined provider is probed by the watchdog
+            if(channel->isQuarantined()) {
+                counters.skipped.fetch_add(1, std::memory_order_relaxed);
+                return now + interval;
+            }
+
+            bool reasserted = false;
+            for(bool healthState : {false, true}) {
+                if(channel->getWanted(healthState) < 0) {
+                    continue;
+                }
+
+                detail::StatusUpdate update;
+                update.isHealthState = healthState;
+                update.isKeepalive = true;
+                dispatcher->push(update);
+                reasserted = true;
+            }
+
+            if(reasserted) {
+                counters.keepalives.fetch_add(1, std::memory_order_relaxed);
+            }
+            return now + interval;
+        }
+
+        //the mutex must be locked
+        void removeKeepaliveTimer(const std::string & pluginName) noexcept {
+            auto it = m_keepaliveTimers.find(pluginName);
+            if(it != m_keepaliveTimers.end()) {
+                m_keepaliveScheduler->remove(it->second.id);
+                m_keepaliveTimers.erase(it);
+            }
+        }
+
+        //add the keepalive timers of the new providers and remove the ones of the released providers
+        //The mutex must be locked.
+        void updateKeepaliveTimers() noexcept {
+            if(!m_keepaliveScheduler) {
+                return;
+            }
+
+            for(auto it = m_keepaliveTimers.begin(); it != m_keepaliveTimers.end();) {
+                auto slot = findSlot(m_plugins, it->first);
+                if(slot != m_plugins.end() && slot->channel.get() == it->second.channel && slot->dispatcher.get() == it->second.dispatcher) {
+                    ++it;
+                } else {
+                    m_keepaliveScheduler->remove(it->second.id);
+                    it = m_keepaliveTimers.erase(it);
+                }
+            }
+
+            for(const PluginSlot & slot : m_plugins) {
+                const std::string & pluginName = *slot.name;
+                if(!slot.dispatcher || m_keepaliveTimers.count(pluginName) != 0) {
+                    continue;
+                }
+
+                auto pluginSettings = m_pluginKeepaliveSettings.find(pluginName);
+                const KeepaliveSettings & settings = pluginSettings != m_pluginKeepaliveSettings.end() ? pluginSettings->second : m_keepaliveSettings;
+                const std::int64_t interval = std::chrono::duration_cast<std::chrono::nanoseconds>(settings.interval).count();
+
+                std::weak_ptr<detail::ProviderChannel> channel = slot.channel;
+                std::weak_ptr<detail::ServiceStatusDispatcher> dispatcher = slot.dispatcher;
+                std::shared_ptr<detail::DeliveryCounters> counters = m_counters;
+
+                try {
+                    KeepaliveTimer & timer = m_keepaliveTimers[pluginName];
+                    timer.channel = slot.channel.get();
+                    timer.dispatcher = slot.dispatcher.get();
+                    try {
+                        timer.id = m_keepaliveScheduler->add(detail::monotonicNs() + interval, settings.jitter,
+                            [channel, dispatcher, counters, interval](std::int64_t now) {
+                                return keepalive(channel, dispatcher, *counters, interval, now);
+                            });
+                    }
+                    catch(...) {
+                        m_keepaliveTimers.erase(pluginName);
+                        throw;
+                    }
+                }
+                catch(...) {
+                    //the plugin has no keepalive until the next change of the collection
+                }
+            }
+        }
+
+        //the mutex must be locked
+        void disableKeepaliveLocked() noexcept {
+            if(m_keepaliveScheduler) {
+                for(auto & item : m_keepaliveTimers) {
+                    m_keepaliveScheduler->remove(item.second.id);
+                }
+            }
+            m_keepaliveTimers.clear();
+            m_keepaliveScheduler.reset();
+        }
+
+        //point the names of copied slots at the keys of the copied map, both are sorted by name
+        static void renameSlots(PluginSlots & plugins, const std::map<std::string, ServiceStatusPluginWrapper> & pluginWrappers) noexcept {
+            auto wrapper = pluginWrappers.begin();
+            for(PluginSlot & slot : plugins) {
+                slot.name = &(wrapper++)->first;
+            }
+        }
+
+        //take the plugins and the settings of another collection, the mutex of both must be locked
+        //The slots are copied by the caller before anything changes, the copy shares their providers and dispatchers.
+        void copyLocked(const ServiceStatusPluginWrapperCollection & other, PluginSlots & plugins,
+                        std::map<std::string, ServiceStatusPluginWrapper> & pluginWrappers, SnapshotBlock & block) noexcept {
+            m_serviceName = other.m_serviceName;
+            m_counters = other.m_counters;
+            m_changeSuppression = other.m_changeSuppression.load();
+            m_manifestCache = other.m_manifestCache;
+            m_localRegistry = other.m_localRegistry;
+            m_localIndex = other.m_localIndex;
+            m_accounting = other.m_accounting;
+            m_asyncDispatch = other.m_asyncDispatch.load();
+            m_queueCapacity = other.m_queueCapacity;
+            m_overflowPolicy = other.m_overflowPolicy;
+            m_blockTimeout = other.m_blockTimeout;
+            m_currentOperatingStatus = other.m_currentOperatingStatus.load();
+            m_currentHealthState = other.m_currentHealthState.load();
+
+            m_plugins.swap(plugins);
+            m_pluginWrappers.swap(pluginWrappers);
+            publishSnapshot(block);
+        }
+
+        static void checkKeepaliveSettings(const KeepaliveSettings & settings) {
+            if(settings.interval.count() <= 0 || settings.jitter.count() < 0) {
+                throw std::invalid_argument("The keepalive interval must be greater than 0 and the jitter must not be negative");
+            }
+        }
+
+        public:
+        /// Create a ServiceStatusPluginWrapperCollection
+        ServiceStatusPluginWrapperCollection(const std::string & serviceName) : m_serviceName(serviceName){}
+
+        /// Copy a collection
+        ///
+        /// The copy holds the plugins of the source and shares their providers, their dispatchers and the statistics.
+        /// The watch of a folder, the watchdog and the keepalive of the source are not copied.
+        ///@param other [in] collection to copy, locked during the copy
+        ServiceStatusPluginWrapperCollection(const ServiceStatusPluginWrapperCollection & other) {
+            std::lock_guard<std::mutex> otherLock(other.m_mutex);
+            PluginSlots plugins = other.m_plugins;
+            std::map<std::string, ServiceStatusPluginWrapper> pluginWrappers = other.m_pluginWrappers;
+            SnapshotBlock block(plugins.size());
+            renameSlots(plugins, pluginWrappers);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            copyLocked(other, plugins, pluginWrappers, block);
+        }
+
+        /// Replace the plugins and the settings by the ones of another collection
+        ///
+        /// The watch of a folder, the watchdog and the keepalive of the collection are stopped, the ones of the source
+        /// are not copied. The previous plugins are released once the setForAll in progress are done with them.
+        ///@param other [in] collection to copy, locked during the copy
+        ServiceStatusPluginWrapperCollection & operator=(const ServiceStatusPluginWrapperCollection & other) {
+            if(this == &other) {
+                return *this;
+            }
+            unwatchFolder();
+
+            std::unique_lock<std::mutex> lock(m_mutex, std::defer_lock);
+            std::unique_lock<std::mutex> otherLock(other.m_mutex, std::defer_lock);
+            std::lock(lock, otherLock);
+
+            //the allocations are done before the collection changes
+            PluginSlots plugins = other.m_plugins;
+            std::map<std::string, ServiceStatusPluginWrapper> pluginWrappers = other.m_pluginWrappers;
+            SnapshotBlock block(plugins.size());
+            renameSlots(plugins, pluginWrappers);
+
+            disableKeepaliveLocked();
+            if(m_watchdogEnabled) {
+                disableWatchdogLocked();
+            }
+
+            //the previous slots are released with the local vector, after the publication
+            copyLocked(other, plugins, pluginWrappers, block);
+            return *this;
+        }
+
+        ~ServiceStatusPluginWrapperCollection(){
+            unwatchFolder();
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            disableKeepaliveLocked();
+
+            //the watchdog uses the dispatchers
+            m_watchdog.reset();
+            m_asyncDispatch = false;
+
+            //nothing is published: the snapshot is destroyed first, then the slots, in which the dispatchers
+            //deliver their pending updates before the providers and the plugins are released
+        }
+
+        /// Get the service name
+        ///@return  service name
+        const std::string & getServiceName() const noexcept {return m_serviceName;}
+
+        /// Set the Health State for all the collection
+        ///
+        /// It can be called from any thread, including while plugins are added or removed, and does not take any lock.
+        ///@param hs [in] Health state to set
+        void setForAll(HealthState hs) noexcept { 
+            deliverForAll(detail::StatusUpdate(hs));
+        }
+
+        /// Set the Operating Status for all the collection
+        ///
+        /// It can be called from any thread, including while plugins are added or removed, and does not take any lock.
+        ///@param os [in] Operating Status to set
+        void setForAll(OperatingStatus os) noexcept { 
+            deliverForAll(detail::StatusUpdate(os));
+        }
+
+        /// Record the statuses set with setForAll in a registry of the process
+        ///
+        /// The service is added to the registry, which receives the last status already set.
+        ///@param registry [in] registry receiving the statuses, null to stop recording
+        void setLocalStatusRegistry(std::shared_ptr<LocalStatusRegistry> registry) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            SnapshotBlock block(m_plugins.size());
+            const std::size_t index = registry ? registry->addService(m_serviceName) : LocalStatusRegistry::NOT_FOUND;
+
+            m_localRegistry = registry;
+            m_localIndex = index;
+            publishSnapshot(block);
+
+            if(registry) {
+                const int os = m_currentOperatingStatus.load(std::memory_order_acquire);
+                const int hs = m_currentHealthState.load(std::memory_order_acquire);
+                if(os >= 0) {
+                    registry->set(index, static_cast<OperatingStatus>(os));
+                }
+                if(hs >= 0) {
+                    registry->set(index, static_cast<HealthState>(hs));
+                }
+            }
+        }
+
+        /// Get the registry recording the statuses set with setForAll
+        ///@return null if the statuses are not recorded
+        std::shared_ptr<LocalStatusRegistry> getLocalStatusRegistry() const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_localRegistry;
+        }
+
+        /// Account the time spent in each status set with setForAll
+        ///
+        /// The accounting receives the last status already set.
+        ///@param accounting [in] accounting of the service, null to stop the accounting
+        void setStatusAccounting(std::shared_ptr<StatusAccounting> accounting) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            SnapshotBlock block(m_plugins.size());
+            m_accounting = accounting;
+            publishSnapshot(block);
+
+            if(accounting) {
+                const int os = m_currentOperatingStatus.load(std::memory_order_acquire);
+                const int hs = m_currentHealthState.load(std::memory_order_acquire);
+                if(os >= 0) {
+                    accounting->record(static_cast<OperatingStatus>(os));
+                }
+                if(hs >= 0) {
+                    accounting->record(static_cast<HealthState>(hs));
+                }
+            }
+        }
+
+        /// Get the accounting of the time spent in each status
+        ///@return null without accounting
+        std::shared_ptr<StatusAccounting> getStatusAccounting() const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_accounting;
+        }
+
+        /// Use a cache of the plugin files probed by addAll and addAllWithReport
+        ///
+        /// The files which the cache knows are not plugins, and the files of a plugin name already in the collection,
+        /// are reported without being loaded. The other files are loaded and their result recorded, then the cache is saved.
+        ///@param cache [in] cache, possibly shared with other collections, null to probe every file
+        void setManifestCache(std::shared_ptr<PluginManifestCache> cache) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_manifestCache = std::move(cache);
+        }
+
+        /// Get the cache of the plugin files probed by addAll
+        ///@return null without cache
+        std::shared_ptr<PluginManifestCache> getManifestCache() const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_manifestCache;
+        }
+
+        /// Add a ServiceStatusProvider to the collection using the path to the plugin
+        /// @param pluginPath [in] Path of the plugin
+        void add(const std::string & pluginPath) {
+            ServiceStatusPluginWrapper newPlugin(pluginPath);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            checkNotInCollection(newPlugin.getPluginName());
+            SnapshotBlock block(m_plugins.size() + 1);
+            insert(newPlugin, newPlugin.newServiceStatusProviderPtr(m_serviceName));
+            publishSnapshot(block);
+        }
+
+        /// Add a plugin to the collection without loading it
+        ///
+        /// The plugin is loaded (RTLD_LAZY) and its ServiceStatusProvider created on the first update.
+        /// If the load fails, the updates return an error and the load is retried at most once per second.
+        /// @param pluginPath [in] Path of the plugin
+        /// @param pluginName [in] Name of the plugin, checked when the plugin is loaded
+        void addLazy(const std::string & pluginPath, const std::string & pluginName) {
+            ServiceStatusPluginWrapper newPlugin(pluginPath, pluginName, LoadMode::Lazy);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            checkNotInCollection(pluginName);
+            SnapshotBlock block(m_plugins.size() + 1);
+
+            const std::string serviceName = m_serviceName;
+            std::function<ServiceStatusProviderPtr()> loader = [newPlugin, serviceName] () mutable {
+                return newPlugin.newServiceStatusProviderPtr(serviceName);
+            };
+            insert(newPlugin, std::make_shared<detail::ProviderChannel>(loader, m_counters));
+            publishSnapshot(block);
+        }
+
+        /// Add a plugin running in a host process, requires fty_service_status_isolated.h
+        ///
+        /// The plugin is loaded by fty-service-status-plugin-host, see IsolatedServiceStatusProvider:
+        /// the updates are queued for the host, and a host which dies is restarted with the last status.
+        /// @param pluginPath [in] Path of the plugin
+        /// @param settings [in] Settings of the host
+        /// @return provider forwarding the status to the host
+        template<typename Provider = IsolatedServiceStatusProvider>
+        std::shared_ptr<Provider> addIsolated(const std::string & pluginPath, const IsolationSettings & settings = IsolationSettings()) {
+            //the host is started without lock, the plugin may be slow to load
+            std::shared_ptr<Provider> provider = std::make_shared<Provider>(pluginPath, m_serviceName, settings);
+            ServiceStatusPluginWrapper newPlugin(pluginPath, provider->getPluginName(), LoadMode::Lazy);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            checkNotInCollection(newPlugin.getPluginName());
+
+            //the plugin is never loaded in the service
+            detail::ProviderChannelPtr channel = std::make_shared<detail::ProviderChannel>(provider, m_counters);
+            channel->setLastErrorGetter([provider] () { return provider->getLastError(); });
+            SnapshotBlock block(m_plugins.size() + 1);
+            insert(newPlugin, channel);
+            publishSnapshot(block);
+            return provider;
+        }
+
+        /// Release the plugins added with addLazy which did not receive any update for a while
+        ///
+        /// Their ServiceStatusProvider is destroyed and the plugin unloaded, they are loaded again on the next update.
+        ///@param idlePeriod [in] minimum time since the last update
+        ///@return number of released plugins
+        std::size_t unloadIdlePlugins(std::chrono::milliseconds idlePeriod) noexcept {
+            const std::int64_t now = detail::monotonicNs();
+            const std::int64_t idle = std::chrono::duration_cast<std::chrono::nanoseconds>(idlePeriod).count();
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::size_t released = 0;
+            for(PluginSlot & slot : m_plugins) {
+                if(slot.channel->releaseIfIdle(now, idle)) {
+                    slot.plugin.unload();
+                    released++;
+                }
+            }
+            return released;
+        }
+
+        /// Add all ServiceStatusProvider from a folder to the collection
+        ///@param folderPath [in] Path to the folder
+        ///@param regex [in] 
+        ///@return number of added ServiceStatusProvider
+        int addAll(const std::string & folderPath, const std::regex & regex = std::regex(".*")) {
+            return countAdded(addAllWithReport(folderPath, regex));
+        }
+
+        /// Add all ServiceStatusProvider from a folder to the collection
+        ///@param folderPath [in] Path to the folder
+        ///@param globPattern [in] glob pattern of the file names, for example "*status.so"
+        ///@return number of added ServiceStatusProvider
+        int addAll(const std::string & folderPath, const std::string & globPattern) {
+            return countAdded(addAllWithReport(folderPath, globPattern));
+        }
+
+        /// Add all ServiceStatusProvider from a folder to the collection and report the result for each file
+        ///
+        /// Only the regular files (or links to regular files) are considered.
+        /// The plugins are loaded concurrently, then added in the order of their path,
+        /// so the first path wins when two files provide the same plugin name.
+        ///@param folderPath [in] Path to the folder
+        ///@param regex [in] regex of the file names
+        ///@param concurrency [in] number of threads loading the plugins, 0 for the number of cores
+        ///@return one result per matching file, sorted by path
+        std::vector<PluginLoadResult> addAllWithReport(const std::string & folderPath, const std::regex & regex, unsigned concurrency = 0) {
+            return addFiles(listPluginFiles(folderPath, [&regex](const char * name) { return std::regex_match(name, regex); }), concurrency);
+        }
+
+        /// Add all ServiceStatusProvider from a folder to the collection and report the result for each file
+        ///
+        /// Same as the regex version, using a glob pattern ('*' and '?') which is much cheaper to match.
+        ///@param folderPath [in] Path to the folder
+        ///@param globPattern [in] glob pattern of the file names
+        ///@param concurrency [in] number of threads loading the plugins, 0 for the number of cores
+        ///@return one result per matching file, sorted by path
+        std::vector<PluginLoadResult> addAllWithReport(const std::string & folderPath, const std::string & globPattern = "*", unsigned concurrency = 0) {
+            return addFiles(listPluginFiles(folderPath, [&globPattern](const char * name) { return detail::globMatch(globPattern.c_str(), name); }), concurrency);
+        }
+
+        /// Remove a ServiceStatusProvider to the collection using the name to the plugin
+        ///
+        /// It waits for the setForAll in progress to be done with the provider before releasing it.
+        /// It must not be called by a provider.
+        /// @param pluginName [in] Path of the plugin to remove
+        /// @return false if the plugin is not in the collection, or if the memory of the new snapshot cannot be
+        /// allocated: the collection is unchanged then
+        bool remove( const std::string & pluginName ) noexcept {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto slot = findSlot(m_plugins, pluginName);
+            if(slot == m_plugins.end()) {
+                return false;
+            }
+
+            //the only allocation, done before the collection changes
+            SnapshotBlock block(m_plugins.size() - 1, std::nothrow);
+            if(!block.isAllocated()) {
+                return false;
+            }
+
+            if(m_watchdog) {
+                m_watchdog->unwatch(pluginName);
+            }
+
+            //the plugin is released once the snapshot without it is published
+            const PluginSlot removed = std::move(*slot);
+            m_plugins.erase(slot);
+            m_pluginWrappers.erase(m_pluginWrappers.find(pluginName));
+            publishSnapshot(block);
+            return true;
+        }
+
+        /// Watch a folder and reload its plugins when their files change, requires fty_service_status_folder_watcher.h
+        ///
+        /// The plugins of the folder matching the pattern are added first, the ones already in the collection are kept.
+        /// Then inotify reports the changes: a created file adds its plugin, a replaced file reloads it and a deleted file
+        /// removes it, without touching the other plugins. The events are gathered until the folder is quiet during the debounce period,
+        /// so the burst of events of a package installation gives one reload. A new provider receives the last
+        /// status set with setForAll. The reloads are done by the thread of the watcher and do not block setForAll.
+        /// A file must be replaced by renaming a new file over it: a library in use cannot be rewritten in place.
+        /// Only one folder is watched at a time, watching a folder stops watching the previous one.
+        ///@param folderPath [in] folder of the plugins
+        ///@param globPattern [in] pattern of the names of the plugins, '*' and '?' are wildcards
+        ///@param debounce [in] time without change before the reload
+        template<typename Watcher = detail::FolderWatcher>
+        void watchFolder(const std::string & folderPath, const std::string & globPattern = "*", std::chrono::milliseconds debounce = std::chrono::milliseconds(500)) {
+            startFolderWatch<Watcher>(folderPath, [globPattern](const char * name) { return detail::globMatch(globPattern.c_str(), name); }, debounce);
+        }
+
+        /// Watch a folder and reload its plugins when their files change, requires fty_service_status_folder_watcher.h
+        ///@param folderPath [in] folder of the plugins
+        ///@param regex [in] regex matching the names of the plugins
+        ///@param debounce [in] time without change before the reload
+        template<typename Watcher = detail::FolderWatcher>
+        void watchFolder(const std::string & folderPath, const std::regex & regex, std::chrono::milliseconds debounce = std::chrono::milliseconds(500)) {
+            startFolderWatch<Watcher>(folderPath, [regex](const char * name) { return std::regex_match(name, regex); }, debounce);
+        }
+
+        /// Stop watching the folder, the plugins loaded from it stay in the collection
+        void unwatchFolder() noexcept {
+            //the watcher is stopped after the lock is released, its thread may wait for it
+            std::shared_ptr<detail::FolderWatcher> watcher;
+            std::lock_guard<std::mutex> lock(m_reloadMutex);
+            watcher = std::move(m_folderWatcher);
+            m_watchGeneration++;
+            m_watchedFiles.clear();
+        }
+
+        /// Check if a folder is watched
+        bool isWatchingFolder() const noexcept {
+            std::lock_guard<std::mutex> lock(m_reloadMutex);
+            return m_folderWatcher != nullptr;
+        }
+
+        /// Get the number of times the changes of the watched folder were applied, including the first scan
+        std::uint64_t getFolderReloadCount() const noexcept { return m_reloadCount; }
+
+        /// Get the plugins added, removed or which failed to load during the last reload of the watched folder
+        ///@return the report of each changed file, a replaced plugin is removed and added
+        std::vector<PluginLoadResult> getLastFolderReloadReport() const {
+            std::lock_guard<std::mutex> lock(m_reloadMutex);
+            return m_lastReloadReport;
+        }
+
+        /// Enable the change suppression
+        ///
+        /// The collection remembers the last value delivered to each provider and skips the unchanged values.
+        /// With the asynchronous dispatch, the updates waiting for a busy provider are also coalesced:
+        /// only the newest Operating Status and Health State are delivered.
+        void enableChangeSuppression() noexcept {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_changeSuppression = true;
+            for(PluginSlot & slot : m_plugins) {
+                slot.channel->setChangeSuppression(true);
+            }
+        }
+
+        /// Disable the change suppression, every update is delivered to every provider
+        void disableChangeSuppression() noexcept {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_changeSuppression = false;
+            for(PluginSlot & slot : m_plugins) {
+                slot.channel->setChangeSuppression(false);
+            }
+        }
+
+        /// Check if the change suppression is enabled
+        bool isChangeSuppressionEnabled() const noexcept { return m_changeSuppression; }
+
+        /// Get the number of updates not delivered because the provider already had the value
+        ///@return number of suppressed updates since the creation of the collection
+        std::uint64_t getSuppressedUpdateCount() const noexcept { return m_counters->suppressed.load(std::memory_order_relaxed); }
+
+        /// Get the number of updates not delivered because a newer one was waiting for the same provider
+        ///@return number of coalesced updates since the creation of the collection
+        std::uint64_t getCoalescedUpdateCount() const noexcept { return m_counters->coalesced.load(std::memory_order_relaxed); }
+
+        /// Enable the asynchronous dispatch of the updates
+        ///
+        /// setForAll only queues the update and returns, a dedicated thread per plugin
+        /// delivers the updates to the provider in the order they were set.
+        /// Calling it again flushes the pending updates and applies the new settings.
+        /// The updates set by other threads while the dispatch changes may be delivered out of order.
+        ///@param queueCapacity [in] number of pending updates per plugin (rounded up to a power of 2)
+        ///@param policy [in] policy to apply when the queue of a plugin is full
+        ///@param blockTimeout [in] with OverflowPolicy::Block, maximum wait of setForAll for room in the queue of a plugin,
+        /// the update is then dropped and counted by getDroppedUpdateCount; 0 to wait for ever
+        void enableAsyncDispatch(std::size_t queueCapacity = 64, OverflowPolicy policy = OverflowPolicy::DropOldest,
+                                 std::chrono::milliseconds blockTimeout = std::chrono::milliseconds(0)) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            enableAsyncDispatchLocked(queueCapacity, policy, blockTimeout);
+        }
+
+        /// Disable the asynchronous dispatch, and the watchdog and the keepalive which depend on it
+        ///
+        /// The pending updates are delivered before the dispatcher threads stop.
+        void disableAsyncDispatch() {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            disableWatchdogLocked();
+            disableKeepaliveLocked();
+            stopDispatchers();
+        }
+
+        /// Check if the asynchronous dispatch is enabled
+        bool isAsyncDispatchEnabled() const noexcept { return m_asyncDispatch; }
+
+        /// Wait for the updates set before the call to be delivered to all the plugins
+        /// Does nothing if the asynchronous dispatch is disabled.
+        ///@param timeout [in] maximum time to wait for each plugin
+        ///@return true if all updates were delivered, false if a plugin did not catch up in time
+        bool flush(std::chrono::milliseconds timeout) noexcept {
+            //the dispatchers are kept alive without blocking the other functions while waiting
+            std::vector<DispatcherPtr> dispatchers;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                for(const PluginSlot & slot : m_plugins) {
+                    if(slot.dispatcher) {
+                        dispatchers.push_back(slot.dispatcher);
+                    }
+                }
+            }
+
+            bool done = true;
+            for(auto & dispatcher : dispatchers) {
+                done = dispatcher->flush(timeout) && done;
+            }
+            return done;
+        }
+
+        /// Get the number of updates discarded by the overflow policy of the asynchronous dispatch
+        ///@return number of discarded updates since the creation of the collection
+        std::uint64_t getDroppedUpdateCount() const noexcept { return m_counters->dropped.load(std::memory_order_relaxed); }
+
+        /// Enable the watchdog which quarantines the misbehaving plugins
+        ///
+        /// A plugin is quarantined when a call to set() exceeds the latency budget, even while the call is in progress,
+        /// or when it returns too many consecutive errors. The updates for a quarantined plugin are skipped.
+        /// The plugin is probed in background with the last values set, with an exponential backoff,
+        /// and reinstated when a probe succeeds within the budget.
+        /// The probes go through the dispatchers of the plugins: the asynchronous dispatch must be enabled first,
+        /// with the settings chosen by the service, and disabling it disables the watchdog.
+        ///@param settings [in] settings of the watchdog, applied to all the plugins
+        void enableWatchdog(const WatchdogSettings & settings = WatchdogSettings()) {
+            if(settings.latencyBudget.count() <= 0 || settings.checkPeriod.count() <= 0) {
+                throw std::invalid_argument("The latency budget and the check period of the watchdog must be greater than 0");
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(!m_asyncDispatch) {
+                throw std::runtime_error("The asynchronous dispatch must be enabled before the watchdog");
+            }
+            m_watchdog.reset();
+            m_watchdogSettings = settings;
+            m_watchdogEnabled = true;
+
+            try {
+                startWatchdog();
+            }
+            catch(...) {
+                disableWatchdogLocked();
+                throw;
+            }
+        }
+
+        /// Disable the watchdog, the quarantined plugins are reinstated
+        void disableWatchdog() noexcept {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            disableWatchdogLocked();
+        }
+
+        /// Check if the watchdog is enabled
+        bool isWatchdogEnabled() const noexcept {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_watchdogEnabled;
+        }
+
+        /// Set the latency budget of one plugin, overriding the one of the watchdog settings
+        ///@param pluginName [in] name of the plugin
+        ///@param budget [in] maximum duration of a call to set()
+        void setLatencyBudget(const std::string & pluginName, std::chrono::milliseconds budget) {
+            if(budget.count() <= 0) {
+                throw std::invalid_argument("The latency budget must be greater than 0");
+            }
+
+            //checked under the lock, so the watchdog cannot be disabled before the budget is set
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(!m_watchdogEnabled) {
+                throw std::runtime_error("The watchdog must be enabled to set a latency budget");
+            }
+            auto slot = findSlot(m_plugins, pluginName);
+            if(slot == m_plugins.end()) {
+                throw std::runtime_error("Plugin <"+pluginName+ "> does not exist in the collection.");
+            }
+            slot->channel->setLatencyBudget(budget);
+        }
+
+        /// Check if a plugin is quarantined
+        ///@param pluginName [in] name of the plugin
+        ///@return true if the plugin exists and is quarantined
+        bool isQuarantined(const std::string & pluginName) const noexcept {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto slot = findSlot(m_plugins, pluginName);
+            return slot != m_plugins.end() && slot->channel->isQuarantined();
+        }
+
+        /// Get the names of the quarantined plugins
+        ///@return list of plugin names
+        std::list<std::string> getQuarantinedPlugins() const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::list<std::string> quarantined;
+            for(const PluginSlot & slot : m_plugins) {
+                if(slot.channel->isQuarantined()) {
+                    quarantined.push_back(*slot.name);
+                }
+            }
+            return quarantined;
+        }
+
+        /// Get the number of times a plugin was quarantined
+        ///@param pluginName [in] name of the plugin
+        ///@return number of quarantines, 0 if the plugin does not exist
+        std::uint64_t getQuarantineCount(const std::string & pluginName) const noexcept {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto slot = findSlot(m_plugins, pluginName);
+            return slot != m_plugins.end() ? slot->channel->getQuarantineCount() : 0;
+        }
+
+        /// Get the number of updates skipped because the plugin was quarantined
+        ///@return number of skipped updates since the creation of the collection
+        std::uint64_t getSkippedUpdateCount() const noexcept { return m_counters->skipped.load(std::memory_order_relaxed); }
+
+        /// Enable the keepalive which re-asserts the last status to the plugins
+        ///
+        /// Each plugin receives again the last Operating Status and Health State set with setForAll once per interval,
+        /// even when the change suppression is enabled, unless it received a status during the interval.
+        /// The timers of all the collections run in one scheduler: no thread is created per collection.
+        /// The scheduler is declared in fty_service_status_keepalive.h, which must be included.
+        /// The re-assertions are queued to the dispatchers of the plugins, so a plugin is never called by two threads
+        /// at once: the asynchronous dispatch must be enabled first, with the settings chosen by the service, and
+        /// disabling it disables the keepalive.
+        /// Calling it again replaces the settings.
+        ///@param settings [in] settings of the plugins without their own settings
+        ///@param scheduler [in] scheduler running the timers, the one of the process if null
+        template<typename Scheduler = KeepaliveScheduler>
+        void enableKeepalive(const KeepaliveSettings & settings = KeepaliveSettings(), std::shared_ptr<Scheduler> scheduler = nullptr) {
+            checkKeepaliveSettings(settings);
+            if(!scheduler) {
+                scheduler = Scheduler::getInstance();
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(!m_asyncDispatch) {
+                throw std::runtime_error("The asynchronous dispatch must be enabled before the keepalive");
+            }
+            disableKeepaliveLocked();
+            m_keepaliveSettings = settings;
+            m_keepaliveScheduler = scheduler;
+            updateKeepaliveTimers();
+        }
+
+        /// Disable the keepalive
+        void disableKeepalive() noexcept {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            disableKeepaliveLocked();
+        }
+
+        /// Check if the keepalive is enabled
+        bool isKeepaliveEnabled() const noexcept {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_keepaliveScheduler != nullptr;
+        }
+
+        /// Set the keepalive settings of one plugin, overriding the ones given to enableKeepalive
+        ///
+        /// The settings are kept when the plugin is removed, and apply again when a plugin with this name is added.
+        ///@param pluginName [in] name of the plugin
+        ///@param settings [in] settings of the plugin
+        void setKeepaliveSettings(const std::string & pluginName, const KeepaliveSettings & settings) {
+            checkKeepaliveSettings(settings);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pluginKeepaliveSettings[pluginName] = settings;
+            if(m_keepaliveScheduler) {
+                removeKeepaliveTimer(pluginName);
+                updateKeepaliveTimers();
+            }
+        }
+
+        /// Get the number of times the last status was re-asserted to a plugin by the keepalive
+        ///@return number of re-assertions since the creation of the collection
+        std::uint64_t getKeepaliveCount() const noexcept { return m_counters->keepalives.load(std::memory_order_relaxed); }
+
+        /// Get the number of keepalives skipped because the plugin received a status during the interval
+        ///@return number of skipped keepalives since the creation of the collection
+        std::uint64_t getFreshKeepaliveCount() const noexcept { return m_counters->freshKeepalives.load(std::memory_order_relaxed); }
+
+        /// Get the statistics of the calls to a plugin
+        ///@param pluginName [in] name of the plugin
+        ///@return statistics since the plugin was added
+        PluginStats getPluginStats(const std::string & pluginName) const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto slot = findSlot(m_plugins, pluginName);
+            if(slot == m_plugins.end()) {
+                throw std::runtime_error("Plugin <"+pluginName+ "> does not exist in the collection.");
+            }
+
+            PluginStats stats;
+            stats.pluginName = pluginName;
+            slot->channel->getStats(stats);
+            return stats;
+        }
+
+        /// Get the statistics of the calls to all the plugins
+        ///@return statistics of each plugin, ordered by name
+        std::list<PluginStats> getPluginStats() const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::list<PluginStats> allStats;
+            for(const PluginSlot & slot : m_plugins) {
+                allStats.emplace_back();
+                allStats.back().pluginName = *slot.name;
+                slot.channel->getStats(allStats.back());
+            }
+            return allStats;
+        }
+
+        /// Get the ServiceStatusPluginWrapper from the collection.
+        /// The ServiceStatusPluginWrapper are inside a map with there name as a key.
+        /// The map changes with the collection: use getPluginCollectionCopy while another thread, or the watch
+        /// of a folder, adds or removes plugins.
+        ///@return map of <name, ServiceStatusPluginWrapper>
+        const std::map<std::string, ServiceStatusPluginWrapper> & getPluginCollection() const noexcept { return m_pluginWrappers; }
+
+        /// Get a copy of the ServiceStatusPluginWrapper of the collection, taken under its lock
+        ///
+        /// The copied wrappers share the plugins of the collection.
+        ///@return map of <name, ServiceStatusPluginWrapper>
+        std::map<std::string, ServiceStatusPluginWrapper> getPluginCollectionCopy() const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_pluginWrappers;
+        }
+
+        /// Helper which list the content of a folder and return their full path if they match to the regex
+        /// For example use "*.so" to get all the <file>.so path
+        ///@param folderPath [in] Path to the folder
+        ///@param regex [in] 
+        ///@return List of paths
+        static std::list<std::string> listPathOfFolderElements(const std::string & folderPath, const std::regex & regex = std::regex(".*")) {
+            std::list<std::string> listPathElements;
+            DIR *d;
+            struct dirent *dir;
+            d = opendir(folderPath.c_str());
+
+            if (d) {
+                while ((dir = readdir(d)) != NULL) {
+                    if(std::regex_match(dir->d_name, regex)){
+                        std::string path(folderPath +"/"+std::string(dir->d_name));
+                        char * fullPath = realpath(path.c_str(), NULL);
+                        if(fullPath != NULL) {
+                            listPathElements.push_back(fullPath);
+                            free(fullPath);
+                        }
+                    }
+                }
+                closedir(d);
+            }
+
+            return listPathElements;
+        }
+
+        /// Helper which list the content of a folder and return their full path if they match to the glob pattern
+        /// For example use "*.so" to get all the <file>.so path
+        ///@param folderPath [in] Path to the folder
+        ///@param globPattern [in] glob pattern ('*' matches any sequence, '?' any character)
+        ///@return List of paths
+        static std::list<std::string> listPathOfFolderElements(const std::string & folderPath, const std::string & globPattern) {
+            std::list<std::string> listPathElements;
+            DIR * d = opendir(folderPath.c_str());
+
+            if (d) {
+                struct dirent * dir;
+                while ((dir = readdir(d)) != NULL) {
+                    if(detail::globMatch(globPattern.c_str(), dir->d_name)) {
+                        std::string path(folderPath + "/" + dir->d_name);
+                        char * fullPath = realpath(path.c_str(), NULL);
+                        if(fullPath != NULL) {
+                            listPathElements.push_back(fullPath);
+                            free(fullPath);
+                        }
+                    }
+                }
+                closedir(d);
+            }
+
+            return listPathElements;
+        }
+
+    };
+
+    /// Tree of the components of a service, whose worst status is set to a collection
+    ///
+    /// The components (assets, sensors, connections...) report their own Health State and Operating Status.
+    /// Each component counts the statuses of its children and its own status by severity, so its worst status,
+    /// the one of its subtree, is known without scanning the subtree: an update costs O(depth) and stops at the first
+    /// ancestor whose worst status does not change. The worst status of the tree is set to the collection only when
+    /// it changes.
+    ///
+    /// The Health States are ordered by their value, Unknown being the least severe. The Operating Statuses are ordered
+    /// from Aborted, the most severe, to InService, then None and Unknown: a service with a stopped component is stopped.
+    /// The functions can be called from several threads. The collection is called after the lock of the tree is released,
+    /// by one thread at a time, with the worst status of the tree at the time of the call: a late update never sets an
+    /// older status over a newer one.
+    class ComponentHealthTree
+    {
+        public:
+        using ComponentId = std::size_t;
+
+        static constexpr ComponentId NOT_FOUND = static_cast<ComponentId>(-1);
+        /// The service, parent of the top level components
+        static constexpr ComponentId ROOT = 0;
+
+        private:
+        static constexpr std::size_t HEALTH_RANKS = 7;
+        static constexpr std::size_t OPERATING_RANKS = 17;
+
+        //number of statuses of each rank in a subtree, the worst rank being the highest one
+        template<std::size_t N>
+        struct WorstOf
+        {
+            std::array<std::uint32_t, N> counts;
+            std::uint8_t worst;
+
+            WorstOf() noexcept : worst(0) { counts.fill(0); }
+
+            //@return true if the worst rank changed
+            bool update(std::uint8_t removed, std::uint8_t added) noexcept {
+                counts[removed]--;
+                counts[added]++;
+
+                const std::uint8_t previous = worst;
+                if(added > worst) {
+                    worst = added;
+                } else if(removed == worst && counts[removed] == 0) {
+                    while(worst > 0 && counts[worst] == 0) {
+                        worst--;
+                    }
+                }
+                return worst != previous;
+            }
+        };
+
+        struct Component
+        {
+            std::string name;
+            ComponentId parent = NOT_FOUND;
+            std::vector<ComponentId> children;
+            bool used = false;
+
+            //own status and worst status of the subtree, as ranks
+            std::uint8_t healthRank = 0;
+            std::uint8_t operatingRank = 0;
+            WorstOf<HEALTH_RANKS> health;
+            WorstOf<OPERATING_RANKS> operating;
+        };
+
+        ServiceStatusPluginWrapperCollection * m_collection;
+
+        mutable std::mutex m_mutex;
+        std::vector<Component> m_components;
+        std::vector<ComponentId> m_free;
+        std::unordered_map<std::string, ComponentId> m_names;
+        std::size_t m_count;
+
+        //serialize the calls to the collection, lock before m_mutex
+        mutable std::mutex m_forwardMutex;
+        int m_forwardedHealth;
+        int m_forwardedOperating;
+        std::uint64_t m_forwardCount;
+
+        //Operating Status by rank, from the least to the most severe
+        static const std::array<OperatingStatus, OPERATING_RANKS> & operatingByRank() noexcept {
+            static const std::array<OperatingStatus, OPERATING_RANKS> statuses = {{
+                OperatingStatus::Unknown, OperatingStatus::None, OperatingStatus::InService, OperatingStatus::Completed,
+                OperatingStatus::Dormant, OperatingStatus::Transitioning, OperatingStatus::Snapshotting,
+                OperatingStatus::Emigrating, OperatingStatus::Immigrating, OperatingStatus::Migrating,
+                OperatingStatus::InTest, OperatingStatus::Servicing, OperatingStatus::Starting,
+                OperatingStatus::ShuttingDown, OperatingStatus::Stopping, OperatingStatus::Stopped, OperatingStatus::Aborted
+            }};
+            return statuses;
+        }
+
+        static std::uint8_t rankOf(HealthState hs) noexcept {
+            return static_cast<std::uint8_t>(std::min<std::size_t>(static_cast<std::size_t>(hs) / 5, HEALTH_RANKS - 1));
+        }
+
+        static std::uint8_t rankOf(OperatingStatus os) noexcept {
+            static const std::array<std::uint8_t, OPERATING_RANKS> ranks = [] {
+                std::array<std::uint8_t, OPERATING_RANKS> result;
+                for(std::size_t rank = 0; rank < OPERATING_RANKS; rank++) {
+                    result[static_cast<std::size_t>(operatingByRank()[rank])] = static_cast<std::uint8_t>(rank);
+                }
+                return result;
+            }();
+            return static_cast<std::size_t>(os) < OPERATING_RANKS ? ranks[static_cast<std::size_t>(os)] : 0;
+        }
+
+        static HealthState healthOf(std::uint8_t rank) noexcept { return static_cast<HealthState>(rank * 5); }
+
+        static OperatingStatus operatingOf(std::uint8_t rank) noexcept { return operatingByRank()[rank]; }
+
+        //the mutex must be locked
+        void check(ComponentId id) const {
+            if(id >= m_components.size() || !m_components[id].used) {
+                throw std::runtime_error("Component <" + std::to_string(id) + "> does not exist in the tree.");
+            }
+        }
+
+        //replace one rank in the counts of a component and of its ancestors, as long as the worst rank changes
+        //The mutex must be locked.
+        template<std::size_t N>
+        static bool propagate(std::vector<Component> & components, ComponentId id, WorstOf<N> Component::* counts,
+                              std::uint8_t removed, std::uint8_t added) noexcept {
+            while(removed != added) {
+                WorstOf<N> & node = components[id].*counts;
+                const std::uint8_t previous = node.worst;
+                if(!node.update(removed, added)) {
+                    return false;
+                }
+                if(id == ROOT) {
+                    return true;
+                }
+                removed = previous;
+                added = node.worst;
+                id = components[id].parent;
+            }
+            return false;
+        }
+
+        //the status of the root is the worst status of the components, the mutex must be locked
+        void checkComponent(ComponentId id) const {
+            if(id == ROOT) {
+                throw std::invalid_argument("The status of the root is the worst status of the components");
+            }
+            check(id);
+        }
+
+        //which worst statuses of the tree changed
+        struct Changes
+        {
+            bool health = false;
+            bool operating = false;
+        };
+
+        //set the worst status of the tree to the collection, the mutex must not be locked
+        //The changed worst statuses are read again under the forward mutex, so the last call always sets the current
+        //status, and a status equal to the one already set is skipped.
+        void forward(Changes changes) noexcept {
+            if(m_collection == nullptr || (!changes.health && !changes.operating)) {
+                return;
+            }
+            std::lock_guard<std::mutex> forwardLock(m_forwardMutex);
+
+            int health, operating;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                health = m_components[ROOT].health.worst;
+                operating = m_components[ROOT].operating.worst;
+            }
+
+            if(changes.operating && operating != m_forwardedOperating) {
+                m_collection->setForAll(operatingOf(static_cast<std::uint8_t>(operating)));
+                m_forwardedOperating = operating;
+                m_forwardCount++;
+            }
+            if(changes.health && health != m_forwardedHealth) {
+                m_collection->setForAll(healthOf(static_cast<std::uint8_t>(health)));
+                m_forwardedHealth = health;
+                m_forwardCount++;
+            }
+        }
+
+        //the mutex must be locked
+        Changes setLocked(ComponentId id, std::uint8_t operatingRank, std::uint8_t healthRank) {
+            Component & component = m_components[id];
+
+            Changes changes;
+            changes.operating = propagate(m_components, id, &Component::operating, component.operatingRank, operatingRank);
+            component.operatingRank = operatingRank;
+            changes.health = propagate(m_components, id, &Component::health, component.healthRank, healthRank);
+            component.healthRank = healthRank;
+            return changes;
+        }
+
+        public:
+        /// Create a tree whose worst status is only read with the getters
+        ComponentHealthTree() : ComponentHealthTree(nullptr) {}
+
+        /// Create a tree whose worst status is set to a collection
+        ///@param collection [in] collection of the service, must outlive the tree
+        explicit ComponentHealthTree(ServiceStatusPluginWrapperCollection & collection) : ComponentHealthTree(&collection) {}
+
+        ComponentHealthTree(const ComponentHealthTree &) = delete;
+        ComponentHealthTree & operator=(const ComponentHealthTree &) = delete;
+
+        /// Add a component, with the Unknown status
+        ///@param name [in] name of the component, unique in the tree
+        ///@param parent [in] parent component, ROOT for a top level component
+        ///@return identifier of the component, reused after the component is removed
+        ComponentId add(const std::string & name, ComponentId parent = ROOT) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            check(parent);
+            if(m_names.count(name) != 0) {
+                throw std::runtime_error("Component <" + name + "> already exist in the tree.");
+            }
+
+            ComponentId id;
+            if(!m_free.empty()) {
+                id = m_free.back();
+                m_free.pop_back();
+            } else {
+                m_components.emplace_back();
+                id = m_components.size() - 1;
+            }
+
+            Component & component = m_components[id];
+            component = Component();
+            component.name = name;
+            component.parent = parent;
+            component.used = true;
+            component.health.counts[0] = 1;
+            component.operating.counts[0] = 1;
+
+            try {
+                m_names[name] = id;
+                m_components[parent].children.push_back(id);
+            }
+            catch(...) {
+                m_names.erase(name);
+                component.used = false;
+                m_free.push_back(id);
+                throw;
+            }
+
+            //an Unknown status does not change the worst status of the parent
+            m_components[parent].health.counts[0]++;
+            m_components[parent].operating.counts[0]++;
+            m_count++;
+            return id;
+        }
+
+        /// Remove a component and its subtree
+        ///@param id [in] identifier of the component
+        void remove(ComponentId id) {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if(id == ROOT) {
+                throw std::invalid_argument("The root of the tree cannot be removed");
+            }
+            check(id);
+
+            std::vector<ComponentId> subtree = {id};
+            for(std::size_t i = 0; i < subtree.size(); i++) {
+                const std::vector<ComponentId> & children = m_components[subtree[i]].children;
+                subtree.insert(subtree.end(), children.begin(), children.end());
+            }
+            m_free.reserve(m_free.size() + subtree.size());
+
+            //the subtree leaves the counts of the ancestors
+            const Component & component = m_components[id];
+            const ComponentId parent = component.parent;
+            std::vector<ComponentId> & siblings = m_components[parent].children;
+            siblings.erase(std::find(siblings.begin(), siblings.end(), id));
+
+            Changes changes;
+            changes.operating = propagate(m_components, parent, &Component::operating, component.operating.worst, 0);
+            changes.health = propagate(m_components, parent, &Component::health, component.health.worst, 0);
+            m_components[parent].operating.counts[0]--;
+            m_components[parent].health.counts[0]--;
+
+            for(ComponentId removed : subtree) {
+                m_names.erase(m_components[removed].name);
+                m_components[removed] = Component();
+                m_free.push_back(removed);
+            }
+            m_count -= subtree.size();
+
+            lock.unlock();
+            forward(changes);
+        }
+
+        /// Find a component by name
+        ///@return identifier of the component, NOT_FOUND if it does not exist
+        ComponentId find(const std::string & name) const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_names.find(name);
+            return it != m_names.end() ? it->second : NOT_FOUND;
+        }
+
+        /// Set the Health State of a component
+        ///@param id [in] identifier of the component
+        ///@param hs [in] own Health State of the component
+        void set(ComponentId id, HealthState hs) {
+            Changes changes;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                checkComponent(id);
+                changes = setLocked(id, m_components[id].operatingRank, rankOf(hs));
+            }
+            forward(changes);
+        }
+
+        /// Set the Operating Status of a component
+        ///@param id [in] identifier of the component
+        ///@param os [in] own Operating Status of the component
+        void set(ComponentId id, OperatingStatus os) {
+            Changes changes;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                checkComponent(id);
+                changes = setLocked(id, rankOf(os), m_components[id].healthRank);
+            }
+            forward(changes);
+        }
+
+        /// Set both statuses of a component
+        void set(ComponentId id, OperatingStatus os, HealthState hs) {
+            Changes changes;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                checkComponent(id);
+                changes = setLocked(id, rankOf(os), rankOf(hs));
+            }
+            forward(changes);
+        }
+
+        /// Get the worst Health State of a component and of its subtree
+        ///@param id [in] identifier of the component, ROOT for the whole tree
+        HealthState getHealthState(ComponentId id = ROOT) const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            check(id);
+            return healthOf(m_components[id].health.worst);
+        }
+
+        /// Get the worst Operating Status of a component and of its subtree
+        ///@param id [in] identifier of the component, ROOT for the whole tree
+        OperatingStatus getOperatingStatus(ComponentId id = ROOT) const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            check(id);
+            return operatingOf(m_components[id].operating.worst);
+        }
+
+        /// Get the number of components, without the root
+        std::size_t getComponentCount() const noexcept {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_count;
+        }
+
+        /// Get the number of statuses set to the collection
+        std::uint64_t getForwardCount() const noexcept {
+            std::lock_guard<std::mutex> lock(m_forwardMutex);
+            return m_forwardCount;
+        }
+
+        private:
+        explicit ComponentHealthTree(ServiceStatusPluginWrapperCollection * collection)
+            : m_collection(collection), m_components(1), m_count(0),
+              m_forwardedHealth(-1), m_forwardedOperating(-1), m_forwardCount(0) {
+            m_components[ROOT].used = true;
+        }
+    };
+
+    /// Plugins shared by the services of a process
+    ///
+    /// A process which reports the status of many services loads each plugin once in the registry,
+    /// which creates the providers of every service. The statuses are set by batch: a plugin with the
+    /// setServiceStatusBatch entry point receives the whole batch in one call, the others receive
+    /// the calls to set() of each service. The batches are set one at a time, in the order of the calls, and the plugins
+    /// are called without the lock of the registry, so the other functions are not blocked by a slow plugin.
+    class ServiceStatusPluginRegistry
+    {
+        private:
+        //providers of a service, by index of plugin, null if the plugin refused the service
+        using Providers = std::vector<ServiceStatusProviderPtr>;
+
+        mutable std::mutex m_mutex;
+        std::vector<ServiceStatusPluginWrapper> m_plugins;
+        std::unordered_map<std::string, Providers> m_services;
+
+        //serialize the batches, lock before m_mutex
+        std::mutex m_batchMutex;
+
+        //reused by each batch, guarded by m_batchMutex
+        //The copies of the plugins and of the providers keep them alive while they are called without m_mutex.
+        std::vector<ServiceStatusPluginWrapper> m_batchPlugins;
+        std::vector<ServiceStatusProviderPtr> m_batchProviders;
+        std::vector<std::size_t> m_batchEnds;
+        std::vector<ServiceStatusBatchEntry> m_batch;
+
+        static ServiceStatusProviderPtr newProvider(ServiceStatusPluginWrapper & plugin, const std::string & serviceName) noexcept {
+            try {
+                return plugin.newServiceStatusProviderPtr(serviceName);
+            }
+            catch(const std::exception &) {
+                return nullptr;
+            }
+        }
+
+        //the mutex must be locked
+        std::unordered_map<std::string, Providers>::iterator addServiceLocked(const std::string & serviceName) {
+            auto it = m_services.find(serviceName);
+            if(it != m_services.end()) {
+                return it;
+            }
+
+            Providers providers;
+            providers.reserve(m_plugins.size());
+            for(auto & plugin : m_plugins) {
+                providers.push_back(newProvider(plugin, serviceName));
+            }
+            return m_services.emplace(serviceName, std::move(providers)).first;
+        }
+
+        //release the copies of the last batch, the providers before their plugins
+        //The m_batchMutex must be locked, the m_mutex must not.
+        void releaseBatch() noexcept {
+            m_batchProviders.clear();
+            m_batchPlugins.clear();
+        }
+
+        std::vector<ServiceStatusPluginWrapper>::iterator findPlugin(const std::string & pluginName) {
+            return std::find_if(m_plugins.begin(), m_plugins.end(),
+                [&pluginName] (const ServiceStatusPluginWrapper & plugin) { return plugin.getPluginName() == pluginName; });
+        }
+
+        public:
+        ServiceStatusPluginRegistry() = default;
+
+        ServiceStatusPluginRegistry(const ServiceStatusPluginRegistry &) = delete;
+        ServiceStatusPluginRegistry & operator=(const ServiceStatusPluginRegistry &) = delete;
+
+        ~ServiceStatusPluginRegistry() {
+            //remove the providers before the plugins
+            m_services.clear();
+            m_plugins.clear();
+        }
+
+        /// Get the registry of the process
+        static ServiceStatusPluginRegistry & getInstance() {
+            static ServiceStatusPluginRegistry registry;
+            return registry;
+        }
+
+        /// Load a plugin, the providers of the known services are created
+        ///@param pluginPath [in] path of the plugin
+        void add(const std::string & pluginPath) {
+            ServiceStatusPluginWrapper plugin(pluginPath);
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(findPlugin(plugin.getPluginName()) != m_plugins.end()) {
+                throw std::runtime_error("Plugin <"+plugin.getPluginName()+ "> already exist in the registry.");
+            }
+
+            m_plugins.push_back(plugin);
+            for(auto & service : m_services) {
+                service.second.push_back(newProvider(plugin, service.first));
+            }
+        }
+
+        /// Unload a plugin, with the providers it created
+        ///@param pluginName [in] name of the plugin
+        void remove(const std::string & pluginName) noexcept {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = findPlugin(pluginName);
+            if(it == m_plugins.end()) {
+                return;
+            }
+
+            const std::size_t index = static_cast<std::size_t>(it - m_plugins.begin());
+            for(auto & service : m_services) {
+                service.second.erase(service.second.begin() + static_cast<std::ptrdiff_t>(index));
+            }
+            m_plugins.erase(it);
+        }
+
+        /// Get the names of the loaded plugins
+        std::list<std::string> getPluginNames() const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            std::list<std::string> names;
+            for(auto & plugin : m_plugins) {
+                names.push_back(plugin.getPluginName());
+            }
+            return names;
+        }
+
+        /// Create the providers of a service in every plugin, nothing is done if the service is known
+        ///@param serviceName [in] name of the service
+        ///@return number of plugins which accepted the service
+        std::size_t addService(const std::string & serviceName) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            const Providers & providers = addServiceLocked(serviceName)->second;
+            return static_cast<std::size_t>(std::count_if(providers.begin(), providers.end(),
+                [] (const ServiceStatusProviderPtr & provider) { return provider != nullptr; }));
+        }
+
+        /// Remove the providers of a service
+        ///@param serviceName [in] name of the service
+        void removeService(const std::string & serviceName) noexcept {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_services.erase(serviceName);
+        }
+
+        /// Get the number of known services
+        std::size_t getServiceCount() const noexcept {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_services.size();
+        }
+
+        /// Set the status of several services in every plugin
+        ///
+        /// The unknown services are added. Each plugin receives the batch in one call if it has
+        /// the setServiceStatusBatch entry point, else one call to set() per service and per status.
+        ///@param statuses [in] status of the services
+        ///@param count [in] number of statuses
+        ///@return number of statuses which could not be set, counted once per plugin
+        int setForServices(const ServiceStatus * statuses, std::size_t count) {
+            std::lock_guard<std::mutex> batchLock(m_batchMutex);
+
+            //the batch of each plugin is built under the lock, the plugins are called without it
+            m_batch.clear();
+            m_batchEnds.clear();
+            try {
+                std::lock_guard<std::mutex> lock(m_mutex);
+
+                m_batchProviders.clear();
+                for(std::size_t i = 0; i < count; i++) {
+                    const Providers & providers = addServiceLocked(statuses[i].serviceName)->second;
+                    m_batchProviders.insert(m_batchProviders.end(), providers.begin(), providers.end());
+                }
+
+                m_batchPlugins = m_plugins;
+                const std::size_t pluginCount = m_plugins.size();
+                for(std::size_t index = 0; index < pluginCount; index++) {
+                    for(std::size_t i = 0; i < count; i++) {
+                        ServiceStatusProvider * provider = m_batchProviders[i * pluginCount + index].get();
+                        if(provider != nullptr) {
+                            m_batch.push_back(ServiceStatusBatchEntry{provider, statuses[i].operatingStatus, statuses[i].healthState});
+                        }
+                    }
+                    m_batchEnds.push_back(m_batch.size());
+                }
+            }
+            catch(...) {
+                releaseBatch();
+                throw;
+            }
+
+            int failures = 0;
+            std::size_t begin = 0;
+            for(std::size_t index = 0; index < m_batchPlugins.size(); index++) {
+                const std::size_t end = m_batchEnds[index];
+                if(end != begin) {
+                    failures += m_batchPlugins[index].setBatch(m_batch.data() + begin, end - begin);
+                }
+                begin = end;
+            }
+            releaseBatch();
+            return failures;
+        }
+
+        /// Set the status of several services in every plugin
+        ///@param statuses [in] status of the services
+        ///@return number of statuses which could not be set, counted once per plugin
+        int setForServices(const std::vector<ServiceStatus> & statuses) {
+            return setForServices(statuses.data(), statuses.size());
+        }
+    };
+
+    namespace detail
+    {
+        template<typename Plugin>
+        struct StaticPluginTag {};
+
+        //providers of the static plugins held by value, one level per plugin
+        //The calls to set() are not virtual, so the compiler can inline the whole delivery.
+        template<typename... Plugins>
+        class StaticProviders
+        {
+            public:
+            explicit StaticProviders(const char *) {}
+
+            template<typename Status>
+            void setForAll(Status) noexcept {}
+
+            static void appendPluginNames(std::list<std::string> &) {}
+
+            protected:
+            void get() noexcept {}
+        };
+
+        template<typename Plugin, typename... Others>
+        class StaticProviders<Plugin, Others...> : public StaticProviders<Others...>
+        {
+            private:
+            typename Plugin::Provider m_provider;
+
+            public:
+            explicit StaticProviders(const char * serviceName) : StaticProviders<Others...>(serviceName), m_provider(serviceName) {}
+
+            template<typename Status>
+            void setForAll(Status status) noexcept {
+                m_provider.set(status);
+                StaticProviders<Others...>::setForAll(status);
+            }
+
+            static void appendPluginNames(std::list<std::string> & names) {
+                names.push_back(Plugin::getPluginName());
+                StaticProviders<Others...>::appendPluginNames(names);
+            }
+
+            using StaticProviders<Others...>::get;
+            typename Plugin::Provider & get(StaticPluginTag<Plugin>) noexcept { return m_provider; }
+        };
+
+        //provider of a static plugin exported for dlopen
+        template<typename Plugin>
+        class StaticProviderAdapter final : public ServiceStatusProvider
+        {
+            private:
+            typename Plugin::Provider m_provider;
+
+            public:
+            explicit StaticProviderAdapter(const char * serviceName) : m_provider(serviceName) {}
+
+            const char * getServiceName() const noexcept override { return m_provider.getServiceName(); }
+            int set(OperatingStatus os) noexcept override { return m_provider.set(os); }
+            int set(HealthState hs) noexcept override { return m_provider.set(hs); }
+        };
+
+    } //namespace detail
+
+    /// Collection of plugins linked in the service, without dlopen
+    ///
+    /// A static plugin is a type which gives its name and the class of its providers:
+    ///     struct MyPlugin
+    ///     {
+    ///         static const char * getPluginName() noexcept;
+    ///         class Provider;     // constructed with the service name, with the non virtual getServiceName() and set()
+    ///                             // of ServiceStatusProvider
+    ///     };
+    /// The plugins are registered as template arguments, each type once. The providers are created by the
+    /// constructor and held by value, so setForAll calls them directly and the calls can be inlined.
+    /// The collection may also hold plugins loaded with dlopen, which receive setForAll after the static ones.
+    /// FTY_SERVICE_STATUS_EXPORT_STATIC_PLUGIN builds the same plugin type as a plugin for dlopen.
+    template<typename... Plugins>
+    class StaticServiceStatusPluginCollection
+    {
+        private:
+        std::string m_serviceName;
+        detail::StaticProviders<Plugins...> m_providers;
+        std::unique_ptr<ServiceStatusPluginWrapperCollection> m_dynamicPlugins;
+
+        public:
+        /// Create the providers of the static plugins
+        /// @param serviceName [in] Name of the service
+        /// @param withDynamicPlugins [in] true to also deliver the statuses to plugins loaded with dlopen (see getDynamicPlugins)
+        explicit StaticServiceStatusPluginCollection(const std::string & serviceName, bool withDynamicPlugins = false)
+            : m_serviceName(serviceName), m_providers(serviceName.c_str()) {
+            if(withDynamicPlugins) {
+                m_dynamicPlugins.reset(new ServiceStatusPluginWrapperCollection(serviceName));
+            }
+        }
+
+        StaticServiceStatusPluginCollection(const StaticServiceStatusPluginCollection &) = delete;
+        StaticServiceStatusPluginCollection & operator=(const StaticServiceStatusPluginCollection &) = delete;
+
+        /// Get the service name
+        ///@return  service name
+        const std::string & getServiceName() const noexcept {return m_serviceName;}
+
+        /// Set the Health State for all the collection
+        ///@param hs [in] Health state to set
+        void setForAll(HealthState hs) noexcept {
+            m_providers.setForAll(hs);
+            if(m_dynamicPlugins) {
+                m_dynamicPlugins->setForAll(hs);
+            }
+        }
+
+        /// Set the Operating Status for all the collection
+        ///@param os [in] Operating Status to set
+        void setForAll(OperatingStatus os) noexcept {
+            m_providers.setForAll(os);
+            if(m_dynamicPlugins) {
+                m_dynamicPlugins->setForAll(os);
+            }
+        }
+
+        /// Get the provider of a static plugin
+        template<typename Plugin>
+        typename Plugin::Provider & getProvider() noexcept {
+            return m_providers.get(detail::StaticPluginTag<Plugin>());
+        }
+
+        /// Get the names of the static plugins, in the order of the template arguments
+        static std::list<std::string> getPluginNames() {
+            std::list<std::string> names;
+            detail::StaticProviders<Plugins...>::appendPluginNames(names);
+            return names;
+        }
+
+        /// Get the number of static plugins
+        static constexpr std::size_t getStaticPluginCount() noexcept { return sizeof...(Plugins); }
+
+        /// Check if the collection holds plugins loaded with dlopen
+        bool hasDynamicPlugins() const noexcept { return m_dynamicPlugins != nullptr; }
+
+        /// Get the collection of the plugins loaded with dlopen
+        /// The plugins are added and configured with the functions of ServiceStatusPluginWrapperCollection.
+        /// @throws std::logic_error if the collection was created without dynamic plugins
+        ServiceStatusPluginWrapperCollection & getDynamicPlugins() {
+            if(!m_dynamicPlugins) {
+                throw std::logic_error("The collection of " + m_serviceName + " was created without dynamic plugins");
+            }
+            return *m_dynamicPlugins;
+        }
+    };
+
+} //namespace fty
 
-} //namespace fty
\ No newline at end of file
+/// Define the entry points of a plugin for dlopen from a static plugin (see StaticServiceStatusPluginCollection)
+///
+/// Used once, at global scope, in the source of the shared library:
+///     FTY_SERVICE_STATUS_EXPORT_STATIC_PLUGIN(MyPlugin);
+#define FTY_SERVICE_STATUS_EXPORT_STATIC_PLUGIN(PluginType) \
+    static std::string gStaticPluginLastError; \
+    extern "C" const char * getPluginName() { return PluginType::getPluginName(); } \
+    extern "C" const char * getPluginLastError() { return gStaticPluginLastError.c_str(); } \
+    extern "C" int createServiceStatusProvider(fty::ServiceStatusProvider ** spp, const char * serviceName) { \
+        try { \
+            *spp = new fty::detail::StaticProviderAdapter<PluginType>(serviceName); \
+        } \
+        catch(const std::exception & e) { \
+            gStaticPluginLastError = e.what(); \
+            return -1; \
+        } \
+        return 0; \
+    } \
+    extern "C" void deleteServiceStatusProvider(fty::ServiceStatusProvider * spp) { delete spp; } \
+    static_assert(sizeof(PluginType) > 0, "static plugin")
@@ -0,0 +1,158 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#pragma once
+
+/// Watch of a folder of plugins, see ServiceStatusPluginWrapperCollection::watchFolder
+
+#include <fty_service_status.h>
+
+#include <poll.h>
+#include <sys/inotify.h>
+
+namespace fty
+{
+    namespace detail
+    {
+        /// Watch the files of a folder with inotify
+        ///
+        /// The names of the files created, replaced or deleted which match the filter are gathered until no event
+        /// comes during the debounce period, then given to the callback from the thread of the watcher.
+        /// When the kernel drops events, the callback is asked to rescan the folder.
+        class FolderWatcher
+        {
+            public:
+            using Match = std::function<bool(const char *)>;
+            using Callback = std::function<void(const std::set<std::string> & names, bool rescan)>;
+
+            private:
+            Match m_match;
+            std::chrono::milliseconds m_debounce;
+            Callback m_callback;
+            int m_inotify;
+            int m_stop[2];
+            std::thread m_thread;
+
+            void closeAll() noexcept {
+                for(int fd : {m_inotify, m_stop[0], m_stop[1]}) {
+                    if(fd >= 0) {
+                        close(fd);
+                    }
+                }
+            }
+
+            void run() noexcept {
+                std::set<std::string> names;
+                bool rescan = false;
+                std::int64_t lastEvent = 0;
+                const std::int64_t debounce = std::chrono::duration_cast<std::chrono::nanoseconds>(m_debounce).count();
+
+                alignas(struct inotify_event) char buffer[4096];
+
+                for(;;) {
+                    int timeout = -1;
+                    if(!names.empty() || rescan) {
+                        const std::int64_t remaining = debounce - (monotonicNs() - lastEvent);
+                        timeout = remaining > 0 ? static_cast<int>(remaining / 1000000 + 1) : 0;
+                    }
+
+                    struct pollfd fds[2] = {{m_stop[0], POLLIN, 0}, {m_inotify, POLLIN, 0}};
+                    const int ready = poll(fds, 2, timeout);
+                    if(ready < 0 && errno != EINTR) {
+                        return;
+                    }
+                    if(fds[0].revents != 0) {
+                        return;
+                    }
+
+                    if(ready > 0 && (fds[1].revents & POLLIN)) {
+                        const ssize_t length = read(m_inotify, buffer, sizeof(buffer));
+                        for(ssize_t offset = 0; offset < length; ) {
+                            const struct inotify_event * event = reinterpret_cast<const struct inotify_event *>(buffer + offset);
+                            if(event->mask & IN_Q_OVERFLOW) {
+                                rescan = true;
+                            } else if(event->len > 0 && m_match(event->name)) {
+                                names.insert(event->name);
+                            }
+                            offset += static_cast<ssize_t>(sizeof(struct inotify_event) + event->len);
+                        }
+                        lastEvent = monotonicNs();
+                    }
+
+                    if((!names.empty() || rescan) && monotonicNs() - lastEvent >= debounce) {
+                        try {
+                            m_callback(names, rescan);
+                        }
+                        catch(...) {
+                            //the next events are still handled
+                        }
+                        names.clear();
+                        rescan = false;
+                    }
+                }
+            }
+
+            public:
+            /// Start to watch a folder
+            ///@param folderPath [in] folder to watch
+            ///@param match [in] filter of the file names
+            ///@param debounce [in] time without event before the callback is called
+            ///@param callback [in] function called with the changed names
+            FolderWatcher(const std::string & folderPath, const Match & match, std::chrono::milliseconds debounce, const Callback & callback)
+                : m_match(match), m_debounce(debounce), m_callback(callback), m_inotify(-1), m_stop{-1, -1} {
+
+                m_inotify = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+                if(m_inotify < 0 || pipe(m_stop) != 0) {
+                    const int error = errno;
+                    closeAll();
+                    throw std::system_error(error, std::generic_category(), "Cannot watch the folder <" + folderPath + ">");
+                }
+
+                //a package manager writes a temporary file and renames it
+                const uint32_t mask = IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+                if(inotify_add_watch(m_inotify, folderPath.c_str(), mask) < 0) {
+                    const int error = errno;
+                    closeAll();
+                    throw std::system_error(error, std::generic_category(), "Cannot watch the folder <" + folderPath + ">");
+                }
+
+                try {
+                    m_thread = std::thread(&FolderWatcher::run, this);
+                }
+                catch(...) {
+                    closeAll();
+                    throw;
+                }
+            }
+
+            FolderWatcher(const FolderWatcher &) = delete;
+            FolderWatcher & operator=(const FolderWatcher &) = delete;
+
+            ~FolderWatcher() {
+                const char stop = 0;
+                if(write(m_stop[1], &stop, 1) != 1) {
+                    //the thread also stops when the pipe is closed
+                }
+                m_thread.join();
+                closeAll();
+            }
+        };
+
+    } //namespace detail
+
+} //namespace fty
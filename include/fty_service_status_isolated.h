@@ -0,0 +1,565 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#pragma once
+
+/// Plugins running in a host process, see ServiceStatusPluginWrapperCollection::addIsolated
+
+#include <fty_service_status.h>
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+namespace fty
+{
+    namespace detail
+    {
+        /// Shared memory between a service and the host process of an isolated plugin
+        ///
+        /// The service is the single producer of the ring, the host its single consumer. Each side sets its
+        /// waiting flag before sleeping on its eventfd, the other side writes the eventfd only when the flag is set.
+        /// The latest values are kept apart from the ring, so the host still gets them when the ring is full.
+        struct IsolatedRing
+        {
+            static constexpr std::uint32_t MAGIC = 0x46535352;
+            static constexpr std::size_t TEXT_SIZE = 256;
+
+            //states of the host
+            static constexpr std::uint32_t STARTING = 0;
+            static constexpr std::uint32_t READY = 1;
+            static constexpr std::uint32_t FAILED = 2;
+
+            //an entry is the kind of the update and its value
+            static constexpr std::uint16_t OPERATING_STATUS = 0x100;
+            static constexpr std::uint16_t HEALTH_STATE = 0x200;
+            static constexpr std::uint16_t VALUE_MASK = 0xff;
+
+            std::uint32_t magic;
+            std::uint32_t capacity;
+
+            //written by the service, the latest values are stored plus one, 0 if none
+            alignas(64) std::atomic<std::uint32_t> head;
+            std::atomic<std::uint32_t> overflows;
+            std::atomic<std::uint32_t> latestOperatingStatus;
+            std::atomic<std::uint32_t> latestHealthState;
+            std::atomic<std::uint32_t> serviceWaiting;
+
+            //written by the host
+            alignas(64) std::atomic<std::uint32_t> tail;
+            std::atomic<std::uint32_t> handledOverflows;
+            std::atomic<std::uint32_t> hostWaiting;
+            std::atomic<std::uint32_t> state;
+            std::atomic<std::uint32_t> processed;
+            std::atomic<std::uint32_t> failed;
+            char pluginName[TEXT_SIZE];     //valid once READY
+            char error[TEXT_SIZE];          //valid once FAILED
+
+            /// Get the size of the shared memory
+            static std::size_t getSize(std::uint32_t capacity) noexcept {
+                return sizeof(IsolatedRing) + capacity * sizeof(std::uint16_t);
+            }
+
+            /// Initialize the ring in a new shared memory
+            void init(std::uint32_t ringCapacity) noexcept {
+                magic = MAGIC;
+                capacity = ringCapacity;
+                processed.store(0, std::memory_order_relaxed);
+                failed.store(0, std::memory_order_relaxed);
+                latestOperatingStatus.store(0, std::memory_order_relaxed);
+                latestHealthState.store(0, std::memory_order_relaxed);
+                reset();
+            }
+
+            /// Empty the ring for a new host, the latest values and the counters are kept
+            void reset() noexcept {
+                head.store(0, std::memory_order_relaxed);
+                tail.store(0, std::memory_order_relaxed);
+                overflows.store(0, std::memory_order_relaxed);
+                handledOverflows.store(0, std::memory_order_relaxed);
+                serviceWaiting.store(0, std::memory_order_relaxed);
+                hostWaiting.store(0, std::memory_order_relaxed);
+                std::memset(pluginName, 0, TEXT_SIZE);
+                std::memset(error, 0, TEXT_SIZE);
+                state.store(STARTING, std::memory_order_release);
+            }
+
+            std::uint16_t * getEntries() noexcept { return reinterpret_cast<std::uint16_t *>(this + 1); }
+
+            /// Queue an update, called by the service
+            ///@return false if the ring is full, the host then delivers the latest values
+            bool push(std::uint16_t entry) noexcept {
+                const std::uint32_t position = head.load(std::memory_order_relaxed);
+                if(position - tail.load(std::memory_order_acquire) >= capacity) {
+                    overflows.fetch_add(1, std::memory_order_release);
+                    return false;
+                }
+                getEntries()[position & (capacity - 1)] = entry;
+                head.store(position + 1, std::memory_order_release);
+                return true;
+            }
+
+            /// Get the oldest update, called by the host which removes it with pop() once delivered
+            bool front(std::uint16_t & entry) noexcept {
+                const std::uint32_t position = tail.load(std::memory_order_relaxed);
+                if(position == head.load(std::memory_order_acquire)) {
+                    return false;
+                }
+                entry = getEntries()[position & (capacity - 1)];
+                return true;
+            }
+
+            void pop() noexcept { tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+            /// Check if the host delivered all the updates
+            bool isDrained() const noexcept {
+                return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire)
+                    && overflows.load(std::memory_order_acquire) == handledOverflows.load(std::memory_order_acquire);
+            }
+
+            /// Wake up the other side if it waits, after a change of the ring
+            static void notify(const std::atomic<std::uint32_t> & waiting, int eventFd) noexcept {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if(waiting.load(std::memory_order_relaxed) != 0) {
+                    const std::uint64_t one = 1;
+                    if(write(eventFd, &one, sizeof(one)) != sizeof(one)) {
+                        //the counter of the eventfd is already set
+                    }
+                }
+            }
+
+            /// Wait for a change notified by the other side, unless the condition is already true
+            ///@return true if the condition is true
+            template<typename Condition>
+            static bool wait(std::atomic<std::uint32_t> & waiting, int eventFd, int timeoutMs, Condition condition) noexcept {
+                waiting.store(1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if(!condition()) {
+                    struct pollfd pfd = {eventFd, POLLIN, 0};
+                    if(poll(&pfd, 1, timeoutMs) > 0) {
+                        std::uint64_t value;
+                        if(read(eventFd, &value, sizeof(value)) != sizeof(value)) {
+                            //another waiter cleared the counter
+                        }
+                    }
+                }
+                waiting.store(0, std::memory_order_relaxed);
+                return condition();
+            }
+        };
+
+    } //namespace detail
+
+    /// ServiceStatusProvider forwarding the status to a plugin loaded in a host process
+    ///
+    /// The host (fty-service-status-plugin-host) loads the plugin and calls its provider, so a plugin which
+    /// crashes or blocks does not stop the service. set() queues the update in a ring in shared memory and
+    /// returns without waiting for the plugin: the errors of the plugin are only counted by getFailedCount().
+    /// A host which dies is restarted, it receives the last Operating Status and Health State again.
+    class IsolatedServiceStatusProvider : public ServiceStatusProvider
+    {
+        private:
+        const std::string m_pluginPath;
+        const std::string m_serviceName;
+        const IsolationSettings m_settings;
+        std::string m_pluginName;
+
+        int m_memory;
+        int m_toHost;
+        int m_toService;
+        int m_lifeline[2];
+        //read end of a pipe whose write end is held by the host, the kernel closes it when the host exits
+        int m_exitPipe;
+        detail::IsolatedRing * m_ring;
+
+        //serializes the producer of the ring and protects the state of the host
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cv;
+        pid_t m_pid;
+        bool m_running;
+        bool m_exited;
+        std::atomic<bool> m_stopping;
+        std::uint32_t m_lastOperatingStatus;
+        std::uint32_t m_lastHealthState;
+        std::string m_lastError;
+
+        std::mutex m_flushMutex;
+        std::atomic<std::uint64_t> m_restartCount;
+        std::atomic<std::uint64_t> m_overflowCount;
+        std::thread m_supervisor;
+
+        void closeAll() noexcept {
+            if(m_ring != nullptr) {
+                munmap(m_ring, detail::IsolatedRing::getSize(m_settings.ringCapacity));
+                m_ring = nullptr;
+            }
+            for(int * fd : {&m_memory, &m_toHost, &m_toService, &m_lifeline[0], &m_lifeline[1], &m_exitPipe}) {
+                if(*fd >= 0) {
+                    close(*fd);
+                    *fd = -1;
+                }
+            }
+        }
+
+        //the child only calls async-signal-safe functions before exec
+        pid_t spawn(int exitFd) {
+            std::vector<std::string> args = {m_settings.hostPath, m_pluginPath, m_serviceName, std::to_string(m_memory),
+                std::to_string(m_toHost), std::to_string(m_toService), std::to_string(m_lifeline[0]), std::to_string(exitFd)};
+            std::vector<char *> argv;
+            for(std::string & arg : args) {
+                argv.push_back(&arg[0]);
+            }
+            argv.push_back(nullptr);
+            const int inherited[] = {m_memory, m_toHost, m_toService, m_lifeline[0], exitFd};
+            const bool searchPath = m_settings.hostPath.find('/') == std::string::npos;
+
+            const pid_t pid = fork();
+            if(pid == 0) {
+                for(int fd : inherited) {
+                    fcntl(fd, F_SETFD, 0);
+                }
+                if(searchPath) {
+                    execvp(argv[0], argv.data());
+                }
+                else {
+                    execv(argv[0], argv.data());
+                }
+                _exit(127);
+            }
+            if(pid < 0) {
+                throw std::system_error(errno, std::generic_category(), "Cannot start the host of the plugin <" + m_pluginPath + ">");
+            }
+            return pid;
+        }
+
+        //wait for the exit of the host, detected by its end of the exit pipe
+        //The host is reaped if it is still a child of the process, but the application may ignore SIGCHLD or reap
+        //its children itself: then the process is only awaited until it is gone.
+        //@param timeoutMs [in] maximum time to wait, -1 for ever
+        //@param status [out] status given by waitpid, -1 if the host was reaped by someone else
+        //@return true if the host exited
+        bool waitHostExit(pid_t pid, int timeoutMs, int & status) noexcept {
+            struct pollfd pfd = {m_exitPipe, POLLIN, 0};
+            int ready;
+            while((ready = poll(&pfd, 1, timeoutMs)) < 0 && errno == EINTR) {}
+            if(ready <= 0) {
+                return false;
+            }
+
+            while(waitpid(pid, &status, 0) < 0) {
+                if(errno != EINTR) {
+                    status = -1;
+                    const std::int64_t deadline = detail::monotonicNs() + std::chrono::duration_cast<std::chrono::nanoseconds>(m_settings.startTimeout).count();
+                    while(kill(pid, 0) == 0 && detail::monotonicNs() < deadline) {
+                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                    }
+                    break;
+                }
+            }
+            close(m_exitPipe);
+            m_exitPipe = -1;
+            return true;
+        }
+
+        //start a host on the ring and wait until it loaded the plugin
+        ///@return empty on success, else the error
+        std::string startHost() {
+            int exitPipe[2];
+            if(pipe2(exitPipe, O_CLOEXEC) != 0) {
+                throw std::system_error(errno, std::generic_category(), "Cannot start the host of the plugin <" + m_pluginPath + ">");
+            }
+
+            pid_t pid;
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                try {
+                    pid = m_pid = spawn(exitPipe[1]);
+                }
+                catch(...) {
+                    close(exitPipe[0]);
+                    close(exitPipe[1]);
+                    throw;
+                }
+                close(exitPipe[1]);
+                m_exitPipe = exitPipe[0];
+            }
+
+            const std::int64_t deadline = detail::monotonicNs() + std::chrono::duration_cast<std::chrono::nanoseconds>(m_settings.startTimeout).count();
+            std::string error;
+            int status = 0;
+            while(true) {
+                const std::uint32_t state = m_ring->state.load(std::memory_order_acquire);
+                if(state == detail::IsolatedRing::READY) {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_running = true;
+                    return "";
+                }
+                if(state == detail::IsolatedRing::FAILED) {
+                    error = std::string(m_ring->error, strnlen(m_ring->error, detail::IsolatedRing::TEXT_SIZE));
+                    waitHostExit(pid, -1, status);
+                    break;
+                }
+                if(waitHostExit(pid, 0, status)) {
+                    error = (WIFEXITED(status) && WEXITSTATUS(status) == 127) ? "Cannot execute the host <" + m_settings.hostPath + ">"
+                                                                                 : "The host of the plugin <" + m_pluginPath + "> exited";
+                    break;
+                }
+                if(detail::monotonicNs() > deadline) {
+                    kill(pid, SIGKILL);
+                    waitHostExit(pid, -1, status);
+                    error = "The host of the plugin <" + m_pluginPath + "> did not start in time";
+                    break;
+                }
+                detail::IsolatedRing::wait(m_ring->serviceWaiting, m_toService, 10, [this] {
+                    return m_ring->state.load(std::memory_order_acquire) != detail::IsolatedRing::STARTING;
+                });
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_pid = -1;
+            return error;
+        }
+
+        //queue an update, the mutex must be locked
+        void push(std::uint16_t entry) noexcept {
+            if(!m_ring->push(entry)) {
+                m_overflowCount++;
+            }
+            detail::IsolatedRing::notify(m_ring->hostWaiting, m_toHost);
+        }
+
+        //keep the value for the restarts of the host and queue it
+        int queue(std::uint16_t kind, std::uint16_t value) noexcept {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if(kind == detail::IsolatedRing::OPERATING_STATUS) {
+                m_lastOperatingStatus = value + 1u;
+                m_ring->latestOperatingStatus.store(m_lastOperatingStatus, std::memory_order_relaxed);
+            }
+            else {
+                m_lastHealthState = value + 1u;
+                m_ring->latestHealthState.store(m_lastHealthState, std::memory_order_relaxed);
+            }
+            push(static_cast<std::uint16_t>(kind | value));
+            return m_running ? 0 : -1;
+        }
+
+        //wait for the death of the host and restart it, until the provider is destroyed
+        void supervise() {
+            while(true) {
+                pid_t pid;
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    pid = m_pid;
+                }
+                int status;
+                while(!waitHostExit(pid, -1, status)) {}
+
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_pid = -1;
+                    m_running = false;
+                    m_lastError = "The host of the plugin <" + m_pluginName + "> is not running";
+                }
+
+                std::string error;
+                do {
+                    {
+                        std::unique_lock<std::mutex> lock(m_mutex);
+                        if(m_cv.wait_for(lock, m_settings.restartDelay, [this] { return m_stopping.load(); })) {
+                            m_exited = true;
+                            m_cv.notify_all();
+                            return;
+                        }
+
+                        //the updates queued for the dead host are replaced by the last status
+                        m_ring->reset();
+                        if(m_lastOperatingStatus != 0) {
+                            push(static_cast<std::uint16_t>(detail::IsolatedRing::OPERATING_STATUS | (m_lastOperatingStatus - 1)));
+                        }
+                        if(m_lastHealthState != 0) {
+                            push(static_cast<std::uint16_t>(detail::IsolatedRing::HEALTH_STATE | (m_lastHealthState - 1)));
+                        }
+                    }
+
+                    try {
+                        error = startHost();
+                    }
+                    catch(const std::exception & e) {
+                        error = e.what();
+                    }
+                    if(!error.empty()) {
+                        std::lock_guard<std::mutex> lock(m_mutex);
+                        m_lastError = error;
+                    }
+                } while(!error.empty());
+
+                m_restartCount++;
+            }
+        }
+
+        public:
+        /// Start the host of a plugin
+        ///@param pluginPath [in] path of the plugin, loaded by the host
+        ///@param serviceName [in] name of the service for which we do the notification
+        ///@param settings [in] settings of the host
+        IsolatedServiceStatusProvider(const std::string & pluginPath, const std::string & serviceName, const IsolationSettings & settings = IsolationSettings())
+            : m_pluginPath(pluginPath), m_serviceName(serviceName), m_settings(settings),
+              m_memory(-1), m_toHost(-1), m_toService(-1), m_lifeline{-1, -1}, m_exitPipe(-1), m_ring(nullptr),
+              m_pid(-1), m_running(false), m_exited(false), m_stopping(false), m_lastOperatingStatus(0), m_lastHealthState(0),
+              m_restartCount(0), m_overflowCount(0) {
+
+            if(settings.ringCapacity < 2 || (settings.ringCapacity & (settings.ringCapacity - 1)) != 0) {
+                throw std::invalid_argument("The capacity of the ring must be a power of 2");
+            }
+
+            const std::size_t size = detail::IsolatedRing::getSize(settings.ringCapacity);
+            m_memory = memfd_create("fty-service-status-isolated", MFD_CLOEXEC);
+            m_toHost = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+            m_toService = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+            if(m_memory < 0 || m_toHost < 0 || m_toService < 0 || pipe2(m_lifeline, O_CLOEXEC) != 0
+                || ftruncate(m_memory, static_cast<off_t>(size)) != 0) {
+                const int error = errno;
+                closeAll();
+                throw std::system_error(error, std::generic_category(), "Cannot create the ring of the plugin <" + pluginPath + ">");
+            }
+
+            void * memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, m_memory, 0);
+            if(memory == MAP_FAILED) {
+                const int error = errno;
+                closeAll();
+                throw std::system_error(error, std::generic_category(), "Cannot map the ring of the plugin <" + pluginPath + ">");
+            }
+            m_ring = new (memory) detail::IsolatedRing();
+            m_ring->init(settings.ringCapacity);
+
+            std::string error;
+            try {
+                error = startHost();
+            }
+            catch(...) {
+                closeAll();
+                throw;
+            }
+            if(!error.empty()) {
+                closeAll();
+                throw std::runtime_error(error);
+            }
+            m_pluginName.assign(m_ring->pluginName, strnlen(m_ring->pluginName, detail::IsolatedRing::TEXT_SIZE));
+
+            try {
+                m_supervisor = std::thread(&IsolatedServiceStatusProvider::supervise, this);
+            }
+            catch(...) {
+                int status;
+                kill(m_pid, SIGKILL);
+                waitHostExit(m_pid, -1, status);
+                closeAll();
+                throw;
+            }
+        }
+
+        IsolatedServiceStatusProvider(const IsolatedServiceStatusProvider &) = delete;
+        IsolatedServiceStatusProvider & operator=(const IsolatedServiceStatusProvider &) = delete;
+
+        /// Stop the host once it delivered the queued updates, it is killed if it does not stop in time
+        ~IsolatedServiceStatusProvider() {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stopping = true;
+                close(m_lifeline[1]);
+                m_lifeline[1] = -1;
+            }
+            m_cv.notify_all();
+
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                if(!m_cv.wait_for(lock, m_settings.startTimeout, [this] { return m_exited; })) {
+                    if(m_pid > 0) {
+                        kill(m_pid, SIGKILL);
+                    }
+                    m_cv.wait(lock, [this] { return m_exited; });
+                }
+            }
+            m_supervisor.join();
+            closeAll();
+        }
+
+        const char * getServiceName() const noexcept override { return m_serviceName.c_str(); }
+
+        int set(OperatingStatus status) noexcept override {
+            return queue(detail::IsolatedRing::OPERATING_STATUS, static_cast<std::uint16_t>(status));
+        }
+
+        int set(HealthState state) noexcept override {
+            return queue(detail::IsolatedRing::HEALTH_STATE, static_cast<std::uint16_t>(state));
+        }
+
+        /// Wait until the host delivered the queued updates
+        ///@param timeout [in] maximum time to wait
+        ///@return false if the updates are not delivered in time
+        bool flush(std::chrono::milliseconds timeout) {
+            std::lock_guard<std::mutex> lock(m_flushMutex);
+            const std::int64_t deadline = detail::monotonicNs() + std::chrono::duration_cast<std::chrono::nanoseconds>(timeout).count();
+            while(true) {
+                if(detail::IsolatedRing::wait(m_ring->serviceWaiting, m_toService, 10, [this] { return m_ring->isDrained(); })) {
+                    return true;
+                }
+                if(detail::monotonicNs() > deadline) {
+                    return false;
+                }
+            }
+        }
+
+        /// Get the name of the plugin, given by the host
+        const std::string & getPluginName() const noexcept { return m_pluginName; }
+
+        /// Get the process identifier of the host
+        ///@return -1 if the host is not running
+        pid_t getHostPid() const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_pid;
+        }
+
+        /// Check if the host is running and loaded the plugin
+        bool isHostRunning() const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_running;
+        }
+
+        /// Get the last error of the host
+        std::string getLastError() const {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_lastError;
+        }
+
+        /// Get the number of restarts of the host
+        std::uint64_t getRestartCount() const noexcept { return m_restartCount.load(std::memory_order_relaxed); }
+
+        /// Get the number of updates not queued because the ring was full, the host delivers the latest status instead
+        std::uint64_t getOverflowCount() const noexcept { return m_overflowCount.load(std::memory_order_relaxed); }
+
+        /// Get the number of calls of the provider of the plugin done by the hosts
+        std::uint32_t getProcessedCount() const noexcept { return m_ring->processed.load(std::memory_order_relaxed); }
+
+        /// Get the number of calls of the provider of the plugin which returned an error
+        std::uint32_t getFailedCount() const noexcept { return m_ring->failed.load(std::memory_order_relaxed); }
+    };
+
+} //namespace fty
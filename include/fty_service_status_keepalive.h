@@ -0,0 +1,329 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#pragma once
+
+/// Keepalive timers of the collections, see ServiceStatusPluginWrapperCollection::enableKeepalive
+
+#include <fty_service_status.h>
+
+#include <random>
+#include <unordered_map>
+
+namespace fty
+{
+    namespace detail
+    {
+        /// Hierarchical timer wheel, the timers are identified by a number and expire on a tick
+        ///
+        /// Each level has 64 slots, a slot of a level covering the 64 slots of the level below. A timer is stored in
+        /// the lowest level covering its expiry, and moved down when the lower level reaches its slot, so adding a
+        /// timer and advancing by one tick are O(1) whatever the number of timers. The expiries beyond the range of
+        /// the wheel are stored in the last level and moved again until they are in range.
+        /// A removed timer is not searched in the wheel: the owner ignores its expiry.
+        /// The wheel is not thread-safe.
+        class TimerWheel
+        {
+            private:
+            static constexpr unsigned LEVEL_BITS = 6;
+            static constexpr unsigned LEVEL_COUNT = 4;
+            static constexpr std::uint64_t SLOT_COUNT = std::uint64_t(1) << LEVEL_BITS;
+            static constexpr std::uint64_t SLOT_MASK = SLOT_COUNT - 1;
+            static constexpr std::uint64_t MAX_DELAY = (std::uint64_t(1) << (LEVEL_BITS * LEVEL_COUNT)) - 1;
+
+            struct Timer
+            {
+                std::uint64_t id;
+                std::uint64_t expiry;
+            };
+
+            std::vector<Timer> m_slots[LEVEL_COUNT][SLOT_COUNT];
+            std::uint64_t m_current;
+            std::size_t m_count;
+
+            //store a timer in its slot, not before the given tick
+            void place(const Timer & timer, std::uint64_t earliest) {
+                const std::uint64_t target = std::min(std::max(timer.expiry, earliest), m_current + MAX_DELAY);
+                const std::uint64_t delay = target - m_current;
+
+                unsigned level = 0;
+                while(level + 1 < LEVEL_COUNT && delay >= (std::uint64_t(1) << (LEVEL_BITS * (level + 1)))) {
+                    level++;
+                }
+                m_slots[level][(target >> (LEVEL_BITS * level)) & SLOT_MASK].push_back(timer);
+            }
+
+            //move the timers down the levels reaching their slot, then expire the timers of the tick
+            void process(std::uint64_t tick, std::vector<std::uint64_t> & expired) {
+                for(unsigned level = LEVEL_COUNT - 1; level > 0; level--) {
+                    if((tick & ((std::uint64_t(1) << (LEVEL_BITS * level)) - 1)) == 0) {
+                        std::vector<Timer> timers;
+                        timers.swap(m_slots[level][(tick >> (LEVEL_BITS * level)) & SLOT_MASK]);
+                        for(const Timer & timer : timers) {
+                            place(timer, tick);
+                        }
+                    }
+                }
+
+                std::vector<Timer> timers;
+                timers.swap(m_slots[0][tick & SLOT_MASK]);
+                for(const Timer & timer : timers) {
+                    if(timer.expiry <= tick) {
+                        expired.push_back(timer.id);
+                        m_count--;
+                    } else {
+                        place(timer, tick + 1);
+                    }
+                }
+            }
+
+            public:
+            /// Create an empty wheel at tick 0
+            TimerWheel() noexcept : m_current(0), m_count(0) {}
+
+            /// Add a timer
+            ///@param id [in] identifier of the timer
+            ///@param expiry [in] tick of the expiry, a past tick expires on the next one
+            void add(std::uint64_t id, std::uint64_t expiry) {
+                place(Timer{id, expiry}, m_current + 1);
+                m_count++;
+            }
+
+            /// Get the number of timers in the wheel
+            std::size_t size() const noexcept { return m_count; }
+
+            /// Get the current tick
+            std::uint64_t getCurrentTick() const noexcept { return m_current; }
+
+            /// Get the next tick which must be processed: a tick with timers to expire, or moving timers down the levels
+            std::uint64_t getNextEventTick() const noexcept {
+                std::uint64_t tick = m_current + 1;
+                while((tick & SLOT_MASK) != 0 && m_slots[0][tick & SLOT_MASK].empty()) {
+                    tick++;
+                }
+                return tick;
+            }
+
+            /// Advance the wheel, the ticks without event are skipped
+            ///@param tick [in] new current tick
+            ///@param expired [out] identifiers of the expired timers are appended
+            void advance(std::uint64_t tick, std::vector<std::uint64_t> & expired) {
+                while(m_current < tick) {
+                    if(m_count == 0) {
+                        m_current = tick;
+                        break;
+                    }
+                    m_current = std::min(getNextEventTick(), tick);
+                    process(m_current, expired);
+                }
+            }
+        };
+
+    } //namespace detail
+
+    /// This class runs the keepalive timers of the collections from one thread
+    ///
+    /// The timers are stored in a hierarchical timer wheel: the cost of a timer does not depend on the number
+    /// of timers, and the thread only wakes up when a timer expires or when the wheel moves timers between levels.
+    /// The callbacks are called from the thread of the scheduler, one at a time, and must not block.
+    /// The functions can be called from several threads.
+    class KeepaliveScheduler : public KeepaliveTimers
+    {
+        private:
+        struct Timer
+        {
+            Callback callback;
+            std::int64_t jitter;
+        };
+
+        std::int64_t m_resolution;
+        std::int64_t m_start;
+        detail::TimerWheel m_wheel;
+        std::unordered_map<std::uint64_t, Timer> m_timers;
+        std::uint64_t m_nextId;
+        std::minstd_rand m_random;
+        std::atomic<std::uint64_t> m_expiryCount;
+        std::atomic<std::uint64_t> m_wakeupCount;
+
+        //timer whose callback is in progress, 0 if none, and whether it was removed by its own callback
+        std::uint64_t m_running;
+        bool m_runningRemoved;
+
+        mutable std::mutex m_mutex;
+        std::condition_variable m_cv;
+        std::condition_variable m_doneCv;
+        bool m_stop;
+        std::thread m_thread;
+
+        //first tick not before the time, the mutex must be locked
+        std::uint64_t tickOf(std::int64_t time) const noexcept {
+            return time <= m_start ? 0 : static_cast<std::uint64_t>((time - m_start + m_resolution - 1) / m_resolution);
+        }
+
+        //the mutex must be locked
+        void schedule(std::uint64_t id, std::int64_t expiry, std::int64_t jitter) {
+            if(jitter > 0) {
+                expiry += std::uniform_int_distribution<std::int64_t>(0, jitter)(m_random);
+            }
+            m_wheel.add(id, tickOf(expiry));
+        }
+
+        void run() noexcept {
+            std::vector<std::uint64_t> expired;
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while(!m_stop) {
+                m_wakeupCount.fetch_add(1, std::memory_order_relaxed);
+                expired.clear();
+                m_wheel.advance((detail::monotonicNs() - m_start) / m_resolution, expired);
+
+                for(std::uint64_t id : expired) {
+                    auto it = m_timers.find(id);
+                    if(it == m_timers.end()) {
+                        //removed
+                        continue;
+                    }
+
+                    //the node of the timer is not released while it runs
+                    m_running = id;
+                    m_runningRemoved = false;
+                    Timer & timer = it->second;
+                    lock.unlock();
+
+                    const std::int64_t now = detail::monotonicNs();
+                    std::int64_t next = -1;
+                    try {
+                        next = timer.callback(now);
+                    }
+                    catch(...) {
+                        next = -1;
+                    }
+                    m_expiryCount.fetch_add(1, std::memory_order_relaxed);
+
+                    lock.lock();
+                    if(next < 0 || m_runningRemoved) {
+                        m_timers.erase(id);
+                    } else {
+                        try {
+                            schedule(id, next, timer.jitter);
+                        }
+                        catch(...) {
+                            m_timers.erase(id);
+                        }
+                    }
+                    m_running = 0;
+                    m_doneCv.notify_all();
+
+                    if(m_stop) {
+                        return;
+                    }
+                }
+
+                if(m_wheel.size() == 0) {
+                    m_cv.wait(lock);
+                } else {
+                    const std::int64_t wakeup = m_start + static_cast<std::int64_t>(m_wheel.getNextEventTick()) * m_resolution;
+                    m_cv.wait_until(lock, std::chrono::steady_clock::time_point(
+                        std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::nanoseconds(wakeup))));
+                }
+            }
+        }
+
+        public:
+        /// Create a KeepaliveScheduler and start its thread
+        ///@param resolution [in] duration of a tick of the wheel, the timers expire at most one tick late
+        explicit KeepaliveScheduler(std::chrono::milliseconds resolution = std::chrono::milliseconds(10))
+            : m_resolution(std::chrono::duration_cast<std::chrono::nanoseconds>(resolution).count()), m_start(detail::monotonicNs()),
+              m_nextId(1), m_random(static_cast<std::minstd_rand::result_type>(m_start)), m_expiryCount(0), m_wakeupCount(0),
+              m_running(0), m_runningRemoved(false), m_stop(false) {
+            if(m_resolution <= 0) {
+                throw std::invalid_argument("The resolution of the keepalive scheduler must be greater than 0");
+            }
+            m_thread = std::thread(&KeepaliveScheduler::run, this);
+        }
+
+        KeepaliveScheduler(const KeepaliveScheduler &) = delete;
+        KeepaliveScheduler & operator=(const KeepaliveScheduler &) = delete;
+
+        ~KeepaliveScheduler() {
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_stop = true;
+            }
+            m_cv.notify_one();
+            m_thread.join();
+        }
+
+        /// Get the scheduler shared by the collections of the process, created on first use
+        ///
+        /// The collections keep a reference, so the scheduler outlives the collections destroyed at exit.
+        static std::shared_ptr<KeepaliveScheduler> getInstance() {
+            static std::shared_ptr<KeepaliveScheduler> scheduler = std::make_shared<KeepaliveScheduler>();
+            return scheduler;
+        }
+
+        /// Add a timer
+        ///@param expiry [in] monotonic time of the first expiry, in nano seconds
+        ///@param jitter [in] maximum random delay added to each expiry
+        ///@param callback [in] function called when the timer expires
+        ///@return identifier of the timer
+        std::uint64_t add(std::int64_t expiry, std::chrono::nanoseconds jitter, Callback callback) override {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            const std::uint64_t id = m_nextId++;
+            m_timers[id] = Timer{callback, jitter.count()};
+            try {
+                schedule(id, expiry, jitter.count());
+            }
+            catch(...) {
+                m_timers.erase(id);
+                throw;
+            }
+            m_cv.notify_one();
+            return id;
+        }
+
+        /// Remove a timer, its callback is not called after the return
+        ///
+        /// When the callback of the timer is in progress in another thread, the function waits for its end.
+        ///@param id [in] identifier of the timer
+        void remove(std::uint64_t id) noexcept override {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            if(m_running == id) {
+                if(std::this_thread::get_id() == m_thread.get_id()) {
+                    //called by the callback, the timer is removed when it returns
+                    m_runningRemoved = true;
+                    return;
+                }
+                m_doneCv.wait(lock, [this, id] { return m_running != id; });
+            }
+            m_timers.erase(id);
+        }
+
+        /// Get the number of timers
+        std::size_t getTimerCount() const noexcept {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            return m_timers.size();
+        }
+
+        /// Get the number of callbacks called
+        std::uint64_t getExpiryCount() const noexcept { return m_expiryCount.load(std::memory_order_relaxed); }
+
+        /// Get the number of times the thread woke up
+        std::uint64_t getWakeupCount() const noexcept { return m_wakeupCount.load(std::memory_order_relaxed); }
+    };
+
+} //namespace fty
@@ -0,0 +1,252 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#pragma once
+
+//Helpers shared by the plugins of this repository, not installed: the settings read from the environment,
+//the objects shared by the providers of a process, the slots of the services in a shared mapping and the clocks
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <time.h>
+
+namespace plugincommon
+{
+    /// Synchronization of the written status to the storage
+    enum class SyncPolicy
+    {
+        None,       ///< left to the kernel
+        Update,     ///< after each update
+        Group       ///< by a background thread, at most once per period
+    };
+
+    /// Get a variable of the environment
+    ///@return null if it is not set or empty
+    inline const char * getEnv(const char * name) noexcept {
+        const char * value = std::getenv(name);
+        return (value != nullptr && *value != '\0') ? value : nullptr;
+    }
+
+    /// Read a count from the environment
+    ///@param name [in] variable of the environment
+    ///@param defaultCount [in] count when the variable is not set
+    ///@param maxCount [in] maximum count
+    ///@throw std::invalid_argument if the value is not a number between 1 and maxCount
+    inline std::uint32_t countFromEnv(const char * name, std::uint32_t defaultCount, std::uint32_t maxCount) {
+        const char * value = getEnv(name);
+        if(value == nullptr) {
+            return defaultCount;
+        }
+
+        char * end = nullptr;
+        unsigned long count = std::strtoul(value, &end, 10);
+        if(*end != '\0' || count == 0 || count > maxCount) {
+            throw std::invalid_argument(std::string("Invalid ") + name + ": " + value);
+        }
+        return static_cast<std::uint32_t>(count);
+    }
+
+    /// Read a SyncPolicy from the environment: "none", "update" or "group"
+    ///@throw std::invalid_argument if the value is not a policy
+    inline SyncPolicy syncPolicyFromEnv(const char * name, SyncPolicy defaultPolicy) {
+        const char * value = getEnv(name);
+        if(value == nullptr) {
+            return defaultPolicy;
+        }
+
+        const std::string sync = value;
+        if(sync == "none") {
+            return SyncPolicy::None;
+        } else if(sync == "update") {
+            return SyncPolicy::Update;
+        } else if(sync == "group") {
+            return SyncPolicy::Group;
+        }
+        throw std::invalid_argument(std::string("Invalid ") + name + ": " + sync);
+    }
+
+    /// Read a period in milli seconds from the environment
+    ///@throw std::invalid_argument if the value is not a positive number
+    inline std::chrono::milliseconds periodFromEnv(const char * name, std::chrono::milliseconds defaultPeriod) {
+        const char * value = getEnv(name);
+        if(value == nullptr) {
+            return defaultPeriod;
+        }
+
+        char * end = nullptr;
+        unsigned long period = std::strtoul(value, &end, 10);
+        if(*end != '\0' || period == 0) {
+            throw std::invalid_argument(std::string("Invalid ") + name + ": " + value);
+        }
+        return std::chrono::milliseconds(period);
+    }
+
+    /// Objects shared by the providers of the process, one per key
+    ///
+    /// An object is created by the first provider asking for its key and released with the last one.
+    template<typename T>
+    class SharedByKey
+    {
+        public:
+        /// Get the object of a key
+        ///@param key [in] key of the object, for example the path of the file it maps
+        ///@param create [in] function creating the object when the key has none, called with the lock held
+        template<typename Create>
+        static std::shared_ptr<T> get(const std::string & key, Create create) {
+            static std::mutex mutex;
+            static std::map<std::string, std::weak_ptr<T>> objects;
+
+            std::lock_guard<std::mutex> lock(mutex);
+            std::shared_ptr<T> object = objects[key].lock();
+            if(!object) {
+                object = create();
+                objects[key] = object;
+            }
+            return object;
+        }
+    };
+
+    /// States of the slot of a service in a shared mapping, a slot is never released
+    static const std::uint32_t SLOT_FREE = 0;
+    static const std::uint32_t SLOT_CLAIMED = 1;    ///< a writer is filling the service name
+    static const std::uint32_t SLOT_READY = 2;      ///< the service name is set and will not change
+
+    /// Check that a service name fits in the slots
+    ///@param nameSize [in] size of the name in a slot, with the terminating null
+    ///@throw std::invalid_argument if the name is empty or too long
+    inline void checkServiceName(const std::string & serviceName, std::size_t nameSize) {
+        if(serviceName.empty() || serviceName.size() >= nameSize) {
+            throw std::invalid_argument("The service name must have between 1 and "
+                + std::to_string(nameSize - 1) + " characters");
+        }
+    }
+
+    /// Find the slot of a service or claim a free one, in a mapping shared with other processes
+    ///
+    /// A slot has an atomic state (SLOT_FREE, SLOT_CLAIMED or SLOT_READY) and a null terminated serviceName, checked with checkServiceName.
+    /// The slots are claimed in order, so a restarted service finds its slot back. A slot still claimed after the timeout
+    /// was left by a process which died while naming it, it is skipped.
+    ///@param timeout [in] maximum time to wait for another process naming a slot
+    ///@return index of the slot, slotCount if all the slots are used by other services
+    template<typename Slot>
+    std::uint32_t acquireSlot(Slot * slots, std::uint32_t slotCount, const std::string & serviceName, std::chrono::nanoseconds timeout) noexcept {
+        for(std::uint32_t index = 0; index < slotCount; index++) {
+            Slot & slot = slots[index];
+            std::uint32_t state = slot.state.load(std::memory_order_acquire);
+
+            //another process may be naming this one
+            const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            while(state == SLOT_CLAIMED && std::chrono::steady_clock::now() - start < timeout) {
+                std::this_thread::yield();
+                state = slot.state.load(std::memory_order_acquire);
+            }
+            if(state == SLOT_CLAIMED) {
+                continue;
+            }
+
+            if(state == SLOT_READY) {
+                if(serviceName == slot.serviceName) {
+                    return index;
+                }
+                continue;
+            }
+
+            std::uint32_t expected = SLOT_FREE;
+            if(slot.state.compare_exchange_strong(expected, SLOT_CLAIMED, std::memory_order_acquire)) {
+                std::memcpy(slot.serviceName, serviceName.c_str(), serviceName.size() + 1);
+                slot.state.store(SLOT_READY, std::memory_order_release);
+                return index;
+            }
+
+            //lost the race: check the slot again once it is named
+            index--;
+        }
+        return slotCount;
+    }
+
+    /// Claim the odd sequence of a seqlock, waiting while another writer holds it, at most for a timeout
+    ///
+    /// A sequence which stays the same odd value for the timeout was left by a writer which died in the middle
+    /// of an update: the seqlock is taken over, the sequence stays odd for the readers until endWrite.
+    /// The writer updates the fields, then releases the seqlock with endWrite.
+    ///@param sequence [in] sequence of the seqlock
+    ///@param timeout [in] time after which the seqlock is taken over
+    ///@param tookOver [out] true if the seqlock was taken over
+    ///@return the even sequence before the write
+    inline std::uint32_t beginWrite(std::atomic<std::uint32_t> & sequence, std::chrono::nanoseconds timeout, bool & tookOver) noexcept {
+        tookOver = false;
+        std::uint32_t current = sequence.load(std::memory_order_relaxed);
+        //odd sequence of the other writer and since when it holds it, 0 is even so it is never held
+        std::uint32_t held = 0;
+        std::chrono::steady_clock::time_point heldSince;
+
+        while(true) {
+            if((current & 1) == 0) {
+                if(sequence.compare_exchange_weak(current, current + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+                    std::atomic_thread_fence(std::memory_order_release);
+                    return current;
+                }
+                continue;
+            }
+
+            const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+            if(current != held) {
+                held = current;
+                heldSince = now;
+            } else if(now - heldSince >= timeout) {
+                //as if the dead writer had released the seqlock and this one had claimed it
+                if(sequence.compare_exchange_strong(current, current + 2, std::memory_order_acquire, std::memory_order_relaxed)) {
+                    std::atomic_thread_fence(std::memory_order_release);
+                    tookOver = true;
+                    return current + 1;
+                }
+                continue;
+            }
+
+            std::this_thread::yield();
+            current = sequence.load(std::memory_order_relaxed);
+        }
+    }
+
+    /// Release a seqlock claimed by beginWrite
+    inline void endWrite(std::atomic<std::uint32_t> & sequence, std::uint32_t before) noexcept {
+        sequence.store(before + 2, std::memory_order_release);
+    }
+
+    /// Get the time of a clock in nano seconds
+    inline std::int64_t clockNs(clockid_t clock) noexcept {
+        struct timespec ts;
+        clock_gettime(clock, &ts);
+        return static_cast<std::int64_t>(ts.tv_sec) * 1000000000LL + static_cast<std::int64_t>(ts.tv_nsec);
+    }
+
+    /// Get CLOCK_REALTIME in nano seconds
+    inline std::uint64_t realtimeNs() noexcept {
+        return static_cast<std::uint64_t>(clockNs(CLOCK_REALTIME));
+    }
+
+} //namespace plugincommon
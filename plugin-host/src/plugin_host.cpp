@@ -0,0 +1,175 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#include <fty_service_status_isolated.h>
+
+#include <iostream>
+
+//host of an isolated plugin: loads the plugin and delivers the updates queued by the service in the ring
+
+static int usage(const char * program) {
+    std::cerr << "Usage: " << program << " <plugin path> <service name> <memory fd> <host eventfd> <service eventfd> <lifeline fd> <exit fd>" << std::endl
+              << "Load a plugin for a service using IsolatedServiceStatusProvider, this program is started by the service." << std::endl;
+    return 2;
+}
+
+static void copyText(char * destination, const std::string & text) {
+    const std::size_t size = std::min(text.size(), fty::detail::IsolatedRing::TEXT_SIZE - 1);
+    std::memcpy(destination, text.data(), size);
+    destination[size] = '\0';
+}
+
+class PluginHost
+{
+    private:
+    fty::detail::IsolatedRing & m_ring;
+    fty::ServiceStatusProvider & m_provider;
+    const int m_toService;
+
+    //values last given to the provider, plus one
+    std::uint32_t m_operatingStatus = 0;
+    std::uint32_t m_healthState = 0;
+
+    void deliver(std::uint16_t entry) {
+        const std::uint16_t value = entry & fty::detail::IsolatedRing::VALUE_MASK;
+        int result;
+        if((entry & fty::detail::IsolatedRing::OPERATING_STATUS) != 0) {
+            result = m_provider.set(static_cast<fty::OperatingStatus>(value));
+            m_operatingStatus = value + 1u;
+        }
+        else {
+            result = m_provider.set(static_cast<fty::HealthState>(value));
+            m_healthState = value + 1u;
+        }
+
+        m_ring.processed.fetch_add(1, std::memory_order_relaxed);
+        if(result != 0) {
+            m_ring.failed.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    public:
+    PluginHost(fty::detail::IsolatedRing & ring, fty::ServiceStatusProvider & provider, int toService)
+        : m_ring(ring), m_provider(provider), m_toService(toService) {}
+
+    void drain() {
+        std::uint16_t entry;
+        while(m_ring.front(entry)) {
+            deliver(entry);
+            m_ring.pop();
+        }
+
+        //the updates dropped by a full ring are replaced by the latest values
+        const std::uint32_t overflows = m_ring.overflows.load(std::memory_order_acquire);
+        if(overflows != m_ring.handledOverflows.load(std::memory_order_relaxed)) {
+            const std::uint32_t operatingStatus = m_ring.latestOperatingStatus.load(std::memory_order_relaxed);
+            const std::uint32_t healthState = m_ring.latestHealthState.load(std::memory_order_relaxed);
+            if(operatingStatus != 0 && operatingStatus != m_operatingStatus) {
+                deliver(static_cast<std::uint16_t>(fty::detail::IsolatedRing::OPERATING_STATUS | (operatingStatus - 1)));
+            }
+            if(healthState != 0 && healthState != m_healthState) {
+                deliver(static_cast<std::uint16_t>(fty::detail::IsolatedRing::HEALTH_STATE | (healthState - 1)));
+            }
+            m_ring.handledOverflows.store(overflows, std::memory_order_release);
+        }
+
+        fty::detail::IsolatedRing::notify(m_ring.serviceWaiting, m_toService);
+    }
+};
+
+int main(int argc, char * argv[]) {
+    if(argc != 8) {
+        return usage(argv[0]);
+    }
+    const std::string pluginPath = argv[1];
+    const std::string serviceName = argv[2];
+    const int memory = std::atoi(argv[3]);
+    const int toHost = std::atoi(argv[4]);
+    const int toService = std::atoi(argv[5]);
+    const int lifeline = std::atoi(argv[6]);
+    //held open until the host exits, so the service detects the exit without waitpid
+    const int exitFd = std::atoi(argv[7]);
+
+    //the host stops when the service closes the lifeline, not on the signals of its terminal
+    signal(SIGINT, SIG_IGN);
+    signal(SIGPIPE, SIG_IGN);
+    for(int fd : {memory, toHost, toService, lifeline, exitFd}) {
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+    }
+
+    struct stat info;
+    if(fstat(memory, &info) != 0 || static_cast<std::size_t>(info.st_size) < sizeof(fty::detail::IsolatedRing)) {
+        std::cerr << "Invalid ring for the plugin <" << pluginPath << ">" << std::endl;
+        return 1;
+    }
+    void * address = mmap(nullptr, static_cast<std::size_t>(info.st_size), PROT_READ | PROT_WRITE, MAP_SHARED, memory, 0);
+    if(address == MAP_FAILED) {
+        std::cerr << "Cannot map the ring of the plugin <" << pluginPath << ">" << std::endl;
+        return 1;
+    }
+    fty::detail::IsolatedRing & ring = *static_cast<fty::detail::IsolatedRing *>(address);
+    if(ring.magic != fty::detail::IsolatedRing::MAGIC
+        || static_cast<std::size_t>(info.st_size) < fty::detail::IsolatedRing::getSize(ring.capacity)) {
+        std::cerr << "Invalid ring for the plugin <" << pluginPath << ">" << std::endl;
+        return 1;
+    }
+
+    //the service waits for the result of the load
+    const std::uint64_t one = 1;
+    fty::ServiceStatusProviderPtr provider;
+    try {
+        fty::ServiceStatusPluginWrapper plugin(pluginPath);
+        provider = plugin.newServiceStatusProviderPtr(serviceName);
+        copyText(ring.pluginName, plugin.getPluginName());
+        ring.state.store(fty::detail::IsolatedRing::READY, std::memory_order_release);
+    }
+    catch(const std::exception & e) {
+        copyText(ring.error, e.what());
+        ring.state.store(fty::detail::IsolatedRing::FAILED, std::memory_order_release);
+    }
+    if(write(toService, &one, sizeof(one)) != sizeof(one)) {
+        //the service also polls the state
+    }
+    if(!provider) {
+        return 1;
+    }
+
+    PluginHost host(ring, *provider, toService);
+    bool stopping = false;
+    while(!stopping) {
+        host.drain();
+
+        ring.hostWaiting.store(1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if(ring.isDrained()) {
+            struct pollfd fds[2] = {{toHost, POLLIN, 0}, {lifeline, POLLIN, 0}};
+            if(poll(fds, 2, -1) > 0) {
+                std::uint64_t value;
+                if((fds[0].revents & POLLIN) && read(toHost, &value, sizeof(value)) != sizeof(value)) {
+                    //the counter is read on the next wake up
+                }
+                stopping = fds[1].revents != 0;
+            }
+        }
+        ring.hostWaiting.store(0, std::memory_order_relaxed);
+    }
+
+    //the updates queued before the service closed the lifeline are delivered
+    host.drain();
+    return 0;
+}
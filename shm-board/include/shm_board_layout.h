@@ -0,0 +1,101 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#pragma once
+
+//Layout of the shared memory status board, shared by the plugin (writer) and the reader library
+
+#include <fty_service_status.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace shmboard
+{
+    /// Name of the board used when FTY_SERVICE_STATUS_BOARD is not set
+    static const char * const DEFAULT_BOARD_NAME = "/fty-service-status-board";
+    /// Environment variable giving the name of the board (shm_open name)
+    static const char * const BOARD_NAME_ENV = "FTY_SERVICE_STATUS_BOARD";
+    /// Environment variable giving the number of slots, used by the process which creates the board
+    static const char * const BOARD_SLOTS_ENV = "FTY_SERVICE_STATUS_BOARD_SLOTS";
+
+    static const std::uint32_t BOARD_MAGIC = 0x46535342; // "FSSB"
+    static const std::uint32_t BOARD_VERSION = 1;
+    static const std::uint32_t DEFAULT_SLOT_COUNT = 1024;
+    static const std::size_t CACHE_LINE_SIZE = 64;
+    static const std::size_t SERVICE_NAME_SIZE = 40;
+    /// Time after which a slot left claimed or with an odd sequence is considered left by a writer which died:
+    /// the next writer takes the slot over and the readers report the slot as stalled
+    static const std::chrono::milliseconds STALLED_WRITER_TIMEOUT {100};
+
+    /// State of a slot, a slot is never released so a restarted service finds its slot back
+    enum SlotState : std::uint32_t
+    {
+        SLOT_FREE       = 0,
+        SLOT_CLAIMED    = 1,    ///< a writer is filling the service name
+        SLOT_READY      = 2     ///< the service name is set and will not change
+    };
+
+    /// Header of the board, the slots follow it
+    struct BoardHeader
+    {
+        std::atomic<std::uint32_t> magic;   ///< set last by the creator, with release semantic
+        std::uint32_t version;
+        std::uint32_t slotCount;
+        std::uint32_t slotSize;
+        char reserved[CACHE_LINE_SIZE - 4 * sizeof(std::uint32_t)];
+    };
+
+    /// Status of one service, on its own cache line
+    ///
+    /// The status is guarded by a seqlock: a writer claims the sequence by making it odd with a compare and swap,
+    /// updates the fields and makes it even again, the other writers wait while it is odd.
+    /// A reader retries when the sequence is odd or changed during the read.
+    /// A sequence odd for STALLED_WRITER_TIMEOUT was left by a writer which died during an update, the next writer takes it over.
+    struct BoardSlot
+    {
+        std::atomic<std::uint32_t> sequence;
+        std::atomic<std::uint32_t> state;
+        std::atomic<std::uint8_t> operatingStatus;
+        std::atomic<std::uint8_t> healthState;
+        std::uint8_t reserved[6];
+        std::atomic<std::uint64_t> updateTime;      ///< CLOCK_REALTIME of the last update in nano seconds
+        char serviceName[SERVICE_NAME_SIZE];        ///< null terminated, immutable once the slot is ready
+    };
+
+    static_assert(sizeof(BoardHeader) == CACHE_LINE_SIZE, "The board header must use one cache line");
+    static_assert(sizeof(BoardSlot) == CACHE_LINE_SIZE, "A board slot must use one cache line");
+    static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2, "The board needs lock-free atomics");
+
+    /// Size of the board
+    inline std::size_t boardSize(std::uint32_t slotCount) noexcept {
+        return sizeof(BoardHeader) + slotCount * sizeof(BoardSlot);
+    }
+
+    /// Get the slots of a mapped board
+    inline BoardSlot * boardSlots(BoardHeader * header) noexcept {
+        return reinterpret_cast<BoardSlot *>(header + 1);
+    }
+
+    inline const BoardSlot * boardSlots(const BoardHeader * header) noexcept {
+        return reinterpret_cast<const BoardSlot *>(header + 1);
+    }
+
+} //namespace shmboard
@@ -0,0 +1,66 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#pragma once
+
+#include "shm_board_layout.h"
+
+#include <memory>
+#include <string>
+
+//public interfaces
+extern "C"
+{
+    const char * getPluginName();
+    const char * getPluginLastError();
+    int createServiceStatusProvider(fty::ServiceStatusProvider** spp, const char * serviceName);
+    void deleteServiceStatusProvider(fty::ServiceStatusProvider* spp);
+}
+
+namespace shmboard
+{
+    class Board;
+
+    //provider publishing the status of a service in its slot of the shared memory board
+    class ServiceStatusBoard : public fty::ServiceStatusProvider
+    {
+        private:
+        std::shared_ptr<Board> m_board;
+        BoardSlot * m_slot;
+
+        int publish(std::atomic<std::uint8_t> & field, std::uint8_t value) noexcept;
+
+        public:
+        ServiceStatusBoard(const char * serviceName);
+
+        /// Get the service name
+        ///@return  service name
+        const char * getServiceName() const noexcept override;
+
+        /// Set the Operating Status
+        ///@param os [in] Operating Status to set
+        ///@return 0, or -EOWNERDEAD if the slot was taken over from a writer which died during an update, the status is set anyway
+        int set(fty::OperatingStatus os) noexcept override;
+
+        /// Set the Health State
+        ///@param hs [in] Health state to set
+        ///@return 0, or -EOWNERDEAD if the slot was taken over from a writer which died during an update, the status is set anyway
+        int set(fty::HealthState hs) noexcept override;
+    };
+
+} //namespace shmboard
@@ -0,0 +1,88 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#pragma once
+
+#include "shm_board_layout.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace shmboard
+{
+    /// Status of a service read from the board
+    struct BoardEntry
+    {
+        std::string serviceName;
+        fty::OperatingStatus operatingStatus = fty::OperatingStatus::Unknown;
+        fty::HealthState healthState = fty::HealthState::Unknown;
+        std::uint64_t updateTime = 0;   ///< CLOCK_REALTIME in nano seconds, 0 if never updated
+        /// True if the writer of the slot died during an update: the status, read anyway, may be torn
+        bool stalled = false;
+    };
+
+    /// Get the name of the board from FTY_SERVICE_STATUS_BOARD or the default one
+    std::string getBoardName();
+
+    /// Read-only view of the shared memory board
+    ///
+    /// The board is mapped once, reading it does not need any system call and never blocks the writers.
+    class BoardReader
+    {
+        private:
+        const BoardHeader * m_header = nullptr;
+        std::size_t m_size = 0;
+
+        static bool readSlot(const BoardSlot & slot, BoardEntry & entry, bool withName);
+
+        public:
+        /// Map the board
+        ///@param boardName [in] shm_open name of the board
+        ///@throw std::system_error if the board does not exist, std::runtime_error if its layout is not supported
+        explicit BoardReader(const std::string & boardName = getBoardName());
+        ~BoardReader();
+
+        BoardReader(const BoardReader &) = delete;
+        BoardReader & operator = (const BoardReader &) = delete;
+
+        /// Get the number of slots of the board
+        std::uint32_t getSlotCount() const noexcept;
+
+        /// Get a consistent status of every service
+        ///@param entries [out] filled with one entry per service, the existing strings are reused
+        ///@return the number of services
+        std::size_t snapshot(std::vector<BoardEntry> & entries) const;
+
+        /// Get a consistent status of every service
+        std::vector<BoardEntry> snapshot() const;
+
+        /// Get the status of one service
+        ///@param serviceName [in] name of the service
+        ///@param entry [out] status of the service
+        ///@return true if the service is on the board
+        bool find(const std::string & serviceName, BoardEntry & entry) const;
+    };
+
+    /// Get the name of an Operating Status, as listed in the README
+    const char * toString(fty::OperatingStatus os) noexcept;
+
+    /// Get the name of a Health State, as listed in the README
+    const char * toString(fty::HealthState hs) noexcept;
+
+} //namespace shmboard
@@ -0,0 +1,62 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#include "shm_board_reader.h"
+
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+
+//print the status of every service published on the shared memory board
+int main(int argc, char ** argv) {
+    if(argc > 2 || (argc == 2 && (std::strcmp(argv[1], "-h") == 0 || std::strcmp(argv[1], "--help") == 0))) {
+        std::cerr << "Usage: " << argv[0] << " [board name]" << std::endl
+                  << "Print the status published by the shared memory board plugin." << std::endl
+                  << "The default board is $" << shmboard::BOARD_NAME_ENV
+                  << " or " << shmboard::DEFAULT_BOARD_NAME << std::endl;
+        return (argc == 2) ? 0 : 1;
+    }
+
+    try {
+        shmboard::BoardReader reader((argc == 2) ? std::string(argv[1]) : shmboard::getBoardName());
+
+        std::cout << std::left << std::setw(shmboard::SERVICE_NAME_SIZE) << "SERVICE"
+                  << std::setw(16) << "OPERATING" << std::setw(24) << "HEALTH" << "UPDATED" << std::endl;
+
+        for(const shmboard::BoardEntry & entry : reader.snapshot()) {
+            char updated[32] = "never";
+            if(entry.updateTime != 0) {
+                std::time_t seconds = static_cast<std::time_t>(entry.updateTime / 1000000000ULL);
+                struct tm local;
+                std::strftime(updated, sizeof(updated), "%Y-%m-%d %H:%M:%S", localtime_r(&seconds, &local));
+            }
+
+            std::cout << std::setw(shmboard::SERVICE_NAME_SIZE) << entry.serviceName
+                      << std::setw(16) << shmboard::toString(entry.operatingStatus)
+                      << std::setw(24) << shmboard::toString(entry.healthState)
+                      << updated << (entry.stalled ? " (stalled writer)" : "") << std::endl;
+        }
+    }
+    catch(const std::exception & e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+
+    return 0;
+}
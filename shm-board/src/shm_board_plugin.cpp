@@ -0,0 +1,230 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#include "shm_board_plugin.h"
+
+#include <plugin_common.h>
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+//internal variables and functions
+static std::string gPluginLastError = "";
+
+//public interfaces
+const char * getPluginName() {
+    return "Shared memory board plugin";
+}
+
+const char * getPluginLastError(){
+    return gPluginLastError.c_str();
+}
+
+int createServiceStatusProvider(fty::ServiceStatusProvider** spp, const char * serviceName) {
+    try {
+        *spp = dynamic_cast<fty::ServiceStatusProvider*>(new shmboard::ServiceStatusBoard(serviceName));
+    }
+    catch(const std::exception& e) {
+        gPluginLastError = e.what();
+        return -1;
+    }
+
+    gPluginLastError = "";
+    return 0;
+}
+
+void deleteServiceStatusProvider(fty::ServiceStatusProvider* spp) {
+    shmboard::ServiceStatusBoard * ptr = dynamic_cast<shmboard::ServiceStatusBoard*>(spp);
+    delete ptr;
+}
+
+
+namespace shmboard
+{
+    static_assert(SLOT_FREE == plugincommon::SLOT_FREE && SLOT_CLAIMED == plugincommon::SLOT_CLAIMED && SLOT_READY == plugincommon::SLOT_READY,
+                  "The slots of the board are claimed by plugincommon::acquireSlot");
+
+    //board mapped in the process, shared by all the providers of the same board
+    class Board
+    {
+        private:
+        BoardHeader * m_header = nullptr;
+        std::size_t m_size = 0;
+
+        void create(int fd) {
+            std::uint32_t slotCount = plugincommon::countFromEnv(BOARD_SLOTS_ENV, DEFAULT_SLOT_COUNT, 1024 * 1024);
+            m_size = boardSize(slotCount);
+
+            if(ftruncate(fd, static_cast<off_t>(m_size)) != 0) {
+                throw std::system_error(errno, std::generic_category(), "Impossible to size the board");
+            }
+
+            void * mapping = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if(mapping == MAP_FAILED) {
+                throw std::system_error(errno, std::generic_category(), "Impossible to map the board");
+            }
+
+            //the new pages are zeroed, so all the slots are free
+            m_header = static_cast<BoardHeader*>(mapping);
+            m_header->version = BOARD_VERSION;
+            m_header->slotCount = slotCount;
+            m_header->slotSize = sizeof(BoardSlot);
+            m_header->magic.store(BOARD_MAGIC, std::memory_order_release);
+        }
+
+        void attach(int fd) {
+            //the creator may still be sizing and initializing the board
+            const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+            struct stat st;
+            while(fstat(fd, &st) == 0 && static_cast<std::size_t>(st.st_size) < sizeof(BoardHeader)) {
+                if(std::chrono::steady_clock::now() > deadline) {
+                    throw std::runtime_error("The board is not initialized");
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            m_size = static_cast<std::size_t>(st.st_size);
+            void * mapping = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if(mapping == MAP_FAILED) {
+                throw std::system_error(errno, std::generic_category(), "Impossible to map the board");
+            }
+            m_header = static_cast<BoardHeader*>(mapping);
+
+            while(m_header->magic.load(std::memory_order_acquire) != BOARD_MAGIC) {
+                if(std::chrono::steady_clock::now() > deadline) {
+                    throw std::runtime_error("The board is not initialized");
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+
+            if(m_header->version != BOARD_VERSION || m_header->slotSize != sizeof(BoardSlot)
+                || m_size < boardSize(m_header->slotCount)) {
+                throw std::runtime_error("Incompatible board layout");
+            }
+        }
+
+        public:
+        explicit Board(const std::string & name) {
+            int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+            bool creator = (fd >= 0);
+
+            if(!creator) {
+                if(errno != EEXIST) {
+                    throw std::system_error(errno, std::generic_category(), "Impossible to create the board " + name);
+                }
+                fd = shm_open(name.c_str(), O_RDWR, 0);
+                if(fd < 0) {
+                    throw std::system_error(errno, std::generic_category(), "Impossible to open the board " + name);
+                }
+            }
+
+            try {
+                if(creator) {
+                    create(fd);
+                } else {
+                    attach(fd);
+                }
+            }
+            catch(...) {
+                if(m_header != nullptr) {
+                    munmap(m_header, m_size);
+                }
+                close(fd);
+                throw;
+            }
+
+            //the mapping stays valid without the file descriptor
+            close(fd);
+        }
+
+        ~Board() {
+            munmap(m_header, m_size);
+        }
+
+        Board(const Board &) = delete;
+        Board & operator = (const Board &) = delete;
+
+        /// Find the slot of a service or claim a free one
+        BoardSlot & acquireSlot(const std::string & serviceName) {
+            plugincommon::checkServiceName(serviceName, SERVICE_NAME_SIZE);
+
+            const std::uint32_t slotCount = m_header->slotCount;
+            const std::uint32_t index = plugincommon::acquireSlot(boardSlots(m_header), slotCount, serviceName, STALLED_WRITER_TIMEOUT);
+            if(index == slotCount) {
+                throw std::runtime_error("The board is full (" + std::to_string(slotCount) + " slots)");
+            }
+            return boardSlots(m_header)[index];
+        }
+
+        /// Get the board of the process, it is mapped once and released with the last provider
+        static std::shared_ptr<Board> get() {
+            const char * envName = plugincommon::getEnv(BOARD_NAME_ENV);
+            const std::string name = (envName != nullptr) ? envName : DEFAULT_BOARD_NAME;
+            return plugincommon::SharedByKey<Board>::get(name, [&name] () { return std::make_shared<Board>(name); });
+        }
+    };
+
+    ServiceStatusBoard::ServiceStatusBoard(const char * serviceName)
+        : m_board(Board::get()),
+          m_slot(&m_board->acquireSlot(serviceName))
+        {}
+
+    const char * ServiceStatusBoard::getServiceName() const noexcept {
+        return m_slot->serviceName;
+    }
+
+    /// Set the Operating Status
+    ///@param os [in] Operating Status to set
+    ///@return 0, or -EOWNERDEAD if the slot was taken over from a writer which died during an update
+    int ServiceStatusBoard::set(fty::OperatingStatus os) noexcept {
+        return publish(m_slot->operatingStatus, static_cast<std::uint8_t>(os));
+    }
+
+    /// Set the Health State
+    ///@param hs [in] Health state to set
+    ///@return 0, or -EOWNERDEAD if the slot was taken over from a writer which died during an update
+    int ServiceStatusBoard::set(fty::HealthState hs) noexcept {
+        return publish(m_slot->healthState, static_cast<std::uint8_t>(hs));
+    }
+
+    //seqlock write: odd sequence while the slot is updated. Several providers, in this process or another,
+    //may write the slot of a service: the writer claims the odd sequence and waits while another one holds it,
+    //unless it holds it for STALLED_WRITER_TIMEOUT, for example a previous run of the service killed during an update.
+    int ServiceStatusBoard::publish(std::atomic<std::uint8_t> & field, std::uint8_t value) noexcept {
+        bool tookOver = false;
+        const std::uint32_t sequence = plugincommon::beginWrite(m_slot->sequence, STALLED_WRITER_TIMEOUT, tookOver);
+
+        field.store(value, std::memory_order_relaxed);
+        m_slot->updateTime.store(plugincommon::realtimeNs(), std::memory_order_relaxed);
+
+        plugincommon::endWrite(m_slot->sequence, sequence);
+        return tookOver ? -EOWNERDEAD : 0;
+    }
+
+} //namespace shmboard
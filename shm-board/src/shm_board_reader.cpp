@@ -0,0 +1,208 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#include "shm_board_reader.h"
+
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace shmboard
+{
+    std::string getBoardName() {
+        const char * envName = std::getenv(BOARD_NAME_ENV);
+        return (envName != nullptr && *envName != '\0') ? envName : DEFAULT_BOARD_NAME;
+    }
+
+    BoardReader::BoardReader(const std::string & boardName) {
+        int fd = shm_open(boardName.c_str(), O_RDONLY, 0);
+        if(fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "Impossible to open the board " + boardName);
+        }
+
+        struct stat st;
+        if(fstat(fd, &st) != 0 || static_cast<std::size_t>(st.st_size) < sizeof(BoardHeader)) {
+            close(fd);
+            throw std::runtime_error("The board " + boardName + " is not initialized");
+        }
+
+        m_size = static_cast<std::size_t>(st.st_size);
+        void * mapping = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+
+        if(mapping == MAP_FAILED) {
+            throw std::system_error(errno, std::generic_category(), "Impossible to map the board " + boardName);
+        }
+        m_header = static_cast<const BoardHeader*>(mapping);
+
+        if(m_header->magic.load(std::memory_order_acquire) != BOARD_MAGIC
+            || m_header->version != BOARD_VERSION || m_header->slotSize != sizeof(BoardSlot)
+            || m_size < boardSize(m_header->slotCount)) {
+            munmap(const_cast<BoardHeader*>(m_header), m_size);
+            throw std::runtime_error("The board " + boardName + " has an unsupported layout");
+        }
+    }
+
+    BoardReader::~BoardReader() {
+        munmap(const_cast<BoardHeader*>(m_header), m_size);
+    }
+
+    std::uint32_t BoardReader::getSlotCount() const noexcept {
+        return m_header->slotCount;
+    }
+
+    //seqlock read: retry while a writer is updating the slot, at most STALLED_WRITER_TIMEOUT for the same odd sequence
+    bool BoardReader::readSlot(const BoardSlot & slot, BoardEntry & entry, bool withName) {
+        if(slot.state.load(std::memory_order_acquire) != SLOT_READY) {
+            return false;
+        }
+
+        if(withName) {
+            //immutable once the slot is ready
+            entry.serviceName.assign(slot.serviceName, strnlen(slot.serviceName, SERVICE_NAME_SIZE));
+        }
+
+        std::uint32_t held = 0;
+        std::chrono::steady_clock::time_point heldSince;
+        for(unsigned attempt = 0; ; attempt++) {
+            const std::uint32_t before = slot.sequence.load(std::memory_order_acquire);
+            const std::uint8_t os = slot.operatingStatus.load(std::memory_order_relaxed);
+            const std::uint8_t hs = slot.healthState.load(std::memory_order_relaxed);
+            const std::uint64_t updateTime = slot.updateTime.load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const bool consistent = (before & 1) == 0 && slot.sequence.load(std::memory_order_relaxed) == before;
+            bool stalled = false;
+            if(!consistent && (before & 1) != 0 && attempt > 100) {
+                const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+                if(before != held) {
+                    held = before;
+                    heldSince = now;
+                } else {
+                    stalled = (now - heldSince >= STALLED_WRITER_TIMEOUT);
+                }
+            }
+
+            if(consistent || stalled) {
+                entry.operatingStatus = static_cast<fty::OperatingStatus>(os);
+                entry.healthState = static_cast<fty::HealthState>(hs);
+                entry.updateTime = updateTime;
+                entry.stalled = stalled;
+                return true;
+            }
+
+            //a writer preempted in the middle of an update must get the CPU back
+            if(attempt > 100) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    std::size_t BoardReader::snapshot(std::vector<BoardEntry> & entries) const {
+        const BoardSlot * slots = boardSlots(m_header);
+        std::size_t count = 0;
+
+        for(std::uint32_t index = 0; index < m_header->slotCount; index++) {
+            if(count == entries.size()) {
+                entries.emplace_back();
+            }
+
+            if(readSlot(slots[index], entries[count], true)) {
+                count++;
+            } else if(slots[index].state.load(std::memory_order_relaxed) == SLOT_FREE) {
+                //the slots are claimed in order
+                break;
+            }
+        }
+
+        entries.resize(count);
+        return count;
+    }
+
+    std::vector<BoardEntry> BoardReader::snapshot() const {
+        std::vector<BoardEntry> entries;
+        snapshot(entries);
+        return entries;
+    }
+
+    bool BoardReader::find(const std::string & serviceName, BoardEntry & entry) const {
+        const BoardSlot * slots = boardSlots(m_header);
+
+        for(std::uint32_t index = 0; index < m_header->slotCount; index++) {
+            const BoardSlot & slot = slots[index];
+            const std::uint32_t state = slot.state.load(std::memory_order_acquire);
+
+            if(state == SLOT_FREE) {
+                break;
+            }
+
+            if(state == SLOT_READY && serviceName == slot.serviceName) {
+                entry.serviceName = serviceName;
+                return readSlot(slot, entry, false);
+            }
+        }
+
+        return false;
+    }
+
+    const char * toString(fty::OperatingStatus os) noexcept {
+        switch(os) {
+            case fty::OperatingStatus::Unknown:         return "Unknown";
+            case fty::OperatingStatus::None:            return "None";
+            case fty::OperatingStatus::Servicing:       return "Servicing";
+            case fty::OperatingStatus::Starting:        return "Starting";
+            case fty::OperatingStatus::Stopping:        return "Stopping";
+            case fty::OperatingStatus::Stopped:         return "Stopped";
+            case fty::OperatingStatus::Aborted:         return "Aborted";
+            case fty::OperatingStatus::Dormant:         return "Dormant";
+            case fty::OperatingStatus::Completed:       return "Completed";
+            case fty::OperatingStatus::Migrating:       return "Migrating";
+            case fty::OperatingStatus::Immigrating:     return "Immigrating";
+            case fty::OperatingStatus::Emigrating:      return "Emigrating";
+            case fty::OperatingStatus::Snapshotting:    return "Snapshotting";
+            case fty::OperatingStatus::ShuttingDown:    return "Shutting Down";
+            case fty::OperatingStatus::InTest:          return "In Test";
+            case fty::OperatingStatus::Transitioning:   return "Transitioning";
+            case fty::OperatingStatus::InService:       return "In Service";
+        }
+        return "Invalid";
+    }
+
+    const char * toString(fty::HealthState hs) noexcept {
+        switch(hs) {
+            case fty::HealthState::Unknown:             return "Unknown";
+            case fty::HealthState::Ok:                  return "OK";
+            case fty::HealthState::Warning:             return "Warning";
+            case fty::HealthState::MinorFailure:        return "Minor Failure";
+            case fty::HealthState::MajorFailure:        return "Major Failure";
+            case fty::HealthState::CriticalFailure:     return "Critical Failure";
+            case fty::HealthState::NonRecoverableFailure: return "Non-recoverable Error";
+        }
+        return "Invalid";
+    }
+
+} //namespace shmboard
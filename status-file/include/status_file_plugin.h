@@ -0,0 +1,87 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#pragma once
+
+#include "status_file_record.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+
+//public interfaces
+extern "C"
+{
+    const char * getPluginName();
+    const char * getPluginLastError();
+    int createServiceStatusProvider(fty::ServiceStatusProvider** spp, const char * serviceName);
+    void deleteServiceStatusProvider(fty::ServiceStatusProvider* spp);
+}
+
+namespace statusfile
+{
+    class StatusFolder;
+
+    //provider writing the status of a service in "<folder>/<service name>.status"
+    //
+    //In "record" mode the file stays open and the record is rewritten in place with pwrite.
+    //In "rename" mode the record is written in a temporary file which replaces the status file.
+    class ServiceStatusFile : public fty::ServiceStatusProvider
+    {
+        private:
+        std::string m_serviceName;
+        std::shared_ptr<StatusFolder> m_folder;
+        std::string m_fileName;     //relative to the folder
+        std::string m_tempName;     //relative to the folder, "rename" mode only
+        int m_fd = -1;              //"record" mode only
+        std::mutex m_mutex;
+        StatusRecord m_record;
+        std::atomic<bool> m_dirty;  //written since the last group synchronization
+
+        int write() noexcept;
+        int writeInPlace() noexcept;
+        int writeAndRename() noexcept;
+
+        public:
+        ServiceStatusFile(const char * serviceName);
+        ~ServiceStatusFile();
+
+        ServiceStatusFile(const ServiceStatusFile &) = delete;
+        ServiceStatusFile & operator = (const ServiceStatusFile &) = delete;
+
+        /// Get the service name
+        ///@return  service name
+        const char * getServiceName() const noexcept override;
+
+        /// Set the Operating Status
+        ///@param os [in] Operating Status to set
+        ///@return 0 in success, -1  in case of error and message is stored in getPluginLastError
+        int set(fty::OperatingStatus os) noexcept override;
+
+        /// Set the Health State
+        ///@param hs [in] Health state to set
+        ///@return 0 in success, -1  in case of error and message is stored in getPluginLastError
+        int set(fty::HealthState hs) noexcept override;
+
+        /// Make the last update durable, used by the group synchronization
+        ///@return true if the file was updated since the previous call
+        bool sync() noexcept;
+    };
+
+} //namespace statusfile
@@ -0,0 +1,113 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#pragma once
+
+//Record written by the status file plugin, and functions to read it
+
+#include <fty_service_status.h>
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace statusfile
+{
+    /// Environment variable giving the folder of the status files
+    static const char * const FOLDER_ENV = "FTY_SERVICE_STATUS_FILE_DIR";
+    /// Environment variable giving the write mode: "record" (default) or "rename"
+    static const char * const MODE_ENV = "FTY_SERVICE_STATUS_FILE_MODE";
+    /// Environment variable giving the durability: "none" (default), "update" or "group"
+    static const char * const SYNC_ENV = "FTY_SERVICE_STATUS_FILE_SYNC";
+    /// Environment variable giving the period of the group synchronization in milli seconds
+    static const char * const SYNC_PERIOD_ENV = "FTY_SERVICE_STATUS_FILE_SYNC_MS";
+
+    static const char * const DEFAULT_FOLDER = "/run/fty-service-status";
+    static const unsigned DEFAULT_SYNC_PERIOD_MS = 1000;
+    /// Extension of the status files, the file of a service is "<folder>/<service name>.status"
+    static const char * const STATUS_FILE_EXTENSION = ".status";
+
+    static const std::uint32_t RECORD_MAGIC = 0x46535346; // "FSSF"
+    static const std::uint8_t RECORD_VERSION = 1;
+
+    /// Content of a status file, written at offset 0 in one pwrite
+    struct StatusRecord
+    {
+        std::uint32_t magic;
+        std::uint8_t version;
+        std::uint8_t operatingStatus;
+        std::uint8_t healthState;
+        std::uint8_t reserved;
+        std::uint64_t sequence;         ///< incremented by each update
+        std::uint64_t updateTime;       ///< CLOCK_REALTIME of the update in nano seconds
+        std::uint32_t reserved2;
+        std::uint32_t checksum;         ///< FNV-1a of the previous bytes
+    };
+
+    static_assert(sizeof(StatusRecord) == 32, "The status record must have a fixed size");
+
+    /// Compute the checksum of a record
+    inline std::uint32_t recordChecksum(const StatusRecord & record) noexcept {
+        const unsigned char * bytes = reinterpret_cast<const unsigned char *>(&record);
+        std::uint32_t hash = 2166136261u;
+        for(std::size_t i = 0; i < offsetof(StatusRecord, checksum); i++) {
+            hash = (hash ^ bytes[i]) * 16777619u;
+        }
+        return hash;
+    }
+
+    /// Check a record read from a file
+    inline bool isValidRecord(const StatusRecord & record) noexcept {
+        return record.magic == RECORD_MAGIC && record.version == RECORD_VERSION
+            && record.checksum == recordChecksum(record);
+    }
+
+    /// Read the status file of a service
+    ///
+    /// A record updated in place may be read during a write, the read is retried until the record is valid.
+    ///@param path [in] path of the status file
+    ///@param record [out] content of the file
+    ///@return true if the file exists and contains a valid record
+    inline bool readStatusFile(const std::string & path, StatusRecord & record) noexcept {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0) {
+            return false;
+        }
+
+        bool valid = false;
+        for(unsigned attempt = 0; attempt < 100 && !valid; attempt++) {
+            ssize_t size = pread(fd, &record, sizeof(record), 0);
+            if(size < 0 && errno == EINTR) {
+                continue;
+            }
+            if(size != static_cast<ssize_t>(sizeof(record))) {
+                break;
+            }
+            valid = isValidRecord(record);
+        }
+
+        close(fd);
+        return valid;
+    }
+
+} //namespace statusfile
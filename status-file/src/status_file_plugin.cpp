@@ -0,0 +1,358 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#include "status_file_plugin.h"
+
+#include <plugin_common.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <set>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#include <sys/stat.h>
+
+
+//internal variables and functions
+static std::string gPluginLastError = "";
+static int setError(const std::string & message, int error) noexcept;
+
+//public interfaces
+const char * getPluginName() {
+    return "File plugin";
+}
+
+const char * getPluginLastError(){
+    return gPluginLastError.c_str();
+}
+
+int createServiceStatusProvider(fty::ServiceStatusProvider** spp, const char * serviceName) {
+    try {
+        *spp = dynamic_cast<fty::ServiceStatusProvider*>(new statusfile::ServiceStatusFile(serviceName));
+    }
+    catch(const std::exception& e) {
+        gPluginLastError = e.what();
+        return -1;
+    }
+
+    gPluginLastError = "";
+    return 0;
+}
+
+void deleteServiceStatusProvider(fty::ServiceStatusProvider* spp) {
+    statusfile::ServiceStatusFile * ptr = dynamic_cast<statusfile::ServiceStatusFile*>(spp);
+    delete ptr;
+}
+
+
+namespace statusfile
+{
+    enum class WriteMode { Record, Rename };
+    using plugincommon::SyncPolicy;
+
+    //settings read from the environment when a provider is created
+    struct FolderSettings
+    {
+        std::string path = DEFAULT_FOLDER;
+        WriteMode mode = WriteMode::Record;
+        SyncPolicy sync = SyncPolicy::None;
+        std::chrono::milliseconds syncPeriod = std::chrono::milliseconds(DEFAULT_SYNC_PERIOD_MS);
+
+        static FolderSettings fromEnv() {
+            FolderSettings settings;
+
+            const char * value = plugincommon::getEnv(FOLDER_ENV);
+            if(value != nullptr) {
+                settings.path = value;
+            }
+
+            value = plugincommon::getEnv(MODE_ENV);
+            if(value != nullptr) {
+                const std::string mode = value;
+                if(mode == "record") {
+                    settings.mode = WriteMode::Record;
+                } else if(mode == "rename") {
+                    settings.mode = WriteMode::Rename;
+                } else {
+                    throw std::invalid_argument(std::string("Invalid ") + MODE_ENV + ": " + mode);
+                }
+            }
+
+            settings.sync = plugincommon::syncPolicyFromEnv(SYNC_ENV, settings.sync);
+            settings.syncPeriod = plugincommon::periodFromEnv(SYNC_PERIOD_ENV, settings.syncPeriod);
+            return settings;
+        }
+
+        std::string key() const {
+            return path + "|" + std::to_string(static_cast<int>(mode)) + "|" + std::to_string(static_cast<int>(sync))
+                + "|" + std::to_string(syncPeriod.count());
+        }
+    };
+
+    //folder of the status files, shared by the providers with the same settings
+    //It keeps the folder open, and runs the group synchronization
+    class StatusFolder
+    {
+        private:
+        FolderSettings m_settings;
+        int m_fd = -1;
+
+        std::mutex m_mutex;
+        std::condition_variable m_wakeup;
+        bool m_stop = false;
+        std::set<ServiceStatusFile*> m_files;
+        std::thread m_flusher;
+
+        void flushLoop() {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while(!m_stop) {
+                m_wakeup.wait_for(lock, m_settings.syncPeriod);
+
+                bool updated = false;
+                for(ServiceStatusFile * file : m_files) {
+                    updated = file->sync() || updated;
+                }
+
+                //the renamed files are not open anymore
+                if(updated && m_settings.mode == WriteMode::Rename) {
+                    syncfs(m_fd);
+                }
+            }
+        }
+
+        public:
+        explicit StatusFolder(const FolderSettings & settings)
+            : m_settings(settings) {
+            if(mkdir(m_settings.path.c_str(), 0755) != 0 && errno != EEXIST) {
+                throw std::system_error(errno, std::generic_category(), "Impossible to create the folder " + m_settings.path);
+            }
+
+            m_fd = open(m_settings.path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+            if(m_fd < 0) {
+                throw std::system_error(errno, std::generic_category(), "Impossible to open the folder " + m_settings.path);
+            }
+
+            if(m_settings.sync == SyncPolicy::Group) {
+                m_flusher = std::thread(&StatusFolder::flushLoop, this);
+            }
+        }
+
+        ~StatusFolder() {
+            if(m_flusher.joinable()) {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_stop = true;
+                }
+                m_wakeup.notify_one();
+                m_flusher.join();
+            }
+            close(m_fd);
+        }
+
+        StatusFolder(const StatusFolder &) = delete;
+        StatusFolder & operator = (const StatusFolder &) = delete;
+
+        int getFd() const noexcept { return m_fd; }
+        const std::string & getPath() const noexcept { return m_settings.path; }
+        WriteMode getMode() const noexcept { return m_settings.mode; }
+        SyncPolicy getSync() const noexcept { return m_settings.sync; }
+
+        /// Add a file to the group synchronization
+        void attach(ServiceStatusFile * file) {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_files.insert(file);
+        }
+
+        /// Remove a file from the group synchronization and synchronize it one last time
+        void detach(ServiceStatusFile * file) noexcept {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_files.erase(file);
+            if(file->sync() && m_settings.mode == WriteMode::Rename) {
+                syncfs(m_fd);
+            }
+        }
+
+        /// Get the folder for the settings of the environment, it is opened once and closed with the last provider
+        static std::shared_ptr<StatusFolder> get() {
+            const FolderSettings settings = FolderSettings::fromEnv();
+            return plugincommon::SharedByKey<StatusFolder>::get(settings.key(), [&settings] () { return std::make_shared<StatusFolder>(settings); });
+        }
+    };
+
+    ServiceStatusFile::ServiceStatusFile(const char * serviceName)
+        : m_serviceName(serviceName),
+          m_folder(StatusFolder::get()),
+          m_fileName(m_serviceName + STATUS_FILE_EXTENSION),
+          m_tempName(m_fileName + ".tmp"),
+          m_dirty(false)
+    {
+        if(m_serviceName.empty() || m_serviceName.find('/') != std::string::npos) {
+            throw std::invalid_argument("Invalid service name <" + m_serviceName + "> for a status file");
+        }
+
+        //a restarted service keeps the status it published
+        const bool existing = readStatusFile(m_folder->getPath() + "/" + m_fileName, m_record);
+        if(!existing) {
+            std::memset(&m_record, 0, sizeof(m_record));
+            m_record.magic = RECORD_MAGIC;
+            m_record.version = RECORD_VERSION;
+            m_record.checksum = recordChecksum(m_record);
+        }
+
+        if(m_folder->getMode() == WriteMode::Record) {
+            //the file is created by a rename so it is never seen empty
+            if(!existing && writeAndRename() != 0) {
+                throw std::runtime_error(gPluginLastError);
+            }
+
+            m_fd = openat(m_folder->getFd(), m_fileName.c_str(), O_WRONLY | O_CLOEXEC);
+            if(m_fd < 0) {
+                throw std::system_error(errno, std::generic_category(), "Impossible to open " + m_fileName);
+            }
+        }
+
+        if(m_folder->getSync() == SyncPolicy::Group) {
+            m_folder->attach(this);
+        }
+    }
+
+    ServiceStatusFile::~ServiceStatusFile() {
+        if(m_folder->getSync() == SyncPolicy::Group) {
+            m_folder->detach(this);
+        }
+        if(m_fd >= 0) {
+            close(m_fd);
+        }
+    }
+
+    const char * ServiceStatusFile::getServiceName() const noexcept {
+        return m_serviceName.c_str();
+    }
+
+    /// Set the Operating Status
+    ///@param os [in] Operating Status to set
+    ///@return 0 in success, -1  in case of error and message is stored in getPluginLastError
+    int ServiceStatusFile::set(fty::OperatingStatus os) noexcept {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_record.operatingStatus = static_cast<std::uint8_t>(os);
+        return write();
+    }
+
+    /// Set the Health State
+    ///@param hs [in] Health state to set
+    ///@return 0 in success, -1  in case of error and message is stored in getPluginLastError
+    int ServiceStatusFile::set(fty::HealthState hs) noexcept {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_record.healthState = static_cast<std::uint8_t>(hs);
+        return write();
+    }
+
+    bool ServiceStatusFile::sync() noexcept {
+        if(!m_dirty.exchange(false)) {
+            return false;
+        }
+        if(m_fd >= 0) {
+            fdatasync(m_fd);
+        }
+        return true;
+    }
+
+    int ServiceStatusFile::write() noexcept {
+        m_record.sequence++;
+        m_record.updateTime = plugincommon::realtimeNs();
+        m_record.checksum = recordChecksum(m_record);
+
+        int result = (m_folder->getMode() == WriteMode::Record) ? writeInPlace() : writeAndRename();
+
+        if(result == 0) {
+            gPluginLastError = "";
+            if(m_folder->getSync() == SyncPolicy::Group) {
+                m_dirty = true;
+            }
+        }
+        return result;
+    }
+
+    //one pwrite of the whole record at offset 0, the file is never truncated
+    int ServiceStatusFile::writeInPlace() noexcept {
+        ssize_t size;
+        do {
+            size = pwrite(m_fd, &m_record, sizeof(m_record), 0);
+        } while(size < 0 && errno == EINTR);
+
+        if(size != static_cast<ssize_t>(sizeof(m_record))) {
+            return setError("Impossible to write " + m_fileName, (size < 0) ? errno : EIO);
+        }
+
+        if(m_folder->getSync() == SyncPolicy::Update && fdatasync(m_fd) != 0) {
+            return setError("Impossible to sync " + m_fileName, errno);
+        }
+        return 0;
+    }
+
+    //write a temporary file and rename it over the status file, readers see the old or the new record
+    int ServiceStatusFile::writeAndRename() noexcept {
+        const int folderFd = m_folder->getFd();
+        const bool syncUpdate = (m_folder->getSync() == SyncPolicy::Update);
+
+        int fd = openat(folderFd, m_tempName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if(fd < 0) {
+            return setError("Impossible to create " + m_tempName, errno);
+        }
+
+        ssize_t size;
+        do {
+            size = pwrite(fd, &m_record, sizeof(m_record), 0);
+        } while(size < 0 && errno == EINTR);
+
+        int error = (size == static_cast<ssize_t>(sizeof(m_record))) ? 0 : ((size < 0) ? errno : EIO);
+        if(error == 0 && syncUpdate && fdatasync(fd) != 0) {
+            error = errno;
+        }
+        close(fd);
+
+        if(error != 0) {
+            unlinkat(folderFd, m_tempName.c_str(), 0);
+            return setError("Impossible to write " + m_tempName, error);
+        }
+
+        if(renameat(folderFd, m_tempName.c_str(), folderFd, m_fileName.c_str()) != 0) {
+            error = errno;
+            unlinkat(folderFd, m_tempName.c_str(), 0);
+            return setError("Impossible to rename " + m_tempName, error);
+        }
+
+        if(syncUpdate && fsync(folderFd) != 0) {
+            return setError("Impossible to sync " + m_folder->getPath(), errno);
+        }
+        return 0;
+    }
+
+} //namespace statusfile
+
+static int setError(const std::string & message, int error) noexcept {
+    try {
+        gPluginLastError = message + ": " + std::strerror(error);
+    }
+    catch(...) {
+        gPluginLastError.clear();
+    }
+    return -1;
+}
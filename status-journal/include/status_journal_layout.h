@@ -0,0 +1,148 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#pragma once
+
+//Layout of the journal file of the transitions, shared by the plugin (writer) and the reader library
+//
+//The file is a header, a table of the services and a ring of fixed-size records. Each service keeps its last status
+//in its slot of the table, so a restarted service restores it without reading the ring.
+
+#include <fty_service_status.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+
+namespace statusjournal
+{
+    /// Path of the journal used when FTY_SERVICE_STATUS_JOURNAL is not set
+    static const char * const DEFAULT_JOURNAL_PATH = "/var/lib/fty-service-status/journal";
+    /// Environment variable giving the path of the journal
+    static const char * const JOURNAL_PATH_ENV = "FTY_SERVICE_STATUS_JOURNAL";
+    /// Environment variable giving the number of records of the ring, used by the process which creates the journal
+    static const char * const JOURNAL_RECORDS_ENV = "FTY_SERVICE_STATUS_JOURNAL_RECORDS";
+    /// Environment variable giving the number of services, used by the process which creates the journal
+    static const char * const JOURNAL_SERVICES_ENV = "FTY_SERVICE_STATUS_JOURNAL_SERVICES";
+    /// Environment variable giving the sync policy: none, update or group
+    static const char * const JOURNAL_SYNC_ENV = "FTY_SERVICE_STATUS_JOURNAL_SYNC";
+    /// Environment variable giving the period of the group sync in milli seconds
+    static const char * const JOURNAL_SYNC_PERIOD_ENV = "FTY_SERVICE_STATUS_JOURNAL_SYNC_MS";
+
+    static const std::uint32_t JOURNAL_MAGIC = 0x46534a4c; // "FSJL"
+    static const std::uint32_t JOURNAL_VERSION = 1;
+    static const std::uint32_t DEFAULT_RECORD_COUNT = 65536;
+    static const std::uint32_t DEFAULT_SERVICE_COUNT = 256;
+    static const unsigned DEFAULT_SYNC_PERIOD_MS = 1000;
+    static const std::size_t SERVICE_NAME_SIZE = 96;
+    /// Time after which a service left claimed or with an odd sequence is considered left by a writer which died:
+    /// the next writer takes the service over and the readers report its last status as stalled
+    static const std::chrono::milliseconds STALLED_WRITER_TIMEOUT {100};
+
+    /// State of a service slot, a slot is never released so a restarted service finds its slot back
+    enum ServiceState : std::uint32_t
+    {
+        SERVICE_FREE       = 0,
+        SERVICE_CLAIMED    = 1,    ///< a writer is filling the service name
+        SERVICE_READY      = 2     ///< the service name is set and will not change
+    };
+
+    /// Header of the journal, the services and the records follow it
+    struct JournalHeader
+    {
+        std::atomic<std::uint32_t> magic;   ///< set last by the creator, with release semantic
+        std::uint32_t version;
+        std::uint32_t recordCount;
+        std::uint32_t recordSize;
+        std::uint32_t serviceCount;
+        std::uint32_t serviceSize;
+        std::atomic<std::uint64_t> nextSequence;    ///< sequence of the next record, the record is at sequence % recordCount
+        char reserved[32];
+    };
+
+    /// Last status of one service
+    ///
+    /// The status is guarded by a seqlock: a writer claims the sequence by making it odd with a compare and swap,
+    /// updates the fields and makes it even again, the other writers wait while it is odd.
+    /// A reader retries when the sequence is odd or changed during the read.
+    /// A sequence odd for STALLED_WRITER_TIMEOUT was left by a writer which died during an update, the next writer takes it over.
+    struct JournalService
+    {
+        std::atomic<std::uint32_t> sequence;
+        std::atomic<std::uint32_t> state;
+        std::atomic<std::uint8_t> operatingStatus;
+        std::atomic<std::uint8_t> healthState;
+        std::uint8_t reserved[6];
+        std::atomic<std::int64_t> monotonicTime;    ///< CLOCK_MONOTONIC of the last transition in nano seconds, 0 if none
+        std::atomic<std::int64_t> wallTime;         ///< CLOCK_REALTIME of the last transition in nano seconds
+        char serviceName[SERVICE_NAME_SIZE];        ///< null terminated, immutable once the slot is ready
+    };
+
+    /// Transition of one service
+    ///
+    /// The writer clears the sequence, writes the fields and sets the sequence to the sequence of the record + 1.
+    /// A reader keeps the record if the sequence is the expected one before and after reading the fields.
+    struct JournalRecord
+    {
+        std::atomic<std::uint64_t> sequence;
+        std::atomic<std::uint32_t> serviceId;       ///< index of the service in the table
+        std::atomic<std::uint8_t> operatingStatus;
+        std::atomic<std::uint8_t> healthState;
+        std::uint8_t reserved[2];
+        std::atomic<std::int64_t> monotonicTime;
+        std::atomic<std::int64_t> wallTime;
+    };
+
+    static_assert(sizeof(JournalHeader) == 64, "The journal header must use one cache line");
+    static_assert(sizeof(JournalService) == 128, "A service must use two cache lines");
+    static_assert(sizeof(JournalRecord) == 32, "A record must use half a cache line");
+    static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2, "The journal needs lock-free atomics");
+
+    /// Size of the journal
+    inline std::size_t journalSize(std::uint32_t serviceCount, std::uint32_t recordCount) noexcept {
+        return sizeof(JournalHeader) + serviceCount * sizeof(JournalService) + recordCount * sizeof(JournalRecord);
+    }
+
+    /// Check if a mapped journal has the layout of this version
+    inline bool isValidJournal(const JournalHeader * header, std::size_t size) noexcept {
+        return size >= sizeof(JournalHeader) && header->magic.load(std::memory_order_acquire) == JOURNAL_MAGIC
+            && header->version == JOURNAL_VERSION && header->recordSize == sizeof(JournalRecord)
+            && header->serviceSize == sizeof(JournalService) && header->recordCount != 0
+            && size >= journalSize(header->serviceCount, header->recordCount);
+    }
+
+    /// Get the services of a mapped journal
+    inline JournalService * journalServices(JournalHeader * header) noexcept {
+        return reinterpret_cast<JournalService *>(header + 1);
+    }
+
+    inline const JournalService * journalServices(const JournalHeader * header) noexcept {
+        return reinterpret_cast<const JournalService *>(header + 1);
+    }
+
+    /// Get the records of a mapped journal
+    inline JournalRecord * journalRecords(JournalHeader * header) noexcept {
+        return reinterpret_cast<JournalRecord *>(journalServices(header) + header->serviceCount);
+    }
+
+    inline const JournalRecord * journalRecords(const JournalHeader * header) noexcept {
+        return reinterpret_cast<const JournalRecord *>(journalServices(header) + header->serviceCount);
+    }
+
+} //namespace statusjournal
@@ -0,0 +1,78 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#pragma once
+
+#include "status_journal_layout.h"
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+//public interfaces
+extern "C"
+{
+    const char * getPluginName();
+    const char * getPluginLastError();
+    int createServiceStatusProvider(fty::ServiceStatusProvider** spp, const char * serviceName);
+    void deleteServiceStatusProvider(fty::ServiceStatusProvider* spp);
+}
+
+namespace statusjournal
+{
+    class Journal;
+
+    //provider appending the transitions of a service to the journal
+    //
+    //The provider starts from the last status of the service in the journal, so the first transition after a restart
+    //is recorded from the restored status. An update which does not change the status is not recorded.
+    class ServiceStatusJournal : public fty::ServiceStatusProvider
+    {
+        private:
+        std::shared_ptr<Journal> m_journal;
+        std::uint32_t m_serviceId;
+        JournalService * m_service;
+        std::mutex m_mutex;
+        fty::OperatingStatus m_operatingStatus;
+        fty::HealthState m_healthState;
+        bool m_hasStatus;   //false until the first status of a new service
+
+        int append(fty::OperatingStatus os, fty::HealthState hs) noexcept;
+
+        public:
+        ServiceStatusJournal(const char * serviceName);
+
+        ServiceStatusJournal(const ServiceStatusJournal &) = delete;
+        ServiceStatusJournal & operator = (const ServiceStatusJournal &) = delete;
+
+        /// Get the service name
+        ///@return  service name
+        const char * getServiceName() const noexcept override;
+
+        /// Set the Operating Status
+        ///@param os [in] Operating Status to set
+        ///@return 0, or -EOWNERDEAD if the service was taken over from a writer which died during an update, the status is set anyway
+        int set(fty::OperatingStatus os) noexcept override;
+
+        /// Set the Health State
+        ///@param hs [in] Health state to set
+        ///@return 0, or -EOWNERDEAD if the service was taken over from a writer which died during an update, the status is set anyway
+        int set(fty::HealthState hs) noexcept override;
+    };
+
+} //namespace statusjournal
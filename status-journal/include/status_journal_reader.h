@@ -0,0 +1,95 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#pragma once
+
+#include "status_journal_layout.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace statusjournal
+{
+    /// Transition of a service read from the journal, or its last status
+    struct JournalEntry
+    {
+        std::uint64_t sequence = 0;     ///< sequence of the record, 0 for a last status
+        std::string serviceName;
+        fty::OperatingStatus operatingStatus = fty::OperatingStatus::Unknown;
+        fty::HealthState healthState = fty::HealthState::Unknown;
+        std::int64_t monotonicTime = 0; ///< CLOCK_MONOTONIC in nano seconds, 0 if the service has no status
+        std::int64_t wallTime = 0;      ///< CLOCK_REALTIME in nano seconds
+        /// True for a last status whose writer died during an update: the status, read anyway, may be torn
+        bool stalled = false;
+    };
+
+    /// Get the path of the journal from FTY_SERVICE_STATUS_JOURNAL or the default one
+    std::string getJournalPath();
+
+    /// Read-only view of the journal
+    ///
+    /// The journal is mapped once, reading it does not need any system call and never blocks the writers.
+    class JournalReader
+    {
+        private:
+        const JournalHeader * m_header = nullptr;
+        std::size_t m_size = 0;
+
+        bool readService(std::uint32_t index, JournalEntry & entry, bool withName) const;
+
+        public:
+        /// Map the journal
+        ///@param path [in] path of the journal
+        ///@throw std::system_error if the journal does not exist, std::runtime_error if its layout is not supported
+        explicit JournalReader(const std::string & path = getJournalPath());
+        ~JournalReader();
+
+        JournalReader(const JournalReader &) = delete;
+        JournalReader & operator = (const JournalReader &) = delete;
+
+        /// Get the number of records of the ring
+        std::uint32_t getRecordCount() const noexcept;
+
+        /// Get the sequence of the next record, which is also the number of records written since the creation
+        std::uint64_t getNextSequence() const noexcept;
+
+        /// Get the sequence of the oldest record still in the ring
+        std::uint64_t getOldestSequence() const noexcept;
+
+        /// Get the last status of a service, without reading the ring
+        ///@param serviceName [in] name of the service
+        ///@param entry [out] last status of the service
+        ///@return true if the service is in the journal
+        bool lastStatus(const std::string & serviceName, JournalEntry & entry) const;
+
+        /// Get the last status of every service
+        std::vector<JournalEntry> lastStatuses() const;
+
+        /// Read the records from a sequence, in order
+        ///
+        /// The reading stops at the first record being written, which is read again by the next call.
+        ///@param from [in] sequence of the first record to read
+        ///@param entries [out] the records read are appended
+        ///@param lost [out] number of records which were overwritten before they could be read
+        ///@param maxCount [in] maximum number of records to read
+        ///@return sequence of the next record to read
+        std::uint64_t read(std::uint64_t from, std::vector<JournalEntry> & entries, std::uint64_t & lost, std::size_t maxCount = SIZE_MAX) const;
+    };
+
+} //namespace statusjournal
@@ -0,0 +1,124 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#include "status_journal_reader.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+
+static int usage(const char * program, int result) {
+    std::cerr << "Usage: " << program << " [-s | -f] [journal path]" << std::endl
+              << "Print the transitions recorded by the journal plugin, the oldest first." << std::endl
+              << "  -s  print the last status of each service" << std::endl
+              << "  -f  print the new transitions as they are recorded, until interrupted" << std::endl
+              << "The default journal is $" << statusjournal::JOURNAL_PATH_ENV
+              << " or " << statusjournal::DEFAULT_JOURNAL_PATH << std::endl;
+    return result;
+}
+
+static void printTime(std::int64_t wallTime) {
+    char updated[32] = "never";
+    if(wallTime != 0) {
+        std::time_t seconds = static_cast<std::time_t>(wallTime / 1000000000LL);
+        struct tm local;
+        std::size_t length = std::strftime(updated, sizeof(updated), "%Y-%m-%d %H:%M:%S", localtime_r(&seconds, &local));
+        std::snprintf(updated + length, sizeof(updated) - length, ".%06lld", static_cast<long long>(wallTime % 1000000000LL / 1000));
+    }
+    std::cout << std::setw(28) << updated;
+}
+
+static int printLastStatuses(const statusjournal::JournalReader & reader) {
+    std::cout << std::left << std::setw(28) << "UPDATED" << std::setw(40) << "SERVICE"
+              << std::setw(12) << "OPERATING" << "HEALTH" << std::endl;
+
+    for(const statusjournal::JournalEntry & entry : reader.lastStatuses()) {
+        printTime(entry.wallTime);
+        std::cout << std::setw(40) << entry.serviceName << std::setw(12) << static_cast<unsigned>(entry.operatingStatus)
+                  << static_cast<unsigned>(entry.healthState) << (entry.stalled ? " (stalled writer)" : "") << std::endl;
+    }
+    return 0;
+}
+
+static int printTransitions(const statusjournal::JournalReader & reader, bool follow) {
+    std::cout << std::left << std::setw(12) << "SEQUENCE" << std::setw(28) << "UPDATED" << std::setw(40) << "SERVICE"
+              << std::setw(12) << "OPERATING" << "HEALTH" << std::endl;
+
+    std::vector<statusjournal::JournalEntry> entries;
+    std::uint64_t next = reader.getOldestSequence();
+    while(true) {
+        std::uint64_t lost = 0;
+        entries.clear();
+        next = reader.read(next, entries, lost, 1024);
+
+        if(lost != 0) {
+            std::cout << "... " << lost << " transitions overwritten" << std::endl;
+        }
+        for(const statusjournal::JournalEntry & entry : entries) {
+            std::cout << std::setw(12) << entry.sequence;
+            printTime(entry.wallTime);
+            std::cout << std::setw(40) << entry.serviceName << std::setw(12) << static_cast<unsigned>(entry.operatingStatus)
+                      << static_cast<unsigned>(entry.healthState) << std::endl;
+        }
+
+        if(entries.empty()) {
+            if(!follow) {
+                return 0;
+            }
+            std::cout.flush();
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+    }
+}
+
+//dump or stream the transitions of the journal
+int main(int argc, char ** argv) {
+    bool lastStatuses = false;
+    bool follow = false;
+    std::string path = statusjournal::getJournalPath();
+
+    for(int i = 1; i < argc; i++) {
+        if(std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0) {
+            return usage(argv[0], 0);
+        } else if(std::strcmp(argv[i], "-s") == 0) {
+            lastStatuses = true;
+        } else if(std::strcmp(argv[i], "-f") == 0) {
+            follow = true;
+        } else if(i == argc - 1 && argv[i][0] != '-') {
+            path = argv[i];
+        } else {
+            return usage(argv[0], 1);
+        }
+    }
+    if(lastStatuses && follow) {
+        return usage(argv[0], 1);
+    }
+
+    try {
+        statusjournal::JournalReader reader(path);
+        return lastStatuses ? printLastStatuses(reader) : printTransitions(reader, follow);
+    }
+    catch(const std::exception & e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,338 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#include "status_journal_plugin.h"
+
+#include <plugin_common.h>
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <time.h>
+
+#include <fcntl.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+
+//internal variables and functions
+static std::string gPluginLastError = "";
+
+//public interfaces
+const char * getPluginName() {
+    return "Journal plugin";
+}
+
+const char * getPluginLastError(){
+    return gPluginLastError.c_str();
+}
+
+int createServiceStatusProvider(fty::ServiceStatusProvider** spp, const char * serviceName) {
+    try {
+        *spp = dynamic_cast<fty::ServiceStatusProvider*>(new statusjournal::ServiceStatusJournal(serviceName));
+    }
+    catch(const std::exception& e) {
+        gPluginLastError = e.what();
+        return -1;
+    }
+
+    gPluginLastError = "";
+    return 0;
+}
+
+void deleteServiceStatusProvider(fty::ServiceStatusProvider* spp) {
+    statusjournal::ServiceStatusJournal * ptr = dynamic_cast<statusjournal::ServiceStatusJournal*>(spp);
+    delete ptr;
+}
+
+
+namespace statusjournal
+{
+    using plugincommon::SyncPolicy;
+
+    static_assert(SERVICE_FREE == plugincommon::SLOT_FREE && SERVICE_CLAIMED == plugincommon::SLOT_CLAIMED && SERVICE_READY == plugincommon::SLOT_READY,
+                  "The services of the journal are claimed by plugincommon::acquireSlot");
+
+    //settings read from the environment when a provider is created
+    struct JournalSettings
+    {
+        std::string path = DEFAULT_JOURNAL_PATH;
+        std::uint32_t recordCount = DEFAULT_RECORD_COUNT;
+        std::uint32_t serviceCount = DEFAULT_SERVICE_COUNT;
+        SyncPolicy sync = SyncPolicy::None;
+        std::chrono::milliseconds syncPeriod = std::chrono::milliseconds(DEFAULT_SYNC_PERIOD_MS);
+
+        static JournalSettings fromEnv() {
+            JournalSettings settings;
+
+            const char * value = plugincommon::getEnv(JOURNAL_PATH_ENV);
+            if(value != nullptr) {
+                settings.path = value;
+            }
+
+            settings.recordCount = plugincommon::countFromEnv(JOURNAL_RECORDS_ENV, DEFAULT_RECORD_COUNT, 16 * 1024 * 1024);
+            settings.serviceCount = plugincommon::countFromEnv(JOURNAL_SERVICES_ENV, DEFAULT_SERVICE_COUNT, 16 * 1024 * 1024);
+            settings.sync = plugincommon::syncPolicyFromEnv(JOURNAL_SYNC_ENV, settings.sync);
+            settings.syncPeriod = plugincommon::periodFromEnv(JOURNAL_SYNC_PERIOD_ENV, settings.syncPeriod);
+            return settings;
+        }
+
+        std::string key() const {
+            return path + "|" + std::to_string(static_cast<int>(sync)) + "|" + std::to_string(syncPeriod.count());
+        }
+    };
+
+    //journal mapped in the process, shared by all the providers with the same settings
+    //It runs the group sync.
+    class Journal
+    {
+        private:
+        JournalSettings m_settings;
+        JournalHeader * m_header = nullptr;
+        std::size_t m_size = 0;
+        long m_pageSize = sysconf(_SC_PAGESIZE);
+
+        std::mutex m_mutex;
+        std::condition_variable m_wakeup;
+        bool m_stop = false;
+        std::atomic<bool> m_dirty {false};
+        std::thread m_flusher;
+
+        void flushLoop() {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            while(!m_stop) {
+                m_wakeup.wait_for(lock, m_settings.syncPeriod);
+                if(m_dirty.exchange(false)) {
+                    msync(m_header, m_size, MS_SYNC);
+                }
+            }
+        }
+
+        //the file is locked: the first process initializes it, a journal of another layout is replaced
+        void map(int fd) {
+            struct stat st;
+            if(fstat(fd, &st) != 0) {
+                throw std::system_error(errno, std::generic_category(), "Impossible to read the journal " + m_settings.path);
+            }
+
+            m_size = static_cast<std::size_t>(st.st_size);
+            if(m_size >= sizeof(JournalHeader)) {
+                void * mapping = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                if(mapping == MAP_FAILED) {
+                    throw std::system_error(errno, std::generic_category(), "Impossible to map the journal " + m_settings.path);
+                }
+                m_header = static_cast<JournalHeader*>(mapping);
+                if(isValidJournal(m_header, m_size)) {
+                    return;
+                }
+                munmap(m_header, m_size);
+                m_header = nullptr;
+            }
+
+            //the new pages are zeroed, so all the services are free and all the records empty
+            m_size = journalSize(m_settings.serviceCount, m_settings.recordCount);
+            if(ftruncate(fd, 0) != 0 || ftruncate(fd, static_cast<off_t>(m_size)) != 0) {
+                throw std::system_error(errno, std::generic_category(), "Impossible to size the journal " + m_settings.path);
+            }
+
+            void * mapping = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if(mapping == MAP_FAILED) {
+                throw std::system_error(errno, std::generic_category(), "Impossible to map the journal " + m_settings.path);
+            }
+            m_header = static_cast<JournalHeader*>(mapping);
+            m_header->version = JOURNAL_VERSION;
+            m_header->recordCount = m_settings.recordCount;
+            m_header->recordSize = sizeof(JournalRecord);
+            m_header->serviceCount = m_settings.serviceCount;
+            m_header->serviceSize = sizeof(JournalService);
+            m_header->nextSequence.store(0, std::memory_order_relaxed);
+            m_header->magic.store(JOURNAL_MAGIC, std::memory_order_release);
+            msync(m_header, m_size, MS_SYNC);
+        }
+
+        //write back the pages of a range
+        void syncRange(const void * address, std::size_t size) noexcept {
+            const std::uintptr_t begin = reinterpret_cast<std::uintptr_t>(address) & ~static_cast<std::uintptr_t>(m_pageSize - 1);
+            const std::uintptr_t end = reinterpret_cast<std::uintptr_t>(address) + size;
+            msync(reinterpret_cast<void *>(begin), end - begin, MS_SYNC);
+        }
+
+        public:
+        explicit Journal(const JournalSettings & settings)
+            : m_settings(settings) {
+            int fd = open(m_settings.path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+            if(fd < 0) {
+                throw std::system_error(errno, std::generic_category(), "Impossible to open the journal " + m_settings.path);
+            }
+
+            try {
+                if(flock(fd, LOCK_EX) != 0) {
+                    throw std::system_error(errno, std::generic_category(), "Impossible to lock the journal " + m_settings.path);
+                }
+                map(fd);
+            }
+            catch(...) {
+                close(fd);
+                throw;
+            }
+
+            //the mapping stays valid without the file descriptor, closing it releases the lock
+            close(fd);
+
+            if(m_settings.sync == SyncPolicy::Group) {
+                m_flusher = std::thread(&Journal::flushLoop, this);
+            }
+        }
+
+        ~Journal() {
+            if(m_flusher.joinable()) {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_stop = true;
+                }
+                m_wakeup.notify_one();
+                m_flusher.join();
+            }
+            if(m_dirty) {
+                msync(m_header, m_size, MS_SYNC);
+            }
+            munmap(m_header, m_size);
+        }
+
+        Journal(const Journal &) = delete;
+        Journal & operator = (const Journal &) = delete;
+
+        /// Find the service or claim a free slot for it
+        ///@return index of the service
+        std::uint32_t acquireService(const std::string & serviceName) {
+            plugincommon::checkServiceName(serviceName, SERVICE_NAME_SIZE);
+
+            const std::uint32_t serviceCount = m_header->serviceCount;
+            const std::uint32_t index = plugincommon::acquireSlot(journalServices(m_header), serviceCount, serviceName, STALLED_WRITER_TIMEOUT);
+            if(index == serviceCount) {
+                throw std::runtime_error("The journal is full (" + std::to_string(serviceCount) + " services)");
+            }
+            return index;
+        }
+
+        JournalService & getService(std::uint32_t index) noexcept {
+            return journalServices(m_header)[index];
+        }
+
+        /// Append a transition to the ring and make it the last status of the service
+        ///@return false if the last status was taken over from a writer which died during an update
+        bool append(std::uint32_t serviceId, std::uint8_t os, std::uint8_t hs) noexcept {
+            const std::int64_t monotonicTime = plugincommon::clockNs(CLOCK_MONOTONIC);
+            const std::int64_t wallTime = plugincommon::clockNs(CLOCK_REALTIME);
+
+            //the writers reserve their record, a record is invalid while it is written
+            const std::uint64_t sequence = m_header->nextSequence.fetch_add(1, std::memory_order_relaxed);
+            JournalRecord & record = journalRecords(m_header)[sequence % m_header->recordCount];
+            record.sequence.store(0, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            record.serviceId.store(serviceId, std::memory_order_relaxed);
+            record.operatingStatus.store(os, std::memory_order_relaxed);
+            record.healthState.store(hs, std::memory_order_relaxed);
+            record.monotonicTime.store(monotonicTime, std::memory_order_relaxed);
+            record.wallTime.store(wallTime, std::memory_order_relaxed);
+            record.sequence.store(sequence + 1, std::memory_order_release);
+
+            //seqlock write of the last status, the writers of a service claim the odd sequence in turn,
+            //unless one holds it for STALLED_WRITER_TIMEOUT, for example a previous run of the service killed during an update
+            JournalService & service = getService(serviceId);
+            bool tookOver = false;
+            const std::uint32_t serviceSequence = plugincommon::beginWrite(service.sequence, STALLED_WRITER_TIMEOUT, tookOver);
+            service.operatingStatus.store(os, std::memory_order_relaxed);
+            service.healthState.store(hs, std::memory_order_relaxed);
+            service.monotonicTime.store(monotonicTime, std::memory_order_relaxed);
+            service.wallTime.store(wallTime, std::memory_order_relaxed);
+            plugincommon::endWrite(service.sequence, serviceSequence);
+
+            if(m_settings.sync == SyncPolicy::Update) {
+                syncRange(&record, sizeof(record));
+                syncRange(&service, sizeof(service));
+            } else if(m_settings.sync == SyncPolicy::Group) {
+                m_dirty.store(true, std::memory_order_relaxed);
+            }
+            return !tookOver;
+        }
+
+        /// Get the journal for the settings of the environment, it is mapped once and released with the last provider
+        static std::shared_ptr<Journal> get() {
+            const JournalSettings settings = JournalSettings::fromEnv();
+            return plugincommon::SharedByKey<Journal>::get(settings.key(), [&settings] () { return std::make_shared<Journal>(settings); });
+        }
+    };
+
+    ServiceStatusJournal::ServiceStatusJournal(const char * serviceName)
+        : m_journal(Journal::get()),
+          m_serviceId(m_journal->acquireService(serviceName)),
+          m_service(&m_journal->getService(m_serviceId)),
+          m_operatingStatus(fty::OperatingStatus::Unknown),
+          m_healthState(fty::HealthState::Unknown),
+          m_hasStatus(false)
+    {
+        //a restarted service starts from its last status
+        if(m_service->monotonicTime.load(std::memory_order_acquire) != 0) {
+            m_operatingStatus = static_cast<fty::OperatingStatus>(m_service->operatingStatus.load(std::memory_order_relaxed));
+            m_healthState = static_cast<fty::HealthState>(m_service->healthState.load(std::memory_order_relaxed));
+            m_hasStatus = true;
+        }
+    }
+
+    const char * ServiceStatusJournal::getServiceName() const noexcept {
+        return m_service->serviceName;
+    }
+
+    /// Set the Operating Status
+    ///@param os [in] Operating Status to set
+    ///@return 0, or -EOWNERDEAD if the service was taken over from a writer which died during an update
+    int ServiceStatusJournal::set(fty::OperatingStatus os) noexcept {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return append(os, m_healthState);
+    }
+
+    /// Set the Health State
+    ///@param hs [in] Health state to set
+    ///@return 0, or -EOWNERDEAD if the service was taken over from a writer which died during an update
+    int ServiceStatusJournal::set(fty::HealthState hs) noexcept {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return append(m_operatingStatus, hs);
+    }
+
+    //the mutex must be locked
+    int ServiceStatusJournal::append(fty::OperatingStatus os, fty::HealthState hs) noexcept {
+        if(m_hasStatus && os == m_operatingStatus && hs == m_healthState) {
+            return 0;
+        }
+
+        const bool appended = m_journal->append(m_serviceId, static_cast<std::uint8_t>(os), static_cast<std::uint8_t>(hs));
+        m_operatingStatus = os;
+        m_healthState = hs;
+        m_hasStatus = true;
+        return appended ? 0 : -EOWNERDEAD;
+    }
+
+} //namespace statusjournal
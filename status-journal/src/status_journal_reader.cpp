@@ -0,0 +1,198 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#include "status_journal_reader.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace statusjournal
+{
+    std::string getJournalPath() {
+        const char * path = std::getenv(JOURNAL_PATH_ENV);
+        return (path != nullptr && *path != '\0') ? path : DEFAULT_JOURNAL_PATH;
+    }
+
+    JournalReader::JournalReader(const std::string & path) {
+        int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        if(fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "Impossible to open the journal " + path);
+        }
+
+        struct stat st;
+        if(fstat(fd, &st) != 0) {
+            int error = errno;
+            close(fd);
+            throw std::system_error(error, std::generic_category(), "Impossible to read the journal " + path);
+        }
+        m_size = static_cast<std::size_t>(st.st_size);
+        if(m_size < sizeof(JournalHeader)) {
+            close(fd);
+            throw std::runtime_error("The journal " + path + " is not initialized");
+        }
+
+        void * mapping = mmap(nullptr, m_size, PROT_READ, MAP_SHARED, fd, 0);
+        int error = errno;
+        close(fd);
+        if(mapping == MAP_FAILED) {
+            throw std::system_error(error, std::generic_category(), "Impossible to map the journal " + path);
+        }
+
+        m_header = static_cast<const JournalHeader *>(mapping);
+        if(!isValidJournal(m_header, m_size)) {
+            munmap(mapping, m_size);
+            throw std::runtime_error("Incompatible journal layout in " + path);
+        }
+    }
+
+    JournalReader::~JournalReader() {
+        munmap(const_cast<JournalHeader *>(m_header), m_size);
+    }
+
+    std::uint32_t JournalReader::getRecordCount() const noexcept {
+        return m_header->recordCount;
+    }
+
+    std::uint64_t JournalReader::getNextSequence() const noexcept {
+        return m_header->nextSequence.load(std::memory_order_acquire);
+    }
+
+    std::uint64_t JournalReader::getOldestSequence() const noexcept {
+        const std::uint64_t next = getNextSequence();
+        return (next > m_header->recordCount) ? next - m_header->recordCount : 0;
+    }
+
+    //seqlock read of the last status of a service, waiting at most STALLED_WRITER_TIMEOUT for the same odd sequence
+    bool JournalReader::readService(std::uint32_t index, JournalEntry & entry, bool withName) const {
+        const JournalService & service = journalServices(m_header)[index];
+        if(service.state.load(std::memory_order_acquire) != SERVICE_READY) {
+            return false;
+        }
+        if(withName) {
+            entry.serviceName = service.serviceName;
+        }
+
+        std::uint32_t held = 0;
+        std::chrono::steady_clock::time_point heldSince;
+        for(unsigned attempt = 0; ; attempt++) {
+            const std::uint32_t before = service.sequence.load(std::memory_order_acquire);
+            entry.sequence = 0;
+            entry.operatingStatus = static_cast<fty::OperatingStatus>(service.operatingStatus.load(std::memory_order_relaxed));
+            entry.healthState = static_cast<fty::HealthState>(service.healthState.load(std::memory_order_relaxed));
+            entry.monotonicTime = service.monotonicTime.load(std::memory_order_relaxed);
+            entry.wallTime = service.wallTime.load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if(before % 2 == 0 && service.sequence.load(std::memory_order_relaxed) == before) {
+                entry.stalled = false;
+                return true;
+            }
+
+            //a writer preempted in the middle of an update must get the CPU back
+            if(attempt > 100 && before % 2 != 0) {
+                const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+                if(before != held) {
+                    held = before;
+                    heldSince = now;
+                } else if(now - heldSince >= STALLED_WRITER_TIMEOUT) {
+                    entry.stalled = true;
+                    return true;
+                }
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    bool JournalReader::lastStatus(const std::string & serviceName, JournalEntry & entry) const {
+        const JournalService * services = journalServices(m_header);
+        for(std::uint32_t index = 0; index < m_header->serviceCount; index++) {
+            if(services[index].state.load(std::memory_order_acquire) == SERVICE_READY && serviceName == services[index].serviceName) {
+                entry.serviceName = serviceName;
+                return readService(index, entry, false);
+            }
+        }
+        return false;
+    }
+
+    std::vector<JournalEntry> JournalReader::lastStatuses() const {
+        std::vector<JournalEntry> entries;
+        JournalEntry entry;
+        for(std::uint32_t index = 0; index < m_header->serviceCount; index++) {
+            if(readService(index, entry, true)) {
+                entries.push_back(entry);
+            }
+        }
+        return entries;
+    }
+
+    std::uint64_t JournalReader::read(std::uint64_t from, std::vector<JournalEntry> & entries, std::uint64_t & lost, std::size_t maxCount) const {
+        lost = 0;
+        const std::uint64_t next = getNextSequence();
+        const std::uint64_t oldest = getOldestSequence();
+        if(from < oldest) {
+            lost = oldest - from;
+            from = oldest;
+        }
+
+        const JournalRecord * records = journalRecords(m_header);
+        const JournalService * services = journalServices(m_header);
+        std::size_t count = 0;
+        for(; from < next && count < maxCount; from++) {
+            const JournalRecord & record = records[from % m_header->recordCount];
+
+            JournalEntry entry;
+            entry.sequence = from;
+            const std::uint64_t before = record.sequence.load(std::memory_order_acquire);
+            const std::uint32_t serviceId = record.serviceId.load(std::memory_order_relaxed);
+            entry.operatingStatus = static_cast<fty::OperatingStatus>(record.operatingStatus.load(std::memory_order_relaxed));
+            entry.healthState = static_cast<fty::HealthState>(record.healthState.load(std::memory_order_relaxed));
+            entry.monotonicTime = record.monotonicTime.load(std::memory_order_relaxed);
+            entry.wallTime = record.wallTime.load(std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_acquire);
+            const std::uint64_t after = record.sequence.load(std::memory_order_relaxed);
+
+            if(std::max(before, after) > from + 1) {
+                //overwritten by a newer record
+                lost++;
+                continue;
+            }
+            if(before != after || before != from + 1) {
+                //the writer of this record has not finished yet
+                break;
+            }
+
+            if(serviceId < m_header->serviceCount) {
+                entry.serviceName = services[serviceId].serviceName;
+            }
+            entries.push_back(std::move(entry));
+            count++;
+        }
+        return from;
+    }
+
+} //namespace statusjournal
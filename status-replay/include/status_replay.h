@@ -0,0 +1,162 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#pragma once
+
+#include <fty_service_status.h>
+
+#include <chrono>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace statusreplay
+{
+    /// Status of a service at a time of a trace
+    struct TraceEvent
+    {
+        std::int64_t time = 0;          ///< micro seconds since the start of the trace
+        std::uint32_t service = 0;      ///< index of the service in Trace::services
+        fty::OperatingStatus operatingStatus = fty::OperatingStatus::Unknown;
+        fty::HealthState healthState = fty::HealthState::Unknown;
+    };
+
+    /// Events of the services, ordered by time
+    struct Trace
+    {
+        std::vector<std::string> services;
+        std::vector<TraceEvent> events;
+
+        /// Get the index of a service, added if it is not in the trace
+        std::uint32_t addService(const std::string & serviceName);
+
+        /// Get the time of the last event in micro seconds
+        std::int64_t getDuration() const noexcept;
+    };
+
+    /// Read a trace, one event per line: "time in milli seconds,service,operating status,health state"
+    ///
+    /// The status are the numbers of fty::OperatingStatus and fty::HealthState. The empty lines and the lines
+    /// starting with '#' are skipped, the events are sorted by time keeping the order of the events at the same time.
+    ///@param input [in] stream to read
+    ///@return the trace
+    ///@throw std::runtime_error with the number of the first invalid line
+    Trace readTrace(std::istream & input);
+
+    /// Read a trace from a file, see readTrace(std::istream &)
+    ///@throw std::system_error if the file cannot be opened, std::runtime_error if a line is invalid
+    Trace readTrace(const std::string & path);
+
+    /// Write a trace in the format of readTrace
+    void writeTrace(std::ostream & output, const Trace & trace);
+
+    /// Read the transitions recorded by the journal plugin, the times are relative to the oldest one
+    ///@param journalPath [in] path of the journal
+    ///@throw std::system_error if the journal does not exist, std::runtime_error if its layout is not supported
+    Trace readJournalTrace(const std::string & journalPath);
+
+    /// Kind of synthetic trace
+    enum class Storm
+    {
+        Restart,    ///< every service goes Stopping, Stopped, Starting then InService in each cycle
+        Flapping    ///< every service stays InService and its Health State alternates Ok and Warning
+    };
+
+    /// Settings of a synthetic trace
+    struct StormSettings
+    {
+        Storm storm = Storm::Restart;
+        unsigned services = 100;
+        /// Number of restarts or health changes of each service
+        unsigned cycles = 1;
+        /// Duration of one cycle, the transitions of a service are spread at random times of the cycle
+        std::chrono::milliseconds period {1000};
+        /// Seed of the random times, the same seed gives the same trace
+        unsigned seed = 1;
+    };
+
+    /// Generate a synthetic trace
+    ///
+    /// The services are named "service-<index>" and start InService with a Health State Ok.
+    ///@throw std::invalid_argument if there is no service, no cycle or the period is not positive
+    Trace generateTrace(const StormSettings & settings);
+
+    /// Settings of a replay
+    struct ReplaySettings
+    {
+        /// Speed of the replay: 1 at the times of the trace, 10 ten times faster, 0 as fast as possible
+        double speed = 1.0;
+        /// Number of threads calling the plugins, all the events of a service are replayed by the same thread
+        unsigned threads = 1;
+    };
+
+    /// Percentiles of a distribution of durations
+    struct Percentiles
+    {
+        std::chrono::nanoseconds p50 {0};
+        std::chrono::nanoseconds p90 {0};
+        std::chrono::nanoseconds p99 {0};
+        std::chrono::nanoseconds max {0};
+    };
+
+    /// Result of the calls to one plugin, summed over the services
+    struct PluginReport
+    {
+        std::string pluginName;
+        std::uint64_t calls = 0;
+        std::uint64_t errors = 0;
+        std::string lastError;
+        /// Percentiles of the duration of the calls, rounded up to the limits of fty::PluginStats::latencyHistogram
+        Percentiles latency;
+
+        double getErrorRate() const noexcept { return calls != 0 ? double(errors) / double(calls) : 0.0; }
+    };
+
+    /// Result of a replay
+    struct ReplayReport
+    {
+        std::uint64_t events = 0;
+        /// Number of calls to setForAll, an event only sets the values which changed for its service
+        std::uint64_t updates = 0;
+        std::chrono::nanoseconds duration {0};
+        /// Duration of the setForAll of an event
+        Percentiles eventLatency;
+        /// Delay of the replay of an event after its time in the trace, 0 when replayed as fast as possible
+        Percentiles lag;
+        /// Plugins sorted by name
+        std::vector<PluginReport> plugins;
+
+        /// Get the number of events replayed per second
+        double getThroughput() const noexcept;
+    };
+
+    /// Replay a trace against the plugins of a folder
+    ///
+    /// Each service of the trace has its fty::ServiceStatusPluginWrapperCollection loaded by addAll, so the plugins
+    /// receive the updates as in the services. The collections are loaded before the start of the replay.
+    ///@param trace [in] trace to replay
+    ///@param folderPath [in] folder of the plugins
+    ///@param globPattern [in] pattern of the plugin files
+    ///@param settings [in] speed and threads of the replay
+    ///@return the statistics of the replay and of each plugin
+    ///@throw std::invalid_argument if the settings are invalid, std::runtime_error if no plugin could be loaded
+    ReplayReport replay(const Trace & trace, const std::string & folderPath, const std::string & globPattern = "*.so",
+                        const ReplaySettings & settings = ReplaySettings());
+
+} //namespace statusreplay
@@ -0,0 +1,417 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#include "status_replay.h"
+
+#include <status_journal_reader.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <istream>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <random>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+
+namespace statusreplay
+{
+    using Clock = std::chrono::steady_clock;
+
+    std::uint32_t Trace::addService(const std::string & serviceName) {
+        auto it = std::find(services.begin(), services.end(), serviceName);
+        if(it != services.end()) {
+            return static_cast<std::uint32_t>(it - services.begin());
+        }
+        services.push_back(serviceName);
+        return static_cast<std::uint32_t>(services.size() - 1);
+    }
+
+    std::int64_t Trace::getDuration() const noexcept {
+        return events.empty() ? 0 : events.back().time;
+    }
+
+    //index of the services by name, to build a trace without a linear search per event
+    class ServiceIndex
+    {
+        private:
+        Trace & m_trace;
+        std::unordered_map<std::string, std::uint32_t> m_indexes;
+
+        public:
+        explicit ServiceIndex(Trace & trace) : m_trace(trace) {}
+
+        std::uint32_t get(const std::string & serviceName) {
+            auto inserted = m_indexes.emplace(serviceName, static_cast<std::uint32_t>(m_trace.services.size()));
+            if(inserted.second) {
+                m_trace.services.push_back(serviceName);
+            }
+            return inserted.first->second;
+        }
+    };
+
+    static void sortByTime(Trace & trace) {
+        std::stable_sort(trace.events.begin(), trace.events.end(), [](const TraceEvent & a, const TraceEvent & b) {
+            return a.time < b.time;
+        });
+    }
+
+    static bool parseNumber(const std::string & field, unsigned long & value) {
+        if(field.empty()) {
+            return false;
+        }
+        char * end = nullptr;
+        errno = 0;
+        value = std::strtoul(field.c_str(), &end, 10);
+        return errno == 0 && *end == '\0' && field[0] != '-';
+    }
+
+    static void parseEvent(const std::string & line, ServiceIndex & services, TraceEvent & event) {
+        std::string fields[4];
+        std::size_t start = 0;
+        for(std::size_t i = 0; i < 4; i++) {
+            std::size_t comma = line.find(',', start);
+            if((comma == std::string::npos) != (i == 3)) {
+                throw std::runtime_error("4 fields expected");
+            }
+            fields[i] = line.substr(start, comma - start);
+            start = comma + 1;
+        }
+
+        char * end = nullptr;
+        const double time = std::strtod(fields[0].c_str(), &end);
+        if(fields[0].empty() || *end != '\0' || !(time >= 0.0) || time > 1e15) {
+            throw std::runtime_error("invalid time '" + fields[0] + "'");
+        }
+        if(fields[1].empty()) {
+            throw std::runtime_error("empty service name");
+        }
+
+        unsigned long operatingStatus = 0;
+        if(!parseNumber(fields[2], operatingStatus) || operatingStatus > static_cast<unsigned long>(fty::OperatingStatus::InService)) {
+            throw std::runtime_error("invalid operating status '" + fields[2] + "'");
+        }
+        unsigned long healthState = 0;
+        if(!parseNumber(fields[3], healthState) || healthState % 5 != 0
+            || healthState > static_cast<unsigned long>(fty::HealthState::NonRecoverableFailure)) {
+            throw std::runtime_error("invalid health state '" + fields[3] + "'");
+        }
+
+        event.time = std::llround(time * 1000.0);
+        event.service = services.get(fields[1]);
+        event.operatingStatus = static_cast<fty::OperatingStatus>(operatingStatus);
+        event.healthState = static_cast<fty::HealthState>(healthState);
+    }
+
+    Trace readTrace(std::istream & input) {
+        Trace trace;
+        ServiceIndex services(trace);
+        std::string line;
+        for(unsigned lineNumber = 1; std::getline(input, line); lineNumber++) {
+            if(!line.empty() && line.back() == '\r') {
+                line.pop_back();
+            }
+            if(line.empty() || line[0] == '#') {
+                continue;
+            }
+
+            TraceEvent event;
+            try {
+                parseEvent(line, services, event);
+            }
+            catch(const std::runtime_error & e) {
+                throw std::runtime_error("Invalid event at line " + std::to_string(lineNumber) + ": " + e.what());
+            }
+            trace.events.push_back(event);
+        }
+        sortByTime(trace);
+        return trace;
+    }
+
+    Trace readTrace(const std::string & path) {
+        std::ifstream input(path);
+        if(!input) {
+            throw std::system_error(errno, std::generic_category(), "Impossible to open the trace " + path);
+        }
+        return readTrace(input);
+    }
+
+    void writeTrace(std::ostream & output, const Trace & trace) {
+        output << "# time ms,service,operating status,health state\n";
+        char time[32];
+        for(const TraceEvent & event : trace.events) {
+            std::snprintf(time, sizeof(time), "%lld.%03lld", static_cast<long long>(event.time / 1000), static_cast<long long>(event.time % 1000));
+            output << time << ',' << trace.services.at(event.service) << ',' << static_cast<unsigned>(event.operatingStatus)
+                   << ',' << static_cast<unsigned>(event.healthState) << '\n';
+        }
+        output.flush();
+    }
+
+    Trace readJournalTrace(const std::string & journalPath) {
+        statusjournal::JournalReader reader(journalPath);
+        std::vector<statusjournal::JournalEntry> entries;
+        std::uint64_t next = reader.getOldestSequence();
+        while(true) {
+            std::uint64_t lost = 0;
+            const std::size_t count = entries.size();
+            next = reader.read(next, entries, lost, 4096);
+            if(entries.size() == count) {
+                break;
+            }
+        }
+
+        Trace trace;
+        ServiceIndex services(trace);
+        trace.events.reserve(entries.size());
+        for(const statusjournal::JournalEntry & entry : entries) {
+            TraceEvent event;
+            event.time = (entry.monotonicTime - entries.front().monotonicTime) / 1000;
+            event.service = services.get(entry.serviceName);
+            event.operatingStatus = entry.operatingStatus;
+            event.healthState = entry.healthState;
+            trace.events.push_back(event);
+        }
+        sortByTime(trace);
+        return trace;
+    }
+
+    Trace generateTrace(const StormSettings & settings) {
+        const std::int64_t period = std::chrono::duration_cast<std::chrono::microseconds>(settings.period).count();
+        if(settings.services == 0 || settings.cycles == 0 || period <= 0) {
+            throw std::invalid_argument("A storm needs services, cycles and a positive period");
+        }
+
+        Trace trace;
+        trace.services.reserve(settings.services);
+        for(unsigned service = 0; service < settings.services; service++) {
+            trace.services.push_back("service-" + std::to_string(service));
+            trace.events.push_back({0, service, fty::OperatingStatus::InService, fty::HealthState::Ok});
+        }
+
+        std::mt19937 random(settings.seed);
+        std::uniform_int_distribution<std::int64_t> offset(0, period - 1);
+        for(unsigned cycle = 0; cycle < settings.cycles; cycle++) {
+            const std::int64_t start = cycle * period;
+            for(unsigned service = 0; service < settings.services; service++) {
+                if(settings.storm == Storm::Restart) {
+                    std::int64_t times[4];
+                    for(std::int64_t & time : times) {
+                        time = start + offset(random);
+                    }
+                    std::sort(std::begin(times), std::end(times));
+                    trace.events.push_back({times[0], service, fty::OperatingStatus::Stopping, fty::HealthState::Ok});
+                    trace.events.push_back({times[1], service, fty::OperatingStatus::Stopped, fty::HealthState::Unknown});
+                    trace.events.push_back({times[2], service, fty::OperatingStatus::Starting, fty::HealthState::Unknown});
+                    trace.events.push_back({times[3], service, fty::OperatingStatus::InService, fty::HealthState::Ok});
+                }
+                else {
+                    const fty::HealthState healthState = (cycle % 2 == 0) ? fty::HealthState::Warning : fty::HealthState::Ok;
+                    trace.events.push_back({start + offset(random), service, fty::OperatingStatus::InService, healthState});
+                }
+            }
+        }
+        sortByTime(trace);
+        return trace;
+    }
+
+    double ReplayReport::getThroughput() const noexcept {
+        return duration.count() > 0 ? double(events) * 1e9 / double(duration.count()) : 0.0;
+    }
+
+    //nearest-rank percentiles of a list of durations in nano seconds
+    static Percentiles getPercentiles(std::vector<std::int64_t> & durations) {
+        Percentiles percentiles;
+        if(durations.empty()) {
+            return percentiles;
+        }
+        std::sort(durations.begin(), durations.end());
+        auto rank = [&durations](double percentile) {
+            std::size_t index = static_cast<std::size_t>(std::ceil(percentile * double(durations.size())));
+            return std::chrono::nanoseconds(durations[std::max<std::size_t>(index, 1) - 1]);
+        };
+        percentiles.p50 = rank(0.50);
+        percentiles.p90 = rank(0.90);
+        percentiles.p99 = rank(0.99);
+        percentiles.max = std::chrono::nanoseconds(durations.back());
+        return percentiles;
+    }
+
+    //percentiles of a latency histogram, as the upper bound of the bucket holding the rank
+    static Percentiles getPercentiles(const std::array<std::uint64_t, fty::LATENCY_BUCKET_COUNT> & histogram, std::uint64_t calls) {
+        Percentiles percentiles;
+        auto rank = [&histogram, calls](double percentile) {
+            const std::uint64_t target = std::max<std::uint64_t>(static_cast<std::uint64_t>(std::ceil(percentile * double(calls))), 1);
+            std::uint64_t count = 0;
+            for(std::size_t bucket = 0; bucket < histogram.size(); bucket++) {
+                count += histogram[bucket];
+                if(count >= target) {
+                    return fty::PluginStats::getBucketUpperBound(bucket);
+                }
+            }
+            return std::chrono::nanoseconds(0);
+        };
+        if(calls != 0) {
+            percentiles.p50 = rank(0.50);
+            percentiles.p90 = rank(0.90);
+            percentiles.p99 = rank(0.99);
+            percentiles.max = rank(1.0);
+        }
+        return percentiles;
+    }
+
+    //durations measured by one replay thread
+    struct WorkerResult
+    {
+        std::vector<std::int64_t> latencies;
+        std::vector<std::int64_t> lags;
+        std::uint64_t updates = 0;
+    };
+
+    using Collection = fty::ServiceStatusPluginWrapperCollection;
+
+    static void replayEvents(const Trace & trace, const std::vector<std::uint32_t> & events,
+                             std::vector<std::unique_ptr<Collection>> & collections, double speed,
+                             Clock::time_point start, WorkerResult & result) {
+        //the last status set for each service, the first event of a service sets both values
+        struct LastStatus
+        {
+            bool set = false;
+            fty::OperatingStatus operatingStatus = fty::OperatingStatus::Unknown;
+            fty::HealthState healthState = fty::HealthState::Unknown;
+        };
+        std::vector<LastStatus> lastStatuses(trace.services.size());
+
+        result.latencies.reserve(events.size());
+        if(speed > 0.0) {
+            result.lags.reserve(events.size());
+        }
+
+        std::this_thread::sleep_until(start);
+        for(std::uint32_t index : events) {
+            const TraceEvent & event = trace.events[index];
+            if(speed > 0.0) {
+                const Clock::time_point scheduled = start + std::chrono::nanoseconds(static_cast<std::int64_t>(double(event.time) * 1000.0 / speed));
+                std::this_thread::sleep_until(scheduled);
+                result.lags.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - scheduled).count());
+            }
+
+            LastStatus & last = lastStatuses[event.service];
+            Collection & collection = *collections[event.service];
+            const Clock::time_point begin = Clock::now();
+            if(!last.set || last.operatingStatus != event.operatingStatus) {
+                collection.setForAll(event.operatingStatus);
+                result.updates++;
+            }
+            if(!last.set || last.healthState != event.healthState) {
+                collection.setForAll(event.healthState);
+                result.updates++;
+            }
+            result.latencies.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count());
+            last = {true, event.operatingStatus, event.healthState};
+        }
+    }
+
+    ReplayReport replay(const Trace & trace, const std::string & folderPath, const std::string & globPattern, const ReplaySettings & settings) {
+        if(!(settings.speed >= 0.0) || std::isinf(settings.speed) || settings.threads == 0) {
+            throw std::invalid_argument("The replay needs a finite speed and at least one thread");
+        }
+
+        //the plugins are loaded before the replay, as in running services
+        std::vector<std::unique_ptr<Collection>> collections;
+        collections.reserve(trace.services.size());
+        for(const std::string & serviceName : trace.services) {
+            std::unique_ptr<Collection> collection(new Collection(serviceName));
+            const std::vector<fty::PluginLoadResult> results = collection->addAllWithReport(folderPath, globPattern);
+            if(std::none_of(results.begin(), results.end(), [](const fty::PluginLoadResult & result) { return result.added; })) {
+                std::string error = "No plugin matching " + globPattern + " could be loaded from " + folderPath;
+                if(!results.empty()) {
+                    error += ": " + results.front().path + ": " + results.front().error;
+                }
+                throw std::runtime_error(error);
+            }
+            collections.push_back(std::move(collection));
+        }
+
+        //each thread replays the events of its services, in the order of the trace
+        const unsigned threadCount = std::max(1u, std::min<unsigned>(settings.threads, static_cast<unsigned>(trace.services.size())));
+        std::vector<std::vector<std::uint32_t>> events(threadCount);
+        for(std::size_t index = 0; index < trace.events.size(); index++) {
+            events[trace.events[index].service % threadCount].push_back(static_cast<std::uint32_t>(index));
+        }
+
+        std::vector<WorkerResult> results(threadCount);
+        std::vector<std::thread> threads;
+        const Clock::time_point start = Clock::now() + std::chrono::milliseconds(10);
+        for(unsigned t = 0; t < threadCount; t++) {
+            threads.emplace_back(replayEvents, std::cref(trace), std::cref(events[t]), std::ref(collections),
+                                 settings.speed, start, std::ref(results[t]));
+        }
+        for(std::thread & thread : threads) {
+            thread.join();
+        }
+
+        ReplayReport report;
+        report.events = trace.events.size();
+        report.duration = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+
+        std::vector<std::int64_t> latencies;
+        std::vector<std::int64_t> lags;
+        latencies.reserve(trace.events.size());
+        for(const WorkerResult & result : results) {
+            latencies.insert(latencies.end(), result.latencies.begin(), result.latencies.end());
+            lags.insert(lags.end(), result.lags.begin(), result.lags.end());
+            report.updates += result.updates;
+        }
+        report.eventLatency = getPercentiles(latencies);
+        report.lag = getPercentiles(lags);
+
+        //the statistics of the plugins are summed over the services
+        std::map<std::string, fty::PluginStats> plugins;
+        for(const std::unique_ptr<Collection> & collection : collections) {
+            for(const fty::PluginStats & stats : collection->getPluginStats()) {
+                fty::PluginStats & total = plugins[stats.pluginName];
+                total.calls += stats.calls;
+                total.errors += stats.errors;
+                if(!stats.lastError.empty()) {
+                    total.lastError = stats.lastError;
+                }
+                for(std::size_t bucket = 0; bucket < fty::LATENCY_BUCKET_COUNT; bucket++) {
+                    total.latencyHistogram[bucket] += stats.latencyHistogram[bucket];
+                }
+            }
+        }
+        for(const auto & plugin : plugins) {
+            PluginReport pluginReport;
+            pluginReport.pluginName = plugin.first;
+            pluginReport.calls = plugin.second.calls;
+            pluginReport.errors = plugin.second.errors;
+            pluginReport.lastError = plugin.second.lastError;
+            pluginReport.latency = getPercentiles(plugin.second.latencyHistogram, plugin.second.calls);
+            report.plugins.push_back(std::move(pluginReport));
+        }
+        return report;
+    }
+
+} //namespace statusreplay
@@ -0,0 +1,194 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#include "status_replay.h"
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <unistd.h>
+
+static int usage(const char * program, int result) {
+    std::cerr << "Usage: " << program << " (-t trace | -J journal | -g storm) [options] [plugin folder [pattern]]" << std::endl
+              << "Replay a trace of status against the plugins of a folder matching the pattern (default *.so)," << std::endl
+              << "then print the throughput, the latency percentiles and the error rate of each plugin." << std::endl
+              << "  -t <file>   read the trace, one \"time ms,service,operating status,health state\" per line, - for stdin" << std::endl
+              << "  -J <path>   replay the transitions recorded in a journal" << std::endl
+              << "  -g <storm>  generate a storm: restart or flapping" << std::endl
+              << "  -n <count>  number of services of the storm (100)" << std::endl
+              << "  -c <count>  number of restarts or health changes of each service of the storm (1)" << std::endl
+              << "  -p <ms>     duration of one cycle of the storm (1000)" << std::endl
+              << "  -r <seed>   seed of the storm (1)" << std::endl
+              << "  -s <speed>  speed of the replay, 1 at the times of the trace, 0 as fast as possible (1)" << std::endl
+              << "  -w <count>  number of threads calling the plugins (1)" << std::endl
+              << "  -e <rate>   maximum error rate of a plugin before failing with the exit code 2 (0)" << std::endl
+              << "  -o <file>   write the trace to a file, it is not replayed without plugin folder" << std::endl;
+    return result;
+}
+
+static std::string formatDuration(std::chrono::nanoseconds duration) {
+    if(duration == std::chrono::nanoseconds::max()) {
+        return "inf";
+    }
+    const double ns = double(duration.count());
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(1);
+    if(ns < 1e3) {
+        text << ns << "ns";
+    }
+    else if(ns < 1e6) {
+        text << ns / 1e3 << "us";
+    }
+    else if(ns < 1e9) {
+        text << ns / 1e6 << "ms";
+    }
+    else {
+        text << ns / 1e9 << "s";
+    }
+    return text.str();
+}
+
+static void printPercentiles(const statusreplay::Percentiles & percentiles) {
+    std::cout << std::setw(12) << formatDuration(percentiles.p50) << std::setw(12) << formatDuration(percentiles.p90)
+              << std::setw(12) << formatDuration(percentiles.p99) << formatDuration(percentiles.max) << std::endl;
+}
+
+static void printReport(const statusreplay::ReplayReport & report, std::size_t services) {
+    std::cout << "Replayed " << report.events << " events (" << report.updates << " updates) of " << services
+              << " services in " << std::fixed << std::setprecision(3) << double(report.duration.count()) / 1e9
+              << " s: " << std::setprecision(0) << report.getThroughput() << " events/s" << std::endl << std::endl;
+
+    std::cout << std::left << std::setw(40) << "" << std::setw(12) << "P50" << std::setw(12) << "P90"
+              << std::setw(12) << "P99" << "MAX" << std::endl;
+    std::cout << std::setw(40) << "event latency";
+    printPercentiles(report.eventLatency);
+    //no lag when replayed as fast as possible
+    if(report.lag.max.count() != 0) {
+        std::cout << std::setw(40) << "event lag";
+        printPercentiles(report.lag);
+    }
+    std::cout << std::endl;
+
+    std::cout << std::setw(40) << "PLUGIN" << std::setw(12) << "CALLS" << std::setw(12) << "ERRORS" << std::setw(12) << "ERROR RATE"
+              << std::setw(12) << "P50" << std::setw(12) << "P90" << std::setw(12) << "P99" << "MAX" << std::endl;
+    for(const statusreplay::PluginReport & plugin : report.plugins) {
+        std::cout << std::setw(40) << plugin.pluginName << std::setw(12) << plugin.calls << std::setw(12) << plugin.errors
+                  << std::setw(12) << std::setprecision(4) << plugin.getErrorRate();
+        printPercentiles(plugin.latency);
+        if(!plugin.lastError.empty()) {
+            std::cout << "    last error: " << plugin.lastError << std::endl;
+        }
+    }
+}
+
+int main(int argc, char * argv[]) {
+    std::string tracePath;
+    std::string journalPath;
+    std::string storm;
+    std::string outputPath;
+    statusreplay::StormSettings stormSettings;
+    statusreplay::ReplaySettings replaySettings;
+    double maxErrorRate = 0.0;
+
+    int option;
+    try {
+        while((option = getopt(argc, argv, "t:J:g:n:c:p:r:s:w:e:o:h")) != -1) {
+            switch(option) {
+                case 't': tracePath = optarg; break;
+                case 'J': journalPath = optarg; break;
+                case 'g': storm = optarg; break;
+                case 'n': stormSettings.services = static_cast<unsigned>(std::stoul(optarg)); break;
+                case 'c': stormSettings.cycles = static_cast<unsigned>(std::stoul(optarg)); break;
+                case 'p': stormSettings.period = std::chrono::milliseconds(std::stoul(optarg)); break;
+                case 'r': stormSettings.seed = static_cast<unsigned>(std::stoul(optarg)); break;
+                case 's': replaySettings.speed = std::stod(optarg); break;
+                case 'w': replaySettings.threads = static_cast<unsigned>(std::stoul(optarg)); break;
+                case 'e': maxErrorRate = std::stod(optarg); break;
+                case 'o': outputPath = optarg; break;
+                case 'h': return usage(argv[0], 0);
+                default: return usage(argv[0], 1);
+            }
+        }
+    }
+    catch(const std::logic_error &) {
+        return usage(argv[0], 1);
+    }
+
+    const int sources = !tracePath.empty() + !journalPath.empty() + !storm.empty();
+    const int arguments = argc - optind;
+    if(sources != 1 || arguments > 2 || (arguments == 0 && outputPath.empty())) {
+        return usage(argv[0], 1);
+    }
+    if(!storm.empty()) {
+        if(storm == "restart") {
+            stormSettings.storm = statusreplay::Storm::Restart;
+        }
+        else if(storm == "flapping") {
+            stormSettings.storm = statusreplay::Storm::Flapping;
+        }
+        else {
+            return usage(argv[0], 1);
+        }
+    }
+
+    try {
+        statusreplay::Trace trace;
+        if(tracePath == "-") {
+            trace = statusreplay::readTrace(std::cin);
+        }
+        else if(!tracePath.empty()) {
+            trace = statusreplay::readTrace(tracePath);
+        }
+        else if(!journalPath.empty()) {
+            trace = statusreplay::readJournalTrace(journalPath);
+        }
+        else {
+            trace = statusreplay::generateTrace(stormSettings);
+        }
+
+        if(!outputPath.empty()) {
+            std::ofstream output(outputPath);
+            statusreplay::writeTrace(output, trace);
+            if(!output) {
+                std::cerr << "Impossible to write the trace " << outputPath << std::endl;
+                return 1;
+            }
+        }
+        if(arguments == 0) {
+            return 0;
+        }
+
+        const std::string pattern = (arguments == 2) ? argv[optind + 1] : "*.so";
+        statusreplay::ReplayReport report = statusreplay::replay(trace, argv[optind], pattern, replaySettings);
+        printReport(report, trace.services.size());
+
+        for(const statusreplay::PluginReport & plugin : report.plugins) {
+            if(plugin.getErrorRate() > maxErrorRate) {
+                return 2;
+            }
+        }
+    }
+    catch(const std::exception & e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,131 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#pragma once
+
+#include "status_socket_protocol.h"
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace statussocket
+{
+    /// Status of a service known by the aggregator
+    struct AggregatorEntry
+    {
+        std::string serviceName;
+        fty::OperatingStatus operatingStatus = fty::OperatingStatus::Unknown;
+        fty::HealthState healthState = fty::HealthState::Unknown;
+        std::uint64_t updateTime = 0;   ///< CLOCK_REALTIME of the last update in nano seconds
+        std::uint32_t pid = 0;          ///< process which sent the last update
+        std::uint64_t updates = 0;      ///< number of datagrams received for the service
+    };
+
+    /// Counters of the aggregator
+    struct AggregatorStats
+    {
+        /// Number of valid datagrams received
+        std::uint64_t received = 0;
+        /// Number of datagrams which are not status messages
+        std::uint64_t invalid = 0;
+        /// Number of calls to recvmmsg which returned datagrams
+        std::uint64_t batches = 0;
+        /// Number of snapshots served on the query socket
+        std::uint64_t queries = 0;
+    };
+
+    /// Receiver of the status datagrams of the services of the host
+    ///
+    /// A thread drains the socket by batches with recvmmsg and keeps the current status of each service.
+    /// The snapshots are read in the process, or by other processes on the query socket
+    /// "<socket path>.query": a client connects and reads one line per service, see querySnapshot.
+    class Aggregator
+    {
+        private:
+        std::string m_socketPath;
+        std::string m_queryPath;
+        int m_socket = -1;
+        int m_query = -1;
+        int m_stop[2] = {-1, -1};
+
+        mutable std::mutex m_mutex;
+        std::unordered_map<std::string, AggregatorEntry> m_entries;
+        AggregatorStats m_stats;
+        std::string m_key;      //reused to find the services without allocation
+
+        std::thread m_thread;
+
+        void receive();
+        void serveQuery();
+        void run() noexcept;
+        void closeAll() noexcept;
+
+        public:
+        /// Number of datagrams received by one call to recvmmsg
+        static const unsigned BATCH_SIZE = 64;
+
+        /// Bind the sockets and start the thread
+        ///
+        /// A socket file left by a previous aggregator is replaced.
+        ///@param socketPath [in] path of the datagram socket
+        ///@param receiveBuffer [in] size of the receive buffer of the socket in bytes, 0 to keep the system default
+        ///@throw std::system_error if a socket cannot be created
+        explicit Aggregator(const std::string & socketPath = statussocket::getSocketPath(), int receiveBuffer = 0);
+
+        /// Stop the thread and remove the socket files
+        ~Aggregator();
+
+        Aggregator(const Aggregator &) = delete;
+        Aggregator & operator = (const Aggregator &) = delete;
+
+        /// Get the path of the datagram socket
+        const std::string & getSocketPath() const noexcept { return m_socketPath; }
+
+        /// Get the path of the query socket
+        const std::string & getQueryPath() const noexcept { return m_queryPath; }
+
+        /// Get the status of every service, sorted by name
+        ///@param entries [out] filled with one entry per service
+        ///@return the number of services
+        std::size_t snapshot(std::vector<AggregatorEntry> & entries) const;
+
+        /// Get the status of every service, sorted by name
+        std::vector<AggregatorEntry> snapshot() const;
+
+        /// Get the status of one service
+        ///@param serviceName [in] name of the service
+        ///@param entry [out] status of the service
+        ///@return true if the service sent its status
+        bool find(const std::string & serviceName, AggregatorEntry & entry) const;
+
+        /// Get the counters of the aggregator
+        AggregatorStats getStats() const;
+    };
+
+    /// Read the snapshot served by an aggregator, possibly in another process
+    ///@param socketPath [in] path of the datagram socket of the aggregator
+    ///@return the status of every service, sorted by name
+    ///@throw std::system_error if the aggregator cannot be reached
+    std::vector<AggregatorEntry> querySnapshot(const std::string & socketPath = getSocketPath());
+
+} //namespace statussocket
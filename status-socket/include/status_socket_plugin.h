@@ -0,0 +1,82 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#pragma once
+
+#include "status_socket_protocol.h"
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+//public interfaces
+extern "C"
+{
+    const char * getPluginName();
+    const char * getPluginLastError();
+    int createServiceStatusProvider(fty::ServiceStatusProvider** spp, const char * serviceName);
+    void deleteServiceStatusProvider(fty::ServiceStatusProvider* spp);
+}
+
+//counters of the plugin, resolved with dlsym by the monitoring, the tests and the benchmarks
+extern "C"
+{
+    /// Get the number of datagrams sent since the plugin was loaded
+    std::uint64_t statusSocketGetSentCount();
+
+    /// Get the number of datagrams dropped since the plugin was loaded, because the socket was full or unreachable
+    std::uint64_t statusSocketGetDroppedCount();
+}
+
+namespace statussocket
+{
+    class Sender;
+
+    //provider sending the status of a service to the aggregator
+    //set() may be called from several threads: the status are atomic and each call builds its datagram on the stack
+    //from the message prepared by the constructor, which is not changed after.
+    class ServiceStatusSocket : public fty::ServiceStatusProvider
+    {
+        private:
+        std::shared_ptr<Sender> m_sender;
+        StatusMessage m_message;
+        std::atomic<std::uint8_t> m_operatingStatus;
+        std::atomic<std::uint8_t> m_healthState;
+        char m_serviceName[SERVICE_NAME_SIZE];
+
+        int send() noexcept;
+
+        public:
+        ServiceStatusSocket(const char * serviceName);
+
+        /// Get the service name
+        ///@return  service name
+        const char * getServiceName() const noexcept override;
+
+        /// Set the Operating Status
+        ///@param os [in] Operating Status to set
+        ///@return 0 if the status was sent or dropped because the socket is full, -1 if the aggregator is unreachable
+        int set(fty::OperatingStatus os) noexcept override;
+
+        /// Set the Health State
+        ///@param hs [in] Health state to set
+        ///@return 0 if the status was sent or dropped because the socket is full, -1 if the aggregator is unreachable
+        int set(fty::HealthState hs) noexcept override;
+    };
+
+} //namespace statussocket
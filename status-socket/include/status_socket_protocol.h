@@ -0,0 +1,82 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#pragma once
+
+//Datagrams sent by the status socket plugin to the aggregator
+
+#include <fty_service_status.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+namespace statussocket
+{
+    /// Environment variable giving the path of the socket of the aggregator
+    static const char * const SOCKET_PATH_ENV = "FTY_SERVICE_STATUS_SOCKET";
+    /// Path of the socket used when FTY_SERVICE_STATUS_SOCKET is not set
+    static const char * const DEFAULT_SOCKET_PATH = "/run/fty-service-status/aggregator.sock";
+    /// Suffix of the stream socket on which the aggregator serves its snapshots
+    static const char * const QUERY_SOCKET_SUFFIX = ".query";
+
+    static const std::uint32_t MESSAGE_MAGIC = 0x46535341; // "FSSA"
+    static const std::uint8_t MESSAGE_VERSION = 1;
+    static const std::size_t SERVICE_NAME_SIZE = 64;
+
+    /// Status of one service, sent in one datagram
+    ///
+    /// Each datagram carries the whole status of the service, so the next one repairs a dropped datagram.
+    /// Only the bytes of the name are sent after the header: the datagram has between 25 and 87 bytes.
+    struct StatusMessage
+    {
+        std::uint32_t magic;
+        std::uint8_t version;
+        std::uint8_t operatingStatus;
+        std::uint8_t healthState;
+        std::uint8_t nameLength;        ///< between 1 and SERVICE_NAME_SIZE - 1
+        std::uint32_t pid;              ///< process of the service
+        std::uint32_t reserved;
+        std::uint64_t updateTime;       ///< CLOCK_REALTIME of the update in nano seconds
+        char serviceName[SERVICE_NAME_SIZE];    ///< not null terminated in the datagram
+    };
+
+    static const std::size_t MESSAGE_HEADER_SIZE = offsetof(StatusMessage, serviceName);
+    static_assert(MESSAGE_HEADER_SIZE == 24, "The header of the status message must have a fixed size");
+
+    /// Get the size of the datagram of a message
+    inline std::size_t messageSize(const StatusMessage & message) noexcept {
+        return MESSAGE_HEADER_SIZE + message.nameLength;
+    }
+
+    /// Check a datagram received by the aggregator
+    ///@param message [in] datagram, the buffer has SERVICE_NAME_SIZE bytes for the name
+    ///@param size [in] size of the datagram
+    inline bool isValidMessage(const StatusMessage & message, std::size_t size) noexcept {
+        return size > MESSAGE_HEADER_SIZE && message.magic == MESSAGE_MAGIC && message.version == MESSAGE_VERSION
+            && message.nameLength > 0 && message.nameLength < SERVICE_NAME_SIZE && size == messageSize(message);
+    }
+
+    /// Get the path of the socket from FTY_SERVICE_STATUS_SOCKET or the default one
+    inline std::string getSocketPath() {
+        const char * path = std::getenv(SOCKET_PATH_ENV);
+        return (path != nullptr && *path != '\0') ? path : DEFAULT_SOCKET_PATH;
+    }
+
+} //namespace statussocket
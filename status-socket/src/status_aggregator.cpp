@@ -0,0 +1,320 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#include "status_aggregator.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace statussocket
+{
+    //fill the address of a socket file
+    static socklen_t makeAddress(const std::string & path, struct sockaddr_un & address) {
+        std::memset(&address, 0, sizeof(address));
+        if(path.empty() || path.size() >= sizeof(address.sun_path)) {
+            throw std::invalid_argument("Invalid path of the aggregator socket <" + path + ">");
+        }
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        return static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + path.size() + 1);
+    }
+
+    //create a socket bound to a path, a previous socket file is replaced
+    static int bindSocket(const std::string & path, int type) {
+        struct sockaddr_un address;
+        const socklen_t length = makeAddress(path, address);
+
+        int fd = socket(AF_UNIX, type | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if(fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "Impossible to create the socket " + path);
+        }
+
+        unlink(path.c_str());
+        if(bind(fd, reinterpret_cast<const struct sockaddr *>(&address), length) != 0
+            || (type == SOCK_STREAM && listen(fd, 16) != 0)) {
+            const int error = errno;
+            close(fd);
+            throw std::system_error(error, std::generic_category(), "Impossible to bind the socket " + path);
+        }
+        return fd;
+    }
+
+    static void setTimeout(int fd, int option, int milliseconds) noexcept {
+        struct timeval timeout = {milliseconds / 1000, (milliseconds % 1000) * 1000};
+        setsockopt(fd, SOL_SOCKET, option, &timeout, sizeof(timeout));
+    }
+
+    static void sortByName(std::vector<AggregatorEntry> & entries) {
+        std::sort(entries.begin(), entries.end(),
+            [] (const AggregatorEntry & a, const AggregatorEntry & b) { return a.serviceName < b.serviceName; });
+    }
+
+    Aggregator::Aggregator(const std::string & socketPath, int receiveBuffer)
+        : m_socketPath(socketPath), m_queryPath(socketPath + QUERY_SOCKET_SUFFIX) {
+        try {
+            m_socket = bindSocket(m_socketPath, SOCK_DGRAM);
+            if(receiveBuffer > 0 && setsockopt(m_socket, SOL_SOCKET, SO_RCVBUF, &receiveBuffer, sizeof(receiveBuffer)) != 0) {
+                throw std::system_error(errno, std::generic_category(), "Impossible to size the socket " + m_socketPath);
+            }
+            m_query = bindSocket(m_queryPath, SOCK_STREAM);
+            if(pipe(m_stop) != 0) {
+                throw std::system_error(errno, std::generic_category(), "Impossible to create the pipe of the aggregator");
+            }
+            m_thread = std::thread(&Aggregator::run, this);
+        }
+        catch(...) {
+            closeAll();
+            throw;
+        }
+    }
+
+    Aggregator::~Aggregator() {
+        const char stop = 1;
+        if(write(m_stop[1], &stop, 1) != 1) {
+            //the thread also stops when the pipe is closed
+        }
+        m_thread.join();
+        closeAll();
+    }
+
+    void Aggregator::closeAll() noexcept {
+        if(m_socket >= 0) {
+            close(m_socket);
+            unlink(m_socketPath.c_str());
+        }
+        if(m_query >= 0) {
+            close(m_query);
+            unlink(m_queryPath.c_str());
+        }
+        for(int fd : m_stop) {
+            if(fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+
+    void Aggregator::run() noexcept {
+        while(true) {
+            struct pollfd fds[3] = {{m_stop[0], POLLIN, 0}, {m_socket, POLLIN, 0}, {m_query, POLLIN, 0}};
+            if(poll(fds, 3, -1) < 0) {
+                if(errno == EINTR) {
+                    continue;
+                }
+                return;
+            }
+            if(fds[0].revents != 0) {
+                return;
+            }
+
+            try {
+                if(fds[1].revents & POLLIN) {
+                    receive();
+                }
+                if(fds[2].revents & POLLIN) {
+                    serveQuery();
+                }
+            }
+            catch(...) {
+                //out of memory: the datagrams are received again on the next poll
+            }
+        }
+    }
+
+    //drain the socket, one lock per batch of datagrams
+    void Aggregator::receive() {
+        StatusMessage messages[BATCH_SIZE];
+        struct iovec iovecs[BATCH_SIZE];
+        struct mmsghdr headers[BATCH_SIZE];
+
+        std::memset(headers, 0, sizeof(headers));
+        for(unsigned i = 0; i < BATCH_SIZE; i++) {
+            iovecs[i].iov_base = &messages[i];
+            iovecs[i].iov_len = sizeof(StatusMessage);
+            headers[i].msg_hdr.msg_iov = &iovecs[i];
+            headers[i].msg_hdr.msg_iovlen = 1;
+        }
+
+        while(true) {
+            const int count = recvmmsg(m_socket, headers, BATCH_SIZE, MSG_DONTWAIT, nullptr);
+            if(count <= 0) {
+                return;
+            }
+
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.batches++;
+            for(int i = 0; i < count; i++) {
+                const StatusMessage & message = messages[i];
+                if(!isValidMessage(message, headers[i].msg_len) || (headers[i].msg_hdr.msg_flags & MSG_TRUNC) != 0) {
+                    m_stats.invalid++;
+                    continue;
+                }
+                m_stats.received++;
+
+                m_key.assign(message.serviceName, message.nameLength);
+                auto it = m_entries.find(m_key);
+                if(it == m_entries.end()) {
+                    it = m_entries.emplace(m_key, AggregatorEntry()).first;
+                    it->second.serviceName = m_key;
+                }
+
+                AggregatorEntry & entry = it->second;
+                entry.operatingStatus = static_cast<fty::OperatingStatus>(message.operatingStatus);
+                entry.healthState = static_cast<fty::HealthState>(message.healthState);
+                entry.updateTime = message.updateTime;
+                entry.pid = message.pid;
+                entry.updates++;
+            }
+
+            if(static_cast<unsigned>(count) < BATCH_SIZE) {
+                return;
+            }
+        }
+    }
+
+    //write the snapshot to one client, one line per service: name, operating status, health state, update time, pid, updates
+    void Aggregator::serveQuery() {
+        int client = accept4(m_query, nullptr, nullptr, SOCK_CLOEXEC);
+        if(client < 0) {
+            return;
+        }
+
+        //a slow client must not stop the reception of the datagrams
+        setTimeout(client, SO_SNDTIMEO, 100);
+
+        std::string text;
+        for(const AggregatorEntry & entry : snapshot()) {
+            text += entry.serviceName + "\t" + std::to_string(static_cast<unsigned>(entry.operatingStatus))
+                  + "\t" + std::to_string(static_cast<unsigned>(entry.healthState)) + "\t" + std::to_string(entry.updateTime)
+                  + "\t" + std::to_string(entry.pid) + "\t" + std::to_string(entry.updates) + "\n";
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stats.queries++;
+        }
+
+        std::size_t offset = 0;
+        while(offset < text.size()) {
+            const ssize_t sent = send(client, text.data() + offset, text.size() - offset, MSG_NOSIGNAL);
+            if(sent <= 0) {
+                break;
+            }
+            offset += static_cast<std::size_t>(sent);
+        }
+        close(client);
+    }
+
+    std::size_t Aggregator::snapshot(std::vector<AggregatorEntry> & entries) const {
+        entries.clear();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            entries.reserve(m_entries.size());
+            for(const auto & item : m_entries) {
+                entries.push_back(item.second);
+            }
+        }
+        sortByName(entries);
+        return entries.size();
+    }
+
+    std::vector<AggregatorEntry> Aggregator::snapshot() const {
+        std::vector<AggregatorEntry> entries;
+        snapshot(entries);
+        return entries;
+    }
+
+    bool Aggregator::find(const std::string & serviceName, AggregatorEntry & entry) const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_entries.find(serviceName);
+        if(it == m_entries.end()) {
+            return false;
+        }
+        entry = it->second;
+        return true;
+    }
+
+    AggregatorStats Aggregator::getStats() const {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_stats;
+    }
+
+    std::vector<AggregatorEntry> querySnapshot(const std::string & socketPath) {
+        const std::string queryPath = socketPath + QUERY_SOCKET_SUFFIX;
+        struct sockaddr_un address;
+        const socklen_t length = makeAddress(queryPath, address);
+
+        int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if(fd < 0) {
+            throw std::system_error(errno, std::generic_category(), "Impossible to create the query socket");
+        }
+        if(connect(fd, reinterpret_cast<const struct sockaddr *>(&address), length) != 0) {
+            const int error = errno;
+            close(fd);
+            throw std::system_error(error, std::generic_category(), "Impossible to reach the aggregator " + queryPath);
+        }
+        setTimeout(fd, SO_RCVTIMEO, 1000);
+
+        std::string text;
+        char buffer[4096];
+        ssize_t received;
+        while((received = recv(fd, buffer, sizeof(buffer), 0)) > 0) {
+            text.append(buffer, static_cast<std::size_t>(received));
+        }
+        const int error = errno;
+        close(fd);
+        if(received < 0) {
+            throw std::system_error(error, std::generic_category(), "Impossible to read the snapshot of the aggregator");
+        }
+
+        //the fields are read from the end of the line, the name may contain tabulations
+        std::vector<AggregatorEntry> entries;
+        std::size_t start = 0;
+        for(std::size_t end = text.find('\n'); end != std::string::npos; start = end + 1, end = text.find('\n', start)) {
+            std::size_t fields[5];
+            std::size_t position = end;
+            bool valid = true;
+            for(int i = 4; i >= 0 && valid; i--) {
+                position = text.rfind('\t', position - 1);
+                valid = (position != std::string::npos && position > start);
+                fields[i] = position + 1;
+            }
+            if(!valid) {
+                continue;
+            }
+
+            AggregatorEntry entry;
+            entry.serviceName = text.substr(start, fields[0] - 1 - start);
+            entry.operatingStatus = static_cast<fty::OperatingStatus>(std::strtoul(text.c_str() + fields[0], nullptr, 10));
+            entry.healthState = static_cast<fty::HealthState>(std::strtoul(text.c_str() + fields[1], nullptr, 10));
+            entry.updateTime = std::strtoull(text.c_str() + fields[2], nullptr, 10);
+            entry.pid = static_cast<std::uint32_t>(std::strtoul(text.c_str() + fields[3], nullptr, 10));
+            entry.updates = std::strtoull(text.c_str() + fields[4], nullptr, 10);
+            entries.push_back(entry);
+        }
+        return entries;
+    }
+
+} //namespace statussocket
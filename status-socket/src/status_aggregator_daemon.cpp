@@ -0,0 +1,100 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#include "status_aggregator.h"
+
+#include <cstring>
+#include <ctime>
+#include <iomanip>
+#include <iostream>
+
+#include <signal.h>
+
+static int usage(const char * program, int result) {
+    std::cerr << "Usage: " << program << " [-s] [socket path]" << std::endl
+              << "Receive the status sent by the status socket plugin of the services, until SIGINT or SIGTERM." << std::endl
+              << "  -s  print the snapshot of the running aggregator and exit" << std::endl
+              << "The default socket is $" << statussocket::SOCKET_PATH_ENV
+              << " or " << statussocket::DEFAULT_SOCKET_PATH << std::endl;
+    return result;
+}
+
+static int printSnapshot(const std::string & socketPath) {
+    std::cout << std::left << std::setw(statussocket::SERVICE_NAME_SIZE) << "SERVICE"
+              << std::setw(12) << "OPERATING" << std::setw(8) << "HEALTH" << std::setw(10) << "PID"
+              << std::setw(10) << "UPDATES" << "UPDATED" << std::endl;
+
+    for(const statussocket::AggregatorEntry & entry : statussocket::querySnapshot(socketPath)) {
+        char updated[32];
+        std::time_t seconds = static_cast<std::time_t>(entry.updateTime / 1000000000ULL);
+        struct tm local;
+        std::strftime(updated, sizeof(updated), "%Y-%m-%d %H:%M:%S", localtime_r(&seconds, &local));
+
+        std::cout << std::setw(statussocket::SERVICE_NAME_SIZE) << entry.serviceName
+                  << std::setw(12) << static_cast<unsigned>(entry.operatingStatus)
+                  << std::setw(8) << static_cast<unsigned>(entry.healthState)
+                  << std::setw(10) << entry.pid << std::setw(10) << entry.updates
+                  << updated << std::endl;
+    }
+    return 0;
+}
+
+static int runAggregator(const std::string & socketPath) {
+    //the signals are received by sigwait, the thread of the aggregator inherits the mask
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+    statussocket::Aggregator aggregator(socketPath);
+
+    int signal = 0;
+    sigwait(&signals, &signal);
+
+    const statussocket::AggregatorStats stats = aggregator.getStats();
+    std::cerr << "Received " << stats.received << " status in " << stats.batches << " batches, "
+              << stats.invalid << " invalid datagrams, served " << stats.queries << " snapshots" << std::endl;
+    return 0;
+}
+
+//aggregate the status of the services of the host, or print the status aggregated by the running aggregator
+int main(int argc, char ** argv) {
+    bool snapshot = false;
+    std::string socketPath = statussocket::getSocketPath();
+
+    for(int i = 1; i < argc; i++) {
+        if(std::strcmp(argv[i], "-h") == 0 || std::strcmp(argv[i], "--help") == 0) {
+            return usage(argv[0], 0);
+        } else if(std::strcmp(argv[i], "-s") == 0) {
+            snapshot = true;
+        } else if(i == argc - 1 && argv[i][0] != '-') {
+            socketPath = argv[i];
+        } else {
+            return usage(argv[0], 1);
+        }
+    }
+
+    try {
+        return snapshot ? printSnapshot(socketPath) : runAggregator(socketPath);
+    }
+    catch(const std::exception & e) {
+        std::cerr << e.what() << std::endl;
+        return 1;
+    }
+}
@@ -0,0 +1,188 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#include "status_socket_plugin.h"
+
+#include <plugin_common.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+
+//internal variables and functions
+//the status is sent without heap allocation: the error is kept in a fixed buffer
+static char gPluginLastError[256] = "";
+static std::atomic<std::uint64_t> gSentCount(0);
+static std::atomic<std::uint64_t> gDroppedCount(0);
+
+//public interfaces
+const char * getPluginName() {
+    return "Status socket plugin";
+}
+
+const char * getPluginLastError(){
+    return gPluginLastError;
+}
+
+int createServiceStatusProvider(fty::ServiceStatusProvider** spp, const char * serviceName) {
+    try {
+        *spp = dynamic_cast<fty::ServiceStatusProvider*>(new statussocket::ServiceStatusSocket(serviceName));
+    }
+    catch(const std::exception& e) {
+        snprintf(gPluginLastError, sizeof(gPluginLastError), "%s", e.what());
+        return -1;
+    }
+
+    gPluginLastError[0] = '\0';
+    return 0;
+}
+
+void deleteServiceStatusProvider(fty::ServiceStatusProvider* spp) {
+    statussocket::ServiceStatusSocket * ptr = dynamic_cast<statussocket::ServiceStatusSocket*>(spp);
+    delete ptr;
+}
+
+std::uint64_t statusSocketGetSentCount() {
+    return gSentCount.load(std::memory_order_relaxed);
+}
+
+std::uint64_t statusSocketGetDroppedCount() {
+    return gDroppedCount.load(std::memory_order_relaxed);
+}
+
+
+namespace statussocket
+{
+    //socket of the process, shared by all the providers sending to the same aggregator
+    class Sender
+    {
+        private:
+        int m_fd = -1;
+        struct sockaddr_un m_address;
+        socklen_t m_addressLength = 0;
+
+        public:
+        explicit Sender(const std::string & path) {
+            std::memset(&m_address, 0, sizeof(m_address));
+            if(path.empty() || path.size() >= sizeof(m_address.sun_path)) {
+                throw std::invalid_argument("Invalid path of the aggregator socket <" + path + ">");
+            }
+            m_address.sun_family = AF_UNIX;
+            std::memcpy(m_address.sun_path, path.c_str(), path.size() + 1);
+            m_addressLength = static_cast<socklen_t>(offsetof(struct sockaddr_un, sun_path) + path.size() + 1);
+
+            //not connected, so the aggregator can be started or restarted at any time
+            m_fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+            if(m_fd < 0) {
+                throw std::system_error(errno, std::generic_category(), "Impossible to create the status socket");
+            }
+        }
+
+        ~Sender() {
+            close(m_fd);
+        }
+
+        Sender(const Sender &) = delete;
+        Sender & operator = (const Sender &) = delete;
+
+        /// Send a message without blocking
+        ///@return 0 if it was sent, else the errno of the failure
+        int send(const StatusMessage & message) noexcept {
+            const ssize_t sent = sendto(m_fd, &message, messageSize(message), MSG_DONTWAIT | MSG_NOSIGNAL,
+                                        reinterpret_cast<const struct sockaddr *>(&m_address), m_addressLength);
+            return (sent < 0) ? errno : 0;
+        }
+
+        /// Get the socket of the process for the aggregator of FTY_SERVICE_STATUS_SOCKET, released with the last provider
+        static std::shared_ptr<Sender> get() {
+            const std::string path = getSocketPath();
+            return plugincommon::SharedByKey<Sender>::get(path, [&path] () { return std::make_shared<Sender>(path); });
+        }
+    };
+
+    ServiceStatusSocket::ServiceStatusSocket(const char * serviceName)
+        : m_sender(Sender::get()), m_operatingStatus(0), m_healthState(0) {
+        const std::size_t length = std::strlen(serviceName);
+        if(length == 0 || length >= SERVICE_NAME_SIZE) {
+            throw std::invalid_argument("The service name must have between 1 and "
+                + std::to_string(SERVICE_NAME_SIZE - 1) + " characters");
+        }
+        std::memcpy(m_serviceName, serviceName, length + 1);
+
+        //the message is prepared once, set() copies it with the status and the time
+        std::memset(&m_message, 0, sizeof(m_message));
+        m_message.magic = MESSAGE_MAGIC;
+        m_message.version = MESSAGE_VERSION;
+        m_message.nameLength = static_cast<std::uint8_t>(length);
+        m_message.pid = static_cast<std::uint32_t>(getpid());
+        std::memcpy(m_message.serviceName, serviceName, length);
+    }
+
+    const char * ServiceStatusSocket::getServiceName() const noexcept {
+        return m_serviceName;
+    }
+
+    /// Set the Operating Status
+    ///@param os [in] Operating Status to set
+    ///@return 0 if the status was sent or dropped because the socket is full, -1 if the aggregator is unreachable
+    int ServiceStatusSocket::set(fty::OperatingStatus os) noexcept {
+        m_operatingStatus.store(static_cast<std::uint8_t>(os), std::memory_order_relaxed);
+        return send();
+    }
+
+    /// Set the Health State
+    ///@param hs [in] Health state to set
+    ///@return 0 if the status was sent or dropped because the socket is full, -1 if the aggregator is unreachable
+    int ServiceStatusSocket::set(fty::HealthState hs) noexcept {
+        m_healthState.store(static_cast<std::uint8_t>(hs), std::memory_order_relaxed);
+        return send();
+    }
+
+    //a full socket is not an error of the service: the status is dropped and the next update repairs it
+    int ServiceStatusSocket::send() noexcept {
+        StatusMessage message;
+        std::memcpy(&message, &m_message, messageSize(m_message));
+        message.operatingStatus = m_operatingStatus.load(std::memory_order_relaxed);
+        message.healthState = m_healthState.load(std::memory_order_relaxed);
+        message.updateTime = plugincommon::realtimeNs();
+
+        const int error = m_sender->send(message);
+        if(error == 0) {
+            gSentCount.fetch_add(1, std::memory_order_relaxed);
+            return 0;
+        }
+
+        gDroppedCount.fetch_add(1, std::memory_order_relaxed);
+        if(error == EAGAIN || error == EWOULDBLOCK || error == ENOBUFS) {
+            return 0;
+        }
+
+        snprintf(gPluginLastError, sizeof(gPluginLastError), "Impossible to send the status of %s: %s", m_serviceName, strerror(error));
+        return -1;
+    }
+
+} //namespace statussocket
@@ -0,0 +1,71 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#pragma once
+
+#include <fty_service_status.h>
+
+#include <string>
+
+//public interfaces
+extern "C"
+{
+    const char * getPluginName();
+    const char * getPluginLastError();
+    int createServiceStatusProvider(fty::ServiceStatusProvider** spp, const char * serviceName);
+    void deleteServiceStatusProvider(fty::ServiceStatusProvider* spp);
+    int setServiceStatusBatch(const fty::ServiceStatusBatchEntry * entries, std::size_t count);
+}
+
+//test interfaces, resolved with dlsym by the tests and the benchmarks
+extern "C"
+{
+    /// Get the number of calls to setServiceStatusBatch() since the plugin was loaded
+    unsigned long noopPluginGetBatchCount();
+
+    /// Get the number of entries received by setServiceStatusBatch() since the plugin was loaded
+    unsigned long noopPluginGetBatchEntryCount();
+}
+
+namespace test
+{
+    //provider which does nothing, used to measure the cost of the call path
+    class ServiceStatusNoop : public fty::ServiceStatusProvider
+    {
+        private:
+        std::string m_serviceName;
+
+        public:
+        ServiceStatusNoop( const char * serviceName);
+
+        /// Get the service name
+        ///@return  service name
+        const char * getServiceName() const noexcept override;
+
+        /// Set the Operating Status
+        ///@param os [in] Operating Status to set
+        ///@return 0
+        int set(fty::OperatingStatus os) noexcept override;
+
+        /// Set the Health State
+        ///@param hs [in] Health state to set
+        ///@return 0
+        int set(fty::HealthState hs) noexcept override;
+    };
+
+} //namespace test
@@ -0,0 +1,99 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#pragma once
+
+#include <fty_service_status.h>
+
+//public interfaces
+extern "C"
+{
+    const char * getPluginName();
+    const char * getPluginLastError();
+    int createServiceStatusProvider(fty::ServiceStatusProvider** spp, const char * serviceName);
+    void deleteServiceStatusProvider(fty::ServiceStatusProvider* spp);
+#ifdef SLEEP_PLUGIN_ABI_V2
+    const fty::ServiceStatusPluginDescriptor * getServiceStatusPluginDescriptor();
+#endif
+}
+
+//test interfaces, resolved with dlsym by the tests and the benchmarks
+//the initial delay can be given in micro seconds with the FTY_SERVICE_STATUS_SLEEP_US environment variable
+extern "C"
+{
+    /// Configure the behaviour of set() for all the providers of the plugin
+    ///@param delayUs [in] time to sleep in micro seconds
+    ///@param result [in] value returned by set()
+    void sleepPluginConfigure(unsigned delayUs, int result);
+
+    /// Get the number of calls to set() since the plugin was loaded
+    unsigned long sleepPluginGetSetCount();
+
+    /// Get the last Operating Status received, -1 if none
+    int sleepPluginGetLastOperatingStatus();
+
+    /// Get the last Health State received, -1 if none
+    int sleepPluginGetLastHealthState();
+
+    /// Get the number of combined updates since the plugin was loaded, always 0 for the version 1 of the plugin
+    unsigned long sleepPluginGetCombinedCount();
+}
+
+namespace test
+{
+    //the plugin is built for the version 1 and for the version 2 of the ABI, with the combined update
+#ifdef SLEEP_PLUGIN_ABI_V2
+    using ServiceStatusSleepBase = fty::ServiceStatusProviderV2;
+#else
+    using ServiceStatusSleepBase = fty::ServiceStatusProvider;
+#endif
+
+    //provider which sleeps before returning the configured result
+    class ServiceStatusSleep : public ServiceStatusSleepBase
+    {
+        private:
+        std::string m_serviceName;
+
+        public:
+        ServiceStatusSleep( const char * serviceName);
+
+        /// Get the service name
+        ///@return  service name
+        const char * getServiceName() const noexcept override;
+
+        /// Set the Operating Status
+        ///@param os [in] Operating Status to set
+        ///@return the configured result
+        int set(fty::OperatingStatus os) noexcept override;
+
+        /// Set the Health State
+        ///@param hs [in] Health state to set
+        ///@return the configured result
+        int set(fty::HealthState hs) noexcept override;
+
+#ifdef SLEEP_PLUGIN_ABI_V2
+        /// Set the Operating Status and the Health State
+        ///@param os [in] Operating Status to set
+        ///@param hs [in] Health state to set
+        ///@param timestamp [in] time of the status, ignored
+        ///@return the configured result
+        int set(fty::OperatingStatus os, fty::HealthState hs, std::int64_t timestamp) noexcept override;
+#endif
+    };
+
+} //namespace test
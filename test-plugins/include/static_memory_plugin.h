@@ -0,0 +1,65 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#pragma once
+
+#include <fty_service_status.h>
+
+#include <string>
+
+namespace test
+{
+    /// Static plugin which keeps the last status of its providers in memory
+    ///
+    /// It is linked in the tests and the benchmarks, and built as a plugin for dlopen by static_memory_plugin.cpp.
+    struct StaticMemoryPlugin
+    {
+        static const char * getPluginName() noexcept { return "Static memory plugin"; }
+
+        class Provider
+        {
+            private:
+            std::string m_serviceName;
+            fty::OperatingStatus m_operatingStatus = fty::OperatingStatus::Unknown;
+            fty::HealthState m_healthState = fty::HealthState::Unknown;
+            unsigned long m_setCount = 0;
+
+            public:
+            explicit Provider(const char * serviceName) : m_serviceName(serviceName) {}
+
+            const char * getServiceName() const noexcept { return m_serviceName.c_str(); }
+
+            int set(fty::OperatingStatus os) noexcept {
+                m_operatingStatus = os;
+                m_setCount++;
+                return 0;
+            }
+
+            int set(fty::HealthState hs) noexcept {
+                m_healthState = hs;
+                m_setCount++;
+                return 0;
+            }
+
+            fty::OperatingStatus getOperatingStatus() const noexcept { return m_operatingStatus; }
+            fty::HealthState getHealthState() const noexcept { return m_healthState; }
+            unsigned long getSetCount() const noexcept { return m_setCount; }
+        };
+    };
+
+} //namespace test
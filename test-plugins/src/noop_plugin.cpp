@@ -0,0 +1,104 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#include "noop_plugin.h"
+
+#include <atomic>
+
+#include <dlfcn.h>
+
+//internal variables
+static std::atomic<unsigned long> gBatchCount(0);
+static std::atomic<unsigned long> gBatchEntryCount(0);
+
+//public interfaces
+const char * getPluginName() {
+    //the name is the file name, so copies of the library can be loaded side by side
+    static const std::string name = [] {
+        Dl_info info;
+        if(dladdr(reinterpret_cast<void *>(&getPluginName), &info) == 0 || info.dli_fname == nullptr) {
+            return std::string("Noop plugin");
+        }
+        std::string path(info.dli_fname);
+        return path.substr(path.find_last_of('/') + 1);
+    }();
+
+    return name.c_str();
+}
+
+const char * getPluginLastError(){
+    return "";
+}
+
+int createServiceStatusProvider(fty::ServiceStatusProvider** spp, const char * serviceName) {
+    try {
+        *spp = new test::ServiceStatusNoop(serviceName);
+    }
+    catch(const std::exception&) {
+        return -1;
+    }
+
+    return 0;
+}
+
+void deleteServiceStatusProvider(fty::ServiceStatusProvider* spp) {
+    delete spp;
+}
+
+int setServiceStatusBatch(const fty::ServiceStatusBatchEntry * entries, std::size_t count) {
+    gBatchCount.fetch_add(1, std::memory_order_relaxed);
+    gBatchEntryCount.fetch_add(count, std::memory_order_relaxed);
+
+    //the providers must come from this plugin
+    int failures = 0;
+    for(std::size_t i = 0; i < count; i++) {
+        if(dynamic_cast<test::ServiceStatusNoop *>(entries[i].provider) == nullptr) {
+            failures++;
+        }
+    }
+    return failures;
+}
+
+unsigned long noopPluginGetBatchCount() {
+    return gBatchCount.load();
+}
+
+unsigned long noopPluginGetBatchEntryCount() {
+    return gBatchEntryCount.load();
+}
+
+namespace test
+{
+
+    ServiceStatusNoop::ServiceStatusNoop(const char * serviceName)
+        : m_serviceName(serviceName)
+        {}
+
+    const char * ServiceStatusNoop::getServiceName() const noexcept {
+        return m_serviceName.c_str();
+    }
+
+    int ServiceStatusNoop::set(fty::OperatingStatus) noexcept {
+        return 0;
+    }
+
+    int ServiceStatusNoop::set(fty::HealthState) noexcept {
+        return 0;
+    }
+
+} //namespace test
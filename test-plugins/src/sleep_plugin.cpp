@@ -0,0 +1,150 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#include "sleep_plugin.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include <thread>
+
+#include <dlfcn.h>
+
+//internal variables and functions
+static unsigned initialDelay();
+
+static std::atomic<unsigned> gDelayUs(initialDelay());
+static std::atomic<int> gResult(0);
+static std::atomic<unsigned long> gSetCount(0);
+static std::atomic<int> gLastOperatingStatus(-1);
+static std::atomic<int> gLastHealthState(-1);
+static std::atomic<unsigned long> gCombinedCount(0);
+
+static int sleepAndReturn();
+
+//public interfaces
+const char * getPluginName() {
+    //the name is the file name, so copies of the library can be loaded side by side
+    static const std::string name = [] {
+        Dl_info info;
+        if(dladdr(reinterpret_cast<void *>(&getPluginName), &info) == 0 || info.dli_fname == nullptr) {
+            return std::string("Sleep plugin");
+        }
+        std::string path(info.dli_fname);
+        return path.substr(path.find_last_of('/') + 1);
+    }();
+
+    return name.c_str();
+}
+
+const char * getPluginLastError(){
+    return gResult.load() < 0 ? "Configured error" : "";
+}
+
+int createServiceStatusProvider(fty::ServiceStatusProvider** spp, const char * serviceName) {
+    try {
+        *spp = new test::ServiceStatusSleep(serviceName);
+    }
+    catch(const std::exception&) {
+        return -1;
+    }
+
+    return 0;
+}
+
+void deleteServiceStatusProvider(fty::ServiceStatusProvider* spp) {
+    delete spp;
+}
+
+#ifdef SLEEP_PLUGIN_ABI_V2
+const fty::ServiceStatusPluginDescriptor * getServiceStatusPluginDescriptor() {
+    static const fty::ServiceStatusPluginDescriptor descriptor = {
+        fty::PLUGIN_ABI_VERSION,
+        static_cast<std::uint32_t>(fty::PluginCapability::CombinedUpdate)
+    };
+    return &descriptor;
+}
+#endif
+
+void sleepPluginConfigure(unsigned delayUs, int result) {
+    gDelayUs = delayUs;
+    gResult = result;
+}
+
+unsigned long sleepPluginGetSetCount() {
+    return gSetCount.load();
+}
+
+int sleepPluginGetLastOperatingStatus() {
+    return gLastOperatingStatus.load();
+}
+
+int sleepPluginGetLastHealthState() {
+    return gLastHealthState.load();
+}
+
+unsigned long sleepPluginGetCombinedCount() {
+    return gCombinedCount.load();
+}
+
+namespace test
+{
+
+    ServiceStatusSleep::ServiceStatusSleep(const char * serviceName)
+        : m_serviceName(serviceName)
+        {}
+
+    const char * ServiceStatusSleep::getServiceName() const noexcept {
+        return m_serviceName.c_str();
+    }
+
+    int ServiceStatusSleep::set(fty::OperatingStatus os) noexcept {
+        gLastOperatingStatus = static_cast<int>(os);
+        return sleepAndReturn();
+    }
+
+    int ServiceStatusSleep::set(fty::HealthState hs) noexcept {
+        gLastHealthState = static_cast<int>(hs);
+        return sleepAndReturn();
+    }
+
+#ifdef SLEEP_PLUGIN_ABI_V2
+    int ServiceStatusSleep::set(fty::OperatingStatus os, fty::HealthState hs, std::int64_t) noexcept {
+        gLastOperatingStatus = static_cast<int>(os);
+        gLastHealthState = static_cast<int>(hs);
+        gCombinedCount++;
+        return sleepAndReturn();
+    }
+#endif
+
+} //namespace test
+
+static unsigned initialDelay() {
+    const char * value = std::getenv("FTY_SERVICE_STATUS_SLEEP_US");
+    return value ? static_cast<unsigned>(std::strtoul(value, nullptr, 10)) : 0;
+}
+
+static int sleepAndReturn() {
+    unsigned delay = gDelayUs.load();
+    if(delay > 0) {
+        std::this_thread::sleep_for(std::chrono::microseconds(delay));
+    }
+    gSetCount++;
+    return gResult.load();
+}
@@ -138,6 +138,31 @@ TEST_CASE( "Test collection remove", "[fty::ServiceStatusPluginWrapperCollection
     REQUIRE(collection.getPluginCollection().size() == 0);
 }
 
+TEST_CASE( "Test collection copy", "[fty::ServiceStatusPluginWrapperCollection]-copy" ) {
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    REQUIRE_NOTHROW(collection.add(EXAMPLE_PATH));
+
+    //the copy keeps its plugins when the source changes
+    fty::ServiceStatusPluginWrapperCollection copy(collection);
+    REQUIRE(copy.getServiceName() == "test-service");
+    REQUIRE(copy.getPluginCollection().size() == 1);
+    REQUIRE(collection.remove("Example plugin"));
+    REQUIRE(copy.getPluginCollection().size() == 1);
+
+    copy.setForAll(fty::OperatingStatus::Emigrating);
+    std::ifstream operating("test-service.operating");
+    int value = -1;
+    operating >> value;
+    REQUIRE(value == static_cast<int>(fty::OperatingStatus::Emigrating));
+
+    fty::ServiceStatusPluginWrapperCollection other("other-service");
+    other = copy;
+    REQUIRE(other.getServiceName() == "test-service");
+    REQUIRE(other.getPluginCollection().size() == 1);
+    other = collection;
+    REQUIRE(other.getPluginCollection().size() == 0);
+}
+
 TEST_CASE( "Test collection set with empty collection", "[fty::ServiceStatusProviderCollection]-emptySet" ) {
     fty::ServiceStatusPluginWrapperCollection collection("test-service");
 
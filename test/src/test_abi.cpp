@@ -0,0 +1,108 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+
+//Tests of the versions of the plugin ABI, with the version 1 and the version 2 of the sleep plugin side by side
+
+#include <fty_service_status.h>
+
+#include "test_plugins.h"
+
+#include <catch2/catch.hpp>
+
+TEST_CASE( "Detect the version of the plugin ABI", "[fty::ServiceStatusPluginWrapper]-abi" ) {
+    fty::ServiceStatusPluginWrapper v1(SLEEP_PLUGIN_PATH);
+    fty::ServiceStatusPluginWrapper v2(SLEEP_V2_PLUGIN_PATH);
+
+    REQUIRE(v1.getAbiVersion() == 1);
+    REQUIRE_FALSE(v1.hasCapability(fty::PluginCapability::CombinedUpdate));
+    REQUIRE(v2.getAbiVersion() == 2);
+    REQUIRE(v2.hasCapability(fty::PluginCapability::CombinedUpdate));
+
+    //nothing is known before the load
+    fty::ServiceStatusPluginWrapper lazy(SLEEP_V2_PLUGIN_PATH, SLEEP_V2_PLUGIN_NAME, fty::LoadMode::Lazy);
+    REQUIRE(lazy.getAbiVersion() == 0);
+    REQUIRE_FALSE(lazy.hasCapability(fty::PluginCapability::CombinedUpdate));
+    lazy.load();
+    REQUIRE(lazy.getAbiVersion() == 2);
+
+    v2.unload();
+    REQUIRE(v2.getAbiVersion() == 0);
+}
+
+TEST_CASE( "Combined update of the plugin ABI version 2", "[fty::ServiceStatusPluginWrapper]-combined" ) {
+    SleepPluginControl v1Control(SLEEP_PLUGIN_PATH);
+    SleepPluginControl v2Control(SLEEP_V2_PLUGIN_PATH);
+
+    fty::ServiceStatusPluginWrapper v1(SLEEP_PLUGIN_PATH);
+    fty::ServiceStatusPluginWrapper v2(SLEEP_V2_PLUGIN_PATH);
+    fty::ServiceStatusProviderPtr v1Provider = v1.newServiceStatusProviderPtr("service-1");
+    fty::ServiceStatusProviderPtr v2Provider = v2.newServiceStatusProviderPtr("service-1");
+
+    const unsigned long v1Calls = v1Control.getSetCount();
+    const unsigned long v2Calls = v2Control.getSetCount();
+
+    //one call for the version 2, two calls for the version 1
+    REQUIRE(v1.setStatus(*v1Provider, fty::OperatingStatus::InService, fty::HealthState::Warning) == 0);
+    REQUIRE(v2.setStatus(*v2Provider, fty::OperatingStatus::InService, fty::HealthState::Warning) == 0);
+    REQUIRE(v1Control.getSetCount() == v1Calls + 2);
+    REQUIRE(v1Control.getCombinedCount() == 0);
+    REQUIRE(v2Control.getSetCount() == v2Calls + 1);
+    REQUIRE(v2Control.getCombinedCount() == 1);
+    REQUIRE(v2Control.getLastOperatingStatus() == static_cast<int>(fty::OperatingStatus::InService));
+    REQUIRE(v2Control.getLastHealthState() == static_cast<int>(fty::HealthState::Warning));
+
+    //the version 2 keeps the calls of the version 1
+    REQUIRE(v2Provider->set(fty::HealthState::Ok) == 0);
+    REQUIRE(v2Control.getSetCount() == v2Calls + 2);
+    REQUIRE(v2Control.getLastHealthState() == static_cast<int>(fty::HealthState::Ok));
+
+    v1Control.configure(0, -2);
+    v2Control.configure(0, -3);
+    REQUIRE(v1.setStatus(*v1Provider, fty::OperatingStatus::Stopped, fty::HealthState::Ok) == -2);
+    REQUIRE(v2.setStatus(*v2Provider, fty::OperatingStatus::Stopped, fty::HealthState::Ok) == -3);
+}
+
+TEST_CASE( "Plugins of both ABI versions in the registry", "[fty::ServiceStatusPluginRegistry]-abi" ) {
+    SleepPluginControl v1Control(SLEEP_PLUGIN_PATH);
+    SleepPluginControl v2Control(SLEEP_V2_PLUGIN_PATH);
+
+    fty::ServiceStatusPluginRegistry registry;
+    registry.add(SLEEP_PLUGIN_PATH);
+    registry.add(SLEEP_V2_PLUGIN_PATH);
+
+    const unsigned long v1Calls = v1Control.getSetCount();
+    const unsigned long v2Calls = v2Control.getSetCount();
+    const unsigned long v2Combined = v2Control.getCombinedCount();
+
+    std::vector<fty::ServiceStatus> statuses = {
+        {"service-1", fty::OperatingStatus::InService, fty::HealthState::Ok},
+        {"service-2", fty::OperatingStatus::Starting, fty::HealthState::MinorFailure}
+    };
+    REQUIRE(registry.setForServices(statuses) == 0);
+
+    REQUIRE(v1Control.getSetCount() == v1Calls + 4);
+    REQUIRE(v2Control.getSetCount() == v2Calls + 2);
+    REQUIRE(v2Control.getCombinedCount() == v2Combined + 2);
+    REQUIRE(v1Control.getLastHealthState() == static_cast<int>(fty::HealthState::MinorFailure));
+    REQUIRE(v2Control.getLastHealthState() == static_cast<int>(fty::HealthState::MinorFailure));
+
+    //the failures are counted by plugin
+    v2Control.configure(0, -1);
+    REQUIRE(registry.setForServices(statuses) == 2);
+}
@@ -0,0 +1,199 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+
+//Tests of StatusAccounting
+
+#include <fty_service_status.h>
+
+#include "test_plugins.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+using std::chrono::milliseconds;
+
+TEST_CASE( "Test accounting of the time in each status", "[fty::StatusAccounting]-time" ) {
+    fty::StatusAccounting accounting;
+
+    accounting.record(fty::OperatingStatus::InService);
+    accounting.record(fty::HealthState::Ok);
+    std::this_thread::sleep_for(milliseconds(30));
+    accounting.record(fty::OperatingStatus::Servicing);
+    accounting.record(fty::HealthState::MajorFailure);
+    std::this_thread::sleep_for(milliseconds(10));
+
+    //an unchanged status is not a transition
+    accounting.record(fty::OperatingStatus::Servicing);
+    accounting.record(fty::HealthState::MajorFailure);
+
+    fty::StatusAccountingSnapshot snapshot = accounting.getSnapshot();
+    REQUIRE(snapshot.operatingStatus == fty::OperatingStatus::Servicing);
+    REQUIRE(snapshot.healthState == fty::HealthState::MajorFailure);
+    REQUIRE(snapshot.getTime(fty::OperatingStatus::InService) >= milliseconds(30));
+    REQUIRE(snapshot.getTime(fty::OperatingStatus::Servicing) >= milliseconds(10));
+    REQUIRE(snapshot.getTime(fty::OperatingStatus::Stopped).count() == 0);
+    REQUIRE(snapshot.getTimeAbove(fty::HealthState::Warning) == snapshot.getTime(fty::HealthState::MajorFailure));
+    REQUIRE(snapshot.getTime(fty::HealthState::MajorFailure) >= milliseconds(10));
+
+    REQUIRE(snapshot.getTransitions(fty::OperatingStatus::Unknown, fty::OperatingStatus::InService) == 1);
+    REQUIRE(snapshot.getTransitions(fty::OperatingStatus::InService, fty::OperatingStatus::Servicing) == 1);
+    REQUIRE(snapshot.getTransitions(fty::OperatingStatus::Servicing, fty::OperatingStatus::Servicing) == 0);
+    REQUIRE(snapshot.getTransitions(fty::HealthState::Ok, fty::HealthState::MajorFailure) == 1);
+    REQUIRE(snapshot.healthStateTransitions[1][4] == 1);
+
+    //the times add up to the elapsed time
+    std::chrono::microseconds total(0);
+    for(std::chrono::microseconds time : snapshot.operatingStatusTime) {
+        total += time;
+    }
+    REQUIRE(total <= snapshot.elapsed);
+    REQUIRE(total >= snapshot.elapsed - milliseconds(1));
+
+    //the current status keeps counting
+    std::this_thread::sleep_for(milliseconds(10));
+    REQUIRE(accounting.getSnapshot().getTime(fty::OperatingStatus::Servicing) >= snapshot.getTime(fty::OperatingStatus::Servicing) + milliseconds(10));
+}
+
+TEST_CASE( "Test accounting flap detection", "[fty::StatusAccounting]-flap" ) {
+    fty::FlapSettings invalid;
+    invalid.transitions = 1;
+    REQUIRE_THROWS_AS(fty::StatusAccounting(invalid), std::invalid_argument);
+    invalid.transitions = 65;
+    REQUIRE_THROWS_AS(fty::StatusAccounting(invalid), std::invalid_argument);
+
+    fty::FlapSettings settings;
+    settings.transitions = 4;
+    settings.window = milliseconds(100);
+    fty::StatusAccounting accounting(settings);
+
+    const fty::HealthState states[] = {fty::HealthState::Ok, fty::HealthState::Warning};
+    for(unsigned i = 0; i < 3; i++) {
+        accounting.record(states[i % 2]);
+    }
+    REQUIRE_FALSE(accounting.getSnapshot().healthStateFlapping);
+
+    //the fourth change in the window
+    accounting.record(states[1]);
+    fty::StatusAccountingSnapshot snapshot = accounting.getSnapshot();
+    REQUIRE(snapshot.healthStateFlapping);
+    REQUIRE(snapshot.healthStateFlaps == 1);
+    REQUIRE_FALSE(snapshot.operatingStatusFlapping);
+
+    //still the same flap
+    accounting.record(states[0]);
+    REQUIRE(accounting.getSnapshot().healthStateFlaps == 1);
+
+    //the flap ends once the window passed
+    std::this_thread::sleep_for(milliseconds(150));
+    REQUIRE_FALSE(accounting.getSnapshot().healthStateFlapping);
+
+    accounting.record(states[1]);
+    REQUIRE_FALSE(accounting.getSnapshot().healthStateFlapping);
+    for(unsigned i = 0; i < 3; i++) {
+        accounting.record(states[i % 2]);
+    }
+    snapshot = accounting.getSnapshot();
+    REQUIRE(snapshot.healthStateFlapping);
+    REQUIRE(snapshot.healthStateFlaps == 2);
+}
+
+TEST_CASE( "Test accounting from several threads", "[fty::StatusAccounting]-concurrent" ) {
+    fty::StatusAccounting accounting;
+    const unsigned threadCount = 4;
+    const unsigned updates = 20000;
+
+    std::atomic<bool> stop(false);
+    std::atomic<unsigned> inconsistent(0);
+
+    //the transitions of a consistent snapshot form a path from Unknown to the current status
+    std::thread reader([&] {
+        while(!stop) {
+            fty::StatusAccountingSnapshot snapshot = accounting.getSnapshot();
+            if(!snapshot.consistent) {
+                continue;
+            }
+            for(std::size_t state = 0; state < fty::StatusAccountingSnapshot::OPERATING_STATUS_COUNT; state++) {
+                std::int64_t balance = 0;
+                for(std::size_t other = 0; other < fty::StatusAccountingSnapshot::OPERATING_STATUS_COUNT; other++) {
+                    balance += static_cast<std::int64_t>(snapshot.operatingStatusTransitions[other][state]);
+                    balance -= static_cast<std::int64_t>(snapshot.operatingStatusTransitions[state][other]);
+                }
+                const std::int64_t expected = (state == static_cast<std::size_t>(snapshot.operatingStatus) ? 1 : 0) - (state == 0 ? 1 : 0);
+                if(balance != expected) {
+                    inconsistent++;
+                }
+            }
+        }
+    });
+
+    std::vector<std::thread> threads;
+    for(unsigned t = 0; t < threadCount; t++) {
+        threads.emplace_back([&accounting, t] {
+            const fty::OperatingStatus statuses[] = {fty::OperatingStatus::InService, fty::OperatingStatus::Servicing, fty::OperatingStatus::Stopped};
+            for(unsigned i = 0; i < updates; i++) {
+                accounting.record(statuses[(i + t) % 3]);
+            }
+        });
+    }
+    for(std::thread & thread : threads) {
+        thread.join();
+    }
+    stop = true;
+    reader.join();
+
+    fty::StatusAccountingSnapshot snapshot = accounting.getSnapshot();
+    std::uint64_t transitions = 0;
+    for(auto & row : snapshot.operatingStatusTransitions) {
+        for(std::uint64_t count : row) {
+            transitions += count;
+        }
+    }
+    REQUIRE(snapshot.consistent);
+    REQUIRE(transitions > 0);
+    REQUIRE(transitions <= threadCount * updates);
+    REQUIRE(inconsistent == 0);
+}
+
+TEST_CASE( "Test accounting of a collection", "[fty::ServiceStatusPluginWrapperCollection]-accounting" ) {
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    REQUIRE_NOTHROW(collection.add(SLEEP_PLUGIN_PATH));
+    REQUIRE(collection.getStatusAccounting() == nullptr);
+
+    //the accounting receives the status already set
+    collection.setForAll(fty::OperatingStatus::Starting);
+    std::shared_ptr<fty::StatusAccounting> accounting = std::make_shared<fty::StatusAccounting>();
+    collection.setStatusAccounting(accounting);
+    REQUIRE(collection.getStatusAccounting() == accounting);
+    REQUIRE(accounting->getSnapshot().operatingStatus == fty::OperatingStatus::Starting);
+
+    collection.setForAll(fty::OperatingStatus::InService);
+    collection.setForAll(fty::HealthState::Ok);
+    fty::StatusAccountingSnapshot snapshot = accounting->getSnapshot();
+    REQUIRE(snapshot.operatingStatus == fty::OperatingStatus::InService);
+    REQUIRE(snapshot.healthState == fty::HealthState::Ok);
+    REQUIRE(snapshot.getTransitions(fty::OperatingStatus::Starting, fty::OperatingStatus::InService) == 1);
+
+    collection.setStatusAccounting(nullptr);
+    collection.setForAll(fty::OperatingStatus::Stopped);
+    REQUIRE(accounting->getSnapshot().operatingStatus == fty::OperatingStatus::InService);
+}
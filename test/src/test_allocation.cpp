@@ -0,0 +1,139 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+
+//Tests of the heap allocations done by setForAll, with the example plugin
+
+#include <fty_service_status.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <new>
+
+#include <catch2/catch.hpp>
+
+//the global operator new of the process is replaced, so the plugins use it too
+//Only the allocations of the calling thread are counted: the other tests may leave threads behind.
+static thread_local unsigned long gAllocations = 0;
+//number of the allocation of the thread which fails, 0 for none
+static thread_local unsigned long gFailingAllocation = 0;
+
+void * operator new(std::size_t size) {
+    gAllocations++;
+    if(gAllocations == gFailingAllocation) {
+        throw std::bad_alloc();
+    }
+    void * ptr = std::malloc(size == 0 ? 1 : size);
+    if(ptr == nullptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void * operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    try {
+        return operator new(size);
+    }
+    catch(const std::bad_alloc &) {
+        return nullptr;
+    }
+}
+
+void operator delete(void * ptr) noexcept {
+    std::free(ptr);
+}
+
+void operator delete(void * ptr, std::size_t) noexcept {
+    std::free(ptr);
+}
+
+static const std::string EXAMPLE_PATH = "../example/libfty-service-status-example.so";
+
+static int readStatus(const std::string & fileName) {
+    std::ifstream file(fileName);
+    int value = -1;
+    file >> value;
+    return value;
+}
+
+TEST_CASE( "setForAll does not allocate in steady state", "[fty::ServiceStatusPluginWrapperCollection]-allocation" ) {
+    fty::ServiceStatusPluginWrapperCollection collection("allocation-service");
+    collection.add(EXAMPLE_PATH);
+
+    //the first updates may initialize the thread
+    collection.setForAll(fty::OperatingStatus::InService);
+    collection.setForAll(fty::HealthState::Ok);
+
+    const unsigned long allocations = gAllocations;
+    for(int i = 0; i < 100; i++) {
+        collection.setForAll((i % 2 == 0) ? fty::OperatingStatus::Starting : fty::OperatingStatus::InService);
+        collection.setForAll((i % 2 == 0) ? fty::HealthState::Warning : fty::HealthState::Ok);
+    }
+    const unsigned long steadyAllocations = gAllocations - allocations;
+    REQUIRE(steadyAllocations == 0);
+
+    REQUIRE(readStatus("allocation-service.operating") == static_cast<int>(fty::OperatingStatus::InService));
+    REQUIRE(readStatus("allocation-service.health") == static_cast<int>(fty::HealthState::Ok));
+}
+
+TEST_CASE( "getPluginName does not allocate", "[fty::ServiceStatusPluginWrapper]-allocation" ) {
+    fty::ServiceStatusPluginWrapper plugin(EXAMPLE_PATH);
+
+    const unsigned long allocations = gAllocations;
+    const bool named = plugin.getPluginName() == "Example plugin";
+    const unsigned long nameAllocations = gAllocations - allocations;
+    REQUIRE(named);
+    REQUIRE(nameAllocations == 0);
+}
+
+TEST_CASE( "A failed allocation leaves the collection unchanged", "[fty::ServiceStatusPluginWrapperCollection]-bad-alloc" ) {
+    fty::ServiceStatusPluginWrapperCollection collection("allocation-service");
+    collection.add(EXAMPLE_PATH);
+    collection.enableAsyncDispatch();
+    const std::string pluginName = collection.getPluginCollection().begin()->first;
+
+    //each allocation of the changes fails in turn, until they succeed
+    bool disabled = false;
+    for(unsigned long failing = 1; !disabled; failing++) {
+        gFailingAllocation = gAllocations + failing;
+        try {
+            collection.disableAsyncDispatch();
+            disabled = true;
+        }
+        catch(const std::bad_alloc &) {
+            gFailingAllocation = 0;
+            REQUIRE(collection.isAsyncDispatchEnabled());
+        }
+        gFailingAllocation = 0;
+    }
+    REQUIRE_FALSE(collection.isAsyncDispatchEnabled());
+
+    //remove does not throw, it reports the failed allocation
+    bool removed = false;
+    for(unsigned long failing = 1; !removed; failing++) {
+        gFailingAllocation = gAllocations + failing;
+        removed = collection.remove(pluginName);
+        gFailingAllocation = 0;
+        if(!removed) {
+            REQUIRE(collection.getPluginCollection().count(pluginName) == 1);
+            collection.setForAll(fty::OperatingStatus::Stopping);
+            REQUIRE(readStatus("allocation-service.operating") == static_cast<int>(fty::OperatingStatus::Stopping));
+        }
+    }
+    REQUIRE(collection.getPluginCollection().empty());
+}
@@ -0,0 +1,217 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+
+//Tests of the asynchronous dispatch of ServiceStatusPluginWrapperCollection, using the sleep plugin
+
+#include <fty_service_status.h>
+
+#include "test_plugins.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+using Clock = std::chrono::steady_clock;
+
+TEST_CASE( "Test bounded queue", "[fty::detail::BoundedQueue]-pushPop" ) {
+    fty::detail::BoundedQueue<int> queue(3);
+
+    REQUIRE(queue.capacity() == 4);
+    REQUIRE(queue.empty());
+
+    for(int i = 0; i < 4; i++) {
+        REQUIRE(queue.push(i));
+    }
+    REQUIRE_FALSE(queue.push(4));
+
+    int value = -1;
+    for(int i = 0; i < 4; i++) {
+        REQUIRE(queue.pop(value));
+        REQUIRE(value == i);
+    }
+    REQUIRE_FALSE(queue.pop(value));
+    REQUIRE(queue.empty());
+}
+
+TEST_CASE( "Test async dispatch keeps caller latency flat", "[fty::ServiceStatusPluginWrapperCollection]-asyncLatency" ) {
+    SleepPluginControl control;
+    control.configure(20000);
+
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    REQUIRE_NOTHROW(collection.add(SLEEP_PLUGIN_PATH));
+    REQUIRE_NOTHROW(collection.enableAsyncDispatch(16, fty::OverflowPolicy::Block));
+    REQUIRE(collection.isAsyncDispatchEnabled());
+
+    std::chrono::microseconds worst(0);
+    for(int i = 0; i < 10; i++) {
+        Clock::time_point start = Clock::now();
+        collection.setForAll(i % 2 ? fty::OperatingStatus::InService : fty::OperatingStatus::Starting);
+        std::chrono::microseconds elapsed = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start);
+        if(elapsed > worst) {
+            worst = elapsed;
+        }
+    }
+
+    //a synchronous call would take at least 20ms
+    CHECK(worst < std::chrono::milliseconds(5));
+    CHECK(control.getSetCount() < 10);
+
+    REQUIRE(collection.flush(std::chrono::milliseconds(5000)));
+    REQUIRE(control.getSetCount() == 10);
+    REQUIRE(control.getLastOperatingStatus() == static_cast<int>(fty::OperatingStatus::InService));
+    REQUIRE(collection.getDroppedUpdateCount() == 0);
+}
+
+TEST_CASE( "Test async dispatch overflow drop newest", "[fty::ServiceStatusPluginWrapperCollection]-asyncDropNewest" ) {
+    SleepPluginControl control;
+    control.configure(50000);
+
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    REQUIRE_NOTHROW(collection.add(SLEEP_PLUGIN_PATH));
+    REQUIRE_NOTHROW(collection.enableAsyncDispatch(2, fty::OverflowPolicy::DropNewest));
+
+    collection.setForAll(fty::HealthState::Ok);
+    //wait for the dispatcher to be busy with the first update
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    collection.setForAll(fty::HealthState::Warning);
+    collection.setForAll(fty::HealthState::MinorFailure);
+    collection.setForAll(fty::HealthState::MajorFailure);
+    collection.setForAll(fty::HealthState::CriticalFailure);
+
+    REQUIRE(collection.flush(std::chrono::milliseconds(5000)));
+    REQUIRE(collection.getDroppedUpdateCount() == 2);
+    REQUIRE(control.getSetCount() == 3);
+    REQUIRE(control.getLastHealthState() == static_cast<int>(fty::HealthState::MinorFailure));
+}
+
+TEST_CASE( "Test async dispatch overflow drop oldest", "[fty::ServiceStatusPluginWrapperCollection]-asyncDropOldest" ) {
+    SleepPluginControl control;
+    control.configure(50000);
+
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    REQUIRE_NOTHROW(collection.add(SLEEP_PLUGIN_PATH));
+    REQUIRE_NOTHROW(collection.enableAsyncDispatch(2, fty::OverflowPolicy::DropOldest));
+
+    collection.setForAll(fty::HealthState::Ok);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    collection.setForAll(fty::HealthState::Warning);
+    collection.setForAll(fty::HealthState::MinorFailure);
+    collection.setForAll(fty::HealthState::MajorFailure);
+    collection.setForAll(fty::HealthState::CriticalFailure);
+
+    REQUIRE(collection.flush(std::chrono::milliseconds(5000)));
+    REQUIRE(collection.getDroppedUpdateCount() == 2);
+    REQUIRE(control.getSetCount() == 3);
+    REQUIRE(control.getLastHealthState() == static_cast<int>(fty::HealthState::CriticalFailure));
+}
+
+TEST_CASE( "Test async dispatch drains on disable", "[fty::ServiceStatusPluginWrapperCollection]-asyncDrain" ) {
+    SleepPluginControl control;
+    control.configure(1000);
+
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    REQUIRE_NOTHROW(collection.enableAsyncDispatch());
+
+    //plugins added after enabling get their own dispatcher
+    REQUIRE_NOTHROW(collection.add(SLEEP_PLUGIN_PATH));
+
+    for(int i = 0; i < 20; i++) {
+        collection.setForAll(fty::OperatingStatus::Transitioning);
+    }
+    collection.setForAll(fty::OperatingStatus::Stopped);
+
+    collection.disableAsyncDispatch();
+    REQUIRE_FALSE(collection.isAsyncDispatchEnabled());
+    REQUIRE(control.getSetCount() == 21);
+    REQUIRE(control.getLastOperatingStatus() == static_cast<int>(fty::OperatingStatus::Stopped));
+
+    //back to synchronous calls
+    collection.setForAll(fty::OperatingStatus::InService);
+    REQUIRE(control.getSetCount() == 22);
+}
+
+TEST_CASE( "Test async dispatch flush with several producers", "[fty::ServiceStatusPluginWrapperCollection]-asyncFlushProducers" ) {
+    SleepPluginControl control;
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    REQUIRE_NOTHROW(collection.add(SLEEP_PLUGIN_PATH));
+    REQUIRE_NOTHROW(collection.enableAsyncDispatch(16, fty::OverflowPolicy::Block));
+    const unsigned long initial = control.getSetCount();
+
+    //once flush returns true, every update set before it started was delivered, whichever thread set it
+    std::atomic<unsigned long> completed(0);
+    std::atomic<unsigned> missed(0);
+    std::vector<std::thread> threads;
+    for(unsigned t = 0; t < 4; t++) {
+        threads.emplace_back([&] {
+            for(unsigned i = 0; i < 2000; i++) {
+                collection.setForAll(fty::OperatingStatus::InService);
+                completed++;
+                const unsigned long before = completed.load();
+                if(collection.flush(std::chrono::milliseconds(5000)) && control.getSetCount() - initial < before) {
+                    missed++;
+                }
+            }
+        });
+    }
+    for(std::thread & thread : threads) {
+        thread.join();
+    }
+    REQUIRE(missed == 0);
+    REQUIRE(control.getSetCount() - initial == 8000);
+}
+
+TEST_CASE( "Test async dispatch blocks on a full queue", "[fty::ServiceStatusPluginWrapperCollection]-asyncBlock" ) {
+    SleepPluginControl control;
+    control.configure(20000);
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    REQUIRE_NOTHROW(collection.add(SLEEP_PLUGIN_PATH));
+
+    //without timeout the caller waits for room, nothing is dropped
+    REQUIRE_NOTHROW(collection.enableAsyncDispatch(2, fty::OverflowPolicy::Block));
+    const unsigned long initial = control.getSetCount();
+    for(int i = 0; i < 8; i++) {
+        collection.setForAll(i % 2 ? fty::OperatingStatus::InService : fty::OperatingStatus::Starting);
+    }
+    REQUIRE(collection.flush(std::chrono::milliseconds(5000)));
+    REQUIRE(control.getSetCount() - initial == 8);
+    REQUIRE(collection.getDroppedUpdateCount() == 0);
+
+    //with a timeout the update is dropped and counted once the caller waited
+    REQUIRE_NOTHROW(collection.enableAsyncDispatch(2, fty::OverflowPolicy::Block, std::chrono::milliseconds(5)));
+    Clock::time_point start = Clock::now();
+    for(int i = 0; i < 8; i++) {
+        collection.setForAll(i % 2 ? fty::OperatingStatus::InService : fty::OperatingStatus::Starting);
+    }
+    CHECK(Clock::now() - start >= std::chrono::milliseconds(5));
+    REQUIRE(collection.flush(std::chrono::milliseconds(5000)));
+    REQUIRE(collection.getDroppedUpdateCount() > 0);
+
+    REQUIRE_THROWS_AS(collection.enableAsyncDispatch(2, fty::OverflowPolicy::Block, std::chrono::milliseconds(-1)), std::invalid_argument);
+}
+
+TEST_CASE( "Test async dispatch invalid capacity", "[fty::ServiceStatusPluginWrapperCollection]-asyncInvalid" ) {
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    REQUIRE_THROWS(collection.enableAsyncDispatch(0));
+    REQUIRE_FALSE(collection.isAsyncDispatchEnabled());
+}
@@ -0,0 +1,217 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+
+//Tests of the collection used from several threads: setForAll while plugins are added and removed
+
+#include <fty_service_status.h>
+
+#include "test_plugins.h"
+
+#include <atomic>
+#include <fstream>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+#include <catch2/catch.hpp>
+
+//folder with copies of the noop plugin, each copy is a different plugin
+class NoopCopies
+{
+    private:
+    std::string m_folder;
+    std::vector<std::string> m_paths;
+
+    public:
+    explicit NoopCopies(unsigned count) {
+        char folderTemplate[] = "/tmp/fty-service-status-test-XXXXXX";
+        REQUIRE(mkdtemp(folderTemplate) != nullptr);
+        m_folder = folderTemplate;
+
+        for(unsigned i = 0; i < count; i++) {
+            const std::string path = m_folder + "/noop-" + std::to_string(i) + ".so";
+            std::ifstream source(NOOP_PLUGIN_PATH, std::ios::binary);
+            std::ofstream destination(path, std::ios::binary);
+            destination << source.rdbuf();
+            m_paths.push_back(path);
+        }
+    }
+
+    ~NoopCopies() {
+        for(auto & path : m_paths) {
+            unlink(path.c_str());
+        }
+        rmdir(m_folder.c_str());
+    }
+
+    const std::vector<std::string> & getPaths() const { return m_paths; }
+
+    static std::string getName(const std::string & path) { return path.substr(path.rfind('/') + 1); }
+};
+
+TEST_CASE( "Test reader counter arena", "[fty::detail::ReaderCounterArena]" ) {
+    using Arena = fty::detail::ReaderCounterArena;
+    const std::size_t initialBlocks = Arena::getBlockCount();
+
+    //the places are distinct, and the blocks are freed with their last place
+    std::vector<Arena::Place> places;
+    for(std::size_t i = 0; i <= Arena::PUBLISHERS_PER_LINE; i++) {
+        places.push_back(Arena::acquire());
+        for(std::size_t j = 0; j < i; j++) {
+            REQUIRE((places[j].block != places[i].block || places[j].index != places[i].index));
+        }
+    }
+    REQUIRE(Arena::getBlockCount() > initialBlocks);
+
+    for(const Arena::Place & place : places) {
+        Arena::release(place);
+    }
+    REQUIRE(Arena::getBlockCount() == initialBlocks);
+}
+
+TEST_CASE( "Test snapshot publisher", "[fty::detail::SnapshotPublisher]" ) {
+    //each snapshot holds values which are all equal
+    using Values = std::vector<int>;
+    fty::detail::SnapshotPublisher<Values> publisher(std::unique_ptr<const Values>(new Values(8, 0)));
+
+    std::atomic<bool> stop(false);
+    std::atomic<unsigned> inconsistent(0);
+    std::vector<std::thread> readers;
+    for(int i = 0; i < 4; i++) {
+        readers.emplace_back([&] () {
+            while(!stop) {
+                auto snapshot = publisher.read();
+                for(int value : *snapshot) {
+                    if(value != snapshot->front()) {
+                        inconsistent++;
+                    }
+                }
+                std::this_thread::yield();
+            }
+        });
+    }
+
+    for(int i = 1; i <= 500; i++) {
+        publisher.publish(std::unique_ptr<const Values>(new Values(8, i)));
+    }
+    stop = true;
+    for(auto & reader : readers) {
+        reader.join();
+    }
+
+    REQUIRE(inconsistent == 0);
+    REQUIRE(publisher.read()->front() == 500);
+}
+
+static void testConcurrentUpdates(bool async) {
+    const unsigned SETTERS = 4;
+    const unsigned ITERATIONS = 2000;
+
+    SleepPluginControl control;
+    NoopCopies copies(8);
+
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    collection.add(SLEEP_PLUGIN_PATH);
+    if(async) {
+        collection.enableAsyncDispatch(16, fty::OverflowPolicy::Block);
+    }
+
+    std::atomic<bool> stop(false);
+    std::atomic<unsigned> errors(0);
+
+    //add and remove the copies while the statuses are set
+    std::thread mutator([&] () {
+        while(!stop) {
+            for(auto & path : copies.getPaths()) {
+                try {
+                    collection.add(path);
+                }
+                catch(const std::exception &) {
+                    errors++;
+                }
+            }
+            collection.getPluginStats();
+            for(auto & path : copies.getPaths()) {
+                collection.remove(NoopCopies::getName(path));
+            }
+        }
+    });
+
+    std::vector<std::thread> setters;
+    for(unsigned i = 0; i < SETTERS; i++) {
+        setters.emplace_back([&collection, i] () {
+            for(unsigned j = 0; j < ITERATIONS; j++) {
+                if((i + j) % 2) {
+                    collection.setForAll(fty::OperatingStatus::InService);
+                } else {
+                    collection.setForAll(fty::HealthState::Ok);
+                }
+            }
+        });
+    }
+
+    for(auto & setter : setters) {
+        setter.join();
+    }
+    stop = true;
+    mutator.join();
+
+    REQUIRE(collection.flush(std::chrono::milliseconds(5000)));
+    REQUIRE(errors == 0);
+    REQUIRE(collection.getPluginCollection().size() == 1);
+
+    //the plugin which stayed in the collection received every update
+    REQUIRE(control.getSetCount() == SETTERS * ITERATIONS);
+    REQUIRE(collection.getPluginStats(SLEEP_PLUGIN_NAME).calls == SETTERS * ITERATIONS);
+}
+
+TEST_CASE( "Test concurrent setForAll while adding and removing plugins", "[fty::ServiceStatusPluginWrapperCollection]-concurrentSync" ) {
+    testConcurrentUpdates(false);
+}
+
+TEST_CASE( "Test concurrent asynchronous setForAll while adding and removing plugins", "[fty::ServiceStatusPluginWrapperCollection]-concurrentAsync" ) {
+    testConcurrentUpdates(true);
+}
+
+TEST_CASE( "Test concurrent dispatch mode changes", "[fty::ServiceStatusPluginWrapperCollection]-concurrentModes" ) {
+    SleepPluginControl control;
+
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    collection.add(SLEEP_PLUGIN_PATH);
+
+    std::atomic<bool> stop(false);
+    std::thread setter([&] () {
+        while(!stop) {
+            collection.setForAll(fty::OperatingStatus::InService);
+        }
+    });
+
+    for(int i = 0; i < 20; i++) {
+        collection.enableAsyncDispatch(8, fty::OverflowPolicy::Block);
+        collection.enableChangeSuppression();
+        collection.disableChangeSuppression();
+        collection.disableAsyncDispatch();
+    }
+    stop = true;
+    setter.join();
+
+    REQUIRE_FALSE(collection.isAsyncDispatchEnabled());
+    REQUIRE(control.getSetCount() == collection.getPluginStats(SLEEP_PLUGIN_NAME).calls);
+}
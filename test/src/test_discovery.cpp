@@ -0,0 +1,112 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+
+//Tests of the discovery of the plugins in a folder (glob matching and addAllWithReport)
+
+#include <fty_service_status.h>
+
+#include "test_plugins.h"
+
+#include <fstream>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <catch2/catch.hpp>
+
+TEST_CASE( "Test glob matching", "[fty::detail::globMatch]" ) {
+    REQUIRE(fty::detail::globMatch("*", ""));
+    REQUIRE(fty::detail::globMatch("*", "anything.so"));
+    REQUIRE(fty::detail::globMatch("*.so", "libexample.so"));
+    REQUIRE_FALSE(fty::detail::globMatch("*.so", "libexample.so.1"));
+    REQUIRE(fty::detail::globMatch("*.so*", "libexample.so.1"));
+    REQUIRE(fty::detail::globMatch("lib*status*.so", "libfty-status-file.so"));
+    REQUIRE_FALSE(fty::detail::globMatch("lib*status*.so", "libfty-file.so"));
+    REQUIRE(fty::detail::globMatch("lib?.so", "liba.so"));
+    REQUIRE_FALSE(fty::detail::globMatch("lib?.so", "libab.so"));
+    REQUIRE(fty::detail::globMatch("a*b*c", "aXbYbZc"));
+    REQUIRE_FALSE(fty::detail::globMatch("exact", "exactly"));
+}
+
+TEST_CASE( "Test listPathOfFolderElements with glob", "[fty::ServiceStatusProviderCollection]-listPathOfFolderElementsGlob" ) {
+    std::list<std::string> list = fty::ServiceStatusPluginWrapperCollection::listPathOfFolderElements(TEST_PLUGINS_FOLDER, "*sleep.so");
+
+    REQUIRE(list.size() == 1);
+}
+
+TEST_CASE( "Test collection addAll with glob", "[fty::ServiceStatusPluginWrapperCollection]-addAllGlob" ) {
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+
+    REQUIRE(collection.addAll(TEST_PLUGINS_FOLDER, "*.so") == 4);
+    REQUIRE(collection.getPluginCollection().count(SLEEP_PLUGIN_NAME) == 1);
+    REQUIRE(collection.getPluginCollection().count(SLEEP_V2_PLUGIN_NAME) == 1);
+    REQUIRE(collection.getPluginCollection().count(NOOP_PLUGIN_NAME) == 1);
+    REQUIRE(collection.getPluginCollection().count(STATIC_MEMORY_PLUGIN_NAME) == 1);
+}
+
+TEST_CASE( "Test collection addAllWithReport", "[fty::ServiceStatusPluginWrapperCollection]-addAllWithReport" ) {
+    //folder with valid plugins, an invalid file, a link and a directory
+    char folderTemplate[] = "/tmp/fty-service-status-test-XXXXXX";
+    REQUIRE(mkdtemp(folderTemplate) != nullptr);
+    const std::string folder(folderTemplate);
+
+    for(const char * name : {"a.so", "b.so"}) {
+        std::ifstream source(SLEEP_PLUGIN_PATH, std::ios::binary);
+        std::ofstream destination(folder + "/" + name, std::ios::binary);
+        destination << source.rdbuf();
+    }
+    std::ofstream(folder + "/fake.so") << "not a plugin";
+    REQUIRE(symlink((folder + "/a.so").c_str(), (folder + "/link.so").c_str()) == 0);
+    REQUIRE(mkdir((folder + "/dir.so").c_str(), 0700) == 0);
+
+    SECTION( "parallel load" ) {
+        fty::ServiceStatusPluginWrapperCollection collection("test-service");
+        std::vector<fty::PluginLoadResult> report = collection.addAllWithReport(folder, "*.so", 4);
+
+        REQUIRE(report.size() == 3);
+        REQUIRE(report[0].path.find("/a.so") != std::string::npos);
+        REQUIRE(report[0].added);
+        REQUIRE(report[0].pluginName == "a.so");
+        REQUIRE(report[1].path.find("/b.so") != std::string::npos);
+        REQUIRE(report[1].added);
+        REQUIRE(report[2].path.find("/fake.so") != std::string::npos);
+        REQUIRE_FALSE(report[2].added);
+        REQUIRE_FALSE(report[2].error.empty());
+        REQUIRE(collection.getPluginCollection().size() == 2);
+
+        //the plugins are already in the collection
+        report = collection.addAllWithReport(folder, std::regex("[ab]\\.so"));
+        REQUIRE(report.size() == 2);
+        REQUIRE_FALSE(report[0].added);
+        REQUIRE(report[0].error.find("already exist") != std::string::npos);
+    }
+
+    SECTION( "sequential load" ) {
+        fty::ServiceStatusPluginWrapperCollection collection("test-service");
+        REQUIRE(fty::ServiceStatusPluginWrapperCollection(
+            "other-service").addAllWithReport(folder, "*", 1).size() == 3);
+        REQUIRE(collection.addAll(folder, "?.so") == 2);
+    }
+
+    for(const char * name : {"a.so", "b.so", "fake.so", "link.so"}) {
+        unlink((folder + "/" + name).c_str());
+    }
+    rmdir((folder + "/dir.so").c_str());
+    rmdir(folder.c_str());
+}
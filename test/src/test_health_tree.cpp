@@ -0,0 +1,185 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+
+//Tests of ComponentHealthTree
+
+#include <fty_service_status.h>
+
+#include "test_plugins.h"
+
+#include <catch2/catch.hpp>
+
+#include <thread>
+
+using ComponentId = fty::ComponentHealthTree::ComponentId;
+
+TEST_CASE( "Test component tree worst Health State", "[fty::ComponentHealthTree]-health" ) {
+    fty::ComponentHealthTree tree;
+    REQUIRE(tree.getHealthState() == fty::HealthState::Unknown);
+
+    const ComponentId ups = tree.add("ups-1");
+    const ComponentId battery = tree.add("ups-1/battery", ups);
+    const ComponentId input = tree.add("ups-1/input", ups);
+    const ComponentId pdu = tree.add("pdu-1");
+    REQUIRE(tree.getComponentCount() == 4);
+    REQUIRE(tree.find("ups-1/battery") == battery);
+    REQUIRE(tree.find("unknown") == fty::ComponentHealthTree::NOT_FOUND);
+
+    tree.set(battery, fty::HealthState::Ok);
+    tree.set(input, fty::HealthState::Ok);
+    tree.set(pdu, fty::HealthState::Ok);
+    REQUIRE(tree.getHealthState() == fty::HealthState::Ok);
+
+    //the worst state rolls up to the ancestors only
+    tree.set(battery, fty::HealthState::MajorFailure);
+    REQUIRE(tree.getHealthState(battery) == fty::HealthState::MajorFailure);
+    REQUIRE(tree.getHealthState(ups) == fty::HealthState::MajorFailure);
+    REQUIRE(tree.getHealthState(input) == fty::HealthState::Ok);
+    REQUIRE(tree.getHealthState(pdu) == fty::HealthState::Ok);
+    REQUIRE(tree.getHealthState() == fty::HealthState::MajorFailure);
+
+    //a second failure keeps the worst state when the first one recovers
+    tree.set(pdu, fty::HealthState::Warning);
+    tree.set(input, fty::HealthState::MajorFailure);
+    tree.set(battery, fty::HealthState::Ok);
+    REQUIRE(tree.getHealthState(ups) == fty::HealthState::MajorFailure);
+    tree.set(input, fty::HealthState::Ok);
+    REQUIRE(tree.getHealthState(ups) == fty::HealthState::Ok);
+    REQUIRE(tree.getHealthState() == fty::HealthState::Warning);
+
+    //the own state of a component counts with its children
+    tree.set(ups, fty::HealthState::CriticalFailure);
+    REQUIRE(tree.getHealthState() == fty::HealthState::CriticalFailure);
+    REQUIRE(tree.getHealthState(battery) == fty::HealthState::Ok);
+}
+
+TEST_CASE( "Test component tree worst Operating Status", "[fty::ComponentHealthTree]-operating" ) {
+    fty::ComponentHealthTree tree;
+    const ComponentId ups = tree.add("ups-1");
+    const ComponentId sensor = tree.add("ups-1/sensor", ups);
+    const ComponentId pdu = tree.add("pdu-1");
+
+    tree.set(ups, fty::OperatingStatus::InService);
+    tree.set(sensor, fty::OperatingStatus::InService);
+    tree.set(pdu, fty::OperatingStatus::InService);
+    REQUIRE(tree.getOperatingStatus() == fty::OperatingStatus::InService);
+
+    tree.set(sensor, fty::OperatingStatus::Starting);
+    REQUIRE(tree.getOperatingStatus() == fty::OperatingStatus::Starting);
+    tree.set(pdu, fty::OperatingStatus::Stopped);
+    REQUIRE(tree.getOperatingStatus() == fty::OperatingStatus::Stopped);
+    REQUIRE(tree.getOperatingStatus(ups) == fty::OperatingStatus::Starting);
+
+    tree.set(pdu, fty::OperatingStatus::InService, fty::HealthState::Ok);
+    tree.set(sensor, fty::OperatingStatus::InService);
+    REQUIRE(tree.getOperatingStatus() == fty::OperatingStatus::InService);
+    REQUIRE(tree.getHealthState(pdu) == fty::HealthState::Ok);
+}
+
+TEST_CASE( "Test component tree removal", "[fty::ComponentHealthTree]-remove" ) {
+    fty::ComponentHealthTree tree;
+    const ComponentId ups = tree.add("ups-1");
+    const ComponentId battery = tree.add("ups-1/battery", ups);
+    const ComponentId cell = tree.add("ups-1/battery/cell-1", battery);
+    const ComponentId pdu = tree.add("pdu-1");
+
+    tree.set(cell, fty::HealthState::NonRecoverableFailure);
+    tree.set(pdu, fty::HealthState::Warning);
+    REQUIRE(tree.getHealthState() == fty::HealthState::NonRecoverableFailure);
+
+    REQUIRE_THROWS(tree.remove(fty::ComponentHealthTree::ROOT));
+    REQUIRE_THROWS(tree.set(fty::ComponentHealthTree::ROOT, fty::HealthState::Ok));
+
+    //the subtree is removed with its worst state
+    tree.remove(battery);
+    REQUIRE(tree.getComponentCount() == 2);
+    REQUIRE(tree.find("ups-1/battery/cell-1") == fty::ComponentHealthTree::NOT_FOUND);
+    REQUIRE_THROWS(tree.set(cell, fty::HealthState::Ok));
+    REQUIRE(tree.getHealthState(ups) == fty::HealthState::Unknown);
+    REQUIRE(tree.getHealthState() == fty::HealthState::Warning);
+
+    //the names and the identifiers can be reused
+    REQUIRE_THROWS(tree.add("pdu-1"));
+    REQUIRE_THROWS(tree.add("orphan", cell));
+    const ComponentId battery2 = tree.add("ups-1/battery", ups);
+    tree.set(battery2, fty::HealthState::MinorFailure);
+    REQUIRE(tree.getHealthState() == fty::HealthState::MinorFailure);
+}
+
+TEST_CASE( "Test component tree sets the collection on change only", "[fty::ComponentHealthTree]-forward" ) {
+    SleepPluginControl control;
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    REQUIRE_NOTHROW(collection.add(SLEEP_PLUGIN_PATH));
+
+    fty::ComponentHealthTree tree(collection);
+    std::vector<ComponentId> sensors;
+    for(unsigned i = 0; i < 100; i++) {
+        sensors.push_back(tree.add("sensor-" + std::to_string(i)));
+        tree.set(sensors.back(), fty::HealthState::Ok);
+    }
+    REQUIRE(tree.getForwardCount() == 1);
+    REQUIRE(control.getLastHealthState() == static_cast<int>(fty::HealthState::Ok));
+
+    //updates which do not change the worst state are not forwarded
+    const unsigned long calls = control.getSetCount();
+    tree.set(sensors[10], fty::HealthState::Warning);
+    tree.set(sensors[20], fty::HealthState::Warning);
+    tree.set(sensors[30], fty::HealthState::Ok);
+    REQUIRE(control.getSetCount() == calls + 1);
+    REQUIRE(control.getLastHealthState() == static_cast<int>(fty::HealthState::Warning));
+
+    tree.set(sensors[10], fty::HealthState::Ok);
+    REQUIRE(control.getSetCount() == calls + 1);
+    tree.set(sensors[20], fty::HealthState::Ok);
+    REQUIRE(control.getSetCount() == calls + 2);
+    REQUIRE(control.getLastHealthState() == static_cast<int>(fty::HealthState::Ok));
+
+    tree.set(sensors[0], fty::OperatingStatus::InService);
+    REQUIRE(control.getLastOperatingStatus() == static_cast<int>(fty::OperatingStatus::InService));
+    REQUIRE(tree.getForwardCount() == 4);
+}
+
+TEST_CASE( "Test component tree sets the current status after concurrent updates", "[fty::ComponentHealthTree]-concurrent" ) {
+    SleepPluginControl control;
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    REQUIRE_NOTHROW(collection.add(SLEEP_PLUGIN_PATH));
+
+    fty::ComponentHealthTree tree(collection);
+    std::vector<ComponentId> sensors;
+    for(unsigned i = 0; i < 4; i++) {
+        sensors.push_back(tree.add("sensor-" + std::to_string(i)));
+    }
+
+    //each thread flips its own sensor, the collection is called without the lock of the tree
+    std::vector<std::thread> writers;
+    for(ComponentId sensor : sensors) {
+        writers.emplace_back([&tree, sensor] () {
+            for(unsigned i = 0; i < 1000; i++) {
+                tree.set(sensor, (i % 2 == 0) ? fty::HealthState::Warning : fty::HealthState::Ok);
+            }
+        });
+    }
+    for(std::thread & writer : writers) {
+        writer.join();
+    }
+
+    //the last status set to the collection is the current one, never an older one
+    REQUIRE(tree.getHealthState() == fty::HealthState::Ok);
+    REQUIRE(control.getLastHealthState() == static_cast<int>(fty::HealthState::Ok));
+}
@@ -0,0 +1,280 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+
+//Tests of the hot reload of the plugins of a watched folder
+
+#include <fty_service_status_folder_watcher.h>
+
+#include "test_plugins.h"
+
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <thread>
+
+#include <unistd.h>
+
+#include <catch2/catch.hpp>
+
+const std::string EXAMPLE_PLUGIN_PATH = "../example/libfty-service-status-example.so";
+
+//temporary plugin folder, the files are installed like a package manager does
+class PluginFolder
+{
+    private:
+    std::string m_path;
+
+    public:
+    PluginFolder() {
+        char folderTemplate[] = "/tmp/fty-service-status-test-XXXXXX";
+        REQUIRE(mkdtemp(folderTemplate) != nullptr);
+        m_path = folderTemplate;
+    }
+
+    ~PluginFolder() {
+        for(const std::string & path : fty::ServiceStatusPluginWrapperCollection::listPathOfFolderElements(m_path)) {
+            unlink(path.c_str());
+        }
+        rmdir(m_path.c_str());
+    }
+
+    const std::string & getPath() const { return m_path; }
+
+    //write a temporary file and rename it over the plugin
+    void install(const std::string & source, const std::string & name) {
+        const std::string temporary = m_path + "/." + name + ".tmp";
+        {
+            std::ifstream in(source, std::ios::binary);
+            std::ofstream out(temporary, std::ios::binary);
+            out << in.rdbuf();
+        }
+        REQUIRE(std::rename(temporary.c_str(), (m_path + "/" + name).c_str()) == 0);
+    }
+
+    void uninstall(const std::string & name) {
+        REQUIRE(unlink((m_path + "/" + name).c_str()) == 0);
+    }
+};
+
+//the map of the plugins is copied under the lock, while the watcher changes the collection
+static bool contains(const fty::ServiceStatusPluginWrapperCollection & collection, const std::string & pluginName) {
+    return collection.getPluginCollectionCopy().count(pluginName) == 1;
+}
+
+static bool waitFor(const std::function<bool()> & condition) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while(!condition()) {
+        if(std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    return true;
+}
+
+TEST_CASE( "Test hot reload of a watched folder", "[fty::ServiceStatusPluginWrapperCollection]-watchFolder" ) {
+    PluginFolder folder;
+    folder.install(NOOP_PLUGIN_PATH, "a.so");
+
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    collection.watchFolder(folder.getPath(), "*.so", std::chrono::milliseconds(50));
+    REQUIRE(collection.isWatchingFolder());
+    REQUIRE(collection.getFolderReloadCount() == 1);
+    REQUIRE(contains(collection, "a.so"));
+
+    collection.setForAll(fty::HealthState::Ok);
+    collection.setForAll(fty::HealthState::Ok);
+    std::uint64_t reloads = collection.getFolderReloadCount();
+
+    SECTION( "add" ) {
+        folder.install(NOOP_PLUGIN_PATH, "b.so");
+        REQUIRE(waitFor([&] { return collection.getFolderReloadCount() > reloads; }));
+
+        std::vector<fty::PluginLoadResult> report = collection.getLastFolderReloadReport();
+        REQUIRE(report.size() == 1);
+        REQUIRE(report[0].pluginName == "b.so");
+        REQUIRE(report[0].added);
+        REQUIRE_FALSE(report[0].removed);
+        REQUIRE(collection.getPluginStats().size() == 2);
+
+        //the other plugin is untouched and the new one received the current status
+        REQUIRE(collection.getPluginStats("a.so").calls == 2);
+        REQUIRE(collection.getPluginStats("b.so").calls == 1);
+    }
+
+    SECTION( "replace" ) {
+        folder.install(NOOP_PLUGIN_PATH, "b.so");
+        REQUIRE(waitFor([&] { return collection.getFolderReloadCount() > reloads; }));
+        reloads = collection.getFolderReloadCount();
+
+        folder.install(NOOP_PLUGIN_PATH, "b.so");
+        REQUIRE(waitFor([&] { return collection.getFolderReloadCount() > reloads; }));
+
+        std::vector<fty::PluginLoadResult> report = collection.getLastFolderReloadReport();
+        REQUIRE(report.size() == 1);
+        REQUIRE(report[0].pluginName == "b.so");
+        REQUIRE(report[0].removed);
+        REQUIRE(report[0].added);
+        REQUIRE(collection.getPluginStats("a.so").calls == 2);
+    }
+
+    SECTION( "delete" ) {
+        folder.uninstall("a.so");
+        REQUIRE(waitFor([&] { return collection.getFolderReloadCount() > reloads; }));
+
+        std::vector<fty::PluginLoadResult> report = collection.getLastFolderReloadReport();
+        REQUIRE(report.size() == 1);
+        REQUIRE(report[0].removed);
+        REQUIRE_FALSE(report[0].added);
+        REQUIRE(collection.getPluginStats().empty());
+    }
+
+    SECTION( "invalid file" ) {
+        std::ofstream(folder.getPath() + "/fake.so") << "not a plugin";
+        REQUIRE(waitFor([&] { return collection.getFolderReloadCount() > reloads; }));
+
+        std::vector<fty::PluginLoadResult> report = collection.getLastFolderReloadReport();
+        REQUIRE(report.size() == 1);
+        REQUIRE_FALSE(report[0].added);
+        REQUIRE_FALSE(report[0].error.empty());
+        REQUIRE(collection.getPluginStats().size() == 1);
+    }
+
+    SECTION( "unwatch" ) {
+        collection.unwatchFolder();
+        REQUIRE_FALSE(collection.isWatchingFolder());
+
+        folder.install(NOOP_PLUGIN_PATH, "b.so");
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        REQUIRE(collection.getFolderReloadCount() == reloads);
+        REQUIRE(collection.getPluginStats().size() == 1);
+    }
+}
+
+TEST_CASE( "Test hot reload gives the current status", "[fty::ServiceStatusPluginWrapperCollection]-watchFolderStatus" ) {
+    PluginFolder folder;
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    collection.watchFolder(folder.getPath(), "*.so", std::chrono::milliseconds(50));
+
+    collection.setForAll(fty::OperatingStatus::InService);
+    collection.setForAll(fty::HealthState::Warning);
+
+    const std::uint64_t reloads = collection.getFolderReloadCount();
+    folder.install(SLEEP_PLUGIN_PATH, "sleep.so");
+    REQUIRE(waitFor([&] { return collection.getFolderReloadCount() > reloads; }));
+    REQUIRE(contains(collection, "sleep.so"));
+
+    SleepPluginControl control(folder.getPath() + "/sleep.so");
+    REQUIRE(control.getLastOperatingStatus() == static_cast<int>(fty::OperatingStatus::InService));
+    REQUIRE(control.getLastHealthState() == static_cast<int>(fty::HealthState::Warning));
+}
+
+TEST_CASE( "Test hot reload debounces the events", "[fty::ServiceStatusPluginWrapperCollection]-watchFolderDebounce" ) {
+    PluginFolder folder;
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    collection.watchFolder(folder.getPath(), "*.so", std::chrono::milliseconds(500));
+    const std::uint64_t reloads = collection.getFolderReloadCount();
+
+    //an upgrade writing the same plugins several times
+    for(int i = 0; i < 5; i++) {
+        for(const char * name : {"a.so", "b.so", "c.so"}) {
+            folder.install(NOOP_PLUGIN_PATH, name);
+        }
+    }
+
+    REQUIRE(waitFor([&] { return collection.getFolderReloadCount() > reloads; }));
+    std::this_thread::sleep_for(std::chrono::milliseconds(600));
+    REQUIRE(collection.getFolderReloadCount() == reloads + 1);
+    REQUIRE(collection.getLastFolderReloadReport().size() == 3);
+    REQUIRE(collection.getPluginStats().size() == 3);
+}
+
+TEST_CASE( "Test hot reload loads the new version of a plugin", "[fty::ServiceStatusPluginWrapperCollection]-watchFolderVersion" ) {
+    PluginFolder folder;
+    folder.install(EXAMPLE_PLUGIN_PATH, "a.so");
+
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    collection.watchFolder(folder.getPath(), "*.so", std::chrono::milliseconds(50));
+    REQUIRE(contains(collection, "Example plugin"));
+
+    //the example plugin stays in memory after it is closed
+    std::uint64_t reloads = collection.getFolderReloadCount();
+    folder.install(NOOP_PLUGIN_PATH, "a.so");
+    REQUIRE(waitFor([&] { return collection.getFolderReloadCount() > reloads; }));
+    REQUIRE_FALSE(contains(collection, "Example plugin"));
+    REQUIRE(contains(collection, "a.so"));
+
+    reloads = collection.getFolderReloadCount();
+    folder.install(EXAMPLE_PLUGIN_PATH, "a.so");
+    REQUIRE(waitFor([&] { return collection.getFolderReloadCount() > reloads; }));
+    REQUIRE(contains(collection, "Example plugin"));
+    REQUIRE_FALSE(contains(collection, "a.so"));
+}
+
+TEST_CASE( "Test hot reload keeps the plugins already added", "[fty::ServiceStatusPluginWrapperCollection]-watchFolderAdopt" ) {
+    PluginFolder folder;
+    folder.install(NOOP_PLUGIN_PATH, "a.so");
+
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    REQUIRE(collection.addAll(folder.getPath(), "*.so") == 1);
+    collection.setForAll(fty::HealthState::Ok);
+
+    collection.watchFolder(folder.getPath(), "*.so", std::chrono::milliseconds(50));
+    REQUIRE(collection.getLastFolderReloadReport().size() == 1);
+    REQUIRE(collection.getLastFolderReloadReport()[0].error.empty());
+    REQUIRE(collection.getPluginStats("a.so").calls == 1);
+
+    //the adopted plugin is reloaded when its file changes
+    const std::uint64_t reloads = collection.getFolderReloadCount();
+    folder.install(NOOP_PLUGIN_PATH, "a.so");
+    REQUIRE(waitFor([&] { return collection.getFolderReloadCount() > reloads; }));
+    REQUIRE(collection.getPluginStats("a.so").calls == 1);
+    REQUIRE(collection.getLastFolderReloadReport()[0].removed);
+}
+
+TEST_CASE( "Test hot reload while the status is set", "[fty::ServiceStatusPluginWrapperCollection]-watchFolderConcurrent" ) {
+    PluginFolder folder;
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    collection.watchFolder(folder.getPath(), "*.so", std::chrono::milliseconds(10));
+
+    std::atomic<bool> stop(false);
+    std::thread setter([&] () {
+        while(!stop) {
+            collection.setForAll(fty::HealthState::Ok);
+            collection.setForAll(fty::HealthState::Warning);
+        }
+    });
+
+    for(int i = 0; i < 10; i++) {
+        const std::uint64_t reloads = collection.getFolderReloadCount();
+        folder.install(NOOP_PLUGIN_PATH, "a.so");
+        REQUIRE(waitFor([&] { return collection.getFolderReloadCount() > reloads; }));
+    }
+
+    stop = true;
+    setter.join();
+    REQUIRE(collection.getPluginStats().size() == 1);
+}
+
+TEST_CASE( "Test watch of a missing folder", "[fty::ServiceStatusPluginWrapperCollection]-watchFolderMissing" ) {
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    REQUIRE_THROWS_AS(collection.watchFolder("/tmp/fty-service-status-missing-folder"), std::system_error);
+    REQUIRE_FALSE(collection.isWatchingFolder());
+}
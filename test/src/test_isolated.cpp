@@ -0,0 +1,210 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+
+//Tests of the plugins running in a host process
+
+#include <fty_service_status_isolated.h>
+#include <status_file_record.h>
+
+#include "test_plugins.h"
+
+#include <chrono>
+#include <cstdlib>
+#include <thread>
+
+#include <signal.h>
+
+#include <catch2/catch.hpp>
+
+static const std::string HOST_PATH = "../plugin-host/fty-service-status-plugin-host";
+static const std::string ISOLATED_FILE_PLUGIN_PATH = "../status-file/libfty-service-status-file.so";
+static const std::string ISOLATED_FILE_PLUGIN_NAME = "File plugin";
+
+//folder of the status file plugin loaded by the host, which inherits the environment
+class IsolatedFolder
+{
+    public:
+    std::string path;
+
+    IsolatedFolder() {
+        char folderTemplate[] = "/tmp/fty-service-status-isolated-XXXXXX";
+        REQUIRE(mkdtemp(folderTemplate) != nullptr);
+        path = folderTemplate;
+
+        setenv(statusfile::FOLDER_ENV, path.c_str(), 1);
+        setenv(statusfile::MODE_ENV, "rename", 1);
+        setenv(statusfile::SYNC_ENV, "none", 1);
+    }
+
+    ~IsolatedFolder() {
+        for(const char * name : {statusfile::FOLDER_ENV, statusfile::MODE_ENV, statusfile::SYNC_ENV}) {
+            unsetenv(name);
+        }
+        unlink(statusFile().c_str());
+        rmdir(path.c_str());
+    }
+
+    std::string statusFile() const {
+        return path + "/isolated-service" + statusfile::STATUS_FILE_EXTENSION;
+    }
+};
+
+static fty::IsolationSettings hostSettings(std::uint32_t ringCapacity = 256) {
+    fty::IsolationSettings settings;
+    settings.hostPath = HOST_PATH;
+    settings.ringCapacity = ringCapacity;
+    settings.restartDelay = std::chrono::milliseconds(10);
+    return settings;
+}
+
+//wait until the condition is true or the timeout expires
+template<typename Condition>
+static bool waitUntil(Condition condition, std::chrono::milliseconds timeout = std::chrono::milliseconds(5000)) {
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + timeout;
+    while(!condition()) {
+        if(std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+TEST_CASE( "Test isolated plugin delivery", "[fty::IsolatedServiceStatusProvider]-delivery" ) {
+    IsolatedFolder folder;
+    fty::ServiceStatusPluginWrapperCollection collection("isolated-service");
+
+    std::shared_ptr<fty::IsolatedServiceStatusProvider> provider;
+    REQUIRE_NOTHROW(provider = collection.addIsolated(ISOLATED_FILE_PLUGIN_PATH, hostSettings()));
+    REQUIRE(provider->getPluginName() == ISOLATED_FILE_PLUGIN_NAME);
+    REQUIRE(provider->isHostRunning());
+    REQUIRE(provider->getHostPid() != getpid());
+    REQUIRE_THROWS(collection.addIsolated(ISOLATED_FILE_PLUGIN_PATH, hostSettings()));
+
+    //the plugin is only loaded by the host
+    REQUIRE(collection.getPluginCollection().count(ISOLATED_FILE_PLUGIN_NAME) == 1);
+    REQUIRE_FALSE(collection.getPluginCollection().at(ISOLATED_FILE_PLUGIN_NAME).isLoaded());
+
+    collection.setForAll(fty::OperatingStatus::InService);
+    collection.setForAll(fty::HealthState::MinorFailure);
+    REQUIRE(provider->flush(std::chrono::milliseconds(5000)));
+    REQUIRE(provider->getProcessedCount() == 2);
+    REQUIRE(provider->getFailedCount() == 0);
+
+    statusfile::StatusRecord record;
+    REQUIRE(statusfile::readStatusFile(folder.statusFile(), record));
+    REQUIRE(record.operatingStatus == static_cast<std::uint8_t>(fty::OperatingStatus::InService));
+    REQUIRE(record.healthState == static_cast<std::uint8_t>(fty::HealthState::MinorFailure));
+
+    //the host stops once the plugin is removed
+    const pid_t pid = provider->getHostPid();
+    collection.remove(ISOLATED_FILE_PLUGIN_NAME);
+    provider.reset();
+    REQUIRE(waitUntil([pid] { return kill(pid, 0) != 0; }));
+}
+
+TEST_CASE( "Test isolated plugin errors", "[fty::IsolatedServiceStatusProvider]-errors" ) {
+    fty::ServiceStatusPluginWrapperCollection collection("isolated-service");
+
+    REQUIRE_THROWS_AS(collection.addIsolated(ISOLATED_FILE_PLUGIN_PATH, hostSettings(100)), std::invalid_argument);
+    REQUIRE_THROWS_AS(collection.addIsolated("../unknown.so", hostSettings()), std::runtime_error);
+
+    fty::IsolationSettings missingHost = hostSettings();
+    missingHost.hostPath = "../plugin-host/unknown-host";
+    REQUIRE_THROWS_AS(collection.addIsolated(ISOLATED_FILE_PLUGIN_PATH, missingHost), std::runtime_error);
+    REQUIRE(collection.getPluginCollection().empty());
+}
+
+TEST_CASE( "Test isolated plugin restart", "[fty::IsolatedServiceStatusProvider]-restart" ) {
+    IsolatedFolder folder;
+    fty::ServiceStatusPluginWrapperCollection collection("isolated-service");
+    std::shared_ptr<fty::IsolatedServiceStatusProvider> provider = collection.addIsolated(ISOLATED_FILE_PLUGIN_PATH, hostSettings());
+
+    collection.setForAll(fty::OperatingStatus::Servicing);
+    collection.setForAll(fty::HealthState::Warning);
+    REQUIRE(provider->flush(std::chrono::milliseconds(5000)));
+
+    //the restarted host receives the last status
+    unlink(folder.statusFile().c_str());
+    const pid_t pid = provider->getHostPid();
+    REQUIRE(kill(pid, SIGKILL) == 0);
+    REQUIRE(waitUntil([&] { return provider->getRestartCount() == 1 && provider->isHostRunning(); }));
+    REQUIRE(provider->getHostPid() != pid);
+    REQUIRE(provider->flush(std::chrono::milliseconds(5000)));
+
+    statusfile::StatusRecord record;
+    REQUIRE(statusfile::readStatusFile(folder.statusFile(), record));
+    REQUIRE(record.operatingStatus == static_cast<std::uint8_t>(fty::OperatingStatus::Servicing));
+    REQUIRE(record.healthState == static_cast<std::uint8_t>(fty::HealthState::Warning));
+
+    //the updates go on with the new host
+    collection.setForAll(fty::HealthState::Ok);
+    REQUIRE(provider->flush(std::chrono::milliseconds(5000)));
+    REQUIRE(statusfile::readStatusFile(folder.statusFile(), record));
+    REQUIRE(record.healthState == static_cast<std::uint8_t>(fty::HealthState::Ok));
+}
+
+TEST_CASE( "Test isolated plugin when the children are reaped by the system", "[fty::IsolatedServiceStatusProvider]-sigchld" ) {
+    IsolatedFolder folder;
+
+    //the exit of the host is not detected by waitpid, which fails with ECHILD
+    struct sigaction ignore = {};
+    struct sigaction previous;
+    ignore.sa_handler = SIG_IGN;
+    REQUIRE(sigaction(SIGCHLD, &ignore, &previous) == 0);
+    {
+        fty::ServiceStatusPluginWrapperCollection collection("isolated-service");
+        std::shared_ptr<fty::IsolatedServiceStatusProvider> provider = collection.addIsolated(ISOLATED_FILE_PLUGIN_PATH, hostSettings());
+        const pid_t pid = provider->getHostPid();
+
+        //a running host is not restarted
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        REQUIRE(provider->getRestartCount() == 0);
+        REQUIRE(provider->getHostPid() == pid);
+        collection.setForAll(fty::HealthState::Warning);
+        REQUIRE(provider->flush(std::chrono::milliseconds(5000)));
+
+        //a dead host is restarted once
+        REQUIRE(kill(pid, SIGKILL) == 0);
+        REQUIRE(waitUntil([&] { return provider->getRestartCount() == 1 && provider->isHostRunning(); }));
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        REQUIRE(provider->getRestartCount() == 1);
+    }
+    sigaction(SIGCHLD, &previous, nullptr);
+}
+
+TEST_CASE( "Test isolated plugin with a full ring", "[fty::IsolatedServiceStatusProvider]-overflow" ) {
+    IsolatedFolder folder;
+    fty::ServiceStatusPluginWrapperCollection collection("isolated-service");
+    std::shared_ptr<fty::IsolatedServiceStatusProvider> provider = collection.addIsolated(ISOLATED_FILE_PLUGIN_PATH, hostSettings(2));
+
+    //the updates dropped by the full ring are replaced by the latest status
+    const fty::HealthState states[] = {fty::HealthState::Ok, fty::HealthState::Warning, fty::HealthState::MajorFailure};
+    const unsigned updates = 2000;
+    for(unsigned i = 0; i < updates; i++) {
+        collection.setForAll(states[i % 3]);
+    }
+    REQUIRE(provider->flush(std::chrono::milliseconds(5000)));
+    REQUIRE(provider->getProcessedCount() <= updates);
+    REQUIRE(provider->getProcessedCount() + provider->getOverflowCount() >= updates);
+
+    statusfile::StatusRecord record;
+    REQUIRE(statusfile::readStatusFile(folder.statusFile(), record));
+    REQUIRE(record.healthState == static_cast<std::uint8_t>(states[(updates - 1) % 3]));
+}
@@ -0,0 +1,231 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+
+//Tests of the timer wheel and of the keepalive of ServiceStatusPluginWrapperCollection
+
+#include <fty_service_status_keepalive.h>
+
+#include "test_plugins.h"
+
+#include <chrono>
+#include <thread>
+
+#include <catch2/catch.hpp>
+
+//wait until the condition is true or the timeout expires
+template<typename Condition>
+static bool waitFor(Condition condition, std::chrono::milliseconds timeout = std::chrono::milliseconds(5000)) {
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + timeout;
+    while(!condition()) {
+        if(std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+static fty::KeepaliveSettings fastKeepalive(unsigned intervalMs = 20) {
+    fty::KeepaliveSettings settings;
+    settings.interval = std::chrono::milliseconds(intervalMs);
+    settings.jitter = std::chrono::milliseconds(2);
+    return settings;
+}
+
+TEST_CASE( "Test timer wheel expiries", "[fty::detail::TimerWheel]-expiry" ) {
+    fty::detail::TimerWheel wheel;
+
+    //one timer in each level, and one beyond the range of the wheel
+    const std::vector<std::uint64_t> expiries = {1, 63, 64, 65, 4095, 4096, 300000, 20000000};
+    for(std::size_t i = 0; i < expiries.size(); i++) {
+        wheel.add(i, expiries[i]);
+    }
+    REQUIRE(wheel.size() == expiries.size());
+
+    //each timer expires on its tick, advancing one tick at a time or by steps
+    std::vector<std::uint64_t> expired;
+    for(std::size_t i = 0; i < expiries.size(); i++) {
+        wheel.advance(expiries[i] - 1, expired);
+        REQUIRE(expired.size() == i);
+        wheel.advance(expiries[i], expired);
+        REQUIRE(expired.size() == i + 1);
+        REQUIRE(expired.back() == i);
+    }
+    REQUIRE(wheel.size() == 0);
+
+    //a past expiry expires on the next tick
+    wheel.add(100, 5);
+    wheel.advance(wheel.getCurrentTick() + 1, expired);
+    REQUIRE(expired.back() == 100);
+}
+
+TEST_CASE( "Test keepalive scheduler", "[fty::KeepaliveScheduler]-timers" ) {
+    std::shared_ptr<fty::KeepaliveScheduler> scheduler = std::make_shared<fty::KeepaliveScheduler>(std::chrono::milliseconds(1));
+
+    std::atomic<unsigned> periodic(0);
+    std::atomic<unsigned> once(0);
+    const std::int64_t period = 5000000;
+    scheduler->add(fty::detail::monotonicNs() + period, std::chrono::nanoseconds(0), [&periodic, period](std::int64_t now) {
+        periodic++;
+        return now + period;
+    });
+    scheduler->add(fty::detail::monotonicNs(), std::chrono::nanoseconds(0), [&once](std::int64_t) {
+        once++;
+        return std::int64_t(-1);
+    });
+
+    REQUIRE(waitFor([&] { return periodic >= 5 && once == 1; }));
+    REQUIRE(scheduler->getTimerCount() == 1);
+
+    //a timer removing itself
+    std::uint64_t id = 0;
+    std::atomic<unsigned> self(0);
+    id = scheduler->add(fty::detail::monotonicNs() + period, std::chrono::nanoseconds(0), [&](std::int64_t now) {
+        self++;
+        scheduler->remove(id);
+        return now + period;
+    });
+    REQUIRE(waitFor([&] { return self == 1; }));
+    REQUIRE(waitFor([&] { return scheduler->getTimerCount() == 1; }));
+}
+
+TEST_CASE( "Test keepalive settings", "[fty::ServiceStatusPluginWrapperCollection]-keepaliveSettings" ) {
+    std::shared_ptr<fty::KeepaliveScheduler> scheduler = std::make_shared<fty::KeepaliveScheduler>(std::chrono::milliseconds(1));
+
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    REQUIRE_NOTHROW(collection.add(SLEEP_PLUGIN_PATH));
+    REQUIRE_FALSE(collection.isKeepaliveEnabled());
+
+    fty::KeepaliveSettings invalid;
+    invalid.interval = std::chrono::milliseconds(0);
+    REQUIRE_THROWS(collection.enableKeepalive(invalid, scheduler));
+    REQUIRE_THROWS(collection.setKeepaliveSettings(SLEEP_PLUGIN_NAME, invalid));
+    REQUIRE_FALSE(collection.isKeepaliveEnabled());
+
+    //the scheduler thread only queues the updates, to the dispatchers enabled by the service
+    REQUIRE_THROWS_AS(collection.enableKeepalive(fty::KeepaliveSettings(), scheduler), std::runtime_error);
+    REQUIRE_FALSE(collection.isKeepaliveEnabled());
+    REQUIRE_FALSE(collection.isAsyncDispatchEnabled());
+    REQUIRE(scheduler->getTimerCount() == 0);
+
+    //one timer per plugin, following the plugins of the collection
+    collection.enableAsyncDispatch();
+    REQUIRE_NOTHROW(collection.enableKeepalive(fty::KeepaliveSettings(), scheduler));
+    REQUIRE(collection.isKeepaliveEnabled());
+    REQUIRE(scheduler->getTimerCount() == 1);
+
+    REQUIRE_NOTHROW(collection.add(SLEEP_V2_PLUGIN_PATH));
+    REQUIRE(scheduler->getTimerCount() == 2);
+
+    collection.remove(SLEEP_PLUGIN_NAME);
+    REQUIRE(scheduler->getTimerCount() == 1);
+
+    //the dispatchers replace the timers of the plugins
+    collection.enableAsyncDispatch();
+    REQUIRE(scheduler->getTimerCount() == 1);
+
+    collection.disableKeepalive();
+    REQUIRE_FALSE(collection.isKeepaliveEnabled());
+    REQUIRE(scheduler->getTimerCount() == 0);
+
+    //the keepalive stops with the asynchronous dispatch
+    REQUIRE_NOTHROW(collection.enableKeepalive(fty::KeepaliveSettings(), scheduler));
+    collection.disableAsyncDispatch();
+    REQUIRE_FALSE(collection.isKeepaliveEnabled());
+    REQUIRE(scheduler->getTimerCount() == 0);
+}
+
+TEST_CASE( "Test keepalive re-asserts the last status", "[fty::ServiceStatusPluginWrapperCollection]-keepaliveReassert" ) {
+    SleepPluginControl control;
+    std::shared_ptr<fty::KeepaliveScheduler> scheduler = std::make_shared<fty::KeepaliveScheduler>(std::chrono::milliseconds(1));
+
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    REQUIRE_NOTHROW(collection.add(SLEEP_PLUGIN_PATH));
+    collection.enableChangeSuppression();
+    collection.enableAsyncDispatch();
+
+    //nothing to re-assert before the first status
+    REQUIRE_NOTHROW(collection.enableKeepalive(fastKeepalive(), scheduler));
+    std::this_thread::sleep_for(std::chrono::milliseconds(60));
+    REQUIRE(collection.getKeepaliveCount() == 0);
+
+    collection.setForAll(fty::OperatingStatus::InService);
+    collection.setForAll(fty::HealthState::Warning);
+    REQUIRE(collection.flush(std::chrono::milliseconds(1000)));
+    const unsigned long calls = control.getSetCount();
+
+    //the unchanged values are suppressed, but re-asserted by the keepalive
+    collection.setForAll(fty::OperatingStatus::InService);
+    REQUIRE(waitFor([&] { return collection.getKeepaliveCount() >= 2 && control.getSetCount() >= calls + 4; }));
+    REQUIRE(control.getLastOperatingStatus() == static_cast<int>(fty::OperatingStatus::InService));
+    REQUIRE(control.getLastHealthState() == static_cast<int>(fty::HealthState::Warning));
+
+    //the re-assertion follows the new values
+    collection.setForAll(fty::OperatingStatus::Stopped);
+    const std::uint64_t keepalives = collection.getKeepaliveCount();
+    REQUIRE(waitFor([&] { return collection.getKeepaliveCount() >= keepalives + 2; }));
+    REQUIRE(collection.flush(std::chrono::milliseconds(1000)));
+    REQUIRE(control.getLastOperatingStatus() == static_cast<int>(fty::OperatingStatus::Stopped));
+}
+
+TEST_CASE( "Test keepalive skips the fresh plugins", "[fty::ServiceStatusPluginWrapperCollection]-keepaliveFresh" ) {
+    SleepPluginControl control;
+    std::shared_ptr<fty::KeepaliveScheduler> scheduler = std::make_shared<fty::KeepaliveScheduler>(std::chrono::milliseconds(1));
+
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    REQUIRE_NOTHROW(collection.add(SLEEP_PLUGIN_PATH));
+    REQUIRE_NOTHROW(collection.enableAsyncDispatch());
+    REQUIRE_NOTHROW(collection.enableKeepalive(fastKeepalive(50), scheduler));
+
+    //a plugin receiving a status more often than the interval is never re-asserted
+    const std::chrono::steady_clock::time_point end = std::chrono::steady_clock::now() + std::chrono::milliseconds(300);
+    while(std::chrono::steady_clock::now() < end) {
+        collection.setForAll(fty::HealthState::Ok);
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    REQUIRE(collection.getKeepaliveCount() == 0);
+    REQUIRE(collection.getFreshKeepaliveCount() > 0);
+
+    //once the updates stop, it is re-asserted
+    REQUIRE(waitFor([&] { return collection.getKeepaliveCount() > 0; }));
+}
+
+TEST_CASE( "Test keepalive settings of one plugin", "[fty::ServiceStatusPluginWrapperCollection]-keepalivePlugin" ) {
+    SleepPluginControl v1Control(SLEEP_PLUGIN_PATH);
+    SleepPluginControl v2Control(SLEEP_V2_PLUGIN_PATH);
+    std::shared_ptr<fty::KeepaliveScheduler> scheduler = std::make_shared<fty::KeepaliveScheduler>(std::chrono::milliseconds(1));
+
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    REQUIRE_NOTHROW(collection.add(SLEEP_PLUGIN_PATH));
+    REQUIRE_NOTHROW(collection.add(SLEEP_V2_PLUGIN_PATH));
+
+    fty::KeepaliveSettings slow;
+    slow.interval = std::chrono::milliseconds(60000);
+    REQUIRE_NOTHROW(collection.setKeepaliveSettings(SLEEP_V2_PLUGIN_NAME, slow));
+    REQUIRE_NOTHROW(collection.enableAsyncDispatch());
+    REQUIRE_NOTHROW(collection.enableKeepalive(fastKeepalive(), scheduler));
+
+    collection.setForAll(fty::OperatingStatus::InService);
+    REQUIRE(collection.flush(std::chrono::milliseconds(1000)));
+    const unsigned long v1Calls = v1Control.getSetCount();
+    const unsigned long v2Calls = v2Control.getSetCount();
+
+    REQUIRE(waitFor([&] { return v1Control.getSetCount() >= v1Calls + 3; }));
+    REQUIRE(v2Control.getSetCount() == v2Calls);
+}
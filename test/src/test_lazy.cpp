@@ -0,0 +1,128 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+
+//Tests of the lazy loading of the plugins, using the example plugin
+
+#include <fty_service_status.h>
+
+#include <fstream>
+#include <thread>
+
+#include <dlfcn.h>
+
+#include <catch2/catch.hpp>
+
+static const std::string EXAMPLE_PATH = "../example/libfty-service-status-example.so";
+static const std::string EXAMPLE_NAME = "Example plugin";
+
+//check if the library is mapped in the process, without loading it
+static bool isMapped(const std::string & path) {
+    void * handle = dlopen(path.c_str(), RTLD_LAZY | RTLD_NOLOAD);
+    if(handle != nullptr) {
+        dlclose(handle);
+    }
+    return handle != nullptr;
+}
+
+static int readStatus(const std::string & fileName) {
+    std::ifstream file(fileName);
+    int value = -1;
+    file >> value;
+    return value;
+}
+
+TEST_CASE( "Lazy plugin wrapper", "[fty::ServiceStatusPluginWrapper]-lazy" ) {
+    fty::ServiceStatusPluginWrapper plugin(EXAMPLE_PATH, EXAMPLE_NAME, fty::LoadMode::Lazy);
+
+    REQUIRE_FALSE(plugin.isLoaded());
+    REQUIRE_FALSE(isMapped(EXAMPLE_PATH));
+    REQUIRE(plugin.getPluginName() == EXAMPLE_NAME);
+    REQUIRE(plugin.getPluginPath() == EXAMPLE_PATH);
+
+    fty::ServiceStatusProviderPtr provider = plugin.newServiceStatusProviderPtr("lazy-service");
+    REQUIRE(plugin.isLoaded());
+    REQUIRE(std::string(provider->getServiceName()) == "lazy-service");
+
+    //the provider keeps the plugin loaded
+    plugin.unload();
+    REQUIRE_FALSE(plugin.isLoaded());
+    REQUIRE(isMapped(EXAMPLE_PATH));
+    REQUIRE(provider->set(fty::HealthState::Ok) == 0);
+
+    provider.reset();
+    REQUIRE_FALSE(isMapped(EXAMPLE_PATH));
+}
+
+TEST_CASE( "Lazy plugin wrapper with a wrong name", "[fty::ServiceStatusPluginWrapper]-lazyWrongName" ) {
+    REQUIRE_THROWS(fty::ServiceStatusPluginWrapper(EXAMPLE_PATH, "", fty::LoadMode::Lazy));
+    REQUIRE_THROWS(fty::ServiceStatusPluginWrapper(EXAMPLE_PATH, "Other plugin", fty::LoadMode::Now));
+
+    fty::ServiceStatusPluginWrapper plugin(EXAMPLE_PATH, "Other plugin", fty::LoadMode::Lazy);
+    REQUIRE_THROWS(plugin.load());
+    REQUIRE_FALSE(plugin.isLoaded());
+}
+
+TEST_CASE( "Test collection addLazy", "[fty::ServiceStatusPluginWrapperCollection]-addLazy" ) {
+    fty::ServiceStatusPluginWrapperCollection collection("lazy-service");
+
+    REQUIRE_NOTHROW(collection.addLazy(EXAMPLE_PATH, EXAMPLE_NAME));
+    REQUIRE_THROWS(collection.addLazy(EXAMPLE_PATH, EXAMPLE_NAME));
+    REQUIRE_THROWS(collection.add(EXAMPLE_PATH));
+    REQUIRE(collection.getPluginCollection().size() == 1);
+    REQUIRE_FALSE(isMapped(EXAMPLE_PATH));
+
+    //loaded by the first update
+    collection.setForAll(fty::OperatingStatus::Dormant);
+    REQUIRE(isMapped(EXAMPLE_PATH));
+    REQUIRE(readStatus("lazy-service.operating") == static_cast<int>(fty::OperatingStatus::Dormant));
+
+    //released when idle
+    REQUIRE(collection.unloadIdlePlugins(std::chrono::milliseconds(1000)) == 0);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    REQUIRE(collection.unloadIdlePlugins(std::chrono::milliseconds(10)) == 1);
+    REQUIRE_FALSE(isMapped(EXAMPLE_PATH));
+
+    //and loaded again
+    collection.setForAll(fty::OperatingStatus::InService);
+    REQUIRE(isMapped(EXAMPLE_PATH));
+    REQUIRE(readStatus("lazy-service.operating") == static_cast<int>(fty::OperatingStatus::InService));
+
+    collection.remove(EXAMPLE_NAME);
+    REQUIRE_FALSE(isMapped(EXAMPLE_PATH));
+}
+
+TEST_CASE( "Test collection addLazy with async dispatch", "[fty::ServiceStatusPluginWrapperCollection]-addLazyAsync" ) {
+    fty::ServiceStatusPluginWrapperCollection collection("lazy-async-service");
+    REQUIRE_NOTHROW(collection.enableAsyncDispatch());
+    REQUIRE_NOTHROW(collection.addLazy(EXAMPLE_PATH, EXAMPLE_NAME));
+
+    collection.setForAll(fty::HealthState::Warning);
+    REQUIRE(collection.flush(std::chrono::milliseconds(5000)));
+    REQUIRE(readStatus("lazy-async-service.health") == static_cast<int>(fty::HealthState::Warning));
+}
+
+TEST_CASE( "Test collection addLazy with a missing plugin", "[fty::ServiceStatusPluginWrapperCollection]-addLazyMissing" ) {
+    fty::ServiceStatusPluginWrapperCollection collection("lazy-service");
+
+    //nothing is checked before the first update
+    REQUIRE_NOTHROW(collection.addLazy("do-not-exist.so", "Missing plugin"));
+    REQUIRE_NOTHROW(collection.setForAll(fty::OperatingStatus::InService));
+    REQUIRE_NOTHROW(collection.setForAll(fty::OperatingStatus::InService));
+    REQUIRE(collection.unloadIdlePlugins(std::chrono::milliseconds(0)) == 0);
+}
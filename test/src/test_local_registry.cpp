@@ -0,0 +1,175 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+
+//Tests of the registry of the statuses in the process
+
+#include <fty_service_status.h>
+
+#include "test_plugins.h"
+
+#include <thread>
+
+#include <catch2/catch.hpp>
+
+TEST_CASE( "Local status registry", "[fty::LocalStatusRegistry]" ) {
+    fty::LocalStatusRegistry registry(3);
+    REQUIRE(registry.getCapacity() == 3);
+    REQUIRE(registry.getServiceCount() == 0);
+    REQUIRE(registry.find("service-1") == fty::LocalStatusRegistry::NOT_FOUND);
+
+    const std::size_t index = registry.addService("service-1");
+    REQUIRE(registry.addService("service-1") == index);
+    REQUIRE(registry.addService("service-2") != index);
+    REQUIRE(registry.find("service-1") == index);
+    REQUIRE(registry.getServiceName(index) == "service-1");
+    REQUIRE(registry.getServiceCount() == 2);
+
+    //never set
+    fty::LocalStatus status = registry.get("service-1");
+    REQUIRE(status.operatingStatus == fty::OperatingStatus::Unknown);
+    REQUIRE(status.healthState == fty::HealthState::Unknown);
+    REQUIRE(status.transitionTime == 0);
+    REQUIRE(registry.get("unknown").transitionTime == 0);
+
+    const std::int64_t before = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    registry.set(index, fty::OperatingStatus::InService);
+    registry.set(index, fty::HealthState::Warning);
+    status = registry.get(index);
+    REQUIRE(status.operatingStatus == fty::OperatingStatus::InService);
+    REQUIRE(status.healthState == fty::HealthState::Warning);
+    REQUIRE(status.transitionTime >= before);
+
+    //the transition time only changes with the status
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    registry.set(index, fty::OperatingStatus::InService);
+    REQUIRE(registry.get(index).transitionTime == status.transitionTime);
+    registry.set(index, fty::OperatingStatus::Stopping, fty::HealthState::NonRecoverableFailure);
+    REQUIRE(registry.get(index).transitionTime > status.transitionTime);
+    REQUIRE(registry.get(index).operatingStatus == fty::OperatingStatus::Stopping);
+    REQUIRE(registry.get(index).healthState == fty::HealthState::NonRecoverableFailure);
+
+    //the other services are not changed
+    REQUIRE(registry.get("service-2").transitionTime == 0);
+    registry.set(fty::LocalStatusRegistry::NOT_FOUND, fty::HealthState::Ok);
+
+    registry.addService("service-3");
+    REQUIRE_THROWS_AS(registry.addService("service-4"), std::length_error);
+    REQUIRE(registry.find("service-3") != fty::LocalStatusRegistry::NOT_FOUND);
+}
+
+TEST_CASE( "Subscription to the local status registry", "[fty::LocalStatusRegistry]-subscribe" ) {
+    fty::LocalStatusRegistry registry(8);
+    const std::size_t index = registry.addService("service-1");
+
+    std::vector<fty::LocalStatusChange> changes;
+    unsigned otherCalls = 0;
+    const std::uint64_t id = registry.subscribe([&changes] (const fty::LocalStatusChange & change) { changes.push_back(change); });
+    const std::uint64_t otherId = registry.subscribe([&otherCalls] (const fty::LocalStatusChange &) { otherCalls++; throw std::runtime_error("ignored"); });
+    REQUIRE(id != otherId);
+
+    registry.set(index, fty::OperatingStatus::Starting);
+    registry.set(index, fty::OperatingStatus::Starting);
+    registry.set(index, fty::OperatingStatus::InService, fty::HealthState::Ok);
+    REQUIRE(changes.size() == 2);
+    REQUIRE(otherCalls == 2);
+    REQUIRE(changes[0].index == index);
+    REQUIRE(*changes[0].serviceName == "service-1");
+    REQUIRE(changes[0].previous.operatingStatus == fty::OperatingStatus::Unknown);
+    REQUIRE(changes[0].current.operatingStatus == fty::OperatingStatus::Starting);
+    REQUIRE(changes[1].previous.operatingStatus == fty::OperatingStatus::Starting);
+    REQUIRE(changes[1].current.operatingStatus == fty::OperatingStatus::InService);
+    REQUIRE(changes[1].current.healthState == fty::HealthState::Ok);
+
+    registry.unsubscribe(id);
+    registry.set(index, fty::HealthState::MinorFailure);
+    REQUIRE(changes.size() == 2);
+    REQUIRE(otherCalls == 3);
+    registry.unsubscribe(otherId);
+}
+
+TEST_CASE( "Local status registry provider", "[fty::LocalStatusRegistry]-provider" ) {
+    std::shared_ptr<fty::LocalStatusRegistry> registry = std::make_shared<fty::LocalStatusRegistry>(4);
+    fty::ServiceStatusProviderPtr provider = fty::LocalStatusRegistry::newProvider(registry, "service-1");
+
+    REQUIRE(std::string(provider->getServiceName()) == "service-1");
+    REQUIRE(provider->set(fty::OperatingStatus::Dormant) == 0);
+    REQUIRE(provider->set(fty::HealthState::CriticalFailure) == 0);
+    REQUIRE(registry->get("service-1").operatingStatus == fty::OperatingStatus::Dormant);
+    REQUIRE(registry->get("service-1").healthState == fty::HealthState::CriticalFailure);
+}
+
+TEST_CASE( "Collection recording in the local status registry", "[fty::ServiceStatusPluginWrapperCollection]-localRegistry" ) {
+    std::shared_ptr<fty::LocalStatusRegistry> registry = std::make_shared<fty::LocalStatusRegistry>(4);
+    SleepPluginControl control;
+
+    fty::ServiceStatusPluginWrapperCollection collection("local-service");
+    collection.add(SLEEP_PLUGIN_PATH);
+    REQUIRE(collection.getLocalStatusRegistry() == nullptr);
+
+    //the last status is recorded when the registry is given
+    collection.setForAll(fty::OperatingStatus::Starting);
+    collection.setLocalStatusRegistry(registry);
+    REQUIRE(collection.getLocalStatusRegistry() == registry);
+    REQUIRE(registry->get("local-service").operatingStatus == fty::OperatingStatus::Starting);
+    REQUIRE(registry->get("local-service").healthState == fty::HealthState::Unknown);
+
+    //the status is recorded even if the plugin fails
+    control.configure(0, -1);
+    collection.setForAll(fty::OperatingStatus::InService);
+    collection.setForAll(fty::HealthState::Ok);
+    REQUIRE(registry->get("local-service").operatingStatus == fty::OperatingStatus::InService);
+    REQUIRE(registry->get("local-service").healthState == fty::HealthState::Ok);
+
+    collection.setLocalStatusRegistry(nullptr);
+    collection.setForAll(fty::HealthState::Warning);
+    REQUIRE(registry->get("local-service").healthState == fty::HealthState::Ok);
+}
+
+TEST_CASE( "Concurrent reads of the local status registry", "[fty::LocalStatusRegistry]-concurrent" ) {
+    fty::LocalStatusRegistry registry(64);
+    std::atomic<bool> stop(false);
+    std::atomic<unsigned> inconsistent(0);
+
+    //the writer sets the same value in both statuses, a reader must never see them differ
+    std::thread reader([&] {
+        while(!stop) {
+            for(std::size_t index = 0; index < registry.getServiceCount(); index++) {
+                fty::LocalStatus status = registry.get(index);
+                if(status.transitionTime != 0 && static_cast<int>(status.operatingStatus) * 5 != static_cast<int>(status.healthState)) {
+                    inconsistent++;
+                }
+            }
+        }
+    });
+
+    for(unsigned round = 0; round < 100; round++) {
+        for(unsigned service = 0; service < 64; service++) {
+            const std::size_t index = registry.addService("service-" + std::to_string(service));
+            const unsigned value = 1 + (round % 6);
+            registry.set(index, static_cast<fty::OperatingStatus>(value), static_cast<fty::HealthState>(value * 5));
+        }
+    }
+    stop = true;
+    reader.join();
+
+    REQUIRE(inconsistent == 0);
+    REQUIRE(registry.getServiceCount() == 64);
+    REQUIRE(registry.find("service-63") != fty::LocalStatusRegistry::NOT_FOUND);
+}
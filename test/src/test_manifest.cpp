@@ -0,0 +1,206 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+
+//Tests of the cache of the plugin files probed by addAll
+
+#include <fty_service_status.h>
+
+#include "test_plugins.h"
+
+#include <fstream>
+
+#include <dlfcn.h>
+#include <unistd.h>
+
+#include <catch2/catch.hpp>
+
+namespace
+{
+    //two folders with a copy of the sleep plugin named a.so, so both provide the plugin a.so, and a file which is not a plugin
+    class ManifestFolders
+    {
+        public:
+        std::string root;
+        std::string first;
+        std::string second;
+        std::string cachePath;
+
+        ManifestFolders() {
+            char folderTemplate[] = "/tmp/fty-service-status-test-XXXXXX";
+            REQUIRE(mkdtemp(folderTemplate) != nullptr);
+            root = folderTemplate;
+            first = root + "/first";
+            second = root + "/second";
+            cachePath = root + "/manifest";
+            REQUIRE(mkdir(first.c_str(), 0700) == 0);
+            REQUIRE(mkdir(second.c_str(), 0700) == 0);
+
+            for(const std::string & folder : {first, second}) {
+                std::ifstream source(SLEEP_PLUGIN_PATH, std::ios::binary);
+                std::ofstream destination(folder + "/a.so", std::ios::binary);
+                destination << source.rdbuf();
+            }
+            std::ofstream(first + "/fake.so") << "not a plugin";
+        }
+
+        ~ManifestFolders() {
+            for(const std::string & file : {first + "/a.so", first + "/fake.so", second + "/a.so", cachePath}) {
+                unlink(file.c_str());
+            }
+            rmdir(first.c_str());
+            rmdir(second.c_str());
+            rmdir(root.c_str());
+        }
+    };
+}
+
+TEST_CASE( "Manifest cache skips the known files", "[fty::PluginManifestCache]-addAll" ) {
+    ManifestFolders folders;
+
+    //first start: every file is probed
+    {
+        auto cache = std::make_shared<fty::PluginManifestCache>(folders.cachePath);
+        fty::ServiceStatusPluginWrapperCollection collection("test-service");
+        collection.setManifestCache(cache);
+        REQUIRE(collection.getManifestCache() == cache);
+
+        std::vector<fty::PluginLoadResult> report = collection.addAllWithReport(folders.first, "*.so");
+        REQUIRE(report.size() == 2);
+        REQUIRE(report[0].added);
+        REQUIRE_FALSE(report[1].added);
+        REQUIRE(collection.addAllWithReport(folders.second, "*.so")[0].error.find("already exist") != std::string::npos);
+
+        REQUIRE(cache->getHitCount() == 0);
+        REQUIRE(cache->getMissCount() == 3);
+        REQUIRE(cache->size() == 3);
+    }
+
+    //next start: the file which is not a plugin and the duplicate are not loaded
+    auto cache = std::make_shared<fty::PluginManifestCache>(folders.cachePath);
+    REQUIRE(cache->size() == 3);
+
+    fty::PluginManifestCache::Entry entry;
+    REQUIRE(cache->lookup(folders.first + "/a.so", entry));
+    REQUIRE(entry.valid);
+    REQUIRE(entry.pluginName == "a.so");
+    REQUIRE(entry.abiVersion == 1);
+    REQUIRE(cache->lookup(folders.first + "/fake.so", entry));
+    REQUIRE_FALSE(entry.valid);
+    REQUIRE_FALSE(entry.error.empty());
+
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    collection.setManifestCache(cache);
+
+    std::vector<fty::PluginLoadResult> report = collection.addAllWithReport(folders.first, "*.so");
+    REQUIRE(report.size() == 2);
+    REQUIRE(report[0].added);
+    REQUIRE_FALSE(report[1].added);
+    REQUIRE(report[1].error == entry.error);
+
+    report = collection.addAllWithReport(folders.second, "*.so");
+    REQUIRE(report.size() == 1);
+    REQUIRE_FALSE(report[0].added);
+    REQUIRE(report[0].pluginName == "a.so");
+    REQUIRE(report[0].error.find("already exist") != std::string::npos);
+    REQUIRE(dlopen((folders.second + "/a.so").c_str(), RTLD_NOW | RTLD_NOLOAD) == nullptr);
+
+    REQUIRE(cache->getHitCount() == 5);
+}
+
+TEST_CASE( "Manifest cache probes the changed files", "[fty::PluginManifestCache]-changed" ) {
+    ManifestFolders folders;
+    auto cache = std::make_shared<fty::PluginManifestCache>(folders.cachePath);
+    {
+        fty::ServiceStatusPluginWrapperCollection collection("test-service");
+        collection.setManifestCache(cache);
+        REQUIRE(collection.addAll(folders.first, "*.so") == 1);
+    }
+
+    //the file is replaced by a plugin: its key does not match any more
+    unlink((folders.first + "/fake.so").c_str());
+    {
+        std::ifstream source(NOOP_PLUGIN_PATH, std::ios::binary);
+        std::ofstream destination(folders.first + "/fake.so", std::ios::binary);
+        destination << source.rdbuf();
+    }
+
+    fty::PluginManifestCache::Entry entry;
+    REQUIRE_FALSE(cache->lookup(folders.first + "/fake.so", entry));
+
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    collection.setManifestCache(cache);
+    REQUIRE(collection.addAll(folders.first, "*.so") == 2);
+    REQUIRE(cache->lookup(folders.first + "/fake.so", entry));
+    REQUIRE(entry.valid);
+    REQUIRE(entry.pluginName == "fake.so");
+}
+
+TEST_CASE( "Manifest cache ignores a corrupted file", "[fty::PluginManifestCache]-corrupted" ) {
+    ManifestFolders folders;
+    std::ofstream(folders.cachePath) << "fty-service-status-plugin-manifest 2\nbroken line\n" << folders.first << "/a.so\tx\t1\t2\t1\t1\ta.so\t\n"
+                                     << folders.first << "/b.so\t1\t1\t2\t0\t0\t\tunknown \\x escape\n";
+
+    auto cache = std::make_shared<fty::PluginManifestCache>(folders.cachePath);
+    REQUIRE(cache->size() == 0);
+
+    std::ofstream(folders.cachePath) << "other format\n";
+    REQUIRE(fty::PluginManifestCache(folders.cachePath).size() == 0);
+
+    //a missing cache file is created by the first save
+    unlink(folders.cachePath.c_str());
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    collection.setManifestCache(cache);
+    REQUIRE(collection.addAll(folders.first, "*.so") == 1);
+    REQUIRE(fty::PluginManifestCache(folders.cachePath).size() == 2);
+}
+
+TEST_CASE( "Manifest cache escapes the separators", "[fty::PluginManifestCache]-escape" ) {
+    ManifestFolders folders;
+    const std::string path = folders.first + "/a\tb.so";
+    std::ofstream(path) << "not a plugin";
+    {
+        fty::PluginManifestCache cache(folders.cachePath);
+        fty::PluginManifestCache::Entry entry;
+        entry.path = path;
+        REQUIRE(fty::PluginManifestCache::readIdentity(entry.path, entry));
+        entry.pluginName = "name\twith\\separators";
+        entry.error = "first line\nsecond line\\n";
+        cache.record(entry);
+        REQUIRE(cache.save());
+    }
+
+    //the temporary file was renamed over the cache file
+    REQUIRE(fty::ServiceStatusPluginWrapperCollection::listPathOfFolderElements(folders.root, "manifest*").size() == 1);
+
+    fty::PluginManifestCache cache(folders.cachePath);
+    fty::PluginManifestCache::Entry entry;
+    REQUIRE(cache.lookup(path, entry));
+    REQUIRE(entry.pluginName == "name\twith\\separators");
+    REQUIRE(entry.error == "first line\nsecond line\\n");
+    unlink(path.c_str());
+
+    //one line for the header and one for the entry
+    std::ifstream file(folders.cachePath);
+    std::string line;
+    std::size_t lines = 0;
+    while(std::getline(file, line)) {
+        lines++;
+    }
+    REQUIRE(lines == 2);
+}
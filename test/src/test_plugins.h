@@ -0,0 +1,126 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+#pragma once
+
+//Helpers to drive the plugins of test-plugins/ from the tests
+
+#include <stdexcept>
+#include <string>
+
+#include <dlfcn.h>
+
+const std::string TEST_PLUGINS_FOLDER = "../test-plugins/";
+const std::string SLEEP_PLUGIN_NAME = "libfty-service-status-sleep.so";
+const std::string SLEEP_PLUGIN_PATH = TEST_PLUGINS_FOLDER + SLEEP_PLUGIN_NAME;
+const std::string SLEEP_V2_PLUGIN_NAME = "libfty-service-status-sleep-v2.so";
+const std::string SLEEP_V2_PLUGIN_PATH = TEST_PLUGINS_FOLDER + SLEEP_V2_PLUGIN_NAME;
+const std::string NOOP_PLUGIN_NAME = "libfty-service-status-noop.so";
+const std::string NOOP_PLUGIN_PATH = TEST_PLUGINS_FOLDER + NOOP_PLUGIN_NAME;
+const std::string STATIC_MEMORY_PLUGIN_NAME = "Static memory plugin";
+const std::string STATIC_MEMORY_PLUGIN_PATH = TEST_PLUGINS_FOLDER + "libfty-service-status-static-memory.so";
+
+/// Access to the test interface of the sleep plugin
+///
+/// The plugin is kept loaded while the object exists, so the settings are shared
+/// with the ServiceStatusPluginWrapper loading the same file.
+class SleepPluginControl
+{
+    using FctConfigure = void(*)(unsigned, int);
+    using FctGetCount = unsigned long(*)();
+    using FctGetInt = int(*)();
+
+    private:
+    void * m_handle;
+    FctConfigure m_configure;
+    FctGetCount m_getSetCount;
+    FctGetInt m_getLastOperatingStatus;
+    FctGetInt m_getLastHealthState;
+    FctGetCount m_getCombinedCount;
+
+    template<typename T>
+    T resolve(const char * name) {
+        T fct = reinterpret_cast<T>(dlsym(m_handle, name));
+        if(fct == nullptr) {
+            throw std::runtime_error(std::string("Cannot load function ") + name);
+        }
+        return fct;
+    }
+
+    public:
+    SleepPluginControl(const std::string & path = SLEEP_PLUGIN_PATH) {
+        m_handle = dlopen(path.c_str(), RTLD_NOW);
+        if(m_handle == nullptr) {
+            throw std::runtime_error("Cannot load plugin: " + std::string(dlerror()));
+        }
+        m_configure = resolve<FctConfigure>("sleepPluginConfigure");
+        m_getSetCount = resolve<FctGetCount>("sleepPluginGetSetCount");
+        m_getLastOperatingStatus = resolve<FctGetInt>("sleepPluginGetLastOperatingStatus");
+        m_getLastHealthState = resolve<FctGetInt>("sleepPluginGetLastHealthState");
+        m_getCombinedCount = resolve<FctGetCount>("sleepPluginGetCombinedCount");
+    }
+
+    SleepPluginControl(const SleepPluginControl &) = delete;
+    SleepPluginControl & operator=(const SleepPluginControl &) = delete;
+
+    ~SleepPluginControl() {
+        m_configure(0, 0);
+        dlclose(m_handle);
+    }
+
+    void configure(unsigned delayUs, int result = 0) { m_configure(delayUs, result); }
+    unsigned long getSetCount() const { return m_getSetCount(); }
+    int getLastOperatingStatus() const { return m_getLastOperatingStatus(); }
+    int getLastHealthState() const { return m_getLastHealthState(); }
+    unsigned long getCombinedCount() const { return m_getCombinedCount(); }
+};
+
+/// Access to the test interface of the noop plugin
+class NoopPluginControl
+{
+    using FctGetCount = unsigned long(*)();
+
+    private:
+    void * m_handle;
+    FctGetCount m_getBatchCount;
+    FctGetCount m_getBatchEntryCount;
+
+    public:
+    NoopPluginControl(const std::string & path = NOOP_PLUGIN_PATH) {
+        m_handle = dlopen(path.c_str(), RTLD_NOW);
+        if(m_handle == nullptr) {
+            throw std::runtime_error("Cannot load plugin: " + std::string(dlerror()));
+        }
+        m_getBatchCount = reinterpret_cast<FctGetCount>(dlsym(m_handle, "noopPluginGetBatchCount"));
+        m_getBatchEntryCount = reinterpret_cast<FctGetCount>(dlsym(m_handle, "noopPluginGetBatchEntryCount"));
+        if(m_getBatchCount == nullptr || m_getBatchEntryCount == nullptr) {
+            dlclose(m_handle);
+            throw std::runtime_error("Cannot load the test interface of the noop plugin");
+        }
+    }
+
+    NoopPluginControl(const NoopPluginControl &) = delete;
+    NoopPluginControl & operator=(const NoopPluginControl &) = delete;
+
+    ~NoopPluginControl() {
+        dlclose(m_handle);
+    }
+
+    unsigned long getBatchCount() const { return m_getBatchCount(); }
+    unsigned long getBatchEntryCount() const { return m_getBatchEntryCount(); }
+};
@@ -0,0 +1,154 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+
+//Tests of the registry of plugins shared by the services of a process, and of the batches
+
+#include <fty_service_status.h>
+
+#include "test_plugins.h"
+
+#include <catch2/catch.hpp>
+
+#include <chrono>
+#include <thread>
+
+TEST_CASE( "Test batch entry point of a plugin", "[fty::ServiceStatusPluginWrapper]-batch" ) {
+    fty::ServiceStatusPluginWrapper noop(NOOP_PLUGIN_PATH);
+    fty::ServiceStatusPluginWrapper sleep(SLEEP_PLUGIN_PATH);
+    REQUIRE(noop.hasBatchEntryPoint());
+    REQUIRE_FALSE(sleep.hasBatchEntryPoint());
+
+    fty::ServiceStatusPluginWrapper lazy(NOOP_PLUGIN_PATH, NOOP_PLUGIN_NAME, fty::LoadMode::Lazy);
+    REQUIRE_FALSE(lazy.hasBatchEntryPoint());
+
+    NoopPluginControl noopControl;
+    SleepPluginControl sleepControl;
+    const unsigned long batches = noopControl.getBatchCount();
+
+    fty::ServiceStatusProviderPtr noopProvider = noop.newServiceStatusProviderPtr("service-1");
+    fty::ServiceStatusProviderPtr sleepProvider = sleep.newServiceStatusProviderPtr("service-1");
+
+    fty::ServiceStatusBatchEntry entry{noopProvider.get(), fty::OperatingStatus::InService, fty::HealthState::Ok};
+    REQUIRE(noop.setBatch(&entry, 1) == 0);
+    REQUIRE(noopControl.getBatchCount() == batches + 1);
+
+    //a plugin released by unload is loaded again for the batch of its providers
+    noop.unload();
+    REQUIRE_FALSE(noop.hasBatchEntryPoint());
+    REQUIRE(noop.getPluginLastError().empty());
+    REQUIRE(noop.setBatch(&entry, 1) == 0);
+    REQUIRE(noopControl.getBatchCount() == batches + 2);
+    REQUIRE(noop.hasBatchEntryPoint());
+
+    //without the entry point, set() is called for each status
+    entry.provider = sleepProvider.get();
+    entry.healthState = fty::HealthState::Warning;
+    REQUIRE(sleep.setBatch(&entry, 1) == 0);
+    REQUIRE(sleepControl.getSetCount() == 2);
+    REQUIRE(sleepControl.getLastOperatingStatus() == static_cast<int>(fty::OperatingStatus::InService));
+    REQUIRE(sleepControl.getLastHealthState() == static_cast<int>(fty::HealthState::Warning));
+
+    sleepControl.configure(0, -1);
+    REQUIRE(sleep.setBatch(&entry, 1) == 1);
+}
+
+TEST_CASE( "Test plugin registry", "[fty::ServiceStatusPluginRegistry]" ) {
+    NoopPluginControl noopControl;
+    SleepPluginControl sleepControl;
+
+    fty::ServiceStatusPluginRegistry registry;
+    registry.add(NOOP_PLUGIN_PATH);
+    REQUIRE_THROWS_AS(registry.add(NOOP_PLUGIN_PATH), std::runtime_error);
+    REQUIRE_THROWS_AS(registry.add("does-not-exist.so"), std::runtime_error);
+
+    REQUIRE(registry.addService("service-1") == 1);
+    REQUIRE(registry.addService("service-1") == 1);
+    REQUIRE(registry.getServiceCount() == 1);
+
+    //the providers of the known services are created with the plugin
+    registry.add(SLEEP_PLUGIN_PATH);
+    REQUIRE(registry.getPluginNames() == std::list<std::string>{NOOP_PLUGIN_NAME, SLEEP_PLUGIN_NAME});
+    REQUIRE(registry.addService("service-1") == 2);
+
+    const unsigned long batches = noopControl.getBatchCount();
+    const unsigned long entries = noopControl.getBatchEntryCount();
+
+    //the unknown services are added
+    std::vector<fty::ServiceStatus> statuses = {
+        {"service-1", fty::OperatingStatus::InService, fty::HealthState::Ok},
+        {"service-2", fty::OperatingStatus::Starting, fty::HealthState::Warning},
+        {"service-3", fty::OperatingStatus::Stopping, fty::HealthState::MajorFailure}
+    };
+    REQUIRE(registry.setForServices(statuses) == 0);
+    REQUIRE(registry.getServiceCount() == 3);
+
+    //one call for the plugin with the batch entry point, two calls per service for the other
+    REQUIRE(noopControl.getBatchCount() == batches + 1);
+    REQUIRE(noopControl.getBatchEntryCount() == entries + 3);
+    REQUIRE(sleepControl.getSetCount() == 6);
+    REQUIRE(sleepControl.getLastOperatingStatus() == static_cast<int>(fty::OperatingStatus::Stopping));
+    REQUIRE(sleepControl.getLastHealthState() == static_cast<int>(fty::HealthState::MajorFailure));
+
+    //the failures are counted by plugin
+    sleepControl.configure(0, -1);
+    REQUIRE(registry.setForServices(statuses.data(), 2) == 2);
+    sleepControl.configure(0, 0);
+
+    registry.removeService("service-3");
+    REQUIRE(registry.getServiceCount() == 2);
+
+    registry.remove(SLEEP_PLUGIN_NAME);
+    REQUIRE(registry.getPluginNames() == std::list<std::string>{NOOP_PLUGIN_NAME});
+    REQUIRE(registry.setForServices(statuses) == 0);
+    REQUIRE(sleepControl.getSetCount() == 10);
+    REQUIRE(noopControl.getBatchEntryCount() == entries + 8);
+}
+
+TEST_CASE( "Test plugin registry calls the plugins without its lock", "[fty::ServiceStatusPluginRegistry]-unlocked" ) {
+    SleepPluginControl sleepControl;
+
+    fty::ServiceStatusPluginRegistry registry;
+    registry.add(SLEEP_PLUGIN_PATH);
+    REQUIRE(registry.addService("service-1") == 1);
+
+    //each call to set() of the plugin lasts 100 ms
+    sleepControl.configure(100000);
+    int failures = -1;
+    std::thread batch([&registry, &failures] () {
+        failures = registry.setForServices({{"service-1", fty::OperatingStatus::InService, fty::HealthState::Ok}});
+    });
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    //the registry is not blocked by the plugin, and the provider stays alive until the end of the batch
+    const auto start = std::chrono::steady_clock::now();
+    REQUIRE(registry.getServiceCount() == 1);
+    registry.removeService("service-1");
+    REQUIRE(registry.getPluginNames() == std::list<std::string>{SLEEP_PLUGIN_NAME});
+    REQUIRE(std::chrono::steady_clock::now() - start < std::chrono::milliseconds(100));
+
+    batch.join();
+    REQUIRE(failures == 0);
+    REQUIRE(registry.getServiceCount() == 0);
+    REQUIRE(sleepControl.getSetCount() == 2);
+    REQUIRE(sleepControl.getLastHealthState() == static_cast<int>(fty::HealthState::Ok));
+}
+
+TEST_CASE( "Test plugin registry of the process", "[fty::ServiceStatusPluginRegistry]-instance" ) {
+    REQUIRE(&fty::ServiceStatusPluginRegistry::getInstance() == &fty::ServiceStatusPluginRegistry::getInstance());
+}
@@ -0,0 +1,229 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+
+//Tests of the trace replay tool
+
+#include <status_replay.h>
+#include <status_journal_reader.h>
+
+#include "test_plugins.h"
+
+#include <cstdlib>
+#include <sstream>
+
+#include <unistd.h>
+
+#include <catch2/catch.hpp>
+
+using std::chrono::milliseconds;
+
+TEST_CASE( "Test trace read and write", "[statusreplay]-trace" ) {
+    std::istringstream input(
+        "# time ms,service,operating status,health state\n"
+        "\n"
+        "10.5,service-b,16,5\n"
+        "0,service-a,3,0\r\n"
+        "10.5,service-a,16,10\n"
+        "2,service-b,3,0\n");
+    statusreplay::Trace trace = statusreplay::readTrace(input);
+    REQUIRE(trace.services == std::vector<std::string>({"service-b", "service-a"}));
+    REQUIRE(trace.events.size() == 4);
+    REQUIRE(trace.getDuration() == 10500);
+
+    //sorted by time, in the order of the file at the same time
+    REQUIRE(trace.events[0].time == 0);
+    REQUIRE(trace.events[0].service == 1);
+    REQUIRE(trace.events[1].time == 2000);
+    REQUIRE(trace.events[2].service == 0);
+    REQUIRE(trace.events[2].operatingStatus == fty::OperatingStatus::InService);
+    REQUIRE(trace.events[3].healthState == fty::HealthState::Warning);
+
+    std::stringstream written;
+    statusreplay::writeTrace(written, trace);
+    statusreplay::Trace readAgain = statusreplay::readTrace(written);
+    REQUIRE(readAgain.events.size() == trace.events.size());
+    for(std::size_t i = 0; i < trace.events.size(); i++) {
+        REQUIRE(readAgain.events[i].time == trace.events[i].time);
+        REQUIRE(readAgain.services[readAgain.events[i].service] == trace.services[trace.events[i].service]);
+        REQUIRE(readAgain.events[i].healthState == trace.events[i].healthState);
+    }
+
+    //the first invalid line is reported
+    for(const char * invalid : {"1,service\n", "-1,service,16,5\n", "1,,16,5\n", "1,service,17,5\n", "1,service,16,7\n", "x,service,16,5\n"}) {
+        std::istringstream invalidInput(std::string("0,service,16,5\n") + invalid);
+        REQUIRE_THROWS_WITH(statusreplay::readTrace(invalidInput), Catch::StartsWith("Invalid event at line 2"));
+    }
+}
+
+TEST_CASE( "Test synthetic storms", "[statusreplay]-storm" ) {
+    statusreplay::StormSettings settings;
+    settings.services = 50;
+    settings.cycles = 3;
+    settings.period = milliseconds(100);
+
+    statusreplay::Trace restart = statusreplay::generateTrace(settings);
+    REQUIRE(restart.services.size() == 50);
+    REQUIRE(restart.events.size() == 50 * (1 + 3 * 4));
+    REQUIRE(restart.getDuration() < 300000);
+
+    //every restart of a service goes through the same status, in order
+    std::vector<unsigned> steps(50, 0);
+    const fty::OperatingStatus cycle[] = {fty::OperatingStatus::InService, fty::OperatingStatus::Stopping,
+                                          fty::OperatingStatus::Stopped, fty::OperatingStatus::Starting};
+    for(std::size_t i = 0; i < restart.events.size(); i++) {
+        const statusreplay::TraceEvent & event = restart.events[i];
+        REQUIRE(event.operatingStatus == cycle[steps[event.service]++ % 4]);
+        if(i > 0) {
+            REQUIRE(event.time >= restart.events[i - 1].time);
+        }
+    }
+
+    //the same seed gives the same trace
+    settings.storm = statusreplay::Storm::Flapping;
+    statusreplay::Trace flapping = statusreplay::generateTrace(settings);
+    REQUIRE(flapping.events.size() == 50 * 4);
+    statusreplay::Trace again = statusreplay::generateTrace(settings);
+    for(std::size_t i = 0; i < flapping.events.size(); i++) {
+        REQUIRE(flapping.events[i].time == again.events[i].time);
+        REQUIRE(flapping.events[i].operatingStatus == fty::OperatingStatus::InService);
+    }
+
+    settings.services = 0;
+    REQUIRE_THROWS_AS(statusreplay::generateTrace(settings), std::invalid_argument);
+}
+
+TEST_CASE( "Test replay as fast as possible", "[statusreplay]-fast" ) {
+    statusreplay::StormSettings settings;
+    settings.services = 40;
+    settings.cycles = 5;
+    statusreplay::Trace trace = statusreplay::generateTrace(settings);
+
+    statusreplay::ReplaySettings replaySettings;
+    replaySettings.speed = 0;
+    replaySettings.threads = 4;
+    statusreplay::ReplayReport report = statusreplay::replay(trace, TEST_PLUGINS_FOLDER, NOOP_PLUGIN_NAME, replaySettings);
+
+    //each restart sets the Operating Status 4 times and the Health State twice
+    REQUIRE(report.events == trace.events.size());
+    REQUIRE(report.updates == 40 * (2 + 5 * 6));
+    REQUIRE(report.getThroughput() > 0);
+    REQUIRE(report.eventLatency.p50 <= report.eventLatency.p99);
+    REQUIRE(report.eventLatency.p99 <= report.eventLatency.max);
+    REQUIRE(report.lag.max.count() == 0);
+
+    REQUIRE(report.plugins.size() == 1);
+    REQUIRE(report.plugins[0].pluginName == NOOP_PLUGIN_NAME);
+    REQUIRE(report.plugins[0].calls == report.updates);
+    REQUIRE(report.plugins[0].errors == 0);
+    REQUIRE(report.plugins[0].latency.p50 > std::chrono::nanoseconds(0));
+
+    replaySettings.threads = 0;
+    REQUIRE_THROWS_AS(statusreplay::replay(trace, TEST_PLUGINS_FOLDER, NOOP_PLUGIN_NAME, replaySettings), std::invalid_argument);
+    replaySettings.threads = 1;
+    REQUIRE_THROWS_AS(statusreplay::replay(trace, TEST_PLUGINS_FOLDER, "no-such-plugin.so", replaySettings), std::runtime_error);
+}
+
+TEST_CASE( "Test replay reports the errors of the plugins", "[statusreplay]-errors" ) {
+    SleepPluginControl control;
+    control.configure(0, -1);
+
+    statusreplay::StormSettings settings;
+    settings.services = 10;
+    settings.storm = statusreplay::Storm::Flapping;
+    statusreplay::ReplaySettings replaySettings;
+    replaySettings.speed = 0;
+    statusreplay::ReplayReport report = statusreplay::replay(statusreplay::generateTrace(settings), TEST_PLUGINS_FOLDER,
+                                                             SLEEP_PLUGIN_NAME, replaySettings);
+
+    REQUIRE(report.plugins.size() == 1);
+    REQUIRE(report.plugins[0].calls == report.updates);
+    REQUIRE(report.plugins[0].errors == report.updates);
+    REQUIRE(report.plugins[0].getErrorRate() == 1.0);
+}
+
+TEST_CASE( "Test replay at a scaled speed", "[statusreplay]-speed" ) {
+    statusreplay::StormSettings settings;
+    settings.services = 20;
+    settings.period = milliseconds(400);
+    statusreplay::Trace trace = statusreplay::generateTrace(settings);
+
+    //the trace lasts almost 400ms, replayed 4 times faster
+    statusreplay::ReplaySettings replaySettings;
+    replaySettings.speed = 4;
+    replaySettings.threads = 2;
+    statusreplay::ReplayReport report = statusreplay::replay(trace, TEST_PLUGINS_FOLDER, NOOP_PLUGIN_NAME, replaySettings);
+    REQUIRE(report.duration >= std::chrono::microseconds(trace.getDuration() / 4));
+    REQUIRE(report.duration < milliseconds(1000));
+    REQUIRE(report.lag.p50 < milliseconds(50));
+}
+
+//journal private to the test, the journal plugin is given its path by the environment
+class ReplayJournal
+{
+    public:
+    std::string path;
+
+    ReplayJournal() {
+        char pathTemplate[] = "/tmp/fty-service-status-replay-XXXXXX";
+        int fd = mkstemp(pathTemplate);
+        REQUIRE(fd >= 0);
+        close(fd);
+        path = pathTemplate;
+        setenv(statusjournal::JOURNAL_PATH_ENV, path.c_str(), 1);
+        setenv(statusjournal::JOURNAL_SERVICES_ENV, "8", 1);
+    }
+
+    ~ReplayJournal() {
+        unsetenv(statusjournal::JOURNAL_PATH_ENV);
+        unsetenv(statusjournal::JOURNAL_SERVICES_ENV);
+        unlink(path.c_str());
+    }
+};
+
+TEST_CASE( "Test replay of a recorded journal", "[statusreplay]-journal" ) {
+    ReplayJournal journal;
+
+    //the journal plugin records the updates of a storm, which is then read back as a trace
+    statusreplay::StormSettings settings;
+    settings.services = 8;
+    settings.cycles = 2;
+    settings.period = milliseconds(50);
+    statusreplay::ReplaySettings replaySettings;
+    replaySettings.speed = 0;
+    statusreplay::ReplayReport report = statusreplay::replay(statusreplay::generateTrace(settings), "../status-journal",
+                                                             "libfty-service-status-journal.so", replaySettings);
+    REQUIRE(report.plugins.size() == 1);
+    REQUIRE(report.plugins[0].errors == 0);
+
+    statusreplay::Trace recorded = statusreplay::readJournalTrace(journal.path);
+    REQUIRE(recorded.services.size() == 8);
+    REQUIRE(recorded.events.size() == report.updates);
+    REQUIRE(recorded.events.front().time == 0);
+    for(std::uint32_t service = 0; service < 8; service++) {
+        const statusreplay::TraceEvent * last = nullptr;
+        for(const statusreplay::TraceEvent & event : recorded.events) {
+            if(event.service == service) {
+                last = &event;
+            }
+        }
+        REQUIRE(last != nullptr);
+        REQUIRE(last->operatingStatus == fty::OperatingStatus::InService);
+        REQUIRE(last->healthState == fty::HealthState::Ok);
+    }
+}
@@ -0,0 +1,242 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+
+//Tests of the shared memory board plugin and of its reader
+
+#include <fty_service_status.h>
+#include <shm_board_reader.h>
+
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <catch2/catch.hpp>
+
+static const std::string BOARD_PLUGIN_PATH = "../shm-board/libfty-service-status-shm-board.so";
+static const std::string BOARD_PLUGIN_NAME = "Shared memory board plugin";
+
+//use a board private to the test process, removed at the end of the test
+class TestBoard
+{
+    public:
+    const std::string name;
+
+    TestBoard() : name("/fty-service-status-test-" + std::to_string(getpid())) {
+        shm_unlink(name.c_str());
+        setenv(shmboard::BOARD_NAME_ENV, name.c_str(), 1);
+    }
+
+    ~TestBoard() {
+        unsetenv(shmboard::BOARD_NAME_ENV);
+        shm_unlink(name.c_str());
+    }
+};
+
+TEST_CASE( "Shared memory board publish", "[shmboard::ServiceStatusBoard]-publish" ) {
+    TestBoard board;
+
+    fty::ServiceStatusPluginWrapperCollection statusProviders("board-service");
+    statusProviders.add(BOARD_PLUGIN_PATH);
+
+    shmboard::BoardReader reader(board.name);
+    REQUIRE(reader.getSlotCount() == shmboard::DEFAULT_SLOT_COUNT);
+
+    shmboard::BoardEntry entry;
+    REQUIRE(reader.find("board-service", entry));
+    REQUIRE(entry.operatingStatus == fty::OperatingStatus::Unknown);
+    REQUIRE(entry.healthState == fty::HealthState::Unknown);
+    REQUIRE(entry.updateTime == 0);
+
+    statusProviders.setForAll(fty::OperatingStatus::InService);
+    statusProviders.setForAll(fty::HealthState::Warning);
+
+    REQUIRE(reader.find("board-service", entry));
+    REQUIRE(entry.serviceName == "board-service");
+    REQUIRE(entry.operatingStatus == fty::OperatingStatus::InService);
+    REQUIRE(entry.healthState == fty::HealthState::Warning);
+    REQUIRE(entry.updateTime != 0);
+
+    REQUIRE_FALSE(reader.find("other-service", entry));
+}
+
+TEST_CASE( "Shared memory board slots", "[shmboard::ServiceStatusBoard]-slots" ) {
+    TestBoard board;
+
+    fty::ServiceStatusPluginWrapper plugin(BOARD_PLUGIN_PATH);
+    REQUIRE(plugin.getPluginName() == BOARD_PLUGIN_NAME);
+
+    fty::ServiceStatusProviderPtr first = plugin.newServiceStatusProviderPtr("first-service");
+    fty::ServiceStatusProviderPtr second = plugin.newServiceStatusProviderPtr("second-service");
+    first->set(fty::OperatingStatus::Starting);
+    second->set(fty::OperatingStatus::Stopped);
+
+    //a restarted service finds its slot and its last status back
+    first.reset();
+    first = plugin.newServiceStatusProviderPtr("first-service");
+
+    shmboard::BoardReader reader(board.name);
+    std::vector<shmboard::BoardEntry> entries = reader.snapshot();
+    REQUIRE(entries.size() == 2);
+    REQUIRE(entries[0].serviceName == "first-service");
+    REQUIRE(entries[0].operatingStatus == fty::OperatingStatus::Starting);
+    REQUIRE(entries[1].serviceName == "second-service");
+    REQUIRE(entries[1].operatingStatus == fty::OperatingStatus::Stopped);
+
+    //the name must fit in a slot
+    REQUIRE_THROWS_AS(plugin.newServiceStatusProviderPtr(std::string(shmboard::SERVICE_NAME_SIZE, 'x')), std::runtime_error);
+    REQUIRE_THROWS_AS(plugin.newServiceStatusProviderPtr(""), std::runtime_error);
+    REQUIRE(reader.snapshot().size() == 2);
+}
+
+TEST_CASE( "Shared memory board full", "[shmboard::ServiceStatusBoard]-full" ) {
+    TestBoard board;
+    setenv(shmboard::BOARD_SLOTS_ENV, "2", 1);
+
+    fty::ServiceStatusPluginWrapper plugin(BOARD_PLUGIN_PATH);
+    fty::ServiceStatusProviderPtr first = plugin.newServiceStatusProviderPtr("first-service");
+    fty::ServiceStatusProviderPtr second = plugin.newServiceStatusProviderPtr("second-service");
+    REQUIRE_THROWS_AS(plugin.newServiceStatusProviderPtr("third-service"), std::runtime_error);
+
+    unsetenv(shmboard::BOARD_SLOTS_ENV);
+
+    shmboard::BoardReader reader(board.name);
+    REQUIRE(reader.getSlotCount() == 2);
+    REQUIRE(reader.snapshot().size() == 2);
+}
+
+TEST_CASE( "Shared memory board concurrent read", "[shmboard::BoardReader]-concurrent" ) {
+    TestBoard board;
+
+    fty::ServiceStatusPluginWrapper plugin(BOARD_PLUGIN_PATH);
+    fty::ServiceStatusProviderPtr provider = plugin.newServiceStatusProviderPtr("busy-service");
+
+    shmboard::BoardReader reader(board.name);
+    std::atomic<bool> stop(false);
+    std::atomic<unsigned> invalid(0);
+
+    //the writer is never blocked by the readers, which always see one of the written values
+    std::thread readerThread([&]() {
+        std::vector<shmboard::BoardEntry> entries;
+        while(!stop.load()) {
+            reader.snapshot(entries);
+            if(entries.size() != 1 || (entries[0].healthState != fty::HealthState::Unknown
+                && entries[0].healthState != fty::HealthState::Ok && entries[0].healthState != fty::HealthState::MajorFailure)) {
+                invalid++;
+            }
+        }
+    });
+
+    for(unsigned i = 0; i < 200000; i++) {
+        provider->set((i % 2 == 0) ? fty::HealthState::Ok : fty::HealthState::MajorFailure);
+    }
+    stop = true;
+    readerThread.join();
+
+    REQUIRE(invalid.load() == 0);
+
+    shmboard::BoardEntry entry;
+    REQUIRE(reader.find("busy-service", entry));
+    REQUIRE(entry.healthState == fty::HealthState::MajorFailure);
+}
+
+TEST_CASE( "Shared memory board concurrent writers", "[shmboard::ServiceStatusBoard]-writers" ) {
+    TestBoard board;
+
+    //two providers of the same service write its slot from two threads
+    fty::ServiceStatusPluginWrapper plugin(BOARD_PLUGIN_PATH);
+    fty::ServiceStatusProviderPtr first = plugin.newServiceStatusProviderPtr("shared-service");
+    fty::ServiceStatusProviderPtr second = plugin.newServiceStatusProviderPtr("shared-service");
+
+    const unsigned updates = 100000;
+    std::thread firstThread([&]() {
+        for(unsigned i = 0; i < updates; i++) {
+            first->set((i % 2 == 0) ? fty::HealthState::Ok : fty::HealthState::Warning);
+        }
+    });
+    for(unsigned i = 0; i < updates; i++) {
+        second->set((i % 2 == 0) ? fty::OperatingStatus::InService : fty::OperatingStatus::Stopping);
+    }
+    firstThread.join();
+
+    //each update claimed the sequence in turn: none was lost and the slot is not left locked
+    int fd = shm_open(board.name.c_str(), O_RDONLY, 0);
+    REQUIRE(fd >= 0);
+    const std::size_t size = shmboard::boardSize(shmboard::DEFAULT_SLOT_COUNT);
+    void * address = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    REQUIRE(address != MAP_FAILED);
+    const shmboard::BoardSlot & slot = shmboard::boardSlots(static_cast<const shmboard::BoardHeader *>(address))[0];
+    REQUIRE(std::string(slot.serviceName) == "shared-service");
+    REQUIRE(slot.sequence.load() == 4 * updates);
+    munmap(address, size);
+
+    shmboard::BoardReader reader(board.name);
+    shmboard::BoardEntry entry;
+    REQUIRE(reader.find("shared-service", entry));
+    REQUIRE(entry.operatingStatus == fty::OperatingStatus::Stopping);
+    REQUIRE(entry.healthState == fty::HealthState::Warning);
+}
+
+TEST_CASE( "Shared memory board writer killed during an update", "[shmboard::ServiceStatusBoard]-stalled" ) {
+    TestBoard board;
+    fty::ServiceStatusPluginWrapper plugin(BOARD_PLUGIN_PATH);
+    fty::ServiceStatusProviderPtr provider = plugin.newServiceStatusProviderPtr("stalled-service");
+    REQUIRE(provider->set(fty::OperatingStatus::InService) == 0);
+
+    //a writer died with the sequence odd, and another process while naming the next slot
+    int fd = shm_open(board.name.c_str(), O_RDWR, 0);
+    REQUIRE(fd >= 0);
+    const std::size_t size = shmboard::boardSize(shmboard::DEFAULT_SLOT_COUNT);
+    void * address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    REQUIRE(address != MAP_FAILED);
+    shmboard::BoardSlot * slots = shmboard::boardSlots(static_cast<shmboard::BoardHeader *>(address));
+    slots[0].sequence.fetch_add(1);
+    slots[1].state.store(shmboard::SLOT_CLAIMED);
+
+    //the readers give up waiting and report the slot
+    shmboard::BoardReader reader(board.name);
+    shmboard::BoardEntry entry;
+    REQUIRE(reader.find("stalled-service", entry));
+    REQUIRE(entry.stalled);
+    REQUIRE(entry.operatingStatus == fty::OperatingStatus::InService);
+
+    //the next writer takes the slot over and reports it
+    REQUIRE(provider->set(fty::HealthState::Ok) == -EOWNERDEAD);
+    REQUIRE((slots[0].sequence.load() & 1) == 0);
+    REQUIRE(provider->set(fty::HealthState::Warning) == 0);
+    REQUIRE(reader.find("stalled-service", entry));
+    REQUIRE_FALSE(entry.stalled);
+    REQUIRE(entry.healthState == fty::HealthState::Warning);
+
+    //the slot left claimed is skipped
+    fty::ServiceStatusProviderPtr other = plugin.newServiceStatusProviderPtr("other-service");
+    REQUIRE(std::string(slots[2].serviceName) == "other-service");
+    munmap(address, size);
+}
+
+TEST_CASE( "Shared memory board missing", "[shmboard::BoardReader]-missing" ) {
+    TestBoard board;
+    REQUIRE_THROWS_AS(shmboard::BoardReader(board.name), std::system_error);
+}
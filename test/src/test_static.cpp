@@ -0,0 +1,109 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+
+//Tests of the static plugins, linked in the service without dlopen
+
+#include <fty_service_status.h>
+
+#include "test_plugins.h"
+#include "static_memory_plugin.h"
+
+#include <catch2/catch.hpp>
+
+namespace
+{
+    //second static plugin, which counts the updates of all its providers
+    struct CountingPlugin
+    {
+        static unsigned long count;
+
+        static const char * getPluginName() noexcept { return "Counting plugin"; }
+
+        class Provider
+        {
+            private:
+            std::string m_serviceName;
+
+            public:
+            explicit Provider(const char * serviceName) : m_serviceName(serviceName) {}
+
+            const char * getServiceName() const noexcept { return m_serviceName.c_str(); }
+            int set(fty::OperatingStatus) noexcept { count++; return 0; }
+            int set(fty::HealthState) noexcept { count++; return 0; }
+        };
+    };
+
+    unsigned long CountingPlugin::count = 0;
+}
+
+using StaticCollection = fty::StaticServiceStatusPluginCollection<test::StaticMemoryPlugin, CountingPlugin>;
+
+TEST_CASE( "Static collection", "[fty::StaticServiceStatusPluginCollection]-setForAll" ) {
+    CountingPlugin::count = 0;
+    StaticCollection collection("test-service");
+
+    REQUIRE(collection.getServiceName() == "test-service");
+    REQUIRE(StaticCollection::getStaticPluginCount() == 2);
+    REQUIRE(StaticCollection::getPluginNames() == std::list<std::string>({STATIC_MEMORY_PLUGIN_NAME, "Counting plugin"}));
+
+    test::StaticMemoryPlugin::Provider & provider = collection.getProvider<test::StaticMemoryPlugin>();
+    REQUIRE(std::string(provider.getServiceName()) == "test-service");
+
+    collection.setForAll(fty::OperatingStatus::InService);
+    collection.setForAll(fty::HealthState::Warning);
+
+    REQUIRE(provider.getOperatingStatus() == fty::OperatingStatus::InService);
+    REQUIRE(provider.getHealthState() == fty::HealthState::Warning);
+    REQUIRE(provider.getSetCount() == 2);
+    REQUIRE(CountingPlugin::count == 2);
+
+    REQUIRE_FALSE(collection.hasDynamicPlugins());
+    REQUIRE_THROWS_AS(collection.getDynamicPlugins(), std::logic_error);
+
+    //a collection without plugin is valid
+    fty::StaticServiceStatusPluginCollection<> empty("test-service");
+    empty.setForAll(fty::HealthState::Ok);
+    REQUIRE(empty.getPluginNames().empty());
+}
+
+TEST_CASE( "Static collection with dynamic plugins", "[fty::StaticServiceStatusPluginCollection]-dynamic" ) {
+    SleepPluginControl control;
+    StaticCollection collection("test-service", true);
+    REQUIRE(collection.hasDynamicPlugins());
+
+    collection.getDynamicPlugins().add(SLEEP_PLUGIN_PATH);
+    collection.setForAll(fty::OperatingStatus::Starting);
+    collection.setForAll(fty::HealthState::MinorFailure);
+
+    REQUIRE(collection.getProvider<test::StaticMemoryPlugin>().getOperatingStatus() == fty::OperatingStatus::Starting);
+    REQUIRE(collection.getProvider<test::StaticMemoryPlugin>().getHealthState() == fty::HealthState::MinorFailure);
+    REQUIRE(control.getLastOperatingStatus() == static_cast<int>(fty::OperatingStatus::Starting));
+    REQUIRE(control.getLastHealthState() == static_cast<int>(fty::HealthState::MinorFailure));
+}
+
+TEST_CASE( "Static plugin exported for dlopen", "[fty::StaticServiceStatusPluginCollection]-export" ) {
+    fty::ServiceStatusPluginWrapper plugin(STATIC_MEMORY_PLUGIN_PATH);
+    REQUIRE(plugin.getPluginName() == STATIC_MEMORY_PLUGIN_NAME);
+    REQUIRE(plugin.getAbiVersion() == 1);
+
+    fty::ServiceStatusProviderPtr provider = plugin.newServiceStatusProviderPtr("test-service");
+    REQUIRE(std::string(provider->getServiceName()) == "test-service");
+    REQUIRE(provider->set(fty::OperatingStatus::InService) == 0);
+    REQUIRE(provider->set(fty::HealthState::Ok) == 0);
+}
@@ -0,0 +1,181 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+
+//Tests of the statistics of the calls to the plugins
+
+#include "test_plugins.h"
+
+#include <fty_service_status.h>
+
+#include <chrono>
+#include <numeric>
+#include <thread>
+#include <vector>
+
+#include <catch2/catch.hpp>
+
+static std::uint64_t histogramTotal(const fty::PluginStats & stats) {
+    return std::accumulate(stats.latencyHistogram.begin(), stats.latencyHistogram.end(), std::uint64_t(0));
+}
+
+TEST_CASE( "Test plugin stats", "[fty::ServiceStatusPluginWrapperCollection]-stats" ) {
+    SleepPluginControl control;
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    collection.add(SLEEP_PLUGIN_PATH);
+
+    fty::PluginStats stats = collection.getPluginStats(SLEEP_PLUGIN_NAME);
+    REQUIRE(stats.pluginName == SLEEP_PLUGIN_NAME);
+    REQUIRE(stats.calls == 0);
+    REQUIRE(histogramTotal(stats) == 0);
+
+    collection.setForAll(fty::OperatingStatus::InService);
+    collection.setForAll(fty::HealthState::Ok);
+
+    //a call of 2ms is counted in the bucket [1.048ms, 4.194ms[, or later if the machine is loaded
+    control.configure(2000);
+    collection.setForAll(fty::HealthState::Warning);
+
+    stats = collection.getPluginStats(SLEEP_PLUGIN_NAME);
+    REQUIRE(stats.calls == 3);
+    REQUIRE(stats.errors == 0);
+    REQUIRE(stats.lastError.empty());
+    REQUIRE(histogramTotal(stats) == 3);
+    REQUIRE(std::accumulate(stats.latencyHistogram.begin() + 6, stats.latencyHistogram.end(), std::uint64_t(0)) == 1);
+
+    //errors keep the message of the plugin
+    control.configure(0, -1);
+    collection.setForAll(fty::HealthState::MajorFailure);
+    control.configure(0, 0);
+    collection.setForAll(fty::HealthState::Ok);
+
+    stats = collection.getPluginStats(SLEEP_PLUGIN_NAME);
+    REQUIRE(stats.calls == 5);
+    REQUIRE(stats.errors == 1);
+    REQUIRE(stats.lastError == "Configured error");
+
+    //suppressed updates are not calls
+    collection.enableChangeSuppression();
+    collection.setForAll(fty::HealthState::Ok);
+    REQUIRE(collection.getPluginStats(SLEEP_PLUGIN_NAME).calls == 5);
+
+    REQUIRE_THROWS_AS(collection.getPluginStats("unknown"), std::runtime_error);
+}
+
+TEST_CASE( "Test plugin stats of all plugins", "[fty::ServiceStatusPluginWrapperCollection]-allStats" ) {
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    collection.add(SLEEP_PLUGIN_PATH);
+    collection.add(NOOP_PLUGIN_PATH);
+    collection.addLazy("../example/libfty-service-status-example.so", "Wrong name");
+
+    collection.setForAll(fty::OperatingStatus::Starting);
+
+    std::list<fty::PluginStats> allStats = collection.getPluginStats();
+    REQUIRE(allStats.size() == 3);
+
+    //ordered by name, the lazy plugin failed to load
+    auto it = allStats.begin();
+    REQUIRE(it->pluginName == "Wrong name");
+    REQUIRE(it->calls == 1);
+    REQUIRE(it->errors == 1);
+    REQUIRE(it->lastError.find("Wrong name") != std::string::npos);
+    it++;
+    REQUIRE(it->pluginName == NOOP_PLUGIN_NAME);
+    REQUIRE(it->calls == 1);
+    REQUIRE(it->errors == 0);
+    it++;
+    REQUIRE(it->pluginName == SLEEP_PLUGIN_NAME);
+    REQUIRE(it->calls == 1);
+}
+
+TEST_CASE( "Test plugin stats after removals", "[fty::ServiceStatusPluginWrapperCollection]-statsRemove" ) {
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    collection.add(SLEEP_V2_PLUGIN_PATH);
+    collection.add(NOOP_PLUGIN_PATH);
+    collection.add(SLEEP_PLUGIN_PATH);
+
+    //the remaining plugins are still found by name and receive the updates
+    REQUIRE(collection.remove(SLEEP_PLUGIN_NAME));
+    REQUIRE_FALSE(collection.remove("Unknown plugin"));
+    REQUIRE_THROWS(collection.getPluginStats(SLEEP_PLUGIN_NAME));
+    collection.setForAll(fty::OperatingStatus::InService);
+    REQUIRE(collection.getPluginStats(NOOP_PLUGIN_NAME).calls == 1);
+    REQUIRE(collection.getPluginStats(SLEEP_V2_PLUGIN_NAME).calls == 1);
+
+    //a plugin added again starts with new statistics
+    collection.add(SLEEP_PLUGIN_PATH);
+    collection.setForAll(fty::HealthState::Ok);
+    REQUIRE(collection.getPluginStats(SLEEP_PLUGIN_NAME).calls == 1);
+    REQUIRE(collection.getPluginStats(NOOP_PLUGIN_NAME).calls == 2);
+    REQUIRE(collection.getPluginStats().size() == 3);
+    REQUIRE(collection.getPluginCollection().size() == 3);
+}
+
+TEST_CASE( "Test plugin stats with concurrent callers", "[fty::ServiceStatusPluginWrapperCollection]-statsConcurrent" ) {
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    collection.add(NOOP_PLUGIN_PATH);
+
+    std::vector<std::thread> threads;
+    for(unsigned t = 0; t < 4; t++) {
+        threads.emplace_back([&collection] {
+            for(unsigned i = 0; i < 10000; i++) {
+                collection.setForAll((i % 2 == 0) ? fty::HealthState::Ok : fty::HealthState::Warning);
+            }
+        });
+    }
+    for(auto & thread : threads) {
+        thread.join();
+    }
+
+    fty::PluginStats stats = collection.getPluginStats(NOOP_PLUGIN_NAME);
+    REQUIRE(stats.calls == 40000);
+    REQUIRE(histogramTotal(stats) == 40000);
+}
+
+TEST_CASE( "Test latency histogram buckets", "[fty::PluginStats]-buckets" ) {
+    REQUIRE(fty::PluginStats::getBucketUpperBound(0) == std::chrono::nanoseconds(1024));
+    REQUIRE(fty::PluginStats::getBucketUpperBound(1) == std::chrono::nanoseconds(4096));
+    REQUIRE(fty::PluginStats::getBucketUpperBound(fty::LATENCY_BUCKET_COUNT - 1) == std::chrono::nanoseconds::max());
+
+    for(std::size_t bucket = 0; bucket + 1 < fty::LATENCY_BUCKET_COUNT; bucket++) {
+        const std::int64_t bound = fty::PluginStats::getBucketUpperBound(bucket).count();
+        REQUIRE(fty::detail::CallStats::getBucket(bound - 1) == bucket);
+        REQUIRE(fty::detail::CallStats::getBucket(bound) == bucket + 1);
+    }
+    REQUIRE(fty::detail::CallStats::getBucket(0) == 0);
+    REQUIRE(fty::detail::CallStats::getBucket(std::int64_t(3600) * 1000000000) == fty::LATENCY_BUCKET_COUNT - 1);
+}
+
+TEST_CASE( "Test plugin stats record the calls", "[fty::PluginStats]-record" ) {
+    //the overhead of the recording is measured by the benchmark provider/set/stats
+    fty::ServiceStatusPluginWrapper plugin(NOOP_PLUGIN_PATH);
+    fty::ServiceStatusProviderPtr provider = plugin.newServiceStatusProviderPtr("test-service");
+    fty::detail::CallStats stats;
+    const unsigned calls = 100000;
+
+    for(unsigned i = 0; i < calls; i++) {
+        int result = provider->set((i % 2 == 0) ? fty::HealthState::Ok : fty::HealthState::Warning);
+        stats.record(i % 2048, result < 0);
+    }
+
+    fty::PluginStats snapshot;
+    stats.get(snapshot);
+    REQUIRE(snapshot.calls == calls);
+    REQUIRE(snapshot.errors == 0);
+    REQUIRE(histogramTotal(snapshot) == calls);
+}
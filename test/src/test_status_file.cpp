@@ -0,0 +1,201 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+
+//Tests of the status file plugin
+
+#include <fty_service_status.h>
+#include <status_file_record.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <thread>
+
+#include <dirent.h>
+#include <unistd.h>
+
+#include <catch2/catch.hpp>
+
+static const std::string FILE_PLUGIN_PATH = "../status-file/libfty-service-status-file.so";
+static const std::string FILE_PLUGIN_NAME = "File plugin";
+
+//folder private to the test, with the settings given to the plugin, removed at the end of the test
+class TestFolder
+{
+    public:
+    std::string path;
+
+    TestFolder(const char * mode, const char * sync) {
+        char folderTemplate[] = "/tmp/fty-service-status-file-XXXXXX";
+        REQUIRE(mkdtemp(folderTemplate) != nullptr);
+        path = folderTemplate;
+
+        setenv(statusfile::FOLDER_ENV, path.c_str(), 1);
+        setenv(statusfile::MODE_ENV, mode, 1);
+        setenv(statusfile::SYNC_ENV, sync, 1);
+        setenv(statusfile::SYNC_PERIOD_ENV, "10", 1);
+    }
+
+    ~TestFolder() {
+        for(const char * name : {statusfile::FOLDER_ENV, statusfile::MODE_ENV, statusfile::SYNC_ENV, statusfile::SYNC_PERIOD_ENV}) {
+            unsetenv(name);
+        }
+        for(const std::string & file : list()) {
+            unlink((path + "/" + file).c_str());
+        }
+        rmdir(path.c_str());
+    }
+
+    std::vector<std::string> list() const {
+        std::vector<std::string> files;
+        DIR * dir = opendir(path.c_str());
+        while(struct dirent * entry = readdir(dir)) {
+            if(entry->d_name[0] != '.') {
+                files.push_back(entry->d_name);
+            }
+        }
+        closedir(dir);
+        return files;
+    }
+
+    std::string statusFile(const std::string & serviceName) const {
+        return path + "/" + serviceName + statusfile::STATUS_FILE_EXTENSION;
+    }
+};
+
+static void checkUpdates(const TestFolder & folder) {
+    fty::ServiceStatusPluginWrapperCollection statusProviders("file-service");
+    statusProviders.add(FILE_PLUGIN_PATH);
+    REQUIRE(statusProviders.getPluginCollection().count(FILE_PLUGIN_NAME) == 1);
+
+    statusfile::StatusRecord record;
+    statusProviders.setForAll(fty::OperatingStatus::InService);
+    statusProviders.setForAll(fty::HealthState::MinorFailure);
+
+    REQUIRE(statusfile::readStatusFile(folder.statusFile("file-service"), record));
+    REQUIRE(record.operatingStatus == static_cast<std::uint8_t>(fty::OperatingStatus::InService));
+    REQUIRE(record.healthState == static_cast<std::uint8_t>(fty::HealthState::MinorFailure));
+    REQUIRE(record.sequence == 2);
+    REQUIRE(record.updateTime != 0);
+
+    //no temporary file is left
+    REQUIRE(folder.list() == std::vector<std::string>{"file-service.status"});
+}
+
+TEST_CASE( "Status file record mode", "[statusfile::ServiceStatusFile]-record" ) {
+    TestFolder folder("record", "none");
+
+    {
+        fty::ServiceStatusPluginWrapper plugin(FILE_PLUGIN_PATH);
+        REQUIRE(plugin.getPluginName() == FILE_PLUGIN_NAME);
+
+        //the file exists as soon as the provider is created
+        fty::ServiceStatusProviderPtr provider = plugin.newServiceStatusProviderPtr("new-service");
+        statusfile::StatusRecord record;
+        REQUIRE(statusfile::readStatusFile(folder.statusFile("new-service"), record));
+        REQUIRE(record.operatingStatus == static_cast<std::uint8_t>(fty::OperatingStatus::Unknown));
+        REQUIRE(record.sequence == 0);
+        unlink(folder.statusFile("new-service").c_str());
+    }
+
+    checkUpdates(folder);
+
+    //a restarted service keeps its status
+    fty::ServiceStatusPluginWrapper plugin(FILE_PLUGIN_PATH);
+    fty::ServiceStatusProviderPtr provider = plugin.newServiceStatusProviderPtr("file-service");
+    provider->set(fty::HealthState::Ok);
+
+    statusfile::StatusRecord record;
+    REQUIRE(statusfile::readStatusFile(folder.statusFile("file-service"), record));
+    REQUIRE(record.operatingStatus == static_cast<std::uint8_t>(fty::OperatingStatus::InService));
+    REQUIRE(record.healthState == static_cast<std::uint8_t>(fty::HealthState::Ok));
+    REQUIRE(record.sequence == 3);
+}
+
+TEST_CASE( "Status file rename mode", "[statusfile::ServiceStatusFile]-rename" ) {
+    TestFolder folder("rename", "none");
+
+    {
+        //the file is written on the first update
+        fty::ServiceStatusPluginWrapper plugin(FILE_PLUGIN_PATH);
+        fty::ServiceStatusProviderPtr provider = plugin.newServiceStatusProviderPtr("new-service");
+        REQUIRE(folder.list().empty());
+    }
+
+    checkUpdates(folder);
+}
+
+TEST_CASE( "Status file durability", "[statusfile::ServiceStatusFile]-sync" ) {
+    for(const char * mode : {"record", "rename"}) {
+        for(const char * sync : {"update", "group"}) {
+            TestFolder folder(mode, sync);
+            checkUpdates(folder);
+        }
+    }
+}
+
+TEST_CASE( "Status file invalid settings", "[statusfile::ServiceStatusFile]-settings" ) {
+    TestFolder folder("record", "none");
+    fty::ServiceStatusPluginWrapper plugin(FILE_PLUGIN_PATH);
+
+    setenv(statusfile::MODE_ENV, "append", 1);
+    REQUIRE_THROWS_WITH(plugin.newServiceStatusProviderPtr("service"), Catch::Contains(statusfile::MODE_ENV));
+    setenv(statusfile::MODE_ENV, "record", 1);
+
+    setenv(statusfile::SYNC_ENV, "always", 1);
+    REQUIRE_THROWS_WITH(plugin.newServiceStatusProviderPtr("service"), Catch::Contains(statusfile::SYNC_ENV));
+    setenv(statusfile::SYNC_ENV, "group", 1);
+
+    setenv(statusfile::SYNC_PERIOD_ENV, "0", 1);
+    REQUIRE_THROWS_WITH(plugin.newServiceStatusProviderPtr("service"), Catch::Contains(statusfile::SYNC_PERIOD_ENV));
+    setenv(statusfile::SYNC_PERIOD_ENV, "10", 1);
+
+    REQUIRE_THROWS_AS(plugin.newServiceStatusProviderPtr("../service"), std::runtime_error);
+    REQUIRE(folder.list().empty());
+}
+
+TEST_CASE( "Status file never seen empty or torn", "[statusfile::ServiceStatusFile]-concurrent" ) {
+    for(const char * mode : {"record", "rename"}) {
+        TestFolder folder(mode, "none");
+
+        fty::ServiceStatusPluginWrapper plugin(FILE_PLUGIN_PATH);
+        fty::ServiceStatusProviderPtr provider = plugin.newServiceStatusProviderPtr("busy-service");
+        provider->set(fty::OperatingStatus::InService);
+
+        std::atomic<bool> stop(false);
+        std::atomic<unsigned> invalid(0);
+
+        std::thread reader([&]() {
+            statusfile::StatusRecord record;
+            while(!stop.load()) {
+                if(!statusfile::readStatusFile(folder.statusFile("busy-service"), record)
+                    || record.operatingStatus != static_cast<std::uint8_t>(fty::OperatingStatus::InService)) {
+                    invalid++;
+                }
+            }
+        });
+
+        for(unsigned i = 0; i < 1000; i++) {
+            REQUIRE(provider->set((i % 2 == 0) ? fty::HealthState::Ok : fty::HealthState::Warning) == 0);
+        }
+        stop = true;
+        reader.join();
+
+        REQUIRE(invalid.load() == 0);
+    }
+}
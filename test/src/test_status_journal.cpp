@@ -0,0 +1,253 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+
+//Tests of the journal plugin and of its reader
+
+#include <fty_service_status.h>
+#include <status_journal_reader.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <catch2/catch.hpp>
+
+static const std::string JOURNAL_PLUGIN_PATH = "../status-journal/libfty-service-status-journal.so";
+static const std::string JOURNAL_PLUGIN_NAME = "Journal plugin";
+
+//journal private to the test, with the settings given to the plugin, removed at the end of the test
+class TestJournal
+{
+    public:
+    std::string path;
+
+    TestJournal(const char * records, const char * sync) {
+        char pathTemplate[] = "/tmp/fty-service-status-journal-XXXXXX";
+        int fd = mkstemp(pathTemplate);
+        REQUIRE(fd >= 0);
+        close(fd);
+        path = pathTemplate;
+
+        setenv(statusjournal::JOURNAL_PATH_ENV, path.c_str(), 1);
+        setenv(statusjournal::JOURNAL_RECORDS_ENV, records, 1);
+        setenv(statusjournal::JOURNAL_SERVICES_ENV, "8", 1);
+        setenv(statusjournal::JOURNAL_SYNC_ENV, sync, 1);
+        setenv(statusjournal::JOURNAL_SYNC_PERIOD_ENV, "10", 1);
+    }
+
+    ~TestJournal() {
+        for(const char * name : {statusjournal::JOURNAL_PATH_ENV, statusjournal::JOURNAL_RECORDS_ENV, statusjournal::JOURNAL_SERVICES_ENV,
+                statusjournal::JOURNAL_SYNC_ENV, statusjournal::JOURNAL_SYNC_PERIOD_ENV}) {
+            unsetenv(name);
+        }
+        unlink(path.c_str());
+    }
+};
+
+TEST_CASE( "Journal plugin records the transitions", "[statusjournal]-transitions" ) {
+    for(const char * sync : {"none", "update", "group"}) {
+        TestJournal journal("64", sync);
+        {
+            fty::ServiceStatusPluginWrapperCollection statusProviders("journal-service");
+            statusProviders.add(JOURNAL_PLUGIN_PATH);
+            REQUIRE(statusProviders.getPluginCollection().count(JOURNAL_PLUGIN_NAME) == 1);
+
+            statusProviders.setForAll(fty::OperatingStatus::Starting);
+            statusProviders.setForAll(fty::HealthState::Ok);
+            //no transition
+            statusProviders.setForAll(fty::HealthState::Ok);
+            statusProviders.setForAll(fty::OperatingStatus::InService);
+        }
+
+        statusjournal::JournalReader reader(journal.path);
+        REQUIRE(reader.getRecordCount() == 64);
+        REQUIRE(reader.getNextSequence() == 3);
+
+        std::vector<statusjournal::JournalEntry> entries;
+        std::uint64_t lost = 1;
+        REQUIRE(reader.read(0, entries, lost) == 3);
+        REQUIRE(lost == 0);
+        REQUIRE(entries.size() == 3);
+        REQUIRE(entries[0].serviceName == "journal-service");
+        REQUIRE(entries[0].operatingStatus == fty::OperatingStatus::Starting);
+        REQUIRE(entries[0].healthState == fty::HealthState::Unknown);
+        REQUIRE(entries[1].operatingStatus == fty::OperatingStatus::Starting);
+        REQUIRE(entries[1].healthState == fty::HealthState::Ok);
+        REQUIRE(entries[2].sequence == 2);
+        REQUIRE(entries[2].operatingStatus == fty::OperatingStatus::InService);
+        REQUIRE(entries[2].monotonicTime >= entries[0].monotonicTime);
+        REQUIRE(entries[2].wallTime != 0);
+
+        statusjournal::JournalEntry last;
+        REQUIRE(reader.lastStatus("journal-service", last));
+        REQUIRE(last.operatingStatus == fty::OperatingStatus::InService);
+        REQUIRE(last.healthState == fty::HealthState::Ok);
+        REQUIRE(last.wallTime == entries[2].wallTime);
+        REQUIRE_FALSE(reader.lastStatus("other-service", last));
+    }
+}
+
+TEST_CASE( "Journal plugin restores the last status", "[statusjournal]-restore" ) {
+    TestJournal journal("64", "none");
+    {
+        fty::ServiceStatusPluginWrapperCollection statusProviders("journal-service");
+        statusProviders.add(JOURNAL_PLUGIN_PATH);
+        statusProviders.setForAll(fty::OperatingStatus::InService);
+        statusProviders.setForAll(fty::HealthState::Warning);
+    }
+
+    //the restarted service starts from its last status
+    fty::ServiceStatusPluginWrapperCollection statusProviders("journal-service");
+    statusProviders.add(JOURNAL_PLUGIN_PATH);
+    statusProviders.setForAll(fty::HealthState::Warning);
+    statusProviders.setForAll(fty::OperatingStatus::Starting);
+
+    statusjournal::JournalReader reader(journal.path);
+    std::vector<statusjournal::JournalEntry> entries;
+    std::uint64_t lost = 0;
+    reader.read(0, entries, lost);
+    REQUIRE(entries.size() == 3);
+    REQUIRE(entries[2].operatingStatus == fty::OperatingStatus::Starting);
+    REQUIRE(entries[2].healthState == fty::HealthState::Warning);
+    REQUIRE(reader.lastStatuses().size() == 1);
+}
+
+TEST_CASE( "Journal plugin with concurrent writers", "[statusjournal]-writers" ) {
+    TestJournal journal("64", "none");
+
+    //two providers of the same service append from two threads
+    fty::ServiceStatusPluginWrapper plugin(JOURNAL_PLUGIN_PATH);
+    fty::ServiceStatusProviderPtr first = plugin.newServiceStatusProviderPtr("journal-service");
+    fty::ServiceStatusProviderPtr second = plugin.newServiceStatusProviderPtr("journal-service");
+
+    const unsigned updates = 50000;
+    std::thread firstThread([&]() {
+        for(unsigned i = 0; i < updates; i++) {
+            first->set((i % 2 == 0) ? fty::HealthState::Ok : fty::HealthState::Warning);
+        }
+    });
+    for(unsigned i = 0; i < updates; i++) {
+        second->set((i % 2 == 0) ? fty::OperatingStatus::InService : fty::OperatingStatus::Stopping);
+    }
+    firstThread.join();
+
+    //each transition claimed the last status of the service in turn: none was lost and it is not left locked
+    statusjournal::JournalReader reader(journal.path);
+    REQUIRE(reader.getNextSequence() == 2 * updates);
+
+    int fd = open(journal.path.c_str(), O_RDONLY);
+    REQUIRE(fd >= 0);
+    struct stat info;
+    REQUIRE(fstat(fd, &info) == 0);
+    void * address = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    REQUIRE(address != MAP_FAILED);
+    const statusjournal::JournalService & service = statusjournal::journalServices(static_cast<const statusjournal::JournalHeader *>(address))[0];
+    REQUIRE(std::string(service.serviceName) == "journal-service");
+    REQUIRE(service.sequence.load() == 4 * updates);
+    munmap(address, info.st_size);
+}
+
+TEST_CASE( "Journal plugin writer killed during an update", "[statusjournal]-stalled" ) {
+    TestJournal journal("64", "none");
+    fty::ServiceStatusPluginWrapper plugin(JOURNAL_PLUGIN_PATH);
+    fty::ServiceStatusProviderPtr provider = plugin.newServiceStatusProviderPtr("stalled-service");
+    REQUIRE(provider->set(fty::OperatingStatus::InService) == 0);
+
+    //a writer died with the sequence of the last status odd, and another process while naming the next service
+    int fd = open(journal.path.c_str(), O_RDWR);
+    REQUIRE(fd >= 0);
+    struct stat info;
+    REQUIRE(fstat(fd, &info) == 0);
+    void * address = mmap(nullptr, info.st_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    REQUIRE(address != MAP_FAILED);
+    statusjournal::JournalService * services = statusjournal::journalServices(static_cast<statusjournal::JournalHeader *>(address));
+    services[0].sequence.fetch_add(1);
+    services[1].state.store(statusjournal::SERVICE_CLAIMED);
+
+    //the readers give up waiting and report the last status
+    statusjournal::JournalReader reader(journal.path);
+    statusjournal::JournalEntry entry;
+    REQUIRE(reader.lastStatus("stalled-service", entry));
+    REQUIRE(entry.stalled);
+    REQUIRE(entry.operatingStatus == fty::OperatingStatus::InService);
+
+    //the next writer takes the service over and reports it
+    REQUIRE(provider->set(fty::HealthState::Ok) == -EOWNERDEAD);
+    REQUIRE(provider->set(fty::HealthState::Warning) == 0);
+    REQUIRE(reader.lastStatus("stalled-service", entry));
+    REQUIRE_FALSE(entry.stalled);
+    REQUIRE(entry.healthState == fty::HealthState::Warning);
+
+    //the service left claimed is skipped
+    fty::ServiceStatusProviderPtr other = plugin.newServiceStatusProviderPtr("other-service");
+    REQUIRE(std::string(services[2].serviceName) == "other-service");
+    munmap(address, info.st_size);
+}
+
+TEST_CASE( "Journal ring keeps the last transitions", "[statusjournal]-ring" ) {
+    TestJournal journal("16", "none");
+    fty::ServiceStatusPluginWrapperCollection statusProviders("journal-service");
+    statusProviders.add(JOURNAL_PLUGIN_PATH);
+
+    for(unsigned i = 0; i < 40; i++) {
+        statusProviders.setForAll((i % 2 == 0) ? fty::HealthState::Ok : fty::HealthState::MajorFailure);
+    }
+
+    statusjournal::JournalReader reader(journal.path);
+    REQUIRE(reader.getNextSequence() == 40);
+    REQUIRE(reader.getOldestSequence() == 24);
+
+    std::vector<statusjournal::JournalEntry> entries;
+    std::uint64_t lost = 0;
+    REQUIRE(reader.read(0, entries, lost, 10) == 34);
+    REQUIRE(lost == 24);
+    REQUIRE(entries.size() == 10);
+    REQUIRE(entries[0].sequence == 24);
+    REQUIRE(entries[0].healthState == fty::HealthState::Ok);
+
+    REQUIRE(reader.read(34, entries, lost) == 40);
+    REQUIRE(entries.size() == 16);
+    REQUIRE(entries.back().healthState == fty::HealthState::MajorFailure);
+
+    //the file has a bounded size
+    std::ifstream file(journal.path, std::ios::binary | std::ios::ate);
+    REQUIRE(static_cast<std::size_t>(file.tellg()) == statusjournal::journalSize(8, 16));
+}
+
+TEST_CASE( "Journal plugin replaces an invalid journal", "[statusjournal]-invalid" ) {
+    TestJournal journal("16", "none");
+    std::ofstream(journal.path) << "not a journal, long enough to look like a header of a journal file";
+
+    REQUIRE_THROWS_AS(statusjournal::JournalReader(journal.path), std::runtime_error);
+
+    fty::ServiceStatusPluginWrapperCollection statusProviders("journal-service");
+    statusProviders.add(JOURNAL_PLUGIN_PATH);
+    statusProviders.setForAll(fty::OperatingStatus::InService);
+
+    statusjournal::JournalReader reader(journal.path);
+    REQUIRE(reader.getNextSequence() == 1);
+}
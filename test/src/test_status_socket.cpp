@@ -0,0 +1,252 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+
+//Tests of the status socket plugin and of the aggregator
+
+#include <fty_service_status.h>
+#include <status_aggregator.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include <dlfcn.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <catch2/catch.hpp>
+
+static const std::string SOCKET_PLUGIN_PATH = "../status-socket/libfty-service-status-socket.so";
+
+//use a socket private to the test process
+class TestSocket
+{
+    public:
+    const std::string path;
+
+    TestSocket() : path("/tmp/fty-service-status-test-" + std::to_string(getpid()) + ".sock") {
+        setenv(statussocket::SOCKET_PATH_ENV, path.c_str(), 1);
+    }
+
+    ~TestSocket() {
+        unsetenv(statussocket::SOCKET_PATH_ENV);
+        unlink(path.c_str());
+    }
+};
+
+//counters of the plugin, the plugin is kept loaded while the object exists
+class SocketPluginCounters
+{
+    using FctGetCount = std::uint64_t(*)();
+
+    private:
+    void * m_handle;
+    FctGetCount m_getSent;
+    FctGetCount m_getDropped;
+
+    public:
+    SocketPluginCounters() {
+        m_handle = dlopen(SOCKET_PLUGIN_PATH.c_str(), RTLD_NOW);
+        if(m_handle == nullptr) {
+            throw std::runtime_error("Cannot load plugin: " + std::string(dlerror()));
+        }
+        m_getSent = reinterpret_cast<FctGetCount>(dlsym(m_handle, "statusSocketGetSentCount"));
+        m_getDropped = reinterpret_cast<FctGetCount>(dlsym(m_handle, "statusSocketGetDroppedCount"));
+        if(m_getSent == nullptr || m_getDropped == nullptr) {
+            dlclose(m_handle);
+            throw std::runtime_error("Cannot load the counters of the status socket plugin");
+        }
+    }
+
+    SocketPluginCounters(const SocketPluginCounters &) = delete;
+    SocketPluginCounters & operator=(const SocketPluginCounters &) = delete;
+
+    ~SocketPluginCounters() {
+        dlclose(m_handle);
+    }
+
+    std::uint64_t getSent() const { return m_getSent(); }
+    std::uint64_t getDropped() const { return m_getDropped(); }
+};
+
+//wait until the aggregator received a number of datagrams
+static bool waitForReceived(const statussocket::Aggregator & aggregator, std::uint64_t received) {
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while(aggregator.getStats().received < received) {
+        if(std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+TEST_CASE( "Status socket aggregation", "[statussocket::Aggregator]" ) {
+    TestSocket socket;
+    statussocket::Aggregator aggregator;
+    REQUIRE(aggregator.getSocketPath() == socket.path);
+    REQUIRE(aggregator.getQueryPath() == socket.path + statussocket::QUERY_SOCKET_SUFFIX);
+
+    fty::ServiceStatusPluginWrapperCollection statusProviders("socket-service");
+    statusProviders.add(SOCKET_PLUGIN_PATH);
+    statusProviders.setForAll(fty::OperatingStatus::InService);
+    statusProviders.setForAll(fty::HealthState::Warning);
+    REQUIRE(waitForReceived(aggregator, 2));
+
+    statussocket::AggregatorEntry entry;
+    REQUIRE(aggregator.find("socket-service", entry));
+    REQUIRE(entry.serviceName == "socket-service");
+    REQUIRE(entry.operatingStatus == fty::OperatingStatus::InService);
+    REQUIRE(entry.healthState == fty::HealthState::Warning);
+    REQUIRE(entry.pid == static_cast<std::uint32_t>(getpid()));
+    REQUIRE(entry.updates == 2);
+    REQUIRE(entry.updateTime != 0);
+    REQUIRE_FALSE(aggregator.find("other-service", entry));
+
+    //the snapshot served to the other processes
+    fty::ServiceStatusPluginWrapper plugin(SOCKET_PLUGIN_PATH);
+    fty::ServiceStatusProviderPtr other = plugin.newServiceStatusProviderPtr("another\tservice");
+    other->set(fty::OperatingStatus::Stopped);
+    REQUIRE(waitForReceived(aggregator, 3));
+
+    std::vector<statussocket::AggregatorEntry> entries = statussocket::querySnapshot(socket.path);
+    REQUIRE(entries.size() == 2);
+    REQUIRE(entries[0].serviceName == "another\tservice");
+    REQUIRE(entries[0].operatingStatus == fty::OperatingStatus::Stopped);
+    REQUIRE(entries[0].healthState == fty::HealthState::Unknown);
+    REQUIRE(entries[1].serviceName == "socket-service");
+    REQUIRE(entries[1].healthState == fty::HealthState::Warning);
+    REQUIRE(entries[1].updateTime == entry.updateTime);
+    REQUIRE(entries[1].updates == 2);
+    REQUIRE(aggregator.getStats().queries == 1);
+
+    //the name must fit in a datagram
+    REQUIRE_THROWS_AS(plugin.newServiceStatusProviderPtr(std::string(statussocket::SERVICE_NAME_SIZE, 'x')), std::runtime_error);
+    REQUIRE_THROWS_AS(plugin.newServiceStatusProviderPtr(""), std::runtime_error);
+}
+
+TEST_CASE( "Status socket invalid datagrams", "[statussocket::Aggregator]-invalid" ) {
+    TestSocket socket;
+    statussocket::Aggregator aggregator;
+
+    struct sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socket.path.c_str(), sizeof(address.sun_path) - 1);
+
+    int fd = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+    REQUIRE(fd >= 0);
+    const char garbage[] = "not a status message, but long enough to have a header";
+    REQUIRE(sendto(fd, garbage, sizeof(garbage), 0, reinterpret_cast<const struct sockaddr *>(&address), sizeof(address)) > 0);
+    REQUIRE(sendto(fd, garbage, 4, 0, reinterpret_cast<const struct sockaddr *>(&address), sizeof(address)) > 0);
+    close(fd);
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    while(aggregator.getStats().invalid < 2 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    REQUIRE(aggregator.getStats().invalid == 2);
+    REQUIRE(aggregator.getStats().received == 0);
+    REQUIRE(aggregator.snapshot().empty());
+}
+
+TEST_CASE( "Status socket concurrent updates", "[statussocket::ServiceStatusSocket]-concurrent" ) {
+    TestSocket socket;
+    statussocket::Aggregator aggregator;
+
+    fty::ServiceStatusPluginWrapper plugin(SOCKET_PLUGIN_PATH);
+    fty::ServiceStatusProviderPtr provider = plugin.newServiceStatusProviderPtr("shared-service");
+
+    //one thread sets the Operating Status while another sets the Health State of the same provider
+    const unsigned updates = 2000;
+    std::thread healthThread([&]() {
+        for(unsigned i = 0; i < updates; i++) {
+            provider->set((i % 2 == 0) ? fty::HealthState::Warning : fty::HealthState::Ok);
+        }
+    });
+    for(unsigned i = 0; i < updates; i++) {
+        provider->set((i % 2 == 0) ? fty::OperatingStatus::Stopping : fty::OperatingStatus::InService);
+    }
+    healthThread.join();
+
+    //each datagram carries both status: a new one has the last value of each, it is sent again if the socket was full
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+    statussocket::AggregatorEntry entry;
+    provider->set(fty::OperatingStatus::InService);
+    while((!aggregator.find("shared-service", entry) || entry.operatingStatus != fty::OperatingStatus::InService
+            || entry.healthState != fty::HealthState::Ok) && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        provider->set(fty::OperatingStatus::InService);
+    }
+    REQUIRE(entry.operatingStatus == fty::OperatingStatus::InService);
+    REQUIRE(entry.healthState == fty::HealthState::Ok);
+    REQUIRE(aggregator.getStats().invalid == 0);
+}
+
+TEST_CASE( "Status socket without aggregator", "[statussocket::ServiceStatusSocket]-unreachable" ) {
+    TestSocket socket;
+    SocketPluginCounters counters;
+
+    fty::ServiceStatusPluginWrapper plugin(SOCKET_PLUGIN_PATH);
+    fty::ServiceStatusProviderPtr provider = plugin.newServiceStatusProviderPtr("lonely-service");
+
+    const std::uint64_t dropped = counters.getDropped();
+    REQUIRE(provider->set(fty::HealthState::Ok) == -1);
+    REQUIRE(counters.getDropped() == dropped + 1);
+    REQUIRE_FALSE(plugin.getPluginLastError().empty());
+
+    //the aggregator can be started after the services
+    statussocket::Aggregator aggregator;
+    REQUIRE(provider->set(fty::HealthState::Ok) == 0);
+    REQUIRE(waitForReceived(aggregator, 1));
+}
+
+TEST_CASE( "Status socket full", "[statussocket::ServiceStatusSocket]-full" ) {
+    TestSocket socket;
+    SocketPluginCounters counters;
+
+    //a receiver which never reads
+    struct sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    std::strncpy(address.sun_path, socket.path.c_str(), sizeof(address.sun_path) - 1);
+    int fd = ::socket(AF_UNIX, SOCK_DGRAM, 0);
+    REQUIRE(fd >= 0);
+    REQUIRE(bind(fd, reinterpret_cast<const struct sockaddr *>(&address), sizeof(address)) == 0);
+
+    fty::ServiceStatusPluginWrapper plugin(SOCKET_PLUGIN_PATH);
+    fty::ServiceStatusProviderPtr provider = plugin.newServiceStatusProviderPtr("busy-service");
+
+    //the updates never block and never fail, the datagrams which do not fit are counted
+    const std::uint64_t sent = counters.getSent();
+    const std::uint64_t dropped = counters.getDropped();
+    const unsigned updates = 10000;
+    unsigned failures = 0;
+    for(unsigned i = 0; i < updates; i++) {
+        failures += (provider->set((i % 2 == 0) ? fty::HealthState::Ok : fty::HealthState::Warning) != 0) ? 1 : 0;
+    }
+    close(fd);
+
+    REQUIRE(failures == 0);
+    REQUIRE(counters.getDropped() > dropped);
+    REQUIRE(counters.getSent() > sent);
+    REQUIRE((counters.getSent() - sent) + (counters.getDropped() - dropped) == updates);
+}
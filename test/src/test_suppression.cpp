@@ -0,0 +1,117 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+
+//Tests of the change suppression and of the coalescing of ServiceStatusPluginWrapperCollection
+
+#include <fty_service_status.h>
+
+#include "test_plugins.h"
+
+#include <catch2/catch.hpp>
+
+TEST_CASE( "Test change suppression is disabled by default", "[fty::ServiceStatusPluginWrapperCollection]-noSuppression" ) {
+    SleepPluginControl control;
+
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    REQUIRE_NOTHROW(collection.add(SLEEP_PLUGIN_PATH));
+    REQUIRE_FALSE(collection.isChangeSuppressionEnabled());
+
+    collection.setForAll(fty::HealthState::Ok);
+    collection.setForAll(fty::HealthState::Ok);
+
+    REQUIRE(control.getSetCount() == 2);
+    REQUIRE(collection.getSuppressedUpdateCount() == 0);
+}
+
+TEST_CASE( "Test change suppression skips unchanged values", "[fty::ServiceStatusPluginWrapperCollection]-suppression" ) {
+    SleepPluginControl control;
+
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    collection.enableChangeSuppression();
+    REQUIRE(collection.isChangeSuppressionEnabled());
+
+    //plugins added after enabling are also filtered
+    REQUIRE_NOTHROW(collection.add(SLEEP_PLUGIN_PATH));
+
+    for(int i = 0; i < 5; i++) {
+        collection.setForAll(fty::HealthState::Ok);
+        collection.setForAll(fty::OperatingStatus::InService);
+    }
+    REQUIRE(control.getSetCount() == 2);
+    REQUIRE(collection.getSuppressedUpdateCount() == 8);
+
+    collection.setForAll(fty::HealthState::Warning);
+    REQUIRE(control.getSetCount() == 3);
+    REQUIRE(control.getLastHealthState() == static_cast<int>(fty::HealthState::Warning));
+
+    collection.disableChangeSuppression();
+    collection.setForAll(fty::HealthState::Warning);
+    REQUIRE(control.getSetCount() == 4);
+}
+
+TEST_CASE( "Test change suppression retries failed updates", "[fty::ServiceStatusPluginWrapperCollection]-suppressionError" ) {
+    SleepPluginControl control;
+    control.configure(0, -1);
+
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    REQUIRE_NOTHROW(collection.add(SLEEP_PLUGIN_PATH));
+    collection.enableChangeSuppression();
+
+    collection.setForAll(fty::OperatingStatus::Starting);
+    collection.setForAll(fty::OperatingStatus::Starting);
+    REQUIRE(control.getSetCount() == 2);
+
+    control.configure(0, 0);
+    collection.setForAll(fty::OperatingStatus::Starting);
+    collection.setForAll(fty::OperatingStatus::Starting);
+    REQUIRE(control.getSetCount() == 3);
+    REQUIRE(collection.getSuppressedUpdateCount() == 1);
+}
+
+TEST_CASE( "Test coalescing of pending updates", "[fty::ServiceStatusPluginWrapperCollection]-coalescing" ) {
+    SleepPluginControl control;
+    control.configure(50000);
+
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    REQUIRE_NOTHROW(collection.add(SLEEP_PLUGIN_PATH));
+    collection.enableChangeSuppression();
+    REQUIRE_NOTHROW(collection.enableAsyncDispatch());
+
+    collection.setForAll(fty::OperatingStatus::Starting);
+    //wait for the dispatcher to be busy with the first update
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    //burst while the provider is busy
+    collection.setForAll(fty::HealthState::Ok);
+    collection.setForAll(fty::OperatingStatus::Transitioning);
+    collection.setForAll(fty::HealthState::Warning);
+    collection.setForAll(fty::OperatingStatus::InService);
+
+    REQUIRE(collection.flush(std::chrono::milliseconds(5000)));
+    REQUIRE(control.getSetCount() == 3);
+    REQUIRE(collection.getCoalescedUpdateCount() == 2);
+    REQUIRE(control.getLastOperatingStatus() == static_cast<int>(fty::OperatingStatus::InService));
+    REQUIRE(control.getLastHealthState() == static_cast<int>(fty::HealthState::Warning));
+
+    //the burst ends on an unchanged value
+    collection.setForAll(fty::OperatingStatus::InService);
+    REQUIRE(collection.flush(std::chrono::milliseconds(5000)));
+    REQUIRE(control.getSetCount() == 3);
+    REQUIRE(collection.getSuppressedUpdateCount() == 1);
+}
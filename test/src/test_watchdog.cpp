@@ -0,0 +1,154 @@
+/*  ========================================================================
+    Copyright (C) 2020 Eaton
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License along
+    with this program; if not, write to the Free Software Foundation, Inc.,
+    51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+    ========================================================================
+*/
+
+//Tests of the watchdog and of the quarantine of ServiceStatusPluginWrapperCollection
+
+#include <fty_service_status.h>
+
+#include "test_plugins.h"
+
+#include <chrono>
+#include <thread>
+
+#include <catch2/catch.hpp>
+
+//wait until the condition is true or the timeout expires
+template<typename Condition>
+static bool waitFor(Condition condition, std::chrono::milliseconds timeout = std::chrono::milliseconds(5000)) {
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + timeout;
+    while(!condition()) {
+        if(std::chrono::steady_clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+static fty::WatchdogSettings fastWatchdog() {
+    fty::WatchdogSettings settings;
+    settings.latencyBudget = std::chrono::milliseconds(20);
+    settings.maxConsecutiveErrors = 3;
+    settings.initialBackoff = std::chrono::milliseconds(10);
+    settings.maxBackoff = std::chrono::milliseconds(40);
+    settings.checkPeriod = std::chrono::milliseconds(2);
+    return settings;
+}
+
+TEST_CASE( "Test watchdog requires the asynchronous dispatch", "[fty::ServiceStatusPluginWrapperCollection]-watchdogEnable" ) {
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    REQUIRE_NOTHROW(collection.add(SLEEP_PLUGIN_PATH));
+
+    REQUIRE_THROWS(collection.setLatencyBudget(SLEEP_PLUGIN_NAME, std::chrono::milliseconds(10)));
+
+    REQUIRE_THROWS_AS(collection.enableWatchdog(), std::runtime_error);
+    REQUIRE_FALSE(collection.isWatchdogEnabled());
+    REQUIRE_FALSE(collection.isAsyncDispatchEnabled());
+
+    REQUIRE_NOTHROW(collection.enableAsyncDispatch());
+    REQUIRE_NOTHROW(collection.enableWatchdog());
+    REQUIRE(collection.isWatchdogEnabled());
+    REQUIRE_THROWS(collection.setLatencyBudget("unknown", std::chrono::milliseconds(10)));
+
+    collection.disableAsyncDispatch();
+    REQUIRE_FALSE(collection.isWatchdogEnabled());
+
+    fty::WatchdogSettings invalid;
+    invalid.latencyBudget = std::chrono::milliseconds(0);
+    REQUIRE_THROWS(collection.enableWatchdog(invalid));
+    REQUIRE_FALSE(collection.isWatchdogEnabled());
+}
+
+TEST_CASE( "Test watchdog quarantines a blocked plugin", "[fty::ServiceStatusPluginWrapperCollection]-watchdogBlocked" ) {
+    SleepPluginControl control;
+    control.configure(300000);
+
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    REQUIRE_NOTHROW(collection.add(SLEEP_PLUGIN_PATH));
+    REQUIRE_NOTHROW(collection.enableAsyncDispatch());
+    REQUIRE_NOTHROW(collection.enableWatchdog(fastWatchdog()));
+
+    collection.setForAll(fty::OperatingStatus::Starting);
+
+    //quarantined while the call is still blocked
+    REQUIRE(waitFor([&] { return collection.isQuarantined(SLEEP_PLUGIN_NAME); }));
+    REQUIRE(control.getSetCount() == 0);
+    REQUIRE(collection.getQuarantinedPlugins().size() == 1);
+    REQUIRE(collection.getQuarantineCount(SLEEP_PLUGIN_NAME) == 1);
+
+    //updates are skipped without waiting
+    collection.setForAll(fty::OperatingStatus::InService);
+    collection.setForAll(fty::HealthState::Ok);
+    REQUIRE(collection.getSkippedUpdateCount() == 2);
+
+    //the plugin recovers, the probe delivers the last values and reinstates it
+    control.configure(0);
+    REQUIRE(waitFor([&] { return !collection.isQuarantined(SLEEP_PLUGIN_NAME); }));
+    REQUIRE(collection.flush(std::chrono::milliseconds(5000)));
+    REQUIRE(control.getLastOperatingStatus() == static_cast<int>(fty::OperatingStatus::InService));
+    REQUIRE(control.getLastHealthState() == static_cast<int>(fty::HealthState::Ok));
+    REQUIRE(collection.getQuarantinedPlugins().empty());
+}
+
+TEST_CASE( "Test watchdog quarantines a failing plugin", "[fty::ServiceStatusPluginWrapperCollection]-watchdogErrors" ) {
+    SleepPluginControl control;
+    control.configure(0, -1);
+
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    REQUIRE_NOTHROW(collection.add(SLEEP_PLUGIN_PATH));
+    REQUIRE_NOTHROW(collection.enableAsyncDispatch());
+    REQUIRE_NOTHROW(collection.enableWatchdog(fastWatchdog()));
+
+    for(int i = 0; i < 3; i++) {
+        collection.setForAll(fty::HealthState::MajorFailure);
+    }
+    REQUIRE(collection.flush(std::chrono::milliseconds(5000)));
+    REQUIRE(collection.isQuarantined(SLEEP_PLUGIN_NAME));
+
+    //failed probes keep it in quarantine
+    unsigned long calls = control.getSetCount();
+    REQUIRE(waitFor([&] { return control.getSetCount() > calls + 1; }));
+    REQUIRE(collection.isQuarantined(SLEEP_PLUGIN_NAME));
+    REQUIRE(collection.getQuarantineCount(SLEEP_PLUGIN_NAME) == 1);
+
+    control.configure(0, 0);
+    REQUIRE(waitFor([&] { return !collection.isQuarantined(SLEEP_PLUGIN_NAME); }));
+
+    collection.disableWatchdog();
+    REQUIRE_FALSE(collection.isWatchdogEnabled());
+    REQUIRE(collection.isAsyncDispatchEnabled());
+}
+
+TEST_CASE( "Test watchdog per plugin latency budget", "[fty::ServiceStatusPluginWrapperCollection]-watchdogBudget" ) {
+    SleepPluginControl control;
+    control.configure(30000);
+
+    fty::ServiceStatusPluginWrapperCollection collection("test-service");
+    REQUIRE_NOTHROW(collection.add(SLEEP_PLUGIN_PATH));
+    REQUIRE_NOTHROW(collection.enableAsyncDispatch());
+    REQUIRE_NOTHROW(collection.enableWatchdog(fastWatchdog()));
+    REQUIRE_NOTHROW(collection.setLatencyBudget(SLEEP_PLUGIN_NAME, std::chrono::milliseconds(1000)));
+
+    collection.setForAll(fty::HealthState::Ok);
+    collection.setForAll(fty::HealthState::Warning);
+    REQUIRE(collection.flush(std::chrono::milliseconds(5000)));
+
+    REQUIRE_FALSE(collection.isQuarantined(SLEEP_PLUGIN_NAME));
+    REQUIRE(control.getSetCount() == 2);
+}